@@ -0,0 +1,36 @@
+#pragma once
+
+#include <fmt/core.h>
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace homeshell::bench
+{
+
+/**
+ * @brief Run an operation repeatedly and print its mean latency
+ * @param label Name printed in the result row
+ * @param iterations Number of times to run the operation
+ * @param op Callable invoked with the iteration index
+ * @return Mean latency in nanoseconds per operation
+ */
+template <typename Op>
+double measure(const std::string& label, int64_t iterations, Op&& op)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int64_t i = 0; i < iterations; ++i)
+    {
+        op(i);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    double ns_per_op =
+        static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) /
+        static_cast<double>(iterations);
+    fmt::print("  {:<40} {:>12.0f} ns/op  ({} ops)\n", label, ns_per_op, iterations);
+    return ns_per_op;
+}
+
+} // namespace homeshell::bench
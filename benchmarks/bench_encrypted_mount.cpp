@@ -0,0 +1,220 @@
+/**
+ * @file bench_encrypted_mount.cpp
+ * @brief Per-operation latency of EncryptedMount metadata and file calls
+ *
+ * Populates a temporary mount and times the calls that `tree`, `find` and
+ * tab completion issue in tight loops. The "prepare per call" rows replay
+ * the same queries the way EncryptedMount used to run them (prepare, step,
+ * finalize on every call) on a second connection, as a before/after
+ * reference for the statement cache. The "threads" rows spread reads over
+ * several threads, with and without the pooled reader connections. The
+ * append rows compare appendFile() with rewriting the whole file.
+ *
+ * Usage: homeshell_bench_encrypted_mount [file_count]
+ */
+
+#include "BenchmarkUtils.hpp"
+
+#include <homeshell/EncryptedMount.hpp>
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+using homeshell::bench::measure;
+
+namespace
+{
+
+const std::string kPassword = "benchmark";
+
+bool existsPreparePerCall(sqlite3* db, const std::string& path)
+{
+    sqlite3_stmt* stmt;
+    bool found = false;
+    if (sqlite3_prepare_v2(db, "SELECT 1 FROM files WHERE path = ? LIMIT 1", -1, &stmt,
+                           nullptr) == SQLITE_OK)
+    {
+        sqlite3_bind_text(stmt, 1, path.c_str(), -1, SQLITE_STATIC);
+        found = (sqlite3_step(stmt) == SQLITE_ROW);
+        sqlite3_finalize(stmt);
+    }
+    if (found)
+    {
+        return true;
+    }
+    if (sqlite3_prepare_v2(db, "SELECT 1 FROM directories WHERE path = ? LIMIT 1", -1, &stmt,
+                           nullptr) == SQLITE_OK)
+    {
+        sqlite3_bind_text(stmt, 1, path.c_str(), -1, SQLITE_STATIC);
+        found = (sqlite3_step(stmt) == SQLITE_ROW);
+        sqlite3_finalize(stmt);
+    }
+    return found;
+}
+
+bool isDirectoryPreparePerCall(sqlite3* db, const std::string& path)
+{
+    sqlite3_stmt* stmt;
+    bool found = false;
+    if (sqlite3_prepare_v2(db, "SELECT 1 FROM directories WHERE path = ? LIMIT 1", -1, &stmt,
+                           nullptr) == SQLITE_OK)
+    {
+        sqlite3_bind_text(stmt, 1, path.c_str(), -1, SQLITE_STATIC);
+        found = (sqlite3_step(stmt) == SQLITE_ROW);
+        sqlite3_finalize(stmt);
+    }
+    return found;
+}
+
+/**
+ * @brief Time reads spread over several threads and print the mean wall time per read
+ * @param label Name printed in the result row
+ * @param mount Mount to read from
+ * @param paths Files to read, round-robin
+ * @param threads Number of reader threads
+ * @param reads Total number of reads
+ */
+void measureParallelReads(const std::string& label, homeshell::EncryptedMount& mount,
+                          const std::vector<std::string>& paths, int threads, int64_t reads)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t)
+    {
+        workers.emplace_back(
+            [&, t]
+            {
+                std::string content;
+                for (int64_t i = t; i < reads; i += threads)
+                {
+                    mount.readFile(paths[static_cast<size_t>(i) % paths.size()], content);
+                }
+            });
+    }
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    double ns_per_op =
+        static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) /
+        static_cast<double>(reads);
+    fmt::print("  {:<40} {:>12.0f} ns/op  ({} ops)\n", label, ns_per_op, reads);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    int64_t file_count = argc > 1 ? std::stoll(argv[1]) : 1000;
+
+    auto dir = std::filesystem::temp_directory_path() / "homeshell_bench_mount";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    auto db_path = (dir / "bench.db").string();
+
+    homeshell::EncryptedMount mount("bench", db_path, "/bench", 1024);
+    if (!mount.mount(kPassword))
+    {
+        fmt::print(stderr, "Failed to mount benchmark database\n");
+        return 1;
+    }
+
+    std::vector<std::string> paths;
+    for (int64_t i = 0; i < file_count; ++i)
+    {
+        paths.push_back(fmt::format("/dir{}/file{}.txt", i % 10, i));
+        mount.writeFile(paths.back(), std::string(256, 'x'));
+    }
+
+    fmt::print("EncryptedMount latency ({} files)\n\n", file_count);
+
+    int64_t iterations = file_count * 10;
+    auto pick = [&](int64_t i) -> const std::string& {
+        return paths[static_cast<size_t>(i) % paths.size()];
+    };
+
+    measure("exists (cached statement)", iterations, [&](int64_t i) { mount.exists(pick(i)); });
+    measure("isDirectory (cached statement)", iterations,
+            [&](int64_t i) { mount.isDirectory(pick(i)); });
+    measure("getFileSize (cached statement)", iterations,
+            [&](int64_t i) { mount.getFileSize(pick(i)); });
+
+    std::string content;
+    measure("readFile 256 B", iterations, [&](int64_t i) { mount.readFile(pick(i), content); });
+    measure("writeFile 256 B", file_count,
+            [&](int64_t i) { mount.writeFile(pick(i), std::string(256, 'y')); });
+    mount.beginBatch();
+    measure("writeFile 256 B (batched)", file_count,
+            [&](int64_t i) { mount.writeFile(pick(i), std::string(256, 'z')); });
+    mount.endBatch();
+    measure("listDirectory", 100,
+            [&](int64_t i) { mount.listDirectory("/dir" + std::to_string(i % 10)); });
+
+    // Sequential 4 KiB reads through a 4 MiB file, with and without the chunk cache
+    const int64_t kStreamSize = 4 * 1024 * 1024;
+    const int64_t kStreamRead = 4096;
+    mount.writeFile("/stream.bin", std::string(static_cast<size_t>(kStreamSize), 's'));
+    measure("readFileRange 4 KiB sequential", kStreamSize / kStreamRead,
+            [&](int64_t i)
+            { mount.readFileRange("/stream.bin", i * kStreamRead, kStreamRead, content); });
+
+    homeshell::MountOptions uncached;
+    uncached.chunk_cache_bytes = 0;
+    homeshell::EncryptedMount uncached_mount("bench", db_path, "/bench", 1024, uncached);
+    if (uncached_mount.mount(kPassword))
+    {
+        measure("readFileRange 4 KiB sequential (no cache)", kStreamSize / kStreamRead,
+                [&](int64_t i)
+                {
+                    uncached_mount.readFileRange("/stream.bin", i * kStreamRead, kStreamRead,
+                                                 content);
+                });
+        uncached_mount.unmount();
+    }
+
+    // Appending a line to a 4 MiB log: tail-only append versus read-modify-write
+    const std::string line(100, 'l');
+    mount.writeFile("/append.log", std::string(static_cast<size_t>(kStreamSize), 'a'));
+    measure("appendFile 100 B (4 MiB file)", 200,
+            [&](int64_t) { mount.appendFile("/append.log", line); });
+    measure("readFile + writeFile 100 B (4 MiB file)", 20,
+            [&](int64_t)
+            {
+                mount.readFile("/append.log", content);
+                mount.writeFile("/append.log", content + line);
+            });
+
+    // Concurrent readers on the pooled connections versus the writer alone
+    measureParallelReads("readFile 256 B (4 threads)", mount, paths, 4, iterations);
+    homeshell::MountOptions writer_only;
+    writer_only.read_connections = 0;
+    homeshell::EncryptedMount serial_mount("bench", db_path, "/bench", 1024, writer_only);
+    if (serial_mount.mount(kPassword))
+    {
+        measureParallelReads("readFile 256 B (4 threads, writer only)", serial_mount, paths, 4,
+                             iterations);
+        serial_mount.unmount();
+    }
+
+    // Reference: the same lookups with a prepare/finalize per call
+    sqlite3* db = nullptr;
+    if (sqlite3_open(db_path.c_str(), &db) == SQLITE_OK &&
+        sqlite3_key(db, kPassword.c_str(), static_cast<int>(kPassword.size())) == SQLITE_OK)
+    {
+        fmt::print("\nReference\n\n");
+        measure("exists (prepare per call)", iterations,
+                [&](int64_t i) { existsPreparePerCall(db, pick(i)); });
+        measure("isDirectory (prepare per call)", iterations,
+                [&](int64_t i) { isDirectoryPreparePerCall(db, pick(i)); });
+    }
+    sqlite3_close(db);
+
+    mount.unmount();
+    std::filesystem::remove_all(dir);
+    return 0;
+}
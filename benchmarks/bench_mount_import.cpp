@@ -0,0 +1,122 @@
+/**
+ * @file bench_mount_import.cpp
+ * @brief Throughput of importing a directory tree into an encrypted mount
+ *
+ * Generates a tree of files in the system temp directory and imports it
+ * into a fresh mount three ways:
+ * - writeFile per file: each file read and written with its own commit, the
+ *   way copying file by file into a mount works
+ * - importDirectory with one reader thread and with several, committing in
+ *   large batches while the readers run ahead of the writer
+ *
+ * Usage: homeshell_bench_mount_import [file_count] [file_kb]
+ */
+
+#include <homeshell/EncryptedMount.hpp>
+#include <homeshell/MountImport.hpp>
+
+#include <fmt/core.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <string>
+
+namespace
+{
+
+const std::string kPassword = "benchmark";
+
+void run(const std::string& label, const std::filesystem::path& dir, int64_t total_bytes,
+         const std::function<bool(homeshell::EncryptedMount&)>& import)
+{
+    auto db_path = (dir / "import.db").string();
+    std::filesystem::remove(db_path);
+    std::filesystem::remove(db_path + "-wal");
+    std::filesystem::remove(db_path + "-shm");
+
+    homeshell::EncryptedMount mount("bench", db_path, "/bench", total_bytes / 1024 / 1024 * 2 + 64);
+    if (!mount.mount(kPassword))
+    {
+        fmt::print("  {:<32} failed to mount\n", label);
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    bool ok = import(mount);
+    double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    mount.unmount();
+
+    fmt::print("  {:<32} {:>10.2f} s {:>10.1f} MB/s{}\n", label, seconds,
+               total_bytes / (1024.0 * 1024.0) / seconds, ok ? "" : "  (failed)");
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    int64_t file_count = argc > 1 ? std::stoll(argv[1]) : 500;
+    int64_t file_kb = argc > 2 ? std::stoll(argv[2]) : 256;
+
+    auto dir = std::filesystem::temp_directory_path() / "homeshell_bench_import";
+    auto source = dir / "source";
+    std::filesystem::remove_all(dir);
+
+    // Random content, so neither compression nor dedup could flatter the result
+    std::mt19937_64 rng(7);
+    std::string content(static_cast<size_t>(file_kb * 1024), '\0');
+    for (int64_t i = 0; i < file_count; ++i)
+    {
+        for (auto& c : content)
+        {
+            c = static_cast<char>(rng() & 0xff);
+        }
+        auto path = source / fmt::format("dir{}", i % 20) / fmt::format("file{}.bin", i);
+        std::filesystem::create_directories(path.parent_path());
+        std::ofstream(path, std::ios::binary).write(content.data(), content.size());
+    }
+    int64_t total_bytes = file_count * file_kb * 1024;
+
+    fmt::print("Import of {} files x {} KiB into an encrypted mount\n\n", file_count, file_kb);
+
+    run("writeFile per file", dir, total_bytes,
+        [&](homeshell::EncryptedMount& mount)
+        {
+            std::string data;
+            for (const auto& entry : std::filesystem::recursive_directory_iterator(source))
+            {
+                if (!entry.is_regular_file())
+                {
+                    continue;
+                }
+                std::ifstream in(entry.path(), std::ios::binary);
+                data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+                auto target = "/" + entry.path().lexically_relative(source).generic_string();
+                if (!mount.writeFile(target, data))
+                {
+                    return false;
+                }
+            }
+            return true;
+        });
+
+    for (int workers : {1, 4})
+    {
+        run(fmt::format("importDirectory ({} reader{})", workers, workers > 1 ? "s" : ""), dir,
+            total_bytes,
+            [&](homeshell::EncryptedMount& mount)
+            {
+                homeshell::ImportOptions options;
+                options.workers = workers;
+                homeshell::ImportStats stats;
+                std::string error;
+                return homeshell::importDirectory(mount, source, "/", options, stats, error);
+            });
+    }
+
+    std::filesystem::remove_all(dir);
+    return 0;
+}
@@ -0,0 +1,147 @@
+/**
+ * @file bench_text_index.cpp
+ * @brief Content search in an encrypted mount with and without a text index
+ *
+ * Fills a mount with small notes of random words and searches it for a word
+ * that occurs in a handful of them, the way `grep -r` does:
+ * - full scan: every file read (decrypted) and searched
+ * - text index: EncryptedMount::findTextCandidates() first, then only the
+ *   candidates read and searched
+ * Also reports what the index costs when writing the notes.
+ *
+ * Usage: homeshell_bench_text_index [note_count]
+ */
+
+#include "BenchmarkUtils.hpp"
+
+#include <homeshell/EncryptedMount.hpp>
+
+#include <fmt/core.h>
+
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using homeshell::bench::measure;
+
+namespace
+{
+
+const std::string kPassword = "benchmark";
+const std::string kNeedle = "quasar";
+
+/**
+ * @brief Write the notes into a fresh mount and return it
+ */
+std::unique_ptr<homeshell::EncryptedMount> createMount(const std::filesystem::path& dir,
+                                                       int64_t note_count, bool text_index)
+{
+    auto db_path = (dir / (text_index ? "indexed.db" : "plain.db")).string();
+    std::filesystem::remove(db_path);
+
+    homeshell::MountOptions options;
+    options.text_index = text_index;
+    auto mount = std::make_unique<homeshell::EncryptedMount>("bench", db_path, "/bench", 1024,
+                                                             options);
+    if (!mount->mount(kPassword))
+    {
+        return nullptr;
+    }
+
+    const std::vector<std::string> words = {"alpha", "bravo", "charlie", "delta", "echo",
+                                            "foxtrot", "golf", "hotel", "india", "juliet",
+                                            "kilo", "lima", "mike", "november", "oscar"};
+    std::mt19937_64 rng(11);
+    auto start = std::chrono::steady_clock::now();
+    mount->beginBatch();
+    for (int64_t i = 0; i < note_count; ++i)
+    {
+        std::string note;
+        while (note.size() < 500)
+        {
+            note += words[rng() % words.size()];
+            note += (rng() % 12 == 0) ? "\n" : " ";
+        }
+        if (i % 10000 == 0)
+        {
+            note += kNeedle;
+        }
+        mount->writeFile(fmt::format("/notes/{}/note{}.txt", i % 100, i), note);
+    }
+    mount->endBatch();
+    double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    fmt::print("  {:<40} {:>12.2f} s\n",
+               text_index ? "write notes (text index)" : "write notes (no index)", seconds);
+    return mount;
+}
+
+int64_t searchFiles(homeshell::EncryptedMount& mount, const std::vector<std::string>& paths)
+{
+    int64_t hits = 0;
+    std::string content;
+    for (const auto& path : paths)
+    {
+        if (mount.readFile(path, content) && content.find(kNeedle) != std::string::npos)
+        {
+            ++hits;
+        }
+    }
+    return hits;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    int64_t note_count = argc > 1 ? std::stoll(argv[1]) : 50000;
+
+    auto dir = std::filesystem::temp_directory_path() / "homeshell_bench_text_index";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+
+    fmt::print("Search for one word in {} notes of 500 bytes\n\n", note_count);
+
+    auto plain = createMount(dir, note_count, false);
+    auto indexed = createMount(dir, note_count, true);
+    if (!plain || !indexed)
+    {
+        fmt::print("failed to mount\n");
+        return 1;
+    }
+    fmt::print("\n");
+
+    int64_t hits = 0;
+    measure("full scan", 3,
+            [&](int64_t)
+            {
+                homeshell::FileQuery query;
+                std::vector<homeshell::VirtualFileInfo> files;
+                plain->findFiles(query, files);
+                std::vector<std::string> paths;
+                for (const auto& info : files)
+                {
+                    paths.push_back(info.path);
+                }
+                hits = searchFiles(*plain, paths);
+            });
+    fmt::print("  {:<40} {:>12}\n", "matching files", hits);
+
+    std::vector<std::string> candidates;
+    measure("text index + confirm", 20,
+            [&](int64_t)
+            {
+                indexed->findTextCandidates("/", {kNeedle}, candidates);
+                hits = searchFiles(*indexed, candidates);
+            });
+    fmt::print("  {:<40} {:>12}\n", "candidates", candidates.size());
+    fmt::print("  {:<40} {:>12}\n", "matching files", hits);
+
+    plain.reset();
+    indexed.reset();
+    std::filesystem::remove_all(dir);
+    return 0;
+}
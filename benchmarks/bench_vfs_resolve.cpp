@@ -0,0 +1,165 @@
+/**
+ * @file bench_vfs_resolve.cpp
+ * @brief Latency of VirtualFilesystem::resolvePath() with 1, 10 and 100 mounts
+ *
+ * Resolves a mix of paths inside mounts, outside them and relative to the
+ * current directory. The "linear scan" rows replay the way resolvePath used
+ * to work (a substr per mount, a stringstream split per relative path) as a
+ * before/after reference for the mount trie and the string_view normaliser.
+ * Mounts are registered but never unlocked, so no database is touched.
+ *
+ * Usage: homeshell_bench_vfs_resolve [iterations]
+ */
+
+#include "BenchmarkUtils.hpp"
+
+#include <homeshell/EncryptedMount.hpp>
+#include <homeshell/VirtualFilesystem.hpp>
+
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using homeshell::bench::measure;
+
+namespace
+{
+
+struct LegacyMount
+{
+    std::string mount_point;
+    homeshell::EncryptedMount* mount;
+};
+
+std::string legacyNormalize(const std::string& cwd, const std::string& path)
+{
+    if (path.empty())
+    {
+        return cwd;
+    }
+    if (path[0] == '/')
+    {
+        return path;
+    }
+
+    std::string joined = cwd;
+    if (joined.back() != '/')
+    {
+        joined += "/";
+    }
+    joined += path;
+
+    std::vector<std::string> parts;
+    std::stringstream ss(joined);
+    std::string part;
+    while (std::getline(ss, part, '/'))
+    {
+        if (part.empty() || part == ".")
+        {
+            continue;
+        }
+        if (part == "..")
+        {
+            if (!parts.empty())
+            {
+                parts.pop_back();
+            }
+        }
+        else
+        {
+            parts.push_back(part);
+        }
+    }
+
+    if (parts.empty())
+    {
+        return "/";
+    }
+    std::string result;
+    for (const auto& p : parts)
+    {
+        result += "/" + p;
+    }
+    return result;
+}
+
+homeshell::ResolvedPath legacyResolve(const std::vector<LegacyMount>& mounts,
+                                      const std::string& cwd, const std::string& path)
+{
+    homeshell::ResolvedPath result;
+    std::string resolved = legacyNormalize(cwd, path);
+    for (const auto& entry : mounts)
+    {
+        const std::string& mount_point = entry.mount_point;
+        if (resolved == mount_point || (resolved.length() > mount_point.length() &&
+                                        resolved.substr(0, mount_point.length()) == mount_point &&
+                                        resolved[mount_point.length()] == '/'))
+        {
+            result.type = homeshell::PathType::Virtual;
+            result.full_path = resolved;
+            result.mount_point = mount_point;
+            result.relative_path =
+                resolved == mount_point ? "/" : resolved.substr(mount_point.length());
+            result.mount = entry.mount;
+            return result;
+        }
+    }
+    result.type = homeshell::PathType::Real;
+    result.full_path = resolved;
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    int64_t iterations = argc > 1 ? std::stoll(argv[1]) : 100000;
+
+    auto& vfs = homeshell::VirtualFilesystem::getInstance();
+    const std::string cwd = "/home/user/projects/homeshell";
+    vfs.setCurrentDirectory(cwd);
+
+    fmt::print("VirtualFilesystem::resolvePath latency\n\n");
+
+    std::vector<std::shared_ptr<homeshell::EncryptedMount>> mounts;
+    std::vector<LegacyMount> legacy;
+    for (int count : {1, 10, 100})
+    {
+        while (static_cast<int>(mounts.size()) < count)
+        {
+            auto name = fmt::format("m{:03}", mounts.size());
+            auto mount = std::make_shared<homeshell::EncryptedMount>(
+                name, "/nonexistent/" + name + ".db", "/vault/" + name, 10);
+            vfs.addMount(mount);
+            legacy.push_back({mount->getMountPoint(), mount.get()});
+            mounts.push_back(mount);
+        }
+
+        // The last mount in name order is the worst case for the linear scan
+        std::string last = mounts.back()->getMountPoint();
+        std::vector<std::string> paths = {
+            last + "/docs/report.txt",
+            "/vault/m000/a/b/c/d.txt",
+            "/usr/share/doc/readme",
+            "src/main.cpp",
+            "../other/./file.txt",
+            last,
+        };
+        auto pick = [&](int64_t i) -> const std::string& {
+            return paths[static_cast<size_t>(i) % paths.size()];
+        };
+
+        fmt::print("{} mount(s)\n", count);
+        measure("resolvePath (trie)", iterations, [&](int64_t i) { vfs.resolvePath(pick(i)); });
+        measure("resolvePath (linear scan)", iterations,
+                [&](int64_t i) { legacyResolve(legacy, cwd, pick(i)); });
+        fmt::print("\n");
+    }
+
+    for (const auto& mount : mounts)
+    {
+        vfs.removeMount(mount->getName());
+    }
+    return 0;
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace homeshell
+{
+
+/**
+ * @brief Effectiveness counters of a ChunkCache
+ */
+struct ChunkCacheStats
+{
+    uint64_t hits = 0;       ///< Chunk reads answered from the cache
+    uint64_t misses = 0;     ///< Chunk reads that had to query the database
+    uint64_t read_ahead = 0; ///< Chunks fetched ahead of a sequential reader
+    uint64_t evictions = 0;  ///< Chunks dropped to stay within the budget
+    int64_t bytes = 0;       ///< Bytes of decrypted content currently cached
+    int64_t budget = 0;      ///< Maximum bytes of decrypted content
+};
+
+/**
+ * @brief Size-bounded LRU cache of decrypted file chunks
+ *
+ * Holds chunk contents of one EncryptedMount keyed by file id and chunk
+ * index, so repeated and read-ahead reads skip SQLCipher page decryption.
+ * Blocks are shared immutable strings. Chunks that were never written
+ * (holes) are not cached: an empty block would occupy an entry without
+ * counting against the budget, so a sparse file could grow the cache
+ * without bound.
+ *
+ * @details All member functions are thread-safe. A budget of 0 disables
+ *          caching (insert() becomes a no-op).
+ *
+ *          Every invalidation advances a generation counter. A reader that
+ *          fetched a chunk from a database snapshot passes the generation it
+ *          saw before the fetch to insert(), which drops the block if
+ *          anything was invalidated in between, so a concurrent writer's
+ *          change cannot be shadowed by older content.
+ */
+class ChunkCache
+{
+public:
+    /// Shared, immutable chunk content
+    using Block = std::shared_ptr<const std::string>;
+
+    /// Generation argument of insert() that skips the generation check
+    static constexpr uint64_t kAnyGeneration = ~uint64_t(0);
+
+    /**
+     * @brief Construct an empty cache
+     * @param budget_bytes Maximum bytes of chunk content to keep
+     */
+    explicit ChunkCache(int64_t budget_bytes = 0)
+        : budget_(budget_bytes)
+    {
+    }
+
+    /**
+     * @brief Look up a chunk and count the hit or miss
+     * @param file_id File row id
+     * @param idx Chunk index within the file
+     * @return Cached block, or nullptr on miss
+     */
+    Block lookup(int64_t file_id, int64_t idx);
+
+    /**
+     * @brief Check whether a chunk is cached without touching counters or LRU order
+     */
+    bool contains(int64_t file_id, int64_t idx) const;
+
+    /**
+     * @brief Insert or replace a chunk, evicting least recently used ones
+     * @param file_id File row id
+     * @param idx Chunk index within the file
+     * @param block Chunk content
+     * @param read_ahead true if fetched ahead of the reader (counted separately)
+     * @param generation generation() seen before the chunk was fetched; the
+     *        block is dropped if the cache has been invalidated since
+     *
+     * @details Empty blocks (holes) are ignored.
+     */
+    void insert(int64_t file_id, int64_t idx, Block block, bool read_ahead = false,
+                uint64_t generation = kAnyGeneration);
+
+    /**
+     * @brief Drop one chunk
+     */
+    void invalidate(int64_t file_id, int64_t idx);
+
+    /**
+     * @brief Drop all chunks of a file
+     */
+    void invalidateFile(int64_t file_id);
+
+    /**
+     * @brief Drop all chunks (counters are kept)
+     */
+    void clear();
+
+    /**
+     * @brief Get the current invalidation generation
+     */
+    uint64_t generation() const;
+
+    /**
+     * @brief Advance the generation without dropping anything
+     *
+     * Used around writes whose chunks are invalidated only as they are
+     * written, so that fetches overlapping the write are not cached.
+     */
+    void advanceGeneration();
+
+    /**
+     * @brief Change the memory budget, evicting as needed
+     * @param budget_bytes New maximum bytes of chunk content
+     */
+    void setBudget(int64_t budget_bytes);
+
+    /**
+     * @brief Get counters and occupancy
+     * @return Current statistics
+     */
+    ChunkCacheStats getStats() const;
+
+private:
+    struct Key
+    {
+        int64_t file_id;
+        int64_t idx;
+
+        bool operator==(const Key& other) const
+        {
+            return file_id == other.file_id && idx == other.idx;
+        }
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const
+        {
+            return std::hash<int64_t>()(key.file_id * 1000003 + key.idx);
+        }
+    };
+
+    using LruList = std::list<std::pair<Key, Block>>;
+
+    void eraseLocked(LruList::iterator it);
+    void evictLocked();
+
+    mutable std::mutex mutex_;
+    LruList lru_; ///< Most recently used first
+    std::unordered_map<Key, LruList::iterator, KeyHash> index_;
+    int64_t budget_;
+    int64_t bytes_ = 0;
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+    uint64_t read_ahead_ = 0;
+    uint64_t evictions_ = 0;
+    uint64_t generation_ = 0;
+};
+
+} // namespace homeshell
@@ -13,6 +13,11 @@ namespace homeshell
  *
  * Defines the parameters for an encrypted virtual filesystem mount.
  * Used when loading mount configurations from JSON config files.
+ *
+ * cipher_page_size and kdf_iter are fixed when the database is created. To
+ * open a configured database with the `mount` command, pass the same values
+ * with its `--cipher-page-size` and `--kdf-iter` options; otherwise the
+ * mount fails as if the password were wrong.
  */
 struct MountConfig
 {
@@ -21,7 +26,20 @@ struct MountConfig
     std::string mount_point;   ///< Virtual mount point (e.g., "/secure")
     std::string password;      ///< Mount password (optional, will prompt if empty)
     int64_t max_size_mb = 100; ///< Maximum storage size in megabytes
+    int64_t cache_size_mb = 8; ///< Decrypted chunk cache budget in megabytes (0 disables)
+    bool dedup = false;        ///< Store identical chunks once (content-addressed)
+    int compression_level = 0; ///< Deflate level for stored chunks (0 = off, 1-9)
+    bool text_index = false;   ///< Keep a trigram index of file contents for grep
+    int read_connections = 4;  ///< Extra connections for concurrent reads (0 = none)
     bool auto_mount = true;    ///< Whether to mount automatically on shell startup
+    bool lazy_unlock = false;  ///< Defer key derivation until the mount is first used
+
+    std::string journal_mode = "WAL";   ///< SQLite journal_mode
+    std::string synchronous = "NORMAL"; ///< SQLite synchronous level
+    int64_t page_cache_kb = 0;          ///< SQLite page cache per connection (0 = default)
+    int64_t mmap_size_mb = 0;           ///< SQLite memory-mapped I/O limit (0 = off)
+    int cipher_page_size = 0;           ///< SQLCipher page size, fixed at creation (0 = default)
+    int kdf_iter = 0;                   ///< SQLCipher PBKDF2 iterations, fixed at creation
 };
 
 /**
@@ -45,7 +63,19 @@ struct MountConfig
  *                "mount_point": "/secure",
  *                "password": "",
  *                "max_size_mb": 100,
- *                "auto_mount": true
+ *                "cache_size_mb": 8,
+ *                "dedup": false,
+ *                "compression_level": 0,
+ *                "text_index": false,
+ *                "read_connections": 4,
+ *                "auto_mount": true,
+ *                "lazy_unlock": false,
+ *                "journal_mode": "WAL",
+ *                "synchronous": "NORMAL",
+ *                "page_cache_kb": 0,
+ *                "mmap_size_mb": 0,
+ *                "cipher_page_size": 0,
+ *                "kdf_iter": 0
  *              }
  *            ]
  *          }
@@ -120,10 +150,58 @@ struct Config
                 {
                     mount.max_size_mb = mount_json["max_size_mb"].get<int64_t>();
                 }
+                if (mount_json.contains("cache_size_mb"))
+                {
+                    mount.cache_size_mb = mount_json["cache_size_mb"].get<int64_t>();
+                }
+                if (mount_json.contains("dedup"))
+                {
+                    mount.dedup = mount_json["dedup"].get<bool>();
+                }
+                if (mount_json.contains("compression_level"))
+                {
+                    mount.compression_level = mount_json["compression_level"].get<int>();
+                }
+                if (mount_json.contains("text_index"))
+                {
+                    mount.text_index = mount_json["text_index"].get<bool>();
+                }
+                if (mount_json.contains("read_connections"))
+                {
+                    mount.read_connections = mount_json["read_connections"].get<int>();
+                }
                 if (mount_json.contains("auto_mount"))
                 {
                     mount.auto_mount = mount_json["auto_mount"].get<bool>();
                 }
+                if (mount_json.contains("lazy_unlock"))
+                {
+                    mount.lazy_unlock = mount_json["lazy_unlock"].get<bool>();
+                }
+                if (mount_json.contains("journal_mode"))
+                {
+                    mount.journal_mode = mount_json["journal_mode"].get<std::string>();
+                }
+                if (mount_json.contains("synchronous"))
+                {
+                    mount.synchronous = mount_json["synchronous"].get<std::string>();
+                }
+                if (mount_json.contains("page_cache_kb"))
+                {
+                    mount.page_cache_kb = mount_json["page_cache_kb"].get<int64_t>();
+                }
+                if (mount_json.contains("mmap_size_mb"))
+                {
+                    mount.mmap_size_mb = mount_json["mmap_size_mb"].get<int64_t>();
+                }
+                if (mount_json.contains("cipher_page_size"))
+                {
+                    mount.cipher_page_size = mount_json["cipher_page_size"].get<int>();
+                }
+                if (mount_json.contains("kdf_iter"))
+                {
+                    mount.kdf_iter = mount_json["kdf_iter"].get<int>();
+                }
 
                 config.encrypted_mounts.push_back(mount);
             }
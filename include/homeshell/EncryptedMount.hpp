@@ -1,10 +1,19 @@
 #pragma once
 
+#include <homeshell/ChunkCache.hpp>
+
 #include <sqlite3.h>
 
+#include <array>
+#include <atomic>
+#include <condition_variable>
 #include <cstdint>
+#include <functional>
+#include <limits>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 namespace homeshell
@@ -25,12 +34,135 @@ struct VirtualFileInfo
     int64_t mtime;     ///< Last modification time (Unix timestamp)
 };
 
+/**
+ * @brief Predicates of an EncryptedMount::findFiles() query
+ *
+ * All bounds are inclusive; the defaults match every file. Modification
+ * times use the unit of VirtualFileInfo::mtime.
+ */
+struct FileQuery
+{
+    std::string path = "/";                                  ///< Directory to search below
+    int64_t min_size = 0;                                    ///< Smallest size in bytes
+    int64_t max_size = std::numeric_limits<int64_t>::max();  ///< Largest size in bytes
+    int64_t min_mtime = std::numeric_limits<int64_t>::min(); ///< Earliest modification time
+    int64_t max_mtime = std::numeric_limits<int64_t>::max(); ///< Latest modification time
+
+    /// Check whether the query restricts sizes
+    bool hasSizeBounds() const
+    {
+        return min_size > 0 || max_size != std::numeric_limits<int64_t>::max();
+    }
+
+    /// Check whether the query restricts modification times
+    bool hasMtimeBounds() const
+    {
+        return min_mtime != std::numeric_limits<int64_t>::min() ||
+               max_mtime != std::numeric_limits<int64_t>::max();
+    }
+};
+
+/**
+ * @brief Storage usage counters of an encrypted mount
+ */
+struct MountUsage
+{
+    int64_t used_bytes = 0;      ///< Sum of all file sizes in bytes (logical size)
+    int64_t stored_bytes = 0;    ///< Bytes of chunk content actually stored (physical size)
+    int64_t file_count = 0;      ///< Number of files
+    int64_t directory_count = 0; ///< Number of directories (excluding the root)
+};
+
+/**
+ * @brief Compression counters of an encrypted mount (since mount)
+ */
+struct CompressionStats
+{
+    uint64_t chunks_compressed = 0; ///< Chunks stored deflated
+    uint64_t chunks_skipped = 0;    ///< Chunks stored as-is because they did not compress
+    uint64_t bytes_in = 0;          ///< Uncompressed bytes of the deflated chunks
+    uint64_t bytes_out = 0;         ///< Stored bytes of the deflated chunks
+    uint64_t compress_ns = 0;       ///< Time spent compressing (including skipped attempts)
+    uint64_t bytes_inflated = 0;    ///< Bytes produced by decompression
+    uint64_t decompress_ns = 0;     ///< Time spent decompressing
+};
+
+/**
+ * @brief Progress of an EncryptedMount::snapshot()
+ */
+struct SnapshotProgress
+{
+    int64_t pages_copied = 0; ///< Database pages copied so far
+    int64_t page_count = 0;   ///< Pages in the database (grows if it is written to meanwhile)
+    int64_t page_size = 0;    ///< Bytes per page
+    double seconds = 0.0;     ///< Time since the snapshot started
+};
+
+/**
+ * @brief Outcome of an EncryptedMount::verifyFile()
+ */
+struct FileCheck
+{
+    int64_t chunks = 0;           ///< Stored chunks read (holes are not stored)
+    int64_t unverified = 0;       ///< Chunks written before checksums were recorded
+    int64_t bytes = 0;            ///< Bytes of content read
+    std::vector<int64_t> corrupt; ///< Chunks that failed their checksum or did not inflate
+};
+
+/**
+ * @brief Progress and outcome of an EncryptedMount::compact()
+ */
+struct CompactProgress
+{
+    int64_t pages_freed = 0;     ///< Pages returned to the file system so far
+    int64_t pages_remaining = 0; ///< Free pages still in the database
+    int64_t page_size = 0;       ///< Bytes per page
+    bool vacuumed = false;       ///< Database was converted with a full VACUUM first
+    bool cancelled = false;      ///< Stopped early because progress returned false
+    double seconds = 0.0;        ///< Time since compaction started
+
+    /**
+     * @brief Get the number of bytes freed so far
+     */
+    int64_t bytesFreed() const
+    {
+        return pages_freed * page_size;
+    }
+};
+
+/**
+ * @brief Tunables of an encrypted mount
+ *
+ * Filled from MountConfig for configured mounts. The `mount` command only
+ * sets cipher_page_size and kdf_iter (from its options) and keeps the
+ * defaults for the rest.
+ *
+ * The SQLite settings are applied to the writer and every reader
+ * connection. cipher_page_size and kdf_iter are part of how a database is
+ * encrypted: a database can only be opened with the values it was created
+ * with. An unknown journal_mode or synchronous value makes mount() fail.
+ */
+struct MountOptions
+{
+    int64_t chunk_cache_bytes = 8 * 1024 * 1024; ///< Decrypted chunk cache budget (0 disables)
+    bool dedup = false;                          ///< Store new chunks content-addressed
+    int compression_level = 0;                   ///< Deflate level for new chunks (0 = off, 1-9)
+    int read_connections = 4;                    ///< Pooled reader connections (0 = writer only)
+    std::string journal_mode = "WAL";            ///< SQLite journal_mode (e.g. WAL, DELETE)
+    std::string synchronous = "NORMAL";          ///< SQLite synchronous (OFF, NORMAL, FULL, EXTRA)
+    int64_t page_cache_kb = 0;                   ///< SQLite page cache per connection (0 = default)
+    int64_t mmap_size_mb = 0;                    ///< SQLite memory-mapped I/O limit (0 = off)
+    int cipher_page_size = 0;                    ///< SQLCipher page size (0 = default, 4096)
+    int kdf_iter = 0;                            ///< SQLCipher PBKDF2 iterations (0 = default)
+    bool text_index = false;                     ///< Keep a trigram index of file contents
+};
+
 /**
  * @brief Encrypted virtual filesystem mount
  *
  * Provides an encrypted storage backend using SQLCipher (AES-256 encryption).
- * Files are stored as BLOBs in an encrypted SQLite database with full
- * directory hierarchy support.
+ * Files are stored as fixed-size chunks in an encrypted SQLite database with
+ * full directory hierarchy support.
  *
  * @details Each mount represents a separate encrypted volume with:
  *          - Unique name for identification
@@ -47,8 +179,67 @@ struct VirtualFileInfo
  *
  *          Storage layout:
  *          - Database file on regular filesystem
- *          - Internal schema with files and metadata tables
+ *          - `files` table with one metadata row per file, indexed by parent
+ *            directory so listings cost O(children), and by size and by
+ *            modification time for findFiles()
+ *          - `chunks` table holding file content in kChunkSize blocks, either
+ *            inline or as a reference into the content-addressed `blobs`
+ *            table (deduplication mode, see below)
  *          - Hierarchical directory structure
+ *          - `usage` table with size and entry counters, kept current by
+ *            triggers in the same transaction as every change
+ *          - Schema version tracked in `PRAGMA user_version`; older
+ *            single-BLOB databases are migrated on mount
+ *
+ *          Range reads and writes only touch the chunks they overlap, so
+ *          their memory use is bounded by the chunk size rather than the
+ *          file size. Decrypted chunks are kept in a per-mount ChunkCache
+ *          bounded by MountOptions::chunk_cache_bytes; a reader continuing
+ *          where its last read of the same file ended is treated as
+ *          sequential and gets a doubling read-ahead window (up to
+ *          kMaxReadAheadChunks) fetched with a single range query.
+ *
+ *          With MountOptions::dedup set, new chunks are keyed by the SHA-256
+ *          of their content: identical chunks of any files are stored once
+ *          in `blobs` and reference counted in `blob_refs` by triggers, so a
+ *          blob is dropped with its last chunk. The mode only affects writes;
+ *          inline and deduplicated chunks can be mixed and are always
+ *          readable. MountUsage reports the logical (file size) and physical
+ *          (stored content) bytes.
+ *
+ *          With MountOptions::compression_level set, new chunks (and new
+ *          blobs) are deflated before they are stored. Chunks that do not
+ *          shrink by at least 1/8, judged from a 4 KiB sample first, are
+ *          stored as-is; a per-row flag tells readers which is which.
+ *
+ *          With MountOptions::text_index set, the mount keeps an FTS5 table
+ *          (trigram tokenizer, `file_text`) with the content of every text
+ *          file of up to kMaxIndexedTextBytes, keyed by file id. It is
+ *          updated in the same transaction as each whole-file write and
+ *          cleared by a trigger when a file row is deleted; larger and
+ *          binary files are listed in `file_text_skipped` instead. Range
+ *          writes and appends only list the file in `file_text_stale`, so
+ *          that growing a log stays cheap. findTextCandidates() uses
+ *          it to narrow a content search down to a few files. The index is
+ *          built when the option is first set. A mount opened without the
+ *          option keeps it and lists the files it writes as stale too. The
+ *          next mount with the option re-indexes just the stale files.
+ *
+ *          All frequently used SQL statements are prepared once at mount()
+ *          and reused (reset and rebound) by every call until unmount().
+ *
+ *          Thread safety: the mount may be used from several threads. All
+ *          writes (and open batches) are serialized on the single writer
+ *          connection. Reads use the writer while it is idle and otherwise
+ *          a pool of up to MountOptions::read_connections extra keyed
+ *          connections, opened on demand, so parallel readers proceed
+ *          concurrently on WAL snapshots of the last commit. A thread that
+ *          is writing or has a batch open always reads through the writer
+ *          and so sees its own uncommitted changes. Readers are keyed with the
+ *          raw key derived once by mount(), so opening one skips the key
+ *          derivation and the password is not kept. mount() and unmount()
+ *          must not race with other calls; the deferred mount of
+ *          mountLazily() may be triggered by any thread.
  *
  * Example usage:
  * ```cpp
@@ -62,15 +253,29 @@ struct VirtualFileInfo
 class EncryptedMount
 {
 public:
+    /// Size of a stored content chunk in bytes
+    static constexpr int64_t kChunkSize = 64 * 1024;
+
+    /// Current on-disk schema version (stored in PRAGMA user_version)
+    static constexpr int kSchemaVersion = 8;
+
+    /// Largest read-ahead window in chunks
+    static constexpr int64_t kMaxReadAheadChunks = 16;
+
+    /// Largest file whose content goes into the text index
+    static constexpr int64_t kMaxIndexedTextBytes = 1024 * 1024;
+
     /**
      * @brief Construct an encrypted mount
      * @param name Unique name for this mount
      * @param db_path Path to the SQLCipher database file
      * @param mount_point Virtual path prefix (e.g., "/secure")
      * @param max_size_mb Maximum storage size in megabytes
+     * @param options Cache and storage tunables
      */
     EncryptedMount(const std::string& name, const std::string& db_path,
-                   const std::string& mount_point, int64_t max_size_mb);
+                   const std::string& mount_point, int64_t max_size_mb,
+                   const MountOptions& options = MountOptions());
 
     /**
      * @brief Destructor - safely cleans up without calling SQLite during static destruction
@@ -84,6 +289,21 @@ public:
      */
     bool mount(const std::string& password);
 
+    /**
+     * @brief Register the password now and mount on first access
+     * @param password Password for decryption
+     * @return true (the password is only checked when the mount is first used)
+     *
+     * @details Key derivation and the schema check are deferred until the
+     *          first call that needs the database, so a shell with several
+     *          mounts starts without paying for the ones it never touches.
+     *          Until then is_mounted() reports true and isUnlockPending()
+     *          tells the two states apart. If the deferred mount fails (e.g.
+     *          wrong password), the mount behaves as unmounted from then on
+     *          and unlockFailed() returns true.
+     */
+    bool mountLazily(const std::string& password);
+
     /**
      * @brief Unmount the encrypted volume
      * @return true if unmount successful, false on error
@@ -96,7 +316,25 @@ public:
      */
     bool is_mounted() const
     {
-        return db_ != nullptr;
+        return unlock_pending_ || db_ != nullptr;
+    }
+
+    /**
+     * @brief Check whether a lazy mount has not been unlocked yet
+     * @return true between mountLazily() and the first access
+     */
+    bool isUnlockPending() const
+    {
+        return unlock_pending_;
+    }
+
+    /**
+     * @brief Check whether the deferred mount of mountLazily() failed
+     * @return true if the first access could not unlock the database
+     */
+    bool unlockFailed() const
+    {
+        return unlock_failed_;
     }
 
     /**
@@ -147,6 +385,56 @@ public:
      */
     std::vector<VirtualFileInfo> listDirectory(const std::string& path);
 
+    /**
+     * @brief Visit every directory and file below a directory in path order
+     * @param path Directory within the mount ("/" for the whole mount)
+     * @param visitor Called with each entry; returning false stops the walk
+     * @return true if the walk completed, false if path is not a directory,
+     *         on error, or if the visitor stopped it
+     *
+     * @details All directories are visited before all files, so a parent is
+     *          always seen before its contents. Entries come from ordered range
+     *          scans on the path indexes, fetched a page at a time; no
+     *          connection is held while the visitor runs, so it may read or
+     *          write the mount.
+     */
+    bool walkTree(const std::string& path,
+                  const std::function<bool(const VirtualFileInfo&)>& visitor);
+
+    /**
+     * @brief Find the files below a directory within size and mtime bounds
+     * @param query Directory and bounds to match
+     * @param[out] results Matching files in path order
+     * @return true on success, false if query.path is not a directory or on error
+     *
+     * @details The predicates are evaluated in SQL. A query with mtime bounds
+     *          scans the modification time index, otherwise one with size
+     *          bounds scans the size index, so only candidate rows are read
+     *          instead of every file below the directory. Files without a
+     *          recorded modification time never match mtime bounds.
+     */
+    bool findFiles(const FileQuery& query, std::vector<VirtualFileInfo>& results);
+
+    /**
+     * @brief Find the files below a directory that may contain some strings
+     * @param path Directory within the mount ("/" for the whole mount)
+     * @param terms Strings that must all occur in a matching file
+     * @param[out] paths Candidate files in path order
+     * @return true on success, false if the mount has no text index, no
+     *         term is at least three characters long, path is not a
+     *         directory, or on error
+     *
+     * @details Candidates are the indexed files containing every trigram of
+     *          every term (ignoring case), plus all files too large or too
+     *          binary to be indexed and all files whose entry is stale
+     *          (changed by a range write since). Every file containing all
+     *          terms is a candidate, but not every candidate does: callers
+     *          confirm with their own matcher. Terms shorter than three
+     *          characters cannot be looked up and are ignored.
+     */
+    bool findTextCandidates(const std::string& path, const std::vector<std::string>& terms,
+                            std::vector<std::string>& paths);
+
     /**
      * @brief Read entire file contents
      * @param path File path within the mount
@@ -155,6 +443,19 @@ public:
      */
     bool readFile(const std::string& path, std::string& content);
 
+    /**
+     * @brief Read part of a file
+     * @param path File path within the mount
+     * @param offset Byte offset to start reading at
+     * @param length Maximum number of bytes to read
+     * @param[out] content Buffer to receive the data (empty at end of file)
+     * @return true if the file exists and the read succeeded, false otherwise
+     *
+     * @details Only the chunks overlapping [offset, offset + length) are loaded.
+     */
+    bool readFileRange(const std::string& path, int64_t offset, int64_t length,
+                       std::string& content);
+
     /**
      * @brief Write file contents
      * @param path File path within the mount
@@ -163,6 +464,43 @@ public:
      */
     bool writeFile(const std::string& path, const std::string& content);
 
+    /**
+     * @brief Write data at an offset inside a file
+     * @param path File path within the mount (created if missing)
+     * @param offset Byte offset to write at; gaps past end of file read as zeros
+     * @param data Data to write
+     * @return true if write successful, false on error or quota exceeded
+     *
+     * @details Only the chunks overlapping the written range are rewritten.
+     */
+    bool writeFileRange(const std::string& path, int64_t offset, const std::string& data);
+
+    /**
+     * @brief Append data to the end of a file
+     * @param path File path within the mount (created if missing)
+     * @param data Data to append
+     * @return true if write successful, false on error or quota exceeded
+     *
+     * @details Only the last chunk and the new ones are written, so repeated
+     *          appends stay linear in the data appended rather than the file size.
+     */
+    bool appendFile(const std::string& path, const std::string& data);
+
+    /**
+     * @brief Get type, size and modification time of a file or directory
+     * @param path Path within the mount
+     * @param[out] info Metadata of the entry (name and path filled in too)
+     * @return true if the path exists, false otherwise
+     */
+    bool stat(const std::string& path, VirtualFileInfo& info);
+
+    /**
+     * @brief Get the size of a file
+     * @param path File path within the mount
+     * @return File size in bytes, or -1 if the file does not exist
+     */
+    int64_t getFileSize(const std::string& path);
+
     /**
      * @brief Create a directory
      * @param path Directory path to create within the mount
@@ -174,15 +512,181 @@ public:
      * @brief Remove a file or directory
      * @param path Path to remove within the mount
      * @return true if removal successful, false if not found or error
+     *
+     * @details Directories are removed with everything below them, at any
+     *          depth, in one transaction. The cost is proportional to the
+     *          size of the subtree. The root directory cannot be removed.
      */
     bool remove(const std::string& path);
 
+    /**
+     * @brief Rename or move a file or directory within the mount
+     * @param from Existing path within the mount
+     * @param to New path within the mount (missing parents are created)
+     * @return true if successful, false if the source is missing, the target
+     *         is an existing directory (or a file while moving a directory),
+     *         the target is inside the source, or on error
+     *
+     * @details Only path metadata is rewritten: a directory's whole subtree is
+     *          moved by prefix UPDATEs in one transaction, and file content is
+     *          never read or copied. An existing target file is replaced.
+     */
+    bool rename(const std::string& from, const std::string& to);
+
     /**
      * @brief Get current storage usage
-     * @return Number of bytes currently used
+     * @return Logical size: number of bytes of all files
+     *
+     * @see getUsage() for the physical (stored, deduplicated) size
      */
     int64_t getUsedSpace();
 
+    /**
+     * @brief Get storage usage and entry counts
+     * @return Current counters (all zero if not mounted)
+     *
+     * @details O(1): reads the trigger-maintained usage row.
+     */
+    MountUsage getUsage();
+
+    /**
+     * @brief Check the usage counters against the tables
+     * @return true if the counters were consistent, false if they had drifted
+     *         (they are rebuilt in that case) or the check failed
+     *
+     * @details Scans the whole mount; meant for explicit checks, not hot paths.
+     */
+    bool verifyUsage();
+
+    /**
+     * @brief Run SQLCipher's and SQLite's integrity checks on the database
+     * @param[out] errors Problems reported by the checks (empty if none)
+     * @return true if the checks ran, false if not mounted or they failed to run
+     *
+     * @details PRAGMA cipher_integrity_check verifies the HMAC of every page,
+     *          which catches corrupted pages; PRAGMA integrity_check then
+     *          checks the b-tree structure. Both read the whole file and
+     *          run on a pooled reader connection, so writes continue
+     *          meanwhile (unless MountOptions::read_connections is 0).
+     */
+    bool checkIntegrity(std::vector<std::string>& errors);
+
+    /**
+     * @brief Re-read a file from the database and check every chunk's checksum
+     * @param path Path within the mount
+     * @param[out] check Chunks and bytes read, and the corrupt chunks
+     * @return true if the file was read (corrupt chunks included), false if it
+     *         does not exist or the read failed
+     *
+     * @details Chunks are read from the database, bypassing the chunk cache,
+     *          and their CRC-32 compared with the one recorded when they
+     *          were written. Runs on a pooled reader connection and is safe
+     *          to call from several threads at once.
+     */
+    bool verifyFile(const std::string& path, FileCheck& check);
+
+    /**
+     * @brief Start grouping subsequent operations into one transaction
+     * @return true if successful, false if not mounted or on error
+     *
+     * @details Every write otherwise commits (and syncs the WAL) on its own.
+     *          Between beginBatch() and the matching endBatch() operations
+     *          still succeed or fail individually, but are committed
+     *          together. Calls nest; only the outermost pair begins and
+     *          commits. Prefer the VfsBatch guard over calling this directly.
+     */
+    bool beginBatch();
+
+    /**
+     * @brief End a batch started with beginBatch()
+     * @return true if successful (or still nested), false if no batch was open
+     *         or the commit failed (the batch is rolled back in that case)
+     */
+    bool endBatch();
+
+    /**
+     * @brief Copy the mounted database to a new file while it stays in use
+     * @param dest_path Database file to create (must not exist yet)
+     * @param new_password Password of the copy; empty to keep the mount's
+     * @param progress Called after every step (may be empty)
+     * @param pages_per_step Pages copied per step of the SQLite backup API
+     * @return true if the snapshot was written, false on error (the
+     *         partial file is removed)
+     *
+     * @details Built on sqlite3_backup_step(). Each step holds the writer
+     *          for pages_per_step pages only, so other commands keep running
+     *          in between; the writes they make through this mount are
+     *          carried into the copy. The snapshot is a consistent database
+     *          with the mount's cipher settings and is re-keyed to
+     *          new_password at the end if one is given.
+     */
+    bool snapshot(const std::string& dest_path, const std::string& new_password,
+                  const std::function<void(const SnapshotProgress&)>& progress = {},
+                  int pages_per_step = 256);
+
+    /**
+     * @brief Return the free pages of the database to the file system
+     * @param[out] result Pages freed and whether compaction was cancelled
+     * @param progress Called after every step; returning false stops
+     *                 compaction there (may be empty)
+     * @param pages_per_step Pages freed per step of PRAGMA incremental_vacuum
+     * @return true on success (also when cancelled), false on error
+     *
+     * @details Deleted files leave free pages behind that SQLite reuses but
+     *          never gives back, so the file does not shrink. New mounts are
+     *          created with auto_vacuum=INCREMENTAL, and compaction frees
+     *          their pages pages_per_step at a time, holding the writer for
+     *          one step only. Databases created without it are converted by
+     *          a full VACUUM on their first compaction, which frees all
+     *          pages in one step and cannot be cancelled. The WAL is
+     *          checkpointed at the end so the database file shrinks.
+     */
+    bool compact(CompactProgress& result,
+                 const std::function<bool(const CompactProgress&)>& progress = {},
+                 int pages_per_step = 256);
+
+    /**
+     * @brief Get the bytes held by free pages of the database
+     * @return Bytes compact() would return to the file system
+     */
+    int64_t getReclaimableBytes();
+
+    /**
+     * @brief Get counters of the decrypted chunk cache
+     * @return Current cache statistics
+     */
+    ChunkCacheStats getChunkCacheStats() const
+    {
+        return chunk_cache_.getStats();
+    }
+
+    /**
+     * @brief Get compression ratio and throughput counters
+     * @return Counters since this mount object was created
+     */
+    CompressionStats getCompressionStats() const
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        return compression_stats_;
+    }
+
+    /**
+     * @brief Callback invoked after a committed change
+     *
+     * Receives the normalized path within the mount and whether everything
+     * below it may have changed too (directory removal or rename).
+     */
+    using ChangeListener = std::function<void(const std::string& path, bool subtree)>;
+
+    /**
+     * @brief Register the callback notified of changes made through this mount
+     * @param listener Callback (empty to unregister)
+     *
+     * @details Used by VirtualFilesystem to keep its metadata cache coherent.
+     *          A rolled back batch reports "/" with subtree set.
+     */
+    void setChangeListener(ChangeListener listener);
+
     /**
      * @brief Get maximum storage capacity
      * @return Maximum number of bytes allowed (quota)
@@ -192,13 +696,318 @@ public:
         return max_size_bytes_;
     }
 
+    /**
+     * @brief Get the options this mount was created with
+     * @return Mount options
+     */
+    const MountOptions& getOptions() const
+    {
+        return options_;
+    }
+
 private:
+    /**
+     * @brief Identifiers of the cached prepared statements
+     *
+     * Each value indexes the SQL text table in EncryptedMount.cpp.
+     */
+    enum class Statement
+    {
+        PathExists,
+        StatPath,
+        DirectoryExists,
+        InsertDirectory,
+        ListSubdirectories,
+        ListFiles,
+        ListDirectoryTree,
+        ListFileTree,
+        FindFilesBySize,
+        FindFilesByMtime,
+        LookupFile,
+        UpsertFile,
+        UpdateFileSize,
+        DeleteFile,
+        DeleteFileRange,
+        DeleteDirectoryTree,
+        RenameFile,
+        RenameFileRange,
+        RenameDirectoryTree,
+        SelectChunk,
+        SelectChunkRange,
+        SelectChunkChecksums,
+        InsertChunk,
+        DeleteChunks,
+        FindBlob,
+        InsertBlob,
+        InsertBlobRef,
+        SelectUsage,
+        // Statements from here on use the text index tables, which only
+        // exist with MountOptions::text_index; they are prepared on first use
+        ReplaceText,
+        DeleteText,
+        InsertTextSkipped,
+        DeleteTextSkipped,
+        InsertTextStale,
+        DeleteTextStale,
+        SelectTextCandidates,
+        Count ///< Number of statements (not a statement)
+    };
+
+    /// Prepared statements of one connection, indexed by Statement
+    using StatementCache = std::array<sqlite3_stmt*, static_cast<size_t>(Statement::Count)>;
+
+    /**
+     * @brief A pooled read-only connection with its own statement cache
+     */
+    struct Reader
+    {
+        sqlite3* db = nullptr;       ///< Keyed connection (query_only)
+        StatementCache statements{}; ///< Statements prepared on this connection
+    };
+
+    /**
+     * @brief RAII handle on the connection a read runs on
+     *
+     * Chooses the writer (when this thread is writing, the pool is disabled
+     * or the writer is idle) or a pooled reader, and holds it until
+     * destruction. Long scans ask for a pooled reader even when the writer
+     * is idle, so writes are not held up. Defined in the implementation file.
+     */
+    class ReadLease;
+
+    /**
+     * @brief RAII exclusive use of the writer connection for a write
+     *
+     * Recursive, so write operations can call each other. Defined in the
+     * implementation file.
+     */
+    class WriteLock;
+
+    /**
+     * @brief Get a cached prepared statement, preparing it on first use
+     * @param id Statement identifier
+     * @return Ready-to-bind statement, or nullptr if preparation failed
+     *
+     * @details Callers must reset the statement when done (see ScopedStatement
+     *          in the implementation file) and must not hold it across calls
+     *          that may use the same statement.
+     */
+    sqlite3_stmt* getStatement(Statement id);
+
+    /**
+     * @brief Get a statement from a connection's cache, preparing it on first use
+     * @param db Connection the cache belongs to
+     * @param cache Statement cache of that connection
+     * @param id Statement identifier
+     * @return Ready-to-bind statement, or nullptr if preparation failed
+     */
+    static sqlite3_stmt* prepareCached(sqlite3* db, StatementCache& cache, Statement id);
+
+    /**
+     * @brief Complete a lazy mount if one is pending
+     * @return true if the database is open, false otherwise
+     */
+    bool ensureOpen();
+
+    /**
+     * @brief Take the writer for a write operation (see WriteLock)
+     */
+    void lockWriter();
+
+    /**
+     * @brief Release the writer taken by lockWriter()
+     */
+    void unlockWriter();
+
+    /**
+     * @brief Check whether the calling thread is inside a write or batch
+     */
+    bool ownsWriter() const
+    {
+        return writer_owner_.load() == std::this_thread::get_id();
+    }
+
+    /**
+     * @brief Open one more keyed reader connection
+     * @return New reader, or nullptr if it could not be opened
+     */
+    std::unique_ptr<Reader> openReader();
+
+    /**
+     * @brief Close all pooled reader connections
+     */
+    void closeReaders();
+
+    /**
+     * @brief Prepare all cached statements
+     * @return true if every statement was prepared, false otherwise
+     */
+    bool prepareStatements();
+
+    /**
+     * @brief Finalize all cached statements
+     */
+    void finalizeStatements();
+
     /**
      * @brief Initialize database schema on first mount
      * @return true if schema creation successful, false on error
      */
     bool initializeSchema();
 
+    /**
+     * @brief Create any missing tables, indexes and triggers of the current schema
+     * @return true if successful, false on error
+     */
+    bool createSchema();
+
+    /**
+     * @brief Migrate a version 1 database (one content BLOB per file) to chunks
+     * @return true if migration successful, false on error (changes rolled back)
+     */
+    bool migrateFromBlobSchema();
+
+    /**
+     * @brief Migrate a version 2 database by adding the indexed files.parent column
+     * @return true if migration successful, false on error (changes rolled back)
+     */
+    bool migrateAddFileParent();
+
+    /**
+     * @brief Migrate a version 2-4 database by adding the deduplication columns
+     * @return true if migration successful, false on error (changes rolled back)
+     *
+     * @details Adds chunks.blob_id and usage.stored_bytes where the tables
+     *          exist; createSchema() adds the blob tables and triggers.
+     */
+    bool migrateAddChunkBlobs();
+
+    /**
+     * @brief Migrate a version 2-5 database by adding the compressed flags
+     * @return true if migration successful, false on error (changes rolled back)
+     */
+    bool migrateAddCompressionFlags();
+
+    /**
+     * @brief Migrate a version 2-7 database by adding the chunk checksums
+     * @return true if migration successful, false on error (changes rolled back)
+     */
+    bool migrateAddChunkChecksums();
+
+    /**
+     * @brief Report a change to the registered listener, if any
+     * @param norm_path Normalized path that changed
+     * @param subtree true if descendants may have changed as well
+     */
+    void notifyChange(const std::string& norm_path, bool subtree);
+
+    /**
+     * @brief Recompute the usage counters from the files, chunks and directories tables
+     * @return true if successful, false on error
+     */
+    bool rebuildUsageCounters();
+
+    /**
+     * @brief Prepare the text index for MountOptions::text_index
+     * @return true if successful, false on error
+     *
+     * @details With the option, a newly created index is filled from all
+     *          existing files in the same transaction and an existing one is
+     *          brought up to date with refreshStaleText(). Without it, an
+     *          existing index is kept and writes are recorded as stale.
+     */
+    bool setupTextIndex();
+
+    /**
+     * @brief Re-index the files listed in `file_text_stale` and empty the list
+     * @return true if successful, false on error
+     */
+    bool refreshStaleText();
+
+    /**
+     * @brief Replace the text index entry of a file (writer only)
+     * @param file_id File whose content changed
+     * @param content New content of the whole file, or nullptr if it is
+     *                larger than kMaxIndexedTextBytes
+     * @return true if successful, false on error
+     */
+    bool indexText(int64_t file_id, const std::string* content);
+
+    /**
+     * @brief Re-read a file and update its text index entry
+     * @param file_id File whose content changed
+     * @param norm_path Normalized path of the file
+     * @param size New size of the file
+     * @return true if successful, false on error
+     */
+    bool reindexText(int64_t file_id, const std::string& norm_path, int64_t size);
+
+    /**
+     * @brief Load a range of chunks from the database into the cache
+     * @param lease Connection to read from
+     * @param file_id File row id
+     * @param from First chunk index to load
+     * @param to Last chunk index to load (chunks past the read are read-ahead)
+     * @param first First chunk index of the caller's read
+     * @param[in,out] blocks Blocks of the read (index 0 = first); missing ones are filled in
+     * @return true if successful, false on database error
+     */
+    bool loadChunks(ReadLease& lease, int64_t file_id, int64_t from, int64_t to, int64_t first,
+                    std::vector<ChunkCache::Block>& blocks);
+
+    /**
+     * @brief Look up a file row
+     * @param lease Connection to read from
+     * @param norm_path Normalized file path
+     * @param[out] file_id Row id of the file
+     * @param[out] size File size in bytes
+     * @return true if the file exists, false otherwise
+     */
+    bool lookupFile(ReadLease& lease, const std::string& norm_path, int64_t& file_id,
+                    int64_t& size);
+
+    /**
+     * @brief Store one content chunk, replacing any existing chunk at that index
+     * @param file_id Row id of the owning file
+     * @param idx Chunk index within the file
+     * @param data Pointer to chunk data
+     * @param size Number of bytes in the chunk (at most kChunkSize)
+     * @return true if stored successfully, false on error
+     *
+     * @details In deduplication mode the chunk references a shared blob
+     *          (see findOrInsertBlob()) instead of holding the data.
+     */
+    bool writeChunk(int64_t file_id, int64_t idx, const char* data, int64_t size);
+
+    /**
+     * @brief Find the blob holding some content, storing it if it is new
+     * @param data Pointer to chunk data
+     * @param size Number of bytes
+     * @param[out] blob_id Row id of the blob
+     * @return true if successful, false on error
+     *
+     * @details New blobs start with no references; the chunk triggers count them.
+     */
+    bool findOrInsertBlob(const char* data, int64_t size, int64_t& blob_id);
+
+    /**
+     * @brief Deflate a chunk if compression is enabled and worthwhile
+     * @param data Pointer to chunk data
+     * @param size Number of bytes
+     * @param[out] compressed Deflated data (set only when returning true)
+     * @return true if the chunk should be stored compressed, false to store it as-is
+     */
+    bool compressChunk(const char* data, int64_t size, std::string& compressed);
+
+    /**
+     * @brief Read a chunk's content from a result row, inflating it if needed
+     * @param stmt Statement positioned on a row
+     * @param column Column of the data; the next column holds the compressed flag
+     * @param[out] content Uncompressed chunk content
+     * @return true if successful, false if the stored data is corrupt
+     */
+    bool readChunkColumn(sqlite3_stmt* stmt, int column, std::string& content);
+
     /**
      * @brief Ensure parent directory exists for a path
      * @param path Path whose parent should exist
@@ -220,11 +1029,39 @@ private:
      */
     std::string normalizePath(const std::string& path);
 
-    std::string name_;        ///< Unique mount name
-    std::string db_path_;     ///< Path to SQLCipher database file
-    std::string mount_point_; ///< Virtual path prefix
-    int64_t max_size_bytes_;  ///< Maximum storage quota in bytes
-    sqlite3* db_;             ///< SQLite/SQLCipher database handle
+    std::string name_;                   ///< Unique mount name
+    std::string db_path_;                ///< Path to SQLCipher database file
+    std::string mount_point_;            ///< Virtual path prefix
+    int64_t max_size_bytes_;             ///< Maximum storage quota in bytes
+    int64_t page_size_ = 4096;           ///< Database page size, read when mounted
+    MountOptions options_;               ///< Cache and storage tunables
+    sqlite3* db_;                        ///< SQLite/SQLCipher database handle
+    int batch_depth_ = 0;                ///< Nesting depth of open batches
+    ChangeListener change_listener_;     ///< Notified after committed changes
+    ChunkCache chunk_cache_;             ///< Decrypted chunks
+    int64_t read_ahead_file_ = -1;       ///< File id of the last range read
+    int64_t read_ahead_next_ = 0;        ///< Offset where the last range read ended
+    int64_t read_ahead_window_ = 0;      ///< Current read-ahead window in chunks
+    CompressionStats compression_stats_; ///< Compression counters
+    StatementCache statements_{};        ///< Writer's prepared statements
+    std::string password_;               ///< Held from mountLazily() to the deferred mount only
+    std::string reader_key_;             ///< Raw key (x'...') for readers and snapshots, wiped
+                                         ///< at unmount(); empty disables the reader pool
+
+    std::recursive_mutex writer_mutex_;            ///< Serializes use of the writer
+    int write_depth_ = 0;                          ///< Nested write locks (under writer_mutex_)
+    std::atomic<bool> writing_{false};             ///< A write or batch is in progress
+    std::atomic<std::thread::id> writer_owner_{};  ///< Thread inside a write or batch
+    std::mutex pool_mutex_;                        ///< Guards the reader pool members
+    std::condition_variable pool_cv_;              ///< Signalled when a connection frees up
+    std::vector<std::unique_ptr<Reader>> readers_; ///< All open reader connections
+    std::vector<Reader*> idle_readers_;            ///< Readers not currently leased
+    int pending_readers_ = 0;                      ///< Readers being opened outside the lock
+    std::mutex read_ahead_mutex_;                  ///< Guards the read_ahead_* members
+    mutable std::mutex stats_mutex_;               ///< Guards compression_stats_
+    std::atomic<bool> unlock_pending_{false};      ///< mountLazily() awaits first access
+    std::atomic<bool> unlock_failed_{false};       ///< The deferred mount failed
+    std::recursive_mutex unlock_mutex_;            ///< Serializes the deferred mount
 };
 
 } // namespace homeshell
@@ -27,10 +27,14 @@ struct FileEntry
  */
 struct DatabaseStats
 {
-    int64_t total_files = 0;       ///< Total number of files indexed
-    int64_t total_directories = 0; ///< Total number of directories indexed
-    int64_t total_size = 0;        ///< Total size of all files in bytes
-    double scan_time_ms = 0.0;     ///< Time taken to scan in milliseconds
+    int64_t total_files = 0;         ///< Total number of files indexed
+    int64_t total_directories = 0;   ///< Total number of directories indexed
+    int64_t total_size = 0;          ///< Total size of all files in bytes
+    double scan_time_ms = 0.0;       ///< Time taken to scan in milliseconds
+    int64_t scanned_directories = 0; ///< Directories listed by the update
+    int64_t skipped_directories = 0; ///< Unchanged directories the update did not list
+    int64_t entries_updated = 0;     ///< Entries the update inserted or changed
+    int64_t entries_removed = 0;     ///< Entries the update deleted
 };
 
 /**
@@ -48,7 +52,9 @@ struct DatabaseStats
  * - Support for both regular and virtual filesystems
  *
  * **Database Schema:**
- * - `files` table: path, is_directory, size, mtime
+ * - `files` table: path, parent, is_directory, size, mtime
+ * - `directories` table: mtime of every scanned directory at its last scan
+ * - `settings` table: roots and excludes of the last update
  * - Index on path column for fast lookups
  *
  * **Usage:**
@@ -109,16 +115,25 @@ public:
      *
      * @param search_paths Directories to scan (default: {"/", virtual mounts})
      * @param exclude_paths Directories to skip (default: {"/proc", "/sys", "/dev"})
+     * @param full Discard the index and list every directory again
      * @return Statistics about the update operation
      *
      * @details Recursively scans specified directories and updates the database
-     * with all files and directories found. Existing entries are replaced.
+     * with all files and directories found. A directory whose mtime is the one
+     * recorded at its last scan has had no entry added, removed or renamed, so
+     * it is not listed again; only its subdirectories are visited. Changed
+     * directories are listed and their entries applied as a diff of inserts and
+     * deletes. The whole index is rebuilt when full is set or the search or
+     * exclude paths differ from the previous update.
      *
-     * @note Can take a long time for large directory trees
-     * @note Virtual filesystem paths are also scanned
+     * @note Sizes and mtimes of files in unchanged directories are not
+     *       refreshed (as with mlocate); use full for that
+     * @note Directories in virtual filesystems are always listed, since their
+     *       mtimes do not change when entries are added
      */
     DatabaseStats updateDatabase(const std::vector<std::string>& search_paths = {},
-                                 const std::vector<std::string>& exclude_paths = {});
+                                 const std::vector<std::string>& exclude_paths = {},
+                                 bool full = false);
 
     /**
      * @brief Search for files matching a pattern
@@ -152,6 +167,9 @@ public:
     /**
      * @brief Clear all entries from the database
      * @return true if successful, false on error
+     *
+     * @details Also forgets the recorded directory mtimes, so the next update
+     * lists every directory.
      */
     bool clear();
 
@@ -166,13 +184,33 @@ private:
     bool initSchema();
 
     /**
-     * @brief Scan a directory recursively and collect file entries
-     * @param path Directory to scan
+     * @brief Prepared statements and counters of one updateDatabase() run
+     *
+     * Defined in the implementation file.
+     */
+    struct Update;
+
+    /**
+     * @brief Bring the index of one search path up to date
+     * @param root Directory (or file) to index
      * @param exclude_paths Paths to exclude
-     * @param entries Output vector for collected entries
+     * @param update Statements and counters of the running update
+     */
+    void updateTree(const std::string& root, const std::vector<std::string>& exclude_paths,
+                    Update& update);
+
+    /**
+     * @brief List the entries of a directory
+     * @param path Directory to list
+     * @param is_virtual true if the directory is in a virtual filesystem
+     * @param exclude_paths Paths to leave out
+     * @param[out] entries Entries of the directory
+     * @param[out] subdirectories Entries to descend into (symlinks are not followed)
+     * @return true if the directory could be listed
      */
-    void scanDirectory(const std::string& path, const std::vector<std::string>& exclude_paths,
-                       std::vector<FileEntry>& entries);
+    bool listDirectory(const std::string& path, bool is_virtual,
+                       const std::vector<std::string>& exclude_paths,
+                       std::vector<FileEntry>& entries, std::vector<std::string>& subdirectories);
 
     /**
      * @brief Check if a path should be excluded
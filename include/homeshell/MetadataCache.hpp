@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace homeshell
+{
+
+/**
+ * @brief Cached metadata of one path
+ */
+struct CachedMetadata
+{
+    bool exists = false;       ///< false for a cached "not found" result
+    bool is_directory = false; ///< true if the path is a directory
+    int64_t size = 0;          ///< File size in bytes (0 for directories)
+    int64_t mtime = 0;         ///< Last modification time
+};
+
+/**
+ * @brief Effectiveness counters of a MetadataCache
+ */
+struct MetadataCacheStats
+{
+    uint64_t hits = 0;   ///< Lookups answered from the cache
+    uint64_t misses = 0; ///< Lookups that had to query the mount
+    size_t entries = 0;  ///< Paths currently cached
+    size_t capacity = 0; ///< Maximum number of cached paths
+};
+
+/**
+ * @brief Bounded LRU cache of path metadata (a dentry cache)
+ *
+ * Used by VirtualFilesystem to answer exists/isDirectory/stat for paths
+ * inside encrypted mounts without a database round trip. Keys are absolute,
+ * normalized virtual paths. Negative results are cached as well, which is
+ * why invalidating a path also drops its ancestors: creating a file creates
+ * any missing parent directories.
+ *
+ * @details All member functions are thread-safe. Every invalidation
+ *          advances a generation counter; a caller that queried the mount
+ *          passes the generation it saw beforehand to insert(), so a result
+ *          read while another thread changed the path is not cached.
+ */
+class MetadataCache
+{
+public:
+    /// Default maximum number of cached paths
+    static constexpr size_t kDefaultCapacity = 4096;
+
+    /// Generation argument of insert() that skips the generation check
+    static constexpr uint64_t kAnyGeneration = ~uint64_t(0);
+
+    /**
+     * @brief Construct an empty cache
+     * @param capacity Maximum number of cached paths (least recently used are evicted)
+     */
+    explicit MetadataCache(size_t capacity = kDefaultCapacity)
+        : capacity_(capacity)
+    {
+    }
+
+    /**
+     * @brief Look up a path and count the hit or miss
+     * @param key Normalized absolute path
+     * @param[out] metadata Cached metadata (set on hit)
+     * @return true on hit, false on miss
+     */
+    bool lookup(const std::string& key, CachedMetadata& metadata);
+
+    /**
+     * @brief Insert or replace a path's metadata
+     * @param key Normalized absolute path
+     * @param metadata Metadata to cache
+     * @param generation generation() seen before the metadata was read; it is
+     *        not cached if anything was invalidated since
+     */
+    void insert(const std::string& key, const CachedMetadata& metadata,
+                uint64_t generation = kAnyGeneration);
+
+    /**
+     * @brief Drop a path and its ancestors
+     * @param key Normalized absolute path that was created or modified
+     */
+    void invalidate(const std::string& key);
+
+    /**
+     * @brief Drop a path, its ancestors and everything below it
+     * @param key Normalized absolute path that was removed or renamed
+     *
+     * @details Scans the whole cache; cost is bounded by the capacity.
+     */
+    void invalidateTree(const std::string& key);
+
+    /**
+     * @brief Drop all entries (counters are kept)
+     */
+    void clear();
+
+    /**
+     * @brief Get the current invalidation generation
+     */
+    uint64_t generation() const;
+
+    /**
+     * @brief Get hit/miss counters and occupancy
+     * @return Current statistics
+     */
+    MetadataCacheStats getStats() const;
+
+    /**
+     * @brief Reset the hit and miss counters
+     */
+    void resetStats();
+
+private:
+    using LruList = std::list<std::pair<std::string, CachedMetadata>>;
+
+    void eraseLocked(const std::string& key);
+    void eraseAncestorsLocked(const std::string& key);
+
+    mutable std::mutex mutex_;
+    LruList lru_; ///< Most recently used first
+    std::unordered_map<std::string, LruList::iterator> index_;
+    size_t capacity_;
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+    uint64_t generation_ = 0; ///< Advanced by every invalidation
+};
+
+} // namespace homeshell
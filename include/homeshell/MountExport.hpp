@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+namespace homeshell
+{
+
+class EncryptedMount;
+
+/**
+ * @brief Outcome of exportToDirectory() and exportToZip()
+ */
+struct ExportStats
+{
+    int64_t files = 0;       ///< Files exported
+    int64_t directories = 0; ///< Directories exported, not counting the exported one
+    int64_t bytes = 0;       ///< Bytes of file content exported
+    double seconds = 0.0;    ///< Wall-clock duration
+
+    /**
+     * @brief Get the export throughput in MiB per second
+     */
+    double mbPerSecond() const
+    {
+        return seconds > 0 ? bytes / (1024.0 * 1024.0) / seconds : 0.0;
+    }
+};
+
+/**
+ * @brief Copy a directory of an encrypted mount to a real directory
+ *
+ * Walks the mount with EncryptedMount::walkTree() and streams each file
+ * block by block into a file descriptor, so memory use does not depend on
+ * file sizes. Modification times are preserved.
+ *
+ * @param mount Source mount (unlocked on demand)
+ * @param source Directory within the mount to export ("/" for everything)
+ * @param dest Real directory to export into (created if missing); existing
+ *             files are overwritten
+ * @param[out] stats Counters and duration of the export
+ * @param[out] error Reason when false is returned
+ * @return true on success, false if source is not a directory or a read or write failed
+ */
+bool exportToDirectory(EncryptedMount& mount, const std::string& source,
+                       const std::filesystem::path& dest, ExportStats& stats, std::string& error);
+
+/**
+ * @brief Write a directory of an encrypted mount into a new ZIP archive
+ *
+ * Like exportToDirectory(), but miniz pulls each file's content through a
+ * read callback while compressing it, so no file is held in memory whole.
+ *
+ * @param mount Source mount (unlocked on demand)
+ * @param source Directory within the mount to export ("/" for everything)
+ * @param zip_path Archive to create (replaced if it exists)
+ * @param[out] stats Counters and duration of the export
+ * @param[out] error Reason when false is returned
+ * @return true on success, false if source is not a directory or a read or write failed
+ */
+bool exportToZip(EncryptedMount& mount, const std::string& source,
+                 const std::filesystem::path& zip_path, ExportStats& stats, std::string& error);
+
+} // namespace homeshell
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace homeshell
+{
+
+class EncryptedMount;
+
+/**
+ * @brief Tuning of importDirectory()
+ */
+struct ImportOptions
+{
+    int workers = 0;                         ///< Reader threads (0 = hardware concurrency, max 8)
+    int64_t block_bytes = 1024 * 1024;       ///< Bytes a reader hands to the writer at a time
+    int64_t queue_bytes = 64 * 1024 * 1024;  ///< Read-ahead buffered between readers and writer
+    int64_t batch_bytes = 256 * 1024 * 1024; ///< Bytes written per transaction
+};
+
+/**
+ * @brief Outcome of importDirectory()
+ */
+struct ImportStats
+{
+    int64_t files = 0;               ///< Files imported
+    int64_t directories = 0;         ///< Directories of the imported tree, including the target
+    int64_t bytes = 0;               ///< Bytes of file content written
+    int64_t commits = 0;             ///< Transactions committed
+    double seconds = 0.0;            ///< Wall-clock duration
+    std::vector<std::string> failed; ///< Source files that could not be read or written
+
+    /**
+     * @brief Get the import throughput in MiB per second
+     */
+    double mbPerSecond() const
+    {
+        return seconds > 0 ? bytes / (1024.0 * 1024.0) / seconds : 0.0;
+    }
+};
+
+/**
+ * @brief Copy a real directory tree into an encrypted mount
+ *
+ * Source files are read by a pool of worker threads in blocks and passed
+ * through a bounded queue to the calling thread, which is the mount's only
+ * writer. The writer keeps one transaction open until batch_bytes have been
+ * written, so the cost of a commit (and WAL sync) is paid per batch rather
+ * than per file, and reading overlaps with encryption and database writes.
+ * Memory use is bounded by queue_bytes regardless of file sizes.
+ *
+ * @param mount Destination mount (unlocked on demand)
+ * @param source Real directory to import; symlinks and special files are skipped
+ * @param dest Directory inside the mount to import into (created if missing)
+ * @param options Worker count and buffer sizes
+ * @param[out] stats Counters and duration of the import
+ * @param[out] error Reason when false is returned
+ * @return true if every readable file was imported, false if the source is not
+ *         a directory or a write into the mount failed (e.g. quota exceeded)
+ *
+ * @details Files that cannot be read are skipped and listed in stats.failed.
+ *          Existing files in the mount are overwritten. On a write error the
+ *          files completed so far are kept; files that were only partly
+ *          written are removed and listed in stats.failed.
+ */
+bool importDirectory(EncryptedMount& mount, const std::filesystem::path& source,
+                     const std::string& dest, const ImportOptions& options, ImportStats& stats,
+                     std::string& error);
+
+} // namespace homeshell
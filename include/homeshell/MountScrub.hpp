@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace homeshell
+{
+
+class EncryptedMount;
+
+/**
+ * @brief Tuning of scrubMount()
+ */
+struct ScrubOptions
+{
+    int workers = 0;                         ///< Reader threads (0 = hardware concurrency, max 8)
+    const std::atomic<bool>* stop = nullptr; ///< Stops the scrub early when set (may be null)
+};
+
+/**
+ * @brief Outcome of scrubMount()
+ */
+struct ScrubStats
+{
+    int64_t files = 0;                         ///< Files verified
+    int64_t chunks = 0;                        ///< Stored chunks read
+    int64_t unverified_chunks = 0;             ///< Chunks written before checksums were recorded
+    int64_t bytes = 0;                         ///< Bytes of file content read
+    double seconds = 0.0;                      ///< Wall-clock duration
+    bool stopped = false;                      ///< Stopped through ScrubOptions::stop
+    std::vector<std::string> integrity_errors; ///< Problems found by the database checks
+    std::vector<std::string> corrupt;          ///< Files with a bad chunk or that failed to read
+
+    /**
+     * @brief Check whether the scrub found no problem
+     */
+    bool clean() const
+    {
+        return integrity_errors.empty() && corrupt.empty();
+    }
+
+    /**
+     * @brief Get the verification throughput in MiB per second
+     */
+    double mbPerSecond() const
+    {
+        return seconds > 0 ? bytes / (1024.0 * 1024.0) / seconds : 0.0;
+    }
+};
+
+/**
+ * @brief Verify everything stored in an encrypted mount
+ *
+ * First runs EncryptedMount::checkIntegrity(), which checks the HMAC of
+ * every database page and the b-tree structure. Then a pool of worker
+ * threads re-reads every file with EncryptedMount::verifyFile(), on the
+ * mount's reader connections, and compares each chunk with the checksum
+ * recorded when it was written. The mount stays usable meanwhile.
+ *
+ * @param mount Mount to verify (unlocked on demand)
+ * @param options Worker count and stop flag
+ * @param[out] stats Counters, duration and the problems found
+ * @param[out] error Reason when false is returned
+ * @return true if the scrub ran to the end or was stopped (problems found
+ *         are in stats), false if the mount could not be read at all
+ */
+bool scrubMount(EncryptedMount& mount, const ScrubOptions& options, ScrubStats& stats,
+                std::string& error);
+
+} // namespace homeshell
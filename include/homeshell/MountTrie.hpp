@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace homeshell
+{
+
+class EncryptedMount;
+
+/**
+ * @brief Result of a MountTrie lookup
+ */
+struct MountMatch
+{
+    EncryptedMount* mount = nullptr; ///< Mount owning the path, nullptr if none
+    size_t length = 0;               ///< Length of the path prefix the mount point matched
+};
+
+/**
+ * @brief Path-component trie of mount points for longest-prefix lookup
+ *
+ * Used by VirtualFilesystem::resolvePath() to find the mount a path belongs
+ * to in one walk over the path's components, independent of the number of
+ * mounts. Mount points match whole components only: "/data" owns "/data"
+ * and "/data/x" but not "/database". When mount points nest, the deepest
+ * one wins.
+ *
+ * @details Not thread-safe; VirtualFilesystem rebuilds it when mounts are
+ *          added or removed.
+ */
+class MountTrie
+{
+public:
+    /**
+     * @brief Register a mount point
+     * @param mount_point Absolute mount point (empty components are ignored)
+     * @param mount Mount to return for paths under it
+     * @return true if added, false if the mount point is already taken
+     */
+    bool insert(std::string_view mount_point, EncryptedMount* mount);
+
+    /**
+     * @brief Remove all mount points
+     */
+    void clear();
+
+    /**
+     * @brief Find the deepest mount point that is the path or one of its ancestors
+     * @param path Normalized absolute path
+     * @return Matching mount and the length of the matched prefix of path
+     */
+    MountMatch findLongestPrefix(std::string_view path) const;
+
+    /**
+     * @brief Get the number of registered mount points
+     */
+    size_t size() const
+    {
+        return size_;
+    }
+
+private:
+    struct Node
+    {
+        /// Children by component; std::less<> allows lookup by string_view
+        std::map<std::string, std::unique_ptr<Node>, std::less<>> children;
+        EncryptedMount* mount = nullptr; ///< Mount point ending at this node
+    };
+
+    Node root_;
+    size_t size_ = 0;
+};
+
+} // namespace homeshell
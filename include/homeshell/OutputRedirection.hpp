@@ -53,6 +53,9 @@ struct RedirectInfo
  *          - Automatic stream restoration via RAII
  *          - Flush streams before/after redirection
  *          - Works with shell's color output control
+ *          - Targets inside encrypted mounts: output is spooled to a temporary
+ *            file and written to the mount on restore(), appended with
+ *            VirtualFilesystem::appendFile() for `>>`
  *
  *          Supported operators:
  *          - `>` - Redirect stdout, truncate file
@@ -105,12 +108,20 @@ public:
     }
 
 private:
+    /**
+     * @brief Write the spooled output of a virtual target into its mount
+     * @return true if all output was written
+     */
+    bool flushToVirtualFile();
+
     FILE* original_stdout_ = nullptr;
     FILE* original_stderr_ = nullptr;
     FILE* redirect_file_ = nullptr;
     int saved_stdout_fd_ = -1;
     int saved_stderr_fd_ = -1;
     bool redirected_ = false;
+    std::string virtual_path_;                           ///< Target inside a mount, empty if real
+    RedirectMode virtual_mode_ = RedirectMode::Truncate; ///< Mode for the virtual target
 };
 
 } // namespace homeshell
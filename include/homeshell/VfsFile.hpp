@@ -0,0 +1,251 @@
+#pragma once
+
+#include <cstdint>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+namespace homeshell
+{
+
+class EncryptedMount;
+
+/**
+ * @brief How a VfsFile is opened
+ */
+enum class VfsOpenMode
+{
+    Read,     ///< Read-only, file must exist
+    Write,    ///< Write-only, file is created or truncated
+    Append,   ///< Write-only, file is created if missing and writes go to the end
+    ReadWrite ///< Read and write, file is created if missing
+};
+
+/**
+ * @brief Reference point for VfsFile::seek()
+ */
+enum class VfsSeekOrigin
+{
+    Begin,   ///< Offset is relative to the start of the file
+    Current, ///< Offset is relative to the current position
+    End      ///< Offset is relative to the end of the file
+};
+
+/**
+ * @brief Streaming handle to a file on the real or virtual filesystem
+ *
+ * Obtained from VirtualFilesystem::openFile(). Real paths are backed by a
+ * file descriptor, paths inside encrypted mounts by chunk-level range reads
+ * and writes, so callers can process files of any size with a fixed-size
+ * buffer instead of loading them with VirtualFilesystem::readFile().
+ *
+ * @details Subclasses implement the positional primitives (pread, pwrite,
+ *          size, close); the cursor-based read/write/append/seek are built
+ *          on top of them here. Subclasses whose backend can append in one
+ *          step override append() so that concurrent appends cannot
+ *          overwrite each other. All sizes and offsets are in bytes, and all
+ *          I/O functions return -1 on error.
+ *
+ * Example usage:
+ * ```cpp
+ * auto file = vfs.openFile("/secure/log.txt", VfsOpenMode::Read);
+ * std::vector<char> buffer(64 * 1024);
+ * int64_t n;
+ * while ((n = file->read(buffer.data(), buffer.size())) > 0) {
+ *     process(buffer.data(), n);
+ * }
+ * ```
+ */
+class VfsFile
+{
+public:
+    virtual ~VfsFile() = default;
+
+    /**
+     * @brief Read from the current position and advance it
+     * @param buffer Destination buffer
+     * @param size Maximum number of bytes to read
+     * @return Number of bytes read (0 at end of file), or -1 on error
+     */
+    int64_t read(char* buffer, int64_t size);
+
+    /**
+     * @brief Write at the current position and advance it
+     * @param data Data to write
+     * @param size Number of bytes to write
+     * @return Number of bytes written, or -1 on error
+     */
+    int64_t write(const char* data, int64_t size);
+
+    /**
+     * @brief Write at the end of the file and move the position there
+     * @param data Data to write
+     * @param size Number of bytes to write
+     * @return Number of bytes written, or -1 on error
+     */
+    virtual int64_t append(const char* data, int64_t size);
+
+    /**
+     * @brief Move the current position
+     * @param offset Offset relative to origin
+     * @param origin Reference point for the offset
+     * @return New absolute position, or -1 if it would be negative
+     */
+    int64_t seek(int64_t offset, VfsSeekOrigin origin = VfsSeekOrigin::Begin);
+
+    /**
+     * @brief Get the current position
+     * @return Absolute byte offset of the cursor
+     */
+    int64_t tell() const
+    {
+        return position_;
+    }
+
+    /**
+     * @brief Read at an absolute offset without moving the position
+     * @param buffer Destination buffer
+     * @param size Maximum number of bytes to read
+     * @param offset Byte offset to read from
+     * @return Number of bytes read (0 at end of file), or -1 on error
+     */
+    virtual int64_t pread(char* buffer, int64_t size, int64_t offset) = 0;
+
+    /**
+     * @brief Write at an absolute offset without moving the position
+     * @param data Data to write
+     * @param size Number of bytes to write
+     * @param offset Byte offset to write at
+     * @return Number of bytes written, or -1 on error
+     */
+    virtual int64_t pwrite(const char* data, int64_t size, int64_t offset) = 0;
+
+    /**
+     * @brief Get the current file size
+     * @return File size in bytes, or -1 on error
+     */
+    virtual int64_t size() = 0;
+
+    /**
+     * @brief Release the underlying resources
+     *
+     * Called automatically on destruction; further I/O fails afterwards.
+     */
+    virtual void close() = 0;
+
+protected:
+    int64_t position_ = 0; ///< Current cursor position
+};
+
+/**
+ * @brief VfsFile backed by a POSIX file descriptor
+ */
+class RealVfsFile : public VfsFile
+{
+public:
+    /**
+     * @brief Wrap an open file descriptor (takes ownership)
+     * @param fd File descriptor returned by open()
+     */
+    explicit RealVfsFile(int fd)
+        : fd_(fd)
+    {
+    }
+
+    ~RealVfsFile() override
+    {
+        close();
+    }
+
+    RealVfsFile(const RealVfsFile&) = delete;
+    RealVfsFile& operator=(const RealVfsFile&) = delete;
+
+    int64_t pread(char* buffer, int64_t size, int64_t offset) override;
+    int64_t pwrite(const char* data, int64_t size, int64_t offset) override;
+    int64_t append(const char* data, int64_t size) override;
+    int64_t size() override;
+    void close() override;
+
+private:
+    int fd_; ///< Owned file descriptor (-1 once closed)
+};
+
+/**
+ * @brief VfsFile backed by a file inside an encrypted mount
+ *
+ * Each call only touches the chunks overlapping the requested range. The
+ * open mode is enforced like the flags of a file descriptor: Read handles
+ * refuse writes, Write and Append handles refuse reads, and every write of
+ * an Append handle goes to the end of the file.
+ */
+class MountVfsFile : public VfsFile
+{
+public:
+    /**
+     * @brief Create a handle for a file inside a mount
+     * @param mount Mount holding the file (must outlive the handle)
+     * @param path Path within the mount
+     * @param mode Mode the file was opened with
+     */
+    MountVfsFile(EncryptedMount* mount, const std::string& path,
+                 VfsOpenMode mode = VfsOpenMode::ReadWrite)
+        : mount_(mount)
+        , path_(path)
+        , mode_(mode)
+    {
+    }
+
+    int64_t pread(char* buffer, int64_t size, int64_t offset) override;
+    int64_t pwrite(const char* data, int64_t size, int64_t offset) override;
+    int64_t append(const char* data, int64_t size) override;
+    int64_t size() override;
+    void close() override;
+
+private:
+    EncryptedMount* mount_; ///< Owning mount (nullptr once closed)
+    std::string path_;      ///< Path within the mount
+    VfsOpenMode mode_;      ///< Mode the file was opened with
+    std::string scratch_;   ///< Reused read buffer
+};
+
+/**
+ * @brief Read-only std::streambuf over a VfsFile
+ *
+ * Lets existing std::istream based code (std::getline and friends) consume
+ * a VfsFile through a fixed-size buffer.
+ *
+ * Example usage:
+ * ```cpp
+ * VfsStreamBuf buf(*file);
+ * std::istream in(&buf);
+ * std::string line;
+ * while (std::getline(in, line)) { ... }
+ * ```
+ */
+class VfsStreamBuf : public std::streambuf
+{
+public:
+    /// Default buffer size in bytes
+    static constexpr size_t kBufferSize = 64 * 1024;
+
+    /**
+     * @brief Create a stream buffer reading from the file's current position
+     * @param file File to read from (must outlive the stream buffer)
+     * @param buffer_size Size of the internal read buffer
+     */
+    explicit VfsStreamBuf(VfsFile& file, size_t buffer_size = kBufferSize)
+        : file_(file)
+        , buffer_(buffer_size)
+    {
+        setg(buffer_.data(), buffer_.data(), buffer_.data());
+    }
+
+protected:
+    int_type underflow() override;
+
+private:
+    VfsFile& file_;
+    std::vector<char> buffer_;
+};
+
+} // namespace homeshell
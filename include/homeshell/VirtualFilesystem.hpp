@@ -2,10 +2,14 @@
 
 #include <homeshell/EncryptedMount.hpp>
 #include <homeshell/FilesystemHelper.hpp>
+#include <homeshell/MetadataCache.hpp>
+#include <homeshell/MountTrie.hpp>
+#include <homeshell/VfsFile.hpp>
 
 #include <map>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace homeshell
@@ -50,6 +54,11 @@ struct ResolvedPath
  *          - /real/path/file.txt  → regular filesystem
  *          - /secure/file.txt     → encrypted mount named "secure"
  *
+ *          Metadata lookups on mount paths (exists, isDirectory, stat) are
+ *          served from a bounded LRU cache. Each mount reports its own
+ *          writes, removals and renames to invalidate the affected entries;
+ *          listDirectory() pre-populates the cache with the listed children.
+ *
  *          This class is thread-safe through the singleton pattern but does not
  *          provide internal synchronization for mount operations.
  */
@@ -100,6 +109,17 @@ public:
      */
     ResolvedPath resolvePath(const std::string& path) const;
 
+    /**
+     * @brief Make a path absolute and resolve ".", ".." and repeated slashes
+     * @param base Absolute directory relative paths are resolved against
+     * @param path Absolute or relative path
+     * @return Normalized absolute path without a trailing slash ("/" for the root)
+     *
+     * @details Purely lexical (symlinks are not followed), and builds the
+     *          result in a single allocation.
+     */
+    static std::string normalizePath(std::string_view base, std::string_view path);
+
     /**
      * @brief Check if a path points to a virtual mount
      * @param path Path to check
@@ -154,6 +174,31 @@ public:
      */
     bool isDirectory(const std::string& path);
 
+    /**
+     * @brief Get type, size and modification time of a path
+     * @param path Path to query (real or virtual)
+     * @param[out] info Metadata (path is the resolved absolute path)
+     * @return true if the path exists, false otherwise
+     */
+    bool stat(const std::string& path, VirtualFileInfo& info);
+
+    /**
+     * @brief Get hit/miss counters of the mount metadata cache
+     * @return Current cache statistics
+     */
+    MetadataCacheStats getMetadataCacheStats() const
+    {
+        return metadata_cache_.getStats();
+    }
+
+    /**
+     * @brief Reset the metadata cache hit/miss counters
+     */
+    void resetMetadataCacheStats()
+    {
+        metadata_cache_.resetStats();
+    }
+
     /**
      * @brief Read entire file contents
      * @param path File path (real or virtual)
@@ -170,6 +215,29 @@ public:
      */
     bool writeFile(const std::string& path, const std::string& content);
 
+    /**
+     * @brief Append data to a file, creating it if missing
+     * @param path File path (real or virtual)
+     * @param content Data to append
+     * @return true if write successful, false otherwise
+     *
+     * @details On a mount only the tail of the file is rewritten, not the whole file.
+     */
+    bool appendFile(const std::string& path, const std::string& content);
+
+    /**
+     * @brief Open a streaming handle to a file
+     * @param path File path (real or virtual)
+     * @param mode How to open the file
+     * @return File handle, or nullptr if the file cannot be opened (missing in
+     *         Read mode, a directory, or an unmounted mount)
+     *
+     * @details Prefer this over readFile() for anything that can process the
+     *          file incrementally; memory use is bounded by the caller's buffer.
+     */
+    std::unique_ptr<VfsFile> openFile(const std::string& path,
+                                      VfsOpenMode mode = VfsOpenMode::Read);
+
     /**
      * @brief Create a directory
      * @param path Directory path to create (real or virtual)
@@ -184,6 +252,18 @@ public:
      */
     bool remove(const std::string& path);
 
+    /**
+     * @brief Rename or move a file or directory
+     * @param from Existing path (real or virtual)
+     * @param to New path (real or virtual)
+     * @return true if successful, false on error or if the paths are on
+     *         different filesystems (different mounts, or real and virtual)
+     *
+     * @details Within a mount this is EncryptedMount::rename(), which only
+     *          rewrites metadata; real paths use std::filesystem::rename().
+     */
+    bool rename(const std::string& from, const std::string& to);
+
     ~VirtualFilesystem() noexcept
     {
         try
@@ -191,6 +271,7 @@ public:
             // During program shutdown, we cannot safely call SQLite functions
             // because SQLCipher's global state may already be destroyed.
             // Just clear the map and let the OS clean up file handles.
+            mount_trie_.clear();
             mounts_.clear();
         }
         catch (...)
@@ -207,10 +288,83 @@ private:
     VirtualFilesystem(const VirtualFilesystem&) = delete;
     VirtualFilesystem& operator=(const VirtualFilesystem&) = delete;
 
-    std::string resolveRelativePath(const std::string& path) const;
+    /**
+     * @brief Rebuild mount_trie_ from mounts_
+     */
+    void rebuildMountTrie();
+
+    /**
+     * @brief Get metadata of a mount path, from the cache if possible
+     * @param resolved Resolved virtual path
+     * @param[out] metadata Metadata (exists is false for missing paths)
+     * @return true if the path exists in a mounted mount
+     */
+    bool statVirtual(const ResolvedPath& resolved, CachedMetadata& metadata);
 
     std::map<std::string, std::shared_ptr<EncryptedMount>> mounts_;
     std::string current_directory_;
+    MetadataCache metadata_cache_; ///< Metadata of mount paths
+    MountTrie mount_trie_;         ///< Mount points of mounts_ for resolvePath()
+};
+
+/**
+ * @brief Scoped guard that batches writes into one encrypted mount
+ *
+ * Groups all operations on the mount into a single transaction until the
+ * guard is destroyed (or commit() is called), so bulk importers pay for one
+ * commit instead of one per file. Guards nest safely. Constructed for a real
+ * path or an unmounted mount, the guard does nothing.
+ *
+ * Example usage:
+ * ```cpp
+ * VfsBatch batch(dest_dir);
+ * for (const auto& entry : entries) {
+ *     vfs.writeFile(dest_dir + "/" + entry.name, entry.data);
+ * }
+ * ```
+ */
+class VfsBatch
+{
+public:
+    /**
+     * @brief Batch writes into a mount
+     * @param mount Mount to batch (may be nullptr; must outlive the guard)
+     */
+    explicit VfsBatch(EncryptedMount* mount)
+        : mount_(mount && mount->beginBatch() ? mount : nullptr)
+    {
+    }
+
+    /**
+     * @brief Batch writes into the mount containing a path
+     * @param path Path (real or virtual) whose mount should be batched
+     */
+    explicit VfsBatch(const std::string& path)
+        : VfsBatch(VirtualFilesystem::getInstance().resolvePath(path).mount)
+    {
+    }
+
+    ~VfsBatch()
+    {
+        commit();
+    }
+
+    VfsBatch(const VfsBatch&) = delete;
+    VfsBatch& operator=(const VfsBatch&) = delete;
+
+    /**
+     * @brief End the batch before the guard goes out of scope
+     * @return true if committed (or nothing to commit), false on error
+     */
+    bool commit()
+    {
+        EncryptedMount* mount = mount_;
+        mount_ = nullptr;
+        return !mount || mount->endBatch();
+    }
+
+private:
+    EncryptedMount* mount_; ///< Batched mount (nullptr if none or already committed)
 };
 
 } // namespace homeshell
@@ -7,6 +7,7 @@
 #include <fmt/color.h>
 
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace homeshell
@@ -98,15 +99,30 @@ public:
             return Status::error("Is a directory: " + path);
         }
 
-        std::string content;
-        if (!vfs.readFile(path, content))
+        auto file = vfs.openFile(path);
+        if (!file)
         {
             fmt::print(fg(fmt::color::red), "Error: Failed to read file '{}'\n", path);
             return Status::error("Failed to read file: " + path);
         }
 
-        fmt::print("{}", content);
-        if (!content.empty() && content.back() != '\n')
+        // Stream the file through a fixed-size buffer
+        std::vector<char> buffer(VfsStreamBuf::kBufferSize);
+        char last = '\n';
+        int64_t n;
+        while ((n = file->read(buffer.data(), static_cast<int64_t>(buffer.size()))) > 0)
+        {
+            fmt::print("{}", std::string_view(buffer.data(), static_cast<size_t>(n)));
+            last = buffer[n - 1];
+        }
+
+        if (n < 0)
+        {
+            fmt::print(fg(fmt::color::red), "Error: Failed to read file '{}'\n", path);
+            return Status::error("Failed to read file: " + path);
+        }
+
+        if (last != '\n')
         {
             fmt::print("\n");
         }
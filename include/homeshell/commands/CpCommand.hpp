@@ -7,6 +7,7 @@
 
 #include <homeshell/Command.hpp>
 #include <homeshell/Status.hpp>
+#include <homeshell/VirtualFilesystem.hpp>
 
 #include <sys/stat.h>
 
@@ -66,9 +67,20 @@ public:
         std::string dest = files.back();
         files.pop_back();
 
+        auto& vfs = VirtualFilesystem::getInstance();
+
+        // Commit everything copied into a mount at once
+        VfsBatch batch(dest);
+
         // Copy each source
         for (const auto& src : files)
         {
+            if (vfs.isVirtualPath(src) || vfs.isVirtualPath(dest))
+            {
+                copyVirtual(src, dest, recursive, verbose);
+                continue;
+            }
+
             if (!std::filesystem::exists(src))
             {
                 std::cerr << "cp: cannot stat '" << src << "': No such file or directory\n";
@@ -91,6 +103,13 @@ public:
 
                 if (std::filesystem::is_directory(src))
                 {
+                    if (isSameOrInside(std::filesystem::weakly_canonical(src).string(),
+                                       std::filesystem::weakly_canonical(dest_path).string()))
+                    {
+                        std::cerr << "cp: cannot copy a directory, '" << src
+                                  << "', into itself, '" << dest_path.string() << "'\n";
+                        continue;
+                    }
                     std::filesystem::copy(src, dest_path, std::filesystem::copy_options::recursive);
                 }
                 else
@@ -114,6 +133,120 @@ public:
     }
 
 private:
+    /**
+     * @brief Copy a source where either side is inside an encrypted mount
+     */
+    void copyVirtual(const std::string& src, const std::string& dest, bool recursive,
+                     bool verbose)
+    {
+        auto& vfs = VirtualFilesystem::getInstance();
+
+        if (!vfs.exists(src))
+        {
+            std::cerr << "cp: cannot stat '" << src << "': No such file or directory\n";
+            return;
+        }
+
+        if (vfs.isDirectory(src) && !recursive)
+        {
+            std::cerr << "cp: -r not specified; omitting directory '" << src << "'\n";
+            return;
+        }
+
+        std::string dest_path = dest;
+        if (vfs.isDirectory(dest))
+        {
+            dest_path += "/" + std::filesystem::path(src).filename().string();
+        }
+
+        // The copy would list its own output and never end
+        if (vfs.isDirectory(src) && isSameOrInside(src, dest_path))
+        {
+            std::cerr << "cp: cannot copy a directory, '" << src << "', into itself, '"
+                      << dest_path << "'\n";
+            return;
+        }
+
+        if (!copyTree(src, dest_path))
+        {
+            std::cerr << "cp: cannot copy '" << src << "' to '" << dest_path << "'\n";
+            return;
+        }
+
+        if (verbose)
+        {
+            std::cout << "'" << src << "' -> '" << dest_path << "'\n";
+        }
+    }
+
+    /**
+     * @brief Recursively copy through the VirtualFilesystem, streaming file contents
+     * @return true if every entry was copied
+     */
+    bool copyTree(const std::string& src, const std::string& dest)
+    {
+        auto& vfs = VirtualFilesystem::getInstance();
+
+        if (vfs.isDirectory(src))
+        {
+            // Listed first so that the new directory is never part of it
+            auto entries = vfs.listDirectory(src);
+            if (!vfs.isDirectory(dest) && !vfs.createDirectory(dest))
+            {
+                return false;
+            }
+
+            bool success = true;
+            for (const auto& entry : entries)
+            {
+                success = copyTree(src + "/" + entry.name, dest + "/" + entry.name) && success;
+            }
+            return success;
+        }
+
+        auto in = vfs.openFile(src, VfsOpenMode::Read);
+        auto out = vfs.openFile(dest, VfsOpenMode::Write);
+        if (!in || !out)
+        {
+            return false;
+        }
+
+        std::vector<char> buffer(VfsStreamBuf::kBufferSize);
+        int64_t n;
+        while ((n = in->read(buffer.data(), static_cast<int64_t>(buffer.size()))) > 0)
+        {
+            if (out->write(buffer.data(), n) != n)
+            {
+                return false;
+            }
+        }
+        return n == 0;
+    }
+
+    /**
+     * @brief Check whether dest is the directory src or lies below it
+     */
+    static bool isSameOrInside(const std::string& src, const std::string& dest)
+    {
+        auto normalize = [](const std::string& path)
+        {
+            std::string norm = std::filesystem::path(path).lexically_normal().string();
+            while (norm.size() > 1 && norm.back() == '/')
+            {
+                norm.pop_back();
+            }
+            return norm;
+        };
+
+        std::string norm_src = normalize(src);
+        std::string norm_dest = normalize(dest);
+        if (norm_src == "/")
+        {
+            return !norm_dest.empty() && norm_dest.front() == '/';
+        }
+        return norm_dest == norm_src || norm_dest.rfind(norm_src + "/", 0) == 0;
+    }
+
     void showHelp() const
     {
         std::cout << "Usage: cp [OPTION]... SOURCE DEST\n"
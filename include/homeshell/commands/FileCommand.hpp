@@ -152,14 +152,17 @@ public:
                 continue;
             }
 
-            // Read file content
-            std::string content;
-            if (!vfs.readFile(path, content))
+            // Only the start of the file is needed to identify it
+            auto file = vfs.openFile(path);
+            std::string content(kSniffSize, '\0');
+            int64_t n = file ? file->read(content.data(), kSniffSize) : -1;
+            if (n < 0)
             {
                 fmt::print("{}: {}\n", path, fmt::format(fg(fmt::color::red), "cannot read file"));
                 all_success = false;
                 continue;
             }
+            content.resize(static_cast<size_t>(n));
 
             std::string type = detectFileType(path, content);
             fmt::print("{}: {}\n", path, type);
@@ -169,6 +172,9 @@ public:
     }
 
 private:
+    /// Number of leading bytes inspected to determine the file type
+    static constexpr int64_t kSniffSize = 64 * 1024;
+
     std::string detectFileType(const std::string& path, const std::string& content)
     {
         if (content.empty())
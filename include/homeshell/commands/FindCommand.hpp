@@ -3,12 +3,16 @@
 #include <homeshell/Command.hpp>
 #include <homeshell/Status.hpp>
 
+#include <cstdint>
+#include <limits>
 #include <string>
 #include <vector>
 
 namespace homeshell
 {
 
+struct ResolvedPath;
+
 /**
  * @brief Find command - search for files and directories
  *
@@ -22,6 +26,13 @@ namespace homeshell
  *          - -iname <pattern>: Case-insensitive name matching
  *          - -type <f|d>: Filter by type (f=file, d=directory)
  *          - -maxdepth <n>: Limit recursion depth
+ *          - -size [+-]<n>[cwbkMG]: Size of n units, more (+) or less (-)
+ *          - -mtime [+-]<n>: Modified n days ago, more (+) or less (-)
+ *          - -newer <file>: Modified more recently than file
+ *
+ * On encrypted mounts the size and time predicates become bounds of an
+ * EncryptedMount::findFiles() query, answered from the mount's size and
+ * modification time indexes instead of by listing every directory.
  *
  * Example: find /tmp -name "test.txt" -type f -maxdepth 2
  */
@@ -71,6 +82,20 @@ private:
         FileType type = FileType::All; ///< Type filter
         bool case_insensitive = false; ///< Case-insensitive matching
         int max_depth = -1;            ///< Maximum recursion depth (-1 = unlimited)
+
+        // Inclusive bounds; times in std::chrono::system_clock ticks
+        int64_t min_size = 0;                                    ///< Smallest size in bytes
+        int64_t max_size = std::numeric_limits<int64_t>::max();  ///< Largest size in bytes
+        int64_t min_mtime = std::numeric_limits<int64_t>::min(); ///< Earliest modification time
+        int64_t max_mtime = std::numeric_limits<int64_t>::max(); ///< Latest modification time
+
+        /// Check whether any size or time bound is set
+        bool hasBounds() const
+        {
+            return min_size > 0 || max_size != std::numeric_limits<int64_t>::max() ||
+                   min_mtime != std::numeric_limits<int64_t>::min() ||
+                   max_mtime != std::numeric_limits<int64_t>::max();
+        }
     };
 
     /**
@@ -83,6 +108,48 @@ private:
     void findRecursive(const std::string& path, const FindOptions& options, int current_depth,
                        const CommandContext& context);
 
+    /**
+     * @brief Search below a path inside an encrypted mount
+     * @param start Resolved start path (a virtual path)
+     * @param options Search criteria
+     * @param context Command context for output formatting
+     */
+    void findVirtual(const ResolvedPath& start, const FindOptions& options,
+                     const CommandContext& context);
+
+    /**
+     * @brief Narrow the size bounds by a -size argument
+     * @param arg Argument such as "+10M", "-4k" or "100c"
+     * @param options Options whose bounds are narrowed
+     * @return true if arg is valid
+     */
+    bool parseSize(const std::string& arg, FindOptions& options);
+
+    /**
+     * @brief Narrow the modification time bounds by a -mtime argument
+     * @param arg Argument such as "+7", "-1" or "0" (days)
+     * @param options Options whose bounds are narrowed
+     * @return true if arg is valid
+     */
+    bool parseMtime(const std::string& arg, FindOptions& options);
+
+    /**
+     * @brief Get the modification time of a real or virtual path
+     * @param path Path to inspect
+     * @param[out] mtime Modification time in std::chrono::system_clock ticks,
+     *             the unit of VirtualFileInfo::mtime
+     * @return true if the path exists
+     */
+    bool modificationTime(const std::string& path, int64_t& mtime);
+
+    /**
+     * @brief Check a real path against the size and modification time bounds
+     * @param path Real path
+     * @param options Search criteria
+     * @return true if the path is within all bounds
+     */
+    bool withinBounds(const std::string& path, const FindOptions& options);
+
     /**
      * @brief Check if a filename matches the pattern
      * @param filename File name to test
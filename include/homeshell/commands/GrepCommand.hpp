@@ -1,6 +1,7 @@
 #pragma once
 
 #include <homeshell/Command.hpp>
+#include <homeshell/EncryptedMount.hpp>
 #include <homeshell/Status.hpp>
 #include <homeshell/VirtualFilesystem.hpp>
 
@@ -8,6 +9,7 @@
 #include <fmt/core.h>
 
 #include <algorithm>
+#include <cctype>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
@@ -32,6 +34,9 @@ namespace homeshell
  *          - Reading from standard input when no files specified.
  *          - Colored output highlighting matches (when stdout is a TTY).
  *          - Works with both regular filesystem and encrypted virtual mounts.
+ *          - Recursive searches of mounts with a text index
+ *            (MountOptions::text_index) only read the files the index says
+ *            may contain the literal parts of the pattern.
  *          - Multiple file search with filename prefixes.
  *
  *          Command syntax:
@@ -211,6 +216,9 @@ public:
 
         int match_count = 0;
 
+        // Strings every match contains, for looking up candidate files in text indexes
+        std::vector<std::string> literals = requiredLiterals(pattern);
+
         // Determine if we should show filenames
         bool show_filename = with_filename;
         if (!no_filename && !with_filename)
@@ -231,8 +239,8 @@ public:
             {
                 if (recursive)
                 {
-                    match_count += searchRecursive(file, regex_pattern, show_line_numbers,
-                                                   show_filename, use_color);
+                    match_count += searchRecursive(file, regex_pattern, literals,
+                                                   show_line_numbers, show_filename, use_color);
                 }
                 else
                 {
@@ -282,33 +290,23 @@ private:
         auto& vfs = VirtualFilesystem::getInstance();
         auto resolved = vfs.resolvePath(filename);
 
-        std::string content;
-
-        // Try VFS first
-        if (vfs.exists(resolved.full_path))
+        auto file = vfs.openFile(resolved.full_path);
+        if (!file)
         {
-            if (!vfs.readFile(resolved.full_path, content))
+            if (vfs.exists(resolved.full_path))
             {
                 fmt::print(fg(fmt::color::red), "grep: {}: Failed to read file\n", filename);
-                return 0;
             }
-        }
-        else
-        {
-            // Try regular filesystem
-            std::ifstream file(filename);
-            if (!file.good())
+            else
             {
                 fmt::print(fg(fmt::color::red), "grep: {}: No such file or directory\n", filename);
-                return 0;
             }
-
-            std::stringstream buffer;
-            buffer << file.rdbuf();
-            content = buffer.str();
+            return 0;
         }
 
-        std::istringstream stream(content);
+        // Stream the file line by line instead of loading it whole
+        VfsStreamBuf buf(*file);
+        std::istream stream(&buf);
         return searchStream(stream, pattern, filename, show_line_numbers, show_filename, use_color);
     }
 
@@ -381,11 +379,19 @@ private:
     /**
      * @brief Search recursively in a directory
      */
-    int searchRecursive(const std::string& path, const std::regex& pattern, bool show_line_numbers,
+    int searchRecursive(const std::string& path, const std::regex& pattern,
+                        const std::vector<std::string>& literals, bool show_line_numbers,
                         bool show_filename, bool use_color)
     {
         int match_count = 0;
 
+        auto resolved = VirtualFilesystem::getInstance().resolvePath(path);
+        if (resolved.type == PathType::Virtual)
+        {
+            return searchVirtualTree(path, resolved, pattern, literals, show_line_numbers,
+                                     show_filename, use_color);
+        }
+
         try
         {
             std::filesystem::path fs_path(path);
@@ -422,6 +428,160 @@ private:
         return match_count;
     }
 
+    /**
+     * @brief Search recursively below a path inside an encrypted mount
+     */
+    int searchVirtualTree(const std::string& path, const ResolvedPath& resolved,
+                          const std::regex& pattern, const std::vector<std::string>& literals,
+                          bool show_line_numbers, bool show_filename, bool use_color)
+    {
+        VirtualFileInfo info;
+        if (!VirtualFilesystem::getInstance().stat(resolved.full_path, info))
+        {
+            fmt::print(fg(fmt::color::red), "grep: {}: No such file or directory\n", path);
+            return 0;
+        }
+        if (!info.is_directory)
+        {
+            return searchFile(path, pattern, show_line_numbers, show_filename, use_color);
+        }
+
+        // The text index narrows the search to candidate files; without one
+        // (or without usable literals) every file is read
+        std::vector<std::string> files;
+        if (!resolved.mount->findTextCandidates(resolved.relative_path, literals, files))
+        {
+            FileQuery query;
+            query.path = resolved.relative_path;
+            std::vector<VirtualFileInfo> entries;
+            resolved.mount->findFiles(query, entries);
+            for (const auto& entry : entries)
+            {
+                files.push_back(entry.path);
+            }
+        }
+
+        int match_count = 0;
+        for (const auto& file : files)
+        {
+            std::string virtual_path =
+                resolved.mount_point == "/" ? file : resolved.mount_point + file;
+            match_count +=
+                searchFile(virtual_path, pattern, show_line_numbers, show_filename, use_color);
+        }
+        return match_count;
+    }
+
+    /**
+     * @brief Get literal strings that every match of a regular expression contains
+     * @param pattern ECMAScript regular expression
+     * @return Literal runs outside groups and classes, or nothing if the
+     *         pattern has alternatives
+     *
+     * @details Conservative: a character made optional by a quantifier ends
+     *          a run without being part of it, and anything not understood
+     *          ends the current run.
+     */
+    static std::vector<std::string> requiredLiterals(const std::string& pattern)
+    {
+        std::vector<std::string> literals;
+        std::string run;
+        auto flush = [&]()
+        {
+            if (!run.empty())
+            {
+                literals.push_back(run);
+                run.clear();
+            }
+        };
+
+        int depth = 0;
+        for (size_t i = 0; i < pattern.size(); ++i)
+        {
+            char c = pattern[i];
+            switch (c)
+            {
+            case '|':
+                // Any alternative may match without the literals
+                return {};
+            case '\\':
+                if (i + 1 < pattern.size() &&
+                    !std::isalnum(static_cast<unsigned char>(pattern[i + 1])))
+                {
+                    if (depth == 0)
+                    {
+                        run += pattern[i + 1];
+                    }
+                }
+                else
+                {
+                    flush(); // Character class, assertion or back-reference
+                }
+                ++i;
+                break;
+            case '[':
+            {
+                flush();
+                size_t j = i + 1;
+                if (j < pattern.size() && pattern[j] == '^')
+                {
+                    ++j;
+                }
+                if (j < pattern.size() && pattern[j] == ']')
+                {
+                    ++j;
+                }
+                while (j < pattern.size() && pattern[j] != ']')
+                {
+                    j += pattern[j] == '\\' ? 2 : 1;
+                }
+                i = j;
+                break;
+            }
+            case '(':
+                flush();
+                ++depth;
+                break;
+            case ')':
+                flush();
+                depth = std::max(0, depth - 1);
+                break;
+            case '*':
+            case '?':
+            case '{':
+                // The preceding character is optional: drop it (a whole UTF-8 sequence)
+                while (!run.empty() && (static_cast<unsigned char>(run.back()) & 0xC0) == 0x80)
+                {
+                    run.pop_back();
+                }
+                if (!run.empty())
+                {
+                    run.pop_back();
+                }
+                flush();
+                if (c == '{')
+                {
+                    i = std::min(pattern.find('}', i), pattern.size());
+                }
+                break;
+            case '+':
+            case '.':
+            case '^':
+            case '$':
+                flush();
+                break;
+            default:
+                if (depth == 0)
+                {
+                    run += c;
+                }
+                break;
+            }
+        }
+        flush();
+        return literals;
+    }
+
     /**
      * @brief Highlight all matches in a line
      */
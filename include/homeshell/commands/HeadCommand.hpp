@@ -218,18 +218,19 @@ private:
             return Status::error("Is a directory");
         }
 
-        std::string content;
-        if (!vfs.readFile(path, content))
+        auto file = vfs.openFile(path);
+        if (!file)
         {
             return Status::error("Failed to read file");
         }
 
-        // Split into lines and print first N
-        std::istringstream iss(content);
+        // Stream lines so only the first N are ever read
+        VfsStreamBuf buf(*file);
+        std::istream in(&buf);
         std::string line;
         int count = 0;
 
-        while (count < num_lines && std::getline(iss, line))
+        while (count < num_lines && std::getline(in, line))
         {
             std::cout << line << "\n";
             count++;
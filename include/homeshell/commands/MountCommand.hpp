@@ -33,7 +33,7 @@ namespace homeshell
  *
  * **Usage:**
  * @code
- * mount <name> <db_path> <mount_point> [password] [max_size_mb]
+ * mount [options] <name> <db_path> <mount_point> [password] [max_size_mb]
  * @endcode
  *
  * **Parameters:**
@@ -43,6 +43,16 @@ namespace homeshell
  * - `password` - Encryption password (optional, prompted if omitted - RECOMMENDED)
  * - `max_size_mb` - Maximum storage size in MB (optional, default: 100MB)
  *
+ * **Options:**
+ * - `--cipher-page-size <bytes>` - SQLCipher page size (default: 4096)
+ * - `--kdf-iter <n>` - SQLCipher PBKDF2 iterations (default: SQLCipher's)
+ *
+ * Both are fixed when the database is created: a database can only be
+ * opened with the values it was created with, and a mismatch fails like a
+ * wrong password. Pass the same values as the `cipher_page_size` and
+ * `kdf_iter` of its MountConfig when mounting a configured database by hand.
+ * All other MountOptions keep their defaults.
+ *
  * **Examples:**
  * @code
  * # Mount with password prompt (recommended - secure)
@@ -55,6 +65,9 @@ namespace homeshell
  * # Mount with custom size
  * mount large ~/.homeshell/large.db /large "" 500
  * # Empty string triggers password prompt, 500MB quota
+ *
+ * # Mount a database created with a larger page size
+ * mount --cipher-page-size 16384 archive ~/archive.db /archive
  * @endcode
  *
  * **Password Security:**
@@ -79,12 +92,14 @@ namespace homeshell
  * **Subsequent Mounts:**
  * - Password must match original encryption password
  * - Wrong password returns "Failed to mount" error
+ * - So do a cipher page size or KDF iteration count other than at creation
  * - All previously stored files become accessible
  *
  * **Error Conditions:**
  * - Insufficient arguments: Shows usage message
  * - Empty password: Not allowed
  * - Invalid max_size_mb: Must be positive integer
+ * - Invalid --cipher-page-size or --kdf-iter: Must be positive integer
  * - Mount name conflict: Name already in use
  * - Database file errors: Permission denied, disk full
  * - Wrong password: Cannot decrypt existing database
@@ -138,24 +153,68 @@ public:
 
     Status execute(const CommandContext& context) override
     {
-        if (context.args.size() < 3)
+        // Options may appear anywhere; everything else is positional
+        MountOptions options;
+        std::vector<std::string> args;
+        for (size_t i = 0; i < context.args.size(); ++i)
+        {
+            const std::string& arg = context.args[i];
+            if (arg == "--cipher-page-size" || arg == "--kdf-iter")
+            {
+                int value = 0;
+                if (i + 1 < context.args.size())
+                {
+                    try
+                    {
+                        value = std::stoi(context.args[++i]);
+                    }
+                    catch (...)
+                    {
+                        value = 0;
+                    }
+                }
+                if (value <= 0)
+                {
+                    fmt::print(fg(fmt::color::red), "Error: Invalid {} value\n", arg);
+                    return Status::error("Invalid " + arg.substr(2));
+                }
+                if (arg == "--kdf-iter")
+                {
+                    options.kdf_iter = value;
+                }
+                else
+                {
+                    options.cipher_page_size = value;
+                }
+            }
+            else
+            {
+                args.push_back(arg);
+            }
+        }
+
+        if (args.size() < 3)
         {
             fmt::print(fg(fmt::color::red), "Error: Insufficient arguments\n");
-            fmt::print("Usage: mount <name> <db_path> <mount_point> [password] [max_size_mb]\n");
+            fmt::print("Usage: mount [options] <name> <db_path> <mount_point> [password] "
+                       "[max_size_mb]\n");
             fmt::print("  If password is omitted, you will be prompted to enter it.\n");
+            fmt::print("Options (must match the values the database was created with):\n");
+            fmt::print("  --cipher-page-size <bytes>  SQLCipher page size (default 4096)\n");
+            fmt::print("  --kdf-iter <n>              SQLCipher PBKDF2 iterations\n");
             return Status::error("Insufficient arguments");
         }
 
-        std::string name = context.args[0];
-        std::string db_path = context.args[1];
-        std::string mount_point = context.args[2];
+        std::string name = args[0];
+        std::string db_path = args[1];
+        std::string mount_point = args[2];
         std::string password;
         int64_t max_size_mb = 100;
 
         // Password is optional - prompt if not provided
-        if (context.args.size() >= 4)
+        if (args.size() >= 4)
         {
-            password = context.args[3];
+            password = args[3];
         }
         else
         {
@@ -171,11 +230,11 @@ public:
         }
 
         // Max size is optional
-        if (context.args.size() >= 5)
+        if (args.size() >= 5)
         {
             try
             {
-                max_size_mb = std::stoll(context.args[4]);
+                max_size_mb = std::stoll(args[4]);
             }
             catch (...)
             {
@@ -185,12 +244,15 @@ public:
         }
 
         // Create mount
-        auto mount = std::make_shared<EncryptedMount>(name, db_path, mount_point, max_size_mb);
+        auto mount =
+            std::make_shared<EncryptedMount>(name, db_path, mount_point, max_size_mb, options);
 
         if (!mount->mount(password))
         {
             fmt::print(fg(fmt::color::red), "Error: Failed to mount '{}'\n", name);
             fmt::print("Check that the password is correct and the file is accessible.\n");
+            fmt::print("A database created with --cipher-page-size or --kdf-iter needs the same "
+                       "values.\n");
             return Status::error("Mount failed");
         }
 
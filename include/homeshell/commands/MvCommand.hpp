@@ -7,6 +7,7 @@
 
 #include <homeshell/Command.hpp>
 #include <homeshell/Status.hpp>
+#include <homeshell/VirtualFilesystem.hpp>
 
 #include <filesystem>
 #include <iostream>
@@ -61,9 +62,17 @@ public:
         std::string dest = files.back();
         files.pop_back();
 
+        auto& vfs = VirtualFilesystem::getInstance();
+
         // Move each source
         for (const auto& src : files)
         {
+            if (vfs.isVirtualPath(src) || vfs.isVirtualPath(dest))
+            {
+                moveVirtual(src, dest, verbose);
+                continue;
+            }
+
             if (!std::filesystem::exists(src))
             {
                 std::cerr << "mv: cannot stat '" << src << "': No such file or directory\n";
@@ -95,6 +104,49 @@ public:
     }
 
 private:
+    /**
+     * @brief Move a source where either side is inside an encrypted mount
+     *
+     * Moves within one mount only rewrite metadata (EncryptedMount::rename),
+     * so they take the same time regardless of how much data is moved.
+     */
+    void moveVirtual(const std::string& src, const std::string& dest, bool verbose)
+    {
+        auto& vfs = VirtualFilesystem::getInstance();
+
+        if (!vfs.exists(src))
+        {
+            std::cerr << "mv: cannot stat '" << src << "': No such file or directory\n";
+            return;
+        }
+
+        std::string dest_path = dest;
+        if (vfs.isDirectory(dest))
+        {
+            dest_path += "/" + std::filesystem::path(src).filename().string();
+        }
+
+        auto source = vfs.resolvePath(src);
+        auto target = vfs.resolvePath(dest_path);
+        if (source.type != target.type || source.mount != target.mount)
+        {
+            std::cerr << "mv: cannot move '" << src << "' to '" << dest_path
+                      << "': Moving between filesystems is not supported, use cp and rm\n";
+            return;
+        }
+
+        if (!vfs.rename(src, dest_path))
+        {
+            std::cerr << "mv: cannot move '" << src << "' to '" << dest_path << "'\n";
+            return;
+        }
+
+        if (verbose)
+        {
+            std::cout << "renamed '" << src << "' -> '" << dest_path << "'\n";
+        }
+    }
+
     void showHelp() const
     {
         std::cout << "Usage: mv [OPTION]... SOURCE DEST\n"
@@ -6,6 +6,7 @@
 
 #include <fmt/color.h>
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <deque>
@@ -147,29 +148,19 @@ public:
         auto& vfs = VirtualFilesystem::getInstance();
         auto resolved = vfs.resolvePath(filename);
 
-        // Read file content
-        std::string content;
-        if (vfs.exists(resolved.full_path))
+        auto file = vfs.openFile(resolved.full_path);
+        if (!file)
         {
-            if (!vfs.readFile(resolved.full_path, content))
-            {
-                fmt::print(fg(fmt::color::red), "Error: Failed to read file '{}'\n", filename);
-                return Status::error("Read failed");
-            }
+            fmt::print(fg(fmt::color::red), "Error: Cannot open file '{}'\n", filename);
+            return Status::error("File not found");
         }
-        else
-        {
-            // Try regular filesystem
-            std::ifstream file(filename);
-            if (!file.good())
-            {
-                fmt::print(fg(fmt::color::red), "Error: Cannot open file '{}'\n", filename);
-                return Status::error("File not found");
-            }
 
-            std::stringstream buffer;
-            buffer << file.rdbuf();
-            content = buffer.str();
+        int64_t file_size = file->size();
+        std::string content;
+        if (file_size < 0 || !readTail(*file, file_size, num_lines, content))
+        {
+            fmt::print(fg(fmt::color::red), "Error: Failed to read file '{}'\n", filename);
+            return Status::error("Read failed");
         }
 
         // Display last N lines
@@ -179,14 +170,14 @@ public:
         if (follow)
         {
             // Follow mode only works with regular files (not VFS)
-            if (vfs.exists(resolved.full_path))
+            if (resolved.type == PathType::Virtual)
             {
                 fmt::print(fg(fmt::color::yellow),
                            "Warning: Follow mode not supported for encrypted virtual filesystem\n");
                 return Status::ok();
             }
 
-            return followFile(filename, content.size());
+            return followFile(filename, static_cast<size_t>(file_size));
         }
 
         return Status::ok();
@@ -214,6 +205,57 @@ private:
         fmt::print("  tail -n 50 -f app.log      # Last 50 lines, then follow\n");
     }
 
+    /**
+     * @brief Read just enough of the end of a file to cover its last N lines
+     * @param file File to read
+     * @param file_size Size of the file in bytes
+     * @param num_lines Number of lines wanted
+     * @param[out] content Tail of the file starting at a line boundary
+     * @return true on success, false on read error
+     *
+     * @details Scans backwards block by block, so the cost depends on the
+     *          length of the last lines rather than the size of the file.
+     */
+    bool readTail(VfsFile& file, int64_t file_size, int num_lines, std::string& content)
+    {
+        constexpr int64_t block_size = 64 * 1024;
+        std::vector<char> block(block_size);
+        int64_t start = file_size;
+        int newlines = 0;
+        bool found = false;
+
+        while (start > 0 && !found)
+        {
+            int64_t len = std::min(block_size, start);
+            int64_t block_start = start - len;
+            if (file.pread(block.data(), len, block_start) != len)
+            {
+                return false;
+            }
+
+            for (int64_t i = len - 1; i >= 0; --i)
+            {
+                // A newline terminating the final line does not start a new one
+                bool final_newline = (block_start + i == file_size - 1);
+                if (block[i] == '\n' && !final_newline && ++newlines >= num_lines)
+                {
+                    start = block_start + i + 1;
+                    found = true;
+                    break;
+                }
+            }
+
+            if (!found)
+            {
+                start = block_start;
+            }
+        }
+
+        content.assign(static_cast<size_t>(file_size - start), '\0');
+        return content.empty() ||
+               file.pread(content.data(), file_size - start, start) == file_size - start;
+    }
+
     /**
      * @brief Display last N lines from content
      * @param content File content
@@ -13,6 +13,7 @@
 
 #include <homeshell/Command.hpp>
 #include <homeshell/Status.hpp>
+#include <homeshell/VirtualFilesystem.hpp>
 
 #include <filesystem>
 #include <fstream>
@@ -197,6 +198,11 @@ private:
             return Status::error("Cannot open archive");
         }
 
+        // Entries are relative to the current directory, which may be inside a mount;
+        // commit them all at once there
+        auto& vfs = VirtualFilesystem::getInstance();
+        VfsBatch batch(vfs.getCurrentDirectory());
+
         while (in.peek() != EOF)
         {
             uint32_t name_len = 0;
@@ -213,6 +219,21 @@ private:
             std::string content(content_len, '\0');
             in.read(&content[0], content_len);
 
+            if (vfs.isVirtualPath(filename))
+            {
+                if (!vfs.writeFile(filename, content))
+                {
+                    std::cerr << "tar: cannot create: " << filename << "\n";
+                    continue;
+                }
+
+                if (verbose)
+                {
+                    std::cout << filename << "\n";
+                }
+                continue;
+            }
+
             // Write extracted file
             std::ofstream out(filename, std::ios::binary);
             if (!out)
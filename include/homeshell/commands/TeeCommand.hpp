@@ -13,6 +13,7 @@
 
 #include <homeshell/Command.hpp>
 #include <homeshell/Status.hpp>
+#include <homeshell/VirtualFilesystem.hpp>
 
 #include <fstream>
 #include <iostream>
@@ -69,23 +70,38 @@ public:
             }
         }
 
-        // Open all output files
-        std::vector<std::ofstream> output_files;
+        // Open all output files; files inside mounts are appended to in
+        // chunk-sized pieces instead of being streamed
+        auto& vfs = VirtualFilesystem::getInstance();
+        std::vector<Output> outputs;
         for (const auto& filename : files)
         {
-            std::ios_base::openmode mode = std::ios::out;
-            if (append)
+            Output output;
+            output.name = filename;
+            output.is_virtual = vfs.isVirtualPath(filename);
+
+            bool opened = false;
+            if (output.is_virtual)
+            {
+                opened = append ? vfs.appendFile(filename, "") : vfs.writeFile(filename, "");
+            }
+            else
             {
-                mode |= std::ios::app;
+                std::ios_base::openmode mode = std::ios::out;
+                if (append)
+                {
+                    mode |= std::ios::app;
+                }
+                output.stream.open(filename, mode);
+                opened = static_cast<bool>(output.stream);
             }
 
-            std::ofstream file(filename, mode);
-            if (!file)
+            if (!opened)
             {
                 std::cerr << "tee: " << filename << ": Unable to open file\n";
                 return Status::error("Failed to open file: " + filename);
             }
-            output_files.push_back(std::move(file));
+            outputs.push_back(std::move(output));
         }
 
         // Read from stdin and write to stdout and all files
@@ -96,10 +112,25 @@ public:
             std::cout << line << '\n';
 
             // Write to all files
-            for (auto& file : output_files)
+            for (auto& output : outputs)
             {
-                file << line << '\n';
-                if (!file)
+                bool ok = true;
+                if (output.is_virtual)
+                {
+                    output.pending += line;
+                    output.pending += '\n';
+                    if (output.pending.size() >= kVirtualFlushBytes)
+                    {
+                        ok = flush(vfs, output);
+                    }
+                }
+                else
+                {
+                    output.stream << line << '\n';
+                    ok = static_cast<bool>(output.stream);
+                }
+
+                if (!ok)
                 {
                     std::cerr << "tee: write error\n";
                     return Status::error("Write error");
@@ -108,15 +139,50 @@ public:
         }
 
         // Close all files
-        for (auto& file : output_files)
+        for (auto& output : outputs)
         {
-            file.close();
+            if (output.is_virtual)
+            {
+                if (!flush(vfs, output))
+                {
+                    std::cerr << "tee: write error\n";
+                    return Status::error("Write error");
+                }
+            }
+            else
+            {
+                output.stream.close();
+            }
         }
 
         return Status::ok();
     }
 
 private:
+    /// Bytes buffered per virtual file before they are appended to the mount
+    static constexpr size_t kVirtualFlushBytes = 64 * 1024;
+
+    /**
+     * @brief One output file: a stream for real paths, an append buffer for mounts
+     */
+    struct Output
+    {
+        std::string name;        ///< Path as given on the command line
+        bool is_virtual = false; ///< Inside an encrypted mount
+        std::ofstream stream;    ///< Open stream (real paths)
+        std::string pending;     ///< Data not yet appended (virtual paths)
+    };
+
+    /**
+     * @brief Append the buffered data of a virtual output to its file
+     */
+    static bool flush(VirtualFilesystem& vfs, Output& output)
+    {
+        bool ok = vfs.appendFile(output.name, output.pending);
+        output.pending.clear();
+        return ok;
+    }
+
     void showHelp() const
     {
         std::cout << "Usage: tee [OPTION]... [FILE]...\n\n"
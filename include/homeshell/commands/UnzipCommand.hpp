@@ -133,6 +133,9 @@ private:
         int extracted_count = 0;
         bool all_success = true;
 
+        // One commit for the whole archive when extracting into a mount
+        VfsBatch batch(dest_dir);
+
         fmt::print("Extracting {} file(s) from '{}'...\n", num_files, archive_name);
 
         for (int i = 0; i < num_files; ++i)
@@ -22,6 +22,7 @@ namespace homeshell
  *
  * **Features:**
  * - Recursive filesystem scanning
+ * - Incremental: only directories whose mtime changed are listed again
  * - SQLite database storage
  * - Excludes system directories by default (/proc, /sys, /dev, /run, /tmp)
  * - Scans both regular and virtual encrypted filesystems
@@ -36,6 +37,7 @@ namespace homeshell
  * **Options:**
  * - `--path <dir>` - Add directory to scan (can be specified multiple times)
  * - `--exclude <dir>` - Exclude directory from scan (can be specified multiple times)
+ * - `--full` - Rebuild the whole database instead of updating changed directories
  * - `--help` - Show help message
  *
  * **Examples:**
@@ -61,7 +63,10 @@ namespace homeshell
  * Files indexed:       12,345
  * Directories indexed:  1,234
  * Total size:          45.67 MB
- * Time taken:           2.34 seconds
+ * Directories scanned:     12
+ * Directories skipped:  1,222
+ * Entries changed:          31
+ * Time taken:           0.04 seconds
  * Database:            ~/.homeshell/locate.db
  * @endcode
  *
@@ -74,7 +79,10 @@ namespace homeshell
  * **Performance Notes:**
  * - Scanning large directory trees can take time
  * - Database is optimized for search performance
- * - Subsequent updates replace all previous data
+ * - Subsequent updates list only directories whose mtime changed since the
+ *   previous one and apply the difference; unchanged directories are skipped
+ * - Sizes of files in unchanged directories are not refreshed; `--full`
+ *   rescans everything, as does changing the search or exclude paths
  * - Virtual filesystem entries are included automatically
  *
  * **Use Cases:**
@@ -110,6 +118,7 @@ public:
     {
         std::vector<std::string> search_paths;
         std::vector<std::string> exclude_paths;
+        bool full = false;
 
         // Parse arguments
         for (size_t i = 0; i < context.args.size(); ++i)
@@ -127,6 +136,10 @@ public:
             {
                 exclude_paths.push_back(context.args[++i]);
             }
+            else if (context.args[i] == "--full")
+            {
+                full = true;
+            }
             else
             {
                 fmt::print(fg(fmt::color::red), "Error: Unknown option '{}'\n", context.args[i]);
@@ -146,7 +159,7 @@ public:
         fmt::print(fg(fmt::color::cyan), "Updating file database...\n\n");
 
         // Update database
-        auto stats = db.updateDatabase(search_paths, exclude_paths);
+        auto stats = db.updateDatabase(search_paths, exclude_paths, full);
 
         // Display statistics
         fmt::print(fg(fmt::color::green) | fmt::emphasis::bold, "Database update complete!\n\n");
@@ -160,6 +173,15 @@ public:
         fmt::print(fg(fmt::color::yellow), "Total size:          ");
         fmt::print("{:>10}\n", formatSize(stats.total_size));
 
+        fmt::print(fg(fmt::color::yellow), "Directories scanned: ");
+        fmt::print("{:>10}\n", formatNumber(stats.scanned_directories));
+
+        fmt::print(fg(fmt::color::yellow), "Directories skipped: ");
+        fmt::print("{:>10}\n", formatNumber(stats.skipped_directories));
+
+        fmt::print(fg(fmt::color::yellow), "Entries changed:     ");
+        fmt::print("{:>10}\n", formatNumber(stats.entries_updated + stats.entries_removed));
+
         fmt::print(fg(fmt::color::yellow), "Time taken:          ");
         fmt::print("{:>10.2f} seconds\n", stats.scan_time_ms / 1000.0);
 
@@ -178,6 +200,7 @@ private:
         fmt::print("Options:\n");
         fmt::print("  --path <dir>     Add directory to scan (can be used multiple times)\n");
         fmt::print("  --exclude <dir>  Exclude directory from scan (can be used multiple times)\n");
+        fmt::print("  --full           Rescan every directory, not only changed ones\n");
         fmt::print("  --help           Show this help message\n\n");
         fmt::print("Examples:\n");
         fmt::print("  updatedb                      # Scan current directory\n");
@@ -1,12 +1,20 @@
 #pragma once
 
 #include <homeshell/Command.hpp>
+#include <homeshell/MountExport.hpp>
+#include <homeshell/MountImport.hpp>
+#include <homeshell/MountScrub.hpp>
+#include <homeshell/PasswordInput.hpp>
 #include <homeshell/Status.hpp>
 #include <homeshell/VirtualFilesystem.hpp>
 
 #include <fmt/color.h>
 #include <fmt/core.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
 #include <string>
 #include <vector>
 
@@ -24,6 +32,18 @@ namespace homeshell
  * **Features:**
  * - Lists all active encrypted mounts
  * - Shows storage usage for each mount (used/max)
+ * - Shows physical (stored) bytes and deduplication savings
+ * - Shows file and directory counts
+ * - Shows metadata cache hit/miss counters
+ * - Shows per-mount chunk cache and read-ahead counters
+ * - Shows compression ratio and throughput of compressed mounts
+ * - Shows lazy mounts that are not unlocked yet without unlocking them
+ * - Verifies usage counters against the stored files (`vfs check`)
+ * - Bulk-imports a real directory tree into a mount (`vfs import`)
+ * - Exports a mount or one of its directories to a ZIP or real directory (`vfs export`)
+ * - Writes a consistent copy of a mount's database while it stays in use (`vfs snapshot`)
+ * - Shrinks a mount's database file by freeing unused pages (`vfs compact`)
+ * - Verifies every page and file of a mount against its checksums (`vfs scrub`)
  * - Displays usage percentage
  * - Shows mount points and database paths
  * - Color-coded output for readability
@@ -32,10 +52,38 @@ namespace homeshell
  * **Usage:**
  * @code
  * vfs
+ * vfs check [name]
+ * vfs import [-j workers] <directory> <mount path>
+ * vfs export <mount name|mount path> <archive.zip|directory>
+ * vfs snapshot [--rekey] <name> <database file>
+ * vfs compact <name>
+ * vfs scrub [-j workers] <name>
  * @endcode
  *
  * **Parameters:**
- * - None (command takes no arguments)
+ * - None: show all mounts
+ * - `check [name]`: recount usage of one or all mounts and repair drifted counters
+ * - `import <directory> <mount path>`: copy a real directory tree into a mount;
+ *   files are read by `-j` worker threads (default: one per CPU, up to 8) and
+ *   written in large transactions, then the throughput is reported
+ * - `export <mount> <destination>`: copy a whole mount (by name) or a directory
+ *   inside one to a new ZIP archive (destination ending in `.zip`) or a real
+ *   directory, streaming file contents so memory use stays bounded
+ * - `snapshot [--rekey] <name> <database file>`: back up a mounted database
+ *   page by page with the SQLite backup API, without unmounting it or
+ *   stalling other commands; `--rekey` prompts for a different password for
+ *   the copy. Progress and throughput are shown as it runs
+ * - `compact <name>`: return the pages left free by deleted files to the file
+ *   system in small steps while the mount stays in use, and report the bytes
+ *   freed. Runs in the background and can be cancelled with Ctrl+C; pages
+ *   freed until then stay freed. A mount created before incremental vacuum
+ *   was enabled is converted with one full VACUUM the first time
+ * - `scrub <name>`: detect bit rot. Runs SQLCipher's page HMAC check and
+ *   SQLite's integrity check, then re-reads every file with `-j` worker
+ *   threads and compares each chunk with the CRC-32 recorded when it was
+ *   written. Reports throughput and the paths of corrupt files; chunks written
+ *   before checksums were recorded are counted as unverified. Can be
+ *   cancelled with Ctrl+C
  *
  * **Example Output:**
  * @code
@@ -45,16 +93,33 @@ namespace homeshell
  *   Mount Point: /secure
  *   Database:    /home/user/.homeshell/secure.db
  *   Used:        1.25 MB / 100.00 MB (1.2%)
+ *   Stored:      1.25 MB
+ *   Entries:     42 files, 7 directories
+ *   Chunk cache: 311 hits, 58 misses, 40 read-ahead, 3.62 MB / 8.00 MB
  *
  * backup
  *   Mount Point: /backup
  *   Database:    /home/user/.homeshell/backup.db
  *   Used:        45.67 MB / 200.00 MB (22.8%)
+ *   Stored:      18.02 MB (dedup, saves 27.65 MB)
+ *   Entries:     1280 files, 64 directories
+ *   Chunk cache: 0 hits, 0 misses, 0 read-ahead, 0 B / 8.00 MB
+ *   Compression: 3.12x on 812 chunks (12 skipped), 48.3 MB/s in, 291.7 MB/s out
  *
  * large
  *   Mount Point: /large
  *   Database:    /home/user/.homeshell/large.db
  *   Used:        456.78 MB / 500.00 MB (91.4%)
+ *   Stored:      456.78 MB
+ *   Entries:     12 files, 2 directories
+ *   Chunk cache: 9 hits, 4 misses, 0 read-ahead, 256.00 KB / 8.00 MB
+ *
+ * archive
+ *   Mount Point: /archive
+ *   Database:    /home/user/.homeshell/archive.db
+ *   Status:      locked (unlocks on first access)
+ *
+ * Metadata cache: 1840 hits, 212 misses (89.7% hit rate), 2052/4096 entries
  * @endcode
  *
  * **If No Mounts:**
@@ -69,6 +134,22 @@ namespace homeshell
  * - **Used Space** - Current storage consumption
  * - **Max Space** - Maximum storage quota
  * - **Usage Percentage** - Percentage of quota used
+ * - **Stored** - Bytes of file content actually kept in the database; lower
+ *   than Used for sparse files and, on mounts with `"dedup": true`, for
+ *   repeated content (identical 64 KiB chunks are stored once)
+ * - **Entries** - Number of files and directories in the mount
+ * - **Chunk cache** - Chunk reads served from decrypted memory, chunks read
+ *   from the database, chunks prefetched for sequential readers, and the
+ *   cache occupancy against its budget (`cache_size_mb` in the mount config)
+ * - **Compression** - Shown for mounts with `compression_level` set: the
+ *   ratio achieved on chunks written since mount, how many chunks were kept
+ *   uncompressed because they would not shrink, and compression and
+ *   decompression throughput in uncompressed bytes per second
+ * - **Status** - Shown instead of the usage lines for mounts configured with
+ *   `"lazy_unlock": true` that have not been accessed yet, or whose deferred
+ *   unlock failed
+ * - **Metadata cache** - How many exists/isDirectory/stat lookups on mount
+ *   paths were answered without a database query (counts since startup)
  *
  * **Size Formatting:**
  * - Bytes (B): 0-1023 bytes
@@ -122,15 +203,16 @@ namespace homeshell
  * - Database files persist on disk after unmount
  * - Usage updates in real-time as files are added/removed
  * - Unmounted filesystems don't appear in output
- * - Command is read-only (doesn't modify state)
+ * - Usage is read from counters maintained on every write, so `vfs` is
+ *   instant regardless of mount size; `vfs check` scans the whole mount
  *
- * @note Storage usage includes all data and metadata
+ * @note Storage usage is the sum of file sizes (database overhead not included)
  * @note Quota is enforced on write operations
  * @note Empty mounts still consume minimal space (database overhead)
  *
  * @see MountCommand for mounting filesystems
  * @see UnmountCommand for unmounting filesystems
- * @see VirtualFilesystem::getUsedSpace() for usage calculation
+ * @see EncryptedMount::getUsage() for usage calculation
  */
 class VfsCommand : public ICommand
 {
@@ -147,11 +229,61 @@ public:
 
     CommandType getType() const override
     {
-        return CommandType::Synchronous;
+        return CommandType::Asynchronous;
+    }
+
+    /**
+     * @brief Check if command supports cancellation
+     * @return true (`vfs compact` and `vfs scrub` stop early)
+     */
+    bool supportsCancellation() const override
+    {
+        return true;
+    }
+
+    void cancel() override
+    {
+        cancelled_.store(true);
     }
 
     Status execute(const CommandContext& context) override
     {
+        if (!context.args.empty() && context.args[0] == "check")
+        {
+            return check(context.args.size() > 1 ? context.args[1] : "");
+        }
+        if (!context.args.empty() && context.args[0] == "import")
+        {
+            return importTree({context.args.begin() + 1, context.args.end()});
+        }
+        if (!context.args.empty() && context.args[0] == "export")
+        {
+            return exportTree({context.args.begin() + 1, context.args.end()});
+        }
+        if (!context.args.empty() && context.args[0] == "snapshot")
+        {
+            return snapshot({context.args.begin() + 1, context.args.end()});
+        }
+        if (!context.args.empty() && context.args[0] == "compact")
+        {
+            return compact({context.args.begin() + 1, context.args.end()});
+        }
+        if (!context.args.empty() && context.args[0] == "scrub")
+        {
+            return scrub({context.args.begin() + 1, context.args.end()});
+        }
+        if (!context.args.empty())
+        {
+            fmt::print(fg(fmt::color::red), "Error: Unknown subcommand '{}'\n", context.args[0]);
+            fmt::print("Usage: vfs [check [name]]\n"
+                       "       vfs import [-j workers] <directory> <mount path>\n"
+                       "       vfs export <mount name|mount path> <archive.zip|directory>\n"
+                       "       vfs snapshot [--rekey] <name> <database file>\n"
+                       "       vfs compact <name>\n"
+                       "       vfs scrub [-j workers] <name>\n");
+            return Status::error("Unknown subcommand: " + context.args[0]);
+        }
+
         auto& vfs = VirtualFilesystem::getInstance();
         auto mount_names = vfs.getMountNames();
 
@@ -166,9 +298,23 @@ public:
         for (const auto& name : mount_names)
         {
             auto* mount = vfs.getMount(name);
+
+            // Listing must not unlock a lazy mount, nor hide one that failed to
+            if (mount && (mount->isUnlockPending() || mount->unlockFailed()))
+            {
+                fmt::print(fg(fmt::color::cyan) | fmt::emphasis::bold, "{}\n", name);
+                fmt::print("  Mount Point: {}\n", mount->getMountPoint());
+                fmt::print("  Database:    {}\n", mount->getDbPath());
+                fmt::print("  Status:      {}\n\n", mount->isUnlockPending()
+                                                        ? "locked (unlocks on first access)"
+                                                        : "unlock failed (incorrect password?)");
+                continue;
+            }
+
             if (mount && mount->is_mounted())
             {
-                int64_t used = mount->getUsedSpace();
+                auto usage = mount->getUsage();
+                int64_t used = usage.used_bytes;
                 int64_t max = mount->getMaxSpace();
                 double usage_pct = max > 0 ? (100.0 * used / max) : 0.0;
 
@@ -177,14 +323,428 @@ public:
                 fmt::print("  Database:    {}\n", mount->getDbPath());
                 fmt::print("  Used:        {} / {} ({:.1f}%)\n", formatBytes(used),
                            formatBytes(max), usage_pct);
+                if (mount->getOptions().dedup)
+                {
+                    fmt::print("  Stored:      {} (dedup, saves {})\n",
+                               formatBytes(usage.stored_bytes),
+                               formatBytes(std::max<int64_t>(used - usage.stored_bytes, 0)));
+                }
+                else
+                {
+                    fmt::print("  Stored:      {}\n", formatBytes(usage.stored_bytes));
+                }
+                fmt::print("  Entries:     {} files, {} directories\n", usage.file_count,
+                           usage.directory_count);
+
+                auto chunks = mount->getChunkCacheStats();
+                fmt::print("  Chunk cache: {} hits, {} misses, {} read-ahead, {} / {}\n",
+                           chunks.hits, chunks.misses, chunks.read_ahead,
+                           formatBytes(chunks.bytes), formatBytes(chunks.budget));
+
+                if (mount->getOptions().compression_level > 0)
+                {
+                    auto comp = mount->getCompressionStats();
+                    double ratio =
+                        comp.bytes_out > 0 ? static_cast<double>(comp.bytes_in) / comp.bytes_out
+                                           : 0.0;
+                    fmt::print("  Compression: {:.2f}x on {} chunks ({} skipped), {} in, {} out\n",
+                               ratio, comp.chunks_compressed, comp.chunks_skipped,
+                               formatRate(comp.bytes_in, comp.compress_ns),
+                               formatRate(comp.bytes_inflated, comp.decompress_ns));
+                }
                 fmt::print("\n");
             }
         }
 
+        auto cache = vfs.getMetadataCacheStats();
+        uint64_t lookups = cache.hits + cache.misses;
+        double hit_pct = lookups > 0 ? (100.0 * cache.hits / lookups) : 0.0;
+        fmt::print("Metadata cache: {} hits, {} misses ({:.1f}% hit rate), {}/{} entries\n",
+                   cache.hits, cache.misses, hit_pct, cache.entries, cache.capacity);
+
         return Status::ok();
     }
 
 private:
+    Status check(const std::string& only)
+    {
+        auto& vfs = VirtualFilesystem::getInstance();
+        bool found = false;
+
+        for (const auto& name : vfs.getMountNames())
+        {
+            if (!only.empty() && name != only)
+                continue;
+
+            auto* mount = vfs.getMount(name);
+            if (!mount || !mount->is_mounted())
+                continue;
+
+            found = true;
+            if (mount->verifyUsage())
+            {
+                fmt::print("{}: usage counters consistent\n", name);
+            }
+            else
+            {
+                auto usage = mount->getUsage();
+                fmt::print(fg(fmt::color::yellow),
+                           "{}: usage counters rebuilt ({}, {} files, {} directories)\n", name,
+                           formatBytes(usage.used_bytes), usage.file_count,
+                           usage.directory_count);
+            }
+        }
+
+        if (!found && !only.empty())
+        {
+            fmt::print(fg(fmt::color::red), "Error: Mount '{}' not found\n", only);
+            return Status::error("Mount not found: " + only);
+        }
+        if (!found)
+        {
+            fmt::print("No virtual filesystems mounted.\n");
+        }
+
+        return Status::ok();
+    }
+
+    Status importTree(const std::vector<std::string>& args)
+    {
+        ImportOptions options;
+        std::vector<std::string> paths;
+        for (size_t i = 0; i < args.size(); ++i)
+        {
+            if (args[i] == "-j" && i + 1 < args.size())
+            {
+                try
+                {
+                    options.workers = std::stoi(args[++i]);
+                }
+                catch (const std::exception&)
+                {
+                    options.workers = 0;
+                }
+                if (options.workers <= 0)
+                {
+                    fmt::print(fg(fmt::color::red), "Error: Invalid worker count '{}'\n", args[i]);
+                    return Status::error("Invalid worker count: " + args[i]);
+                }
+            }
+            else
+            {
+                paths.push_back(args[i]);
+            }
+        }
+        if (paths.size() != 2)
+        {
+            fmt::print("Usage: vfs import [-j workers] <directory> <mount path>\n");
+            return Status::error("vfs import needs a directory and a mount path");
+        }
+
+        auto& vfs = VirtualFilesystem::getInstance();
+        ResolvedPath source = vfs.resolvePath(paths[0]);
+        ResolvedPath dest = vfs.resolvePath(paths[1]);
+        if (source.type != PathType::Real)
+        {
+            fmt::print(fg(fmt::color::red), "Error: '{}' is not a real directory\n", paths[0]);
+            return Status::error("Not a real directory: " + paths[0]);
+        }
+        if (dest.type != PathType::Virtual || !dest.mount)
+        {
+            fmt::print(fg(fmt::color::red), "Error: '{}' is not inside a mount\n", paths[1]);
+            return Status::error("Not a mount path: " + paths[1]);
+        }
+
+        ImportStats stats;
+        std::string error;
+        bool ok = importDirectory(*dest.mount, source.full_path, dest.relative_path, options,
+                                  stats, error);
+
+        for (const auto& failed : stats.failed)
+        {
+            fmt::print(fg(fmt::color::yellow), "Skipped file: {}\n", failed);
+        }
+        fmt::print("Imported {} files, {} directories, {} in {:.2f} s ({:.1f} MB/s, {} commits)\n",
+                   stats.files, stats.directories, formatBytes(stats.bytes), stats.seconds,
+                   stats.mbPerSecond(), stats.commits);
+        if (!ok)
+        {
+            fmt::print(fg(fmt::color::red), "Error: {}\n", error);
+            return Status::error(error);
+        }
+        return Status::ok();
+    }
+
+    Status exportTree(const std::vector<std::string>& args)
+    {
+        if (args.size() != 2)
+        {
+            fmt::print("Usage: vfs export <mount name|mount path> <archive.zip|directory>\n");
+            return Status::error("vfs export needs a mount and a destination");
+        }
+
+        // A mount name exports the whole mount, a path the directory it names
+        auto& vfs = VirtualFilesystem::getInstance();
+        EncryptedMount* mount = vfs.getMount(args[0]);
+        std::string source = "/";
+        if (!mount)
+        {
+            ResolvedPath resolved = vfs.resolvePath(args[0]);
+            mount = resolved.type == PathType::Virtual ? resolved.mount : nullptr;
+            source = resolved.relative_path;
+        }
+        if (!mount)
+        {
+            fmt::print(fg(fmt::color::red), "Error: '{}' is not a mount or mount path\n",
+                       args[0]);
+            return Status::error("Not a mount: " + args[0]);
+        }
+
+        ResolvedPath dest = vfs.resolvePath(args[1]);
+        if (dest.type != PathType::Real)
+        {
+            fmt::print(fg(fmt::color::red), "Error: Export destination must be a real path\n");
+            return Status::error("Destination inside a mount: " + args[1]);
+        }
+
+        const std::string zip_suffix = ".zip";
+        bool to_zip = dest.full_path.size() > zip_suffix.size() &&
+                      dest.full_path.compare(dest.full_path.size() - zip_suffix.size(),
+                                             zip_suffix.size(), zip_suffix) == 0;
+
+        ExportStats stats;
+        std::string error;
+        bool ok = to_zip ? exportToZip(*mount, source, dest.full_path, stats, error)
+                         : exportToDirectory(*mount, source, dest.full_path, stats, error);
+        if (!ok)
+        {
+            fmt::print(fg(fmt::color::red), "Error: {}\n", error);
+            return Status::error(error);
+        }
+
+        fmt::print("Exported {} files, {} directories, {} to {} in {:.2f} s ({:.1f} MB/s)\n",
+                   stats.files, stats.directories, formatBytes(stats.bytes), dest.full_path,
+                   stats.seconds, stats.mbPerSecond());
+        return Status::ok();
+    }
+
+    Status snapshot(const std::vector<std::string>& args)
+    {
+        bool rekey = false;
+        std::vector<std::string> operands;
+        for (const auto& arg : args)
+        {
+            if (arg == "--rekey")
+            {
+                rekey = true;
+            }
+            else
+            {
+                operands.push_back(arg);
+            }
+        }
+        if (operands.size() != 2)
+        {
+            fmt::print("Usage: vfs snapshot [--rekey] <name> <database file>\n");
+            return Status::error("vfs snapshot needs a mount name and a database file");
+        }
+
+        auto& vfs = VirtualFilesystem::getInstance();
+        auto* mount = vfs.getMount(operands[0]);
+        if (!mount || !mount->is_mounted())
+        {
+            fmt::print(fg(fmt::color::red), "Error: Mount '{}' not found\n", operands[0]);
+            return Status::error("Mount not found: " + operands[0]);
+        }
+
+        ResolvedPath dest = vfs.resolvePath(operands[1]);
+        if (dest.type != PathType::Real || std::filesystem::exists(dest.full_path))
+        {
+            fmt::print(fg(fmt::color::red), "Error: '{}' must be a new file outside any mount\n",
+                       operands[1]);
+            return Status::error("Invalid snapshot destination: " + operands[1]);
+        }
+
+        std::string new_password;
+        if (rekey)
+        {
+            new_password = PasswordInput::readPasswordWithConfirmation(
+                "New password for the snapshot: ", "Confirm password: ");
+            if (new_password.empty())
+            {
+                return Status::error("No password given");
+            }
+        }
+
+        SnapshotProgress last;
+        bool ok = mount->snapshot(dest.full_path, new_password,
+                                  [&](const SnapshotProgress& progress)
+                                  {
+                                      last = progress;
+                                      double pct = progress.page_count > 0
+                                                       ? 100.0 * progress.pages_copied /
+                                                             progress.page_count
+                                                       : 100.0;
+                                      fmt::print("\rSnapshot: {:5.1f}% ({}/{} pages)", pct,
+                                                 progress.pages_copied, progress.page_count);
+                                      std::fflush(stdout);
+                                  });
+        fmt::print("\n");
+        if (!ok)
+        {
+            fmt::print(fg(fmt::color::red), "Error: Snapshot of '{}' failed\n", operands[0]);
+            return Status::error("Snapshot failed: " + operands[0]);
+        }
+
+        int64_t bytes = last.pages_copied * last.page_size;
+        fmt::print("Snapshot of {} written to {}: {} in {:.2f} s ({:.1f} MB/s){}\n",
+                   operands[0], dest.full_path, formatBytes(bytes), last.seconds,
+                   last.seconds > 0 ? bytes / (1024.0 * 1024.0) / last.seconds : 0.0,
+                   rekey ? ", new password" : "");
+        return Status::ok();
+    }
+
+    Status compact(const std::vector<std::string>& args)
+    {
+        if (args.size() != 1)
+        {
+            fmt::print("Usage: vfs compact <name>\n");
+            return Status::error("vfs compact needs a mount name");
+        }
+
+        auto* mount = VirtualFilesystem::getInstance().getMount(args[0]);
+        if (!mount || !mount->is_mounted())
+        {
+            fmt::print(fg(fmt::color::red), "Error: Mount '{}' not found\n", args[0]);
+            return Status::error("Mount not found: " + args[0]);
+        }
+
+        cancelled_.store(false);
+        fmt::print("Compacting {} ({} reclaimable)...\n", args[0],
+                   formatBytes(mount->getReclaimableBytes()));
+
+        CompactProgress result;
+        bool ok = mount->compact(result,
+                                 [&](const CompactProgress& progress)
+                                 {
+                                     fmt::print("\rCompact: {} freed, {} pages left",
+                                                formatBytes(progress.bytesFreed()),
+                                                progress.pages_remaining);
+                                     std::fflush(stdout);
+                                     return !cancelled_.load();
+                                 });
+        fmt::print("\n");
+        if (!ok)
+        {
+            fmt::print(fg(fmt::color::red), "Error: Compaction of '{}' failed\n", args[0]);
+            return Status::error("Compaction failed: " + args[0]);
+        }
+
+        if (result.cancelled)
+        {
+            fmt::print(fg(fmt::color::yellow), "Compaction cancelled: {} freed in {:.2f} s\n",
+                       formatBytes(result.bytesFreed()), result.seconds);
+            return Status::error("Cancelled");
+        }
+        fmt::print("Compacted {}: {} freed in {:.2f} s{}\n", args[0],
+                   formatBytes(result.bytesFreed()), result.seconds,
+                   result.vacuumed ? " (converted to incremental vacuum)" : "");
+        return Status::ok();
+    }
+
+    Status scrub(const std::vector<std::string>& args)
+    {
+        ScrubOptions options;
+        std::vector<std::string> operands;
+        for (size_t i = 0; i < args.size(); ++i)
+        {
+            if (args[i] == "-j" && i + 1 < args.size())
+            {
+                try
+                {
+                    options.workers = std::stoi(args[++i]);
+                }
+                catch (const std::exception&)
+                {
+                    options.workers = 0;
+                }
+                if (options.workers <= 0)
+                {
+                    fmt::print(fg(fmt::color::red), "Error: Invalid worker count '{}'\n", args[i]);
+                    return Status::error("Invalid worker count: " + args[i]);
+                }
+            }
+            else
+            {
+                operands.push_back(args[i]);
+            }
+        }
+        if (operands.size() != 1)
+        {
+            fmt::print("Usage: vfs scrub [-j workers] <name>\n");
+            return Status::error("vfs scrub needs a mount name");
+        }
+
+        auto* mount = VirtualFilesystem::getInstance().getMount(operands[0]);
+        if (!mount || !mount->is_mounted())
+        {
+            fmt::print(fg(fmt::color::red), "Error: Mount '{}' not found\n", operands[0]);
+            return Status::error("Mount not found: " + operands[0]);
+        }
+
+        cancelled_.store(false);
+        options.stop = &cancelled_;
+        fmt::print("Scrubbing {}...\n", operands[0]);
+
+        ScrubStats stats;
+        std::string error;
+        if (!scrubMount(*mount, options, stats, error))
+        {
+            fmt::print(fg(fmt::color::red), "Error: {}\n", error);
+            return Status::error(error);
+        }
+
+        for (const auto& message : stats.integrity_errors)
+        {
+            fmt::print(fg(fmt::color::red), "Integrity: {}\n", message);
+        }
+        for (const auto& path : stats.corrupt)
+        {
+            fmt::print(fg(fmt::color::red), "Corrupt: {}\n", path);
+        }
+        fmt::print("{} {} files, {} chunks, {} in {:.2f} s ({:.1f} MB/s)\n",
+                   stats.stopped ? "Scrub cancelled after" : "Scrubbed", stats.files,
+                   stats.chunks, formatBytes(stats.bytes), stats.seconds, stats.mbPerSecond());
+        if (stats.unverified_chunks > 0)
+        {
+            fmt::print(fg(fmt::color::yellow), "{} chunks predate checksums and were only read\n",
+                       stats.unverified_chunks);
+        }
+
+        if (!stats.clean())
+        {
+            return Status::error(fmt::format("{} corrupt files, {} integrity errors in {}",
+                                             stats.corrupt.size(), stats.integrity_errors.size(),
+                                             operands[0]));
+        }
+        if (stats.stopped)
+        {
+            return Status::error("Cancelled");
+        }
+        fmt::print(fg(fmt::color::green), "No errors found\n");
+        return Status::ok();
+    }
+
+    std::string formatRate(uint64_t bytes, uint64_t nanoseconds) const
+    {
+        if (nanoseconds == 0)
+        {
+            return "- MB/s";
+        }
+        double mb_per_s = (bytes / (1024.0 * 1024.0)) / (nanoseconds / 1e9);
+        return fmt::format("{:.1f} MB/s", mb_per_s);
+    }
+
     std::string formatBytes(int64_t bytes) const
     {
         const char* units[] = {"B", "KB", "MB", "GB", "TB"};
@@ -206,6 +766,8 @@ private:
             return fmt::format("{:.2f} {}", size, units[unit_idx]);
         }
     }
+
+    std::atomic<bool> cancelled_{false}; ///< Set by cancel(), checked by compact and scrub
 };
 
 } // namespace homeshell
@@ -218,13 +218,26 @@ private:
     Counts countContent(const std::string& content) const
     {
         Counts counts = {0, 0, 0, 0};
+        bool in_word = false;
+        countBlock(content.data(), content.size(), counts, in_word);
+        return counts;
+    }
 
-        counts.bytes = content.length();
-        counts.chars = content.length(); // Simplified (doesn't handle UTF-8)
+    /**
+     * @brief Accumulate counts for one block of a larger input
+     * @param data Block data
+     * @param size Block size in bytes
+     * @param[in,out] counts Running counts
+     * @param[in,out] in_word Whether the previous block ended inside a word
+     */
+    void countBlock(const char* data, size_t size, Counts& counts, bool& in_word) const
+    {
+        counts.bytes += static_cast<int64_t>(size);
+        counts.chars += static_cast<int64_t>(size); // Simplified (doesn't handle UTF-8)
 
-        bool in_word = false;
-        for (char c : content)
+        for (size_t i = 0; i < size; ++i)
         {
+            char c = data[i];
             if (c == '\n')
             {
                 counts.lines++;
@@ -243,8 +256,6 @@ private:
                 }
             }
         }
-
-        return counts;
     }
 
     /**
@@ -281,13 +292,27 @@ private:
             return {-1, 0, 0, 0};
         }
 
-        std::string content;
-        if (!vfs.readFile(path, content))
+        auto file = vfs.openFile(path);
+        if (!file)
         {
             return {-1, 0, 0, 0};
         }
 
-        return countContent(content);
+        Counts counts = {0, 0, 0, 0};
+        bool in_word = false;
+        std::vector<char> buffer(VfsStreamBuf::kBufferSize);
+        int64_t n;
+        while ((n = file->read(buffer.data(), static_cast<int64_t>(buffer.size()))) > 0)
+        {
+            countBlock(buffer.data(), static_cast<size_t>(n), counts, in_word);
+        }
+
+        if (n < 0)
+        {
+            return {-1, 0, 0, 0};
+        }
+
+        return counts;
     }
 
     /**
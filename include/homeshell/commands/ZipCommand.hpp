@@ -7,6 +7,8 @@
 #include <fmt/color.h>
 #include <miniz.h>
 
+#include <chrono>
+#include <ctime>
 #include <filesystem>
 #include <fstream>
 #include <string>
@@ -167,32 +169,33 @@ private:
     {
         auto& vfs = VirtualFilesystem::getInstance();
 
-        std::string content;
-
-        // Try VFS first (for virtual paths), then fall back to regular filesystem
-        if (vfs.isVirtualPath(file_path))
+        // Works for both virtual and regular paths
+        auto file = vfs.openFile(file_path);
+        int64_t size = file ? file->size() : -1;
+        if (size < 0)
         {
-            if (!vfs.readFile(file_path, content))
-            {
-                fmt::print(fg(fmt::color::red), "Error: Failed to read '{}'\n", file_path);
-                return false;
-            }
+            fmt::print(fg(fmt::color::red), "Error: Failed to read '{}'\n", file_path);
+            return false;
         }
-        else
+
+        // Mounts store system_clock ticks, the real filesystem seconds
+        MZ_TIME_T mtime = std::time(nullptr);
+        VirtualFileInfo info;
+        if (vfs.stat(file_path, info))
         {
-            // Read regular file directly
-            std::ifstream file(file_path, std::ios::binary);
-            if (!file)
-            {
-                fmt::print(fg(fmt::color::red), "Error: Failed to read '{}'\n", file_path);
-                return false;
-            }
-            content = std::string((std::istreambuf_iterator<char>(file)),
-                                  std::istreambuf_iterator<char>());
+            mtime = vfs.isVirtualPath(file_path)
+                        ? static_cast<MZ_TIME_T>(
+                              std::chrono::duration_cast<std::chrono::seconds>(
+                                  std::chrono::system_clock::duration(info.mtime))
+                                  .count())
+                        : static_cast<MZ_TIME_T>(info.mtime);
         }
 
-        if (!mz_zip_writer_add_mem(&zip, archive_name.c_str(), content.data(), content.size(),
-                                   MZ_DEFAULT_COMPRESSION))
+        // Let miniz pull the data in pieces so large files are never held in memory
+        if (!mz_zip_writer_add_read_buf_callback(
+                &zip, archive_name.c_str(), &ZipCommand::readCallback, file.get(),
+                static_cast<mz_uint64>(size), &mtime, nullptr, 0, MZ_DEFAULT_COMPRESSION,
+                nullptr, 0, nullptr, 0))
         {
             fmt::print(fg(fmt::color::red), "Error: Failed to add '{}' to archive\n", file_path);
             return false;
@@ -201,6 +204,14 @@ private:
         return true;
     }
 
+    static size_t readCallback(void* opaque, mz_uint64 file_ofs, void* buffer, size_t n)
+    {
+        auto* file = static_cast<VfsFile*>(opaque);
+        int64_t read = file->pread(static_cast<char*>(buffer), static_cast<int64_t>(n),
+                                   static_cast<int64_t>(file_ofs));
+        return read < 0 ? 0 : static_cast<size_t>(read);
+    }
+
     bool addDirectoryToZip(mz_zip_archive& zip, const std::string& dir_path,
                            const std::string& base_path, int& count)
     {
@@ -0,0 +1,149 @@
+#include <homeshell/ChunkCache.hpp>
+
+#include <iterator>
+
+namespace homeshell
+{
+
+ChunkCache::Block ChunkCache::lookup(int64_t file_id, int64_t idx)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = index_.find(Key{file_id, idx});
+    if (it == index_.end())
+    {
+        ++misses_;
+        return nullptr;
+    }
+
+    lru_.splice(lru_.begin(), lru_, it->second);
+    ++hits_;
+    return it->second->second;
+}
+
+bool ChunkCache::contains(int64_t file_id, int64_t idx) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return index_.count(Key{file_id, idx}) > 0;
+}
+
+void ChunkCache::insert(int64_t file_id, int64_t idx, Block block, bool read_ahead,
+                        uint64_t generation)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    int64_t size = static_cast<int64_t>(block->size());
+    if (budget_ <= 0 || size > budget_ ||
+        (generation != kAnyGeneration && generation != generation_))
+    {
+        return;
+    }
+
+    auto it = index_.find(Key{file_id, idx});
+    if (it != index_.end())
+    {
+        eraseLocked(it->second);
+    }
+    if (size == 0)
+    {
+        return; // holes are read from the database, see the class comment
+    }
+
+    lru_.emplace_front(Key{file_id, idx}, std::move(block));
+    index_[Key{file_id, idx}] = lru_.begin();
+    bytes_ += size;
+    if (read_ahead)
+    {
+        ++read_ahead_;
+    }
+
+    evictLocked();
+}
+
+void ChunkCache::invalidate(int64_t file_id, int64_t idx)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    ++generation_;
+    auto it = index_.find(Key{file_id, idx});
+    if (it != index_.end())
+    {
+        eraseLocked(it->second);
+    }
+}
+
+void ChunkCache::invalidateFile(int64_t file_id)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    ++generation_;
+    for (auto it = lru_.begin(); it != lru_.end();)
+    {
+        auto next = std::next(it);
+        if (it->first.file_id == file_id)
+        {
+            eraseLocked(it);
+        }
+        it = next;
+    }
+}
+
+void ChunkCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++generation_;
+    lru_.clear();
+    index_.clear();
+    bytes_ = 0;
+}
+
+uint64_t ChunkCache::generation() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return generation_;
+}
+
+void ChunkCache::advanceGeneration()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++generation_;
+}
+
+void ChunkCache::setBudget(int64_t budget_bytes)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    budget_ = budget_bytes;
+    evictLocked();
+}
+
+ChunkCacheStats ChunkCache::getStats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    ChunkCacheStats stats;
+    stats.hits = hits_;
+    stats.misses = misses_;
+    stats.read_ahead = read_ahead_;
+    stats.evictions = evictions_;
+    stats.bytes = bytes_;
+    stats.budget = budget_;
+    return stats;
+}
+
+void ChunkCache::eraseLocked(LruList::iterator it)
+{
+    bytes_ -= static_cast<int64_t>(it->second->size());
+    index_.erase(it->first);
+    lru_.erase(it);
+}
+
+void ChunkCache::evictLocked()
+{
+    while (bytes_ > budget_ && !lru_.empty())
+    {
+        eraseLocked(std::prev(lru_.end()));
+        ++evictions_;
+    }
+}
+
+} // namespace homeshell
@@ -1,19 +1,586 @@
 #include <homeshell/EncryptedMount.hpp>
 
+#include <miniz.h>
+#include <openssl/evp.h>
+#include <openssl/sha.h>
+
 #include <algorithm>
+#include <cctype>
 #include <chrono>
+#include <cstring>
 #include <filesystem>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <set>
+#include <utility>
 
 namespace homeshell
 {
 
+namespace
+{
+
+/**
+ * @brief RAII wrapper around a SQLite savepoint
+ *
+ * Savepoints nest, so operations that need several statements to be atomic
+ * can use this regardless of whether a transaction is already open. The
+ * savepoint is rolled back on destruction unless commit() was called.
+ */
+class Savepoint
+{
+public:
+    explicit Savepoint(sqlite3* db)
+        : db_(db)
+        , active_(sqlite3_exec(db_, "SAVEPOINT hs_op", nullptr, nullptr, nullptr) == SQLITE_OK)
+    {
+    }
+
+    ~Savepoint()
+    {
+        if (active_)
+        {
+            sqlite3_exec(db_, "ROLLBACK TO hs_op", nullptr, nullptr, nullptr);
+            sqlite3_exec(db_, "RELEASE hs_op", nullptr, nullptr, nullptr);
+        }
+    }
+
+    Savepoint(const Savepoint&) = delete;
+    Savepoint& operator=(const Savepoint&) = delete;
+
+    bool isActive() const
+    {
+        return active_;
+    }
+
+    bool commit()
+    {
+        if (!active_)
+        {
+            return false;
+        }
+        active_ = false;
+        return sqlite3_exec(db_, "RELEASE hs_op", nullptr, nullptr, nullptr) == SQLITE_OK;
+    }
+
+private:
+    sqlite3* db_;
+    bool active_;
+};
+
+/**
+ * @brief Borrowed cached statement that is reset when it goes out of scope
+ *
+ * Resetting releases the read lock held by a stepped SELECT and clearing
+ * the bindings drops references to caller-owned (SQLITE_STATIC) buffers.
+ */
+class ScopedStatement
+{
+public:
+    explicit ScopedStatement(sqlite3_stmt* stmt)
+        : stmt_(stmt)
+    {
+    }
+
+    ~ScopedStatement()
+    {
+        if (stmt_)
+        {
+            sqlite3_reset(stmt_);
+            sqlite3_clear_bindings(stmt_);
+        }
+    }
+
+    ScopedStatement(const ScopedStatement&) = delete;
+    ScopedStatement& operator=(const ScopedStatement&) = delete;
+
+    sqlite3_stmt* get() const
+    {
+        return stmt_;
+    }
+
+    explicit operator bool() const
+    {
+        return stmt_ != nullptr;
+    }
+
+private:
+    sqlite3_stmt* stmt_;
+};
+
+/**
+ * @brief SQL expression computing the parent directory of the `path` column
+ *
+ * rtrim() with the path's own non-slash characters strips the last
+ * component, leaving a trailing slash that is removed unless it is the root.
+ * Matches EncryptedMount::getParentPath() for normalized paths.
+ */
+constexpr const char* kParentOfPathSql =
+    "CASE WHEN rtrim(path, replace(path, '/', '')) = '/' THEN '/' "
+    "ELSE rtrim(rtrim(path, replace(path, '/', '')), '/') END";
+
+/**
+ * @brief Check whether a table exists in the main schema
+ */
+bool hasTable(sqlite3* db, const char* table)
+{
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, "SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = ?",
+                           -1, &stmt, nullptr) != SQLITE_OK)
+    {
+        return false;
+    }
+    sqlite3_bind_text(stmt, 1, table, -1, SQLITE_STATIC);
+    bool found = (sqlite3_step(stmt) == SQLITE_ROW);
+    sqlite3_finalize(stmt);
+    return found;
+}
+
+/**
+ * @brief Run a PRAGMA that returns a single integer
+ * @return The value, or -1 on error
+ */
+int64_t pragmaInt(sqlite3* db, const char* sql)
+{
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK)
+    {
+        return -1;
+    }
+    int64_t value = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int64(stmt, 0) : -1;
+    sqlite3_finalize(stmt);
+    return value;
+}
+
+/**
+ * @brief Overwrite a secret held in a string, then empty it
+ */
+void wipe(std::string& secret)
+{
+    OPENSSL_cleanse(secret.data(), secret.size());
+    secret.clear();
+}
+
+/**
+ * @brief Run a PRAGMA that returns a single text value
+ * @return The value, or an empty string on error
+ */
+std::string pragmaText(sqlite3* db, const char* sql)
+{
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK)
+    {
+        return std::string();
+    }
+    std::string value;
+    if (sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_text(stmt, 0))
+    {
+        value = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+    }
+    sqlite3_finalize(stmt);
+    return value;
+}
+
+/**
+ * @brief Derive the raw key of an open database from its password
+ * @param db Keyed connection that has already read the database
+ * @param password Password it was keyed with
+ * @return Key in SQLCipher's raw form (x'<key><salt>'), or an empty string
+ *         if the cipher settings cannot be read
+ *
+ * @details Runs the same PBKDF2 as SQLCipher, with the salt, iteration
+ *          count and digest the connection reports. Connections keyed with
+ *          the result skip the key derivation entirely.
+ */
+std::string deriveRawKey(sqlite3* db, const std::string& password)
+{
+    constexpr int kKeyBytes = 32; // AES-256
+    constexpr size_t kSaltBytes = 16;
+    std::string salt = pragmaText(db, "PRAGMA cipher_salt");
+    int64_t iterations = pragmaInt(db, "PRAGMA kdf_iter");
+    std::string algorithm = pragmaText(db, "PRAGMA cipher_kdf_algorithm");
+
+    const EVP_MD* digest = nullptr;
+    if (algorithm == "PBKDF2_HMAC_SHA512")
+        digest = EVP_sha512();
+    else if (algorithm == "PBKDF2_HMAC_SHA256")
+        digest = EVP_sha256();
+    else if (algorithm == "PBKDF2_HMAC_SHA1")
+        digest = EVP_sha1();
+
+    if (!digest || iterations <= 0 || iterations > std::numeric_limits<int>::max() ||
+        salt.size() != 2 * kSaltBytes ||
+        !std::all_of(salt.begin(), salt.end(), [](unsigned char c) { return std::isxdigit(c); }))
+    {
+        return std::string();
+    }
+    unsigned char salt_bytes[kSaltBytes];
+    for (size_t i = 0; i < kSaltBytes; ++i)
+    {
+        salt_bytes[i] = static_cast<unsigned char>(std::stoi(salt.substr(2 * i, 2), nullptr, 16));
+    }
+
+    unsigned char key[kKeyBytes];
+    if (PKCS5_PBKDF2_HMAC(password.data(), static_cast<int>(password.size()), salt_bytes,
+                          kSaltBytes, static_cast<int>(iterations), digest, kKeyBytes,
+                          key) != 1)
+    {
+        return std::string();
+    }
+
+    static const char kHex[] = "0123456789abcdef";
+    std::string raw;
+    raw.reserve(2 * (kKeyBytes + kSaltBytes) + 3);
+    raw += "x'";
+    for (unsigned char byte : key)
+    {
+        raw += kHex[byte >> 4];
+        raw += kHex[byte & 0x0f];
+    }
+    raw += salt;
+    raw += "'";
+    OPENSSL_cleanse(key, sizeof(key));
+    return raw;
+}
+
+/// SQL text of the cached statements, indexed by EncryptedMount::Statement
+constexpr const char* kStatementSql[] = {
+    // PathExists
+    "SELECT 1 FROM files WHERE path = ?1 UNION ALL "
+    "SELECT 1 FROM directories WHERE path = ?1 LIMIT 1",
+    // StatPath
+    "SELECT 0, size, mtime FROM files WHERE path = ?1 UNION ALL "
+    "SELECT 1, 0, mtime FROM directories WHERE path = ?1 LIMIT 1",
+    // DirectoryExists
+    "SELECT 1 FROM directories WHERE path = ? LIMIT 1",
+    // InsertDirectory
+    "INSERT INTO directories (path, parent, mtime) VALUES (?, ?, ?)",
+    // ListSubdirectories
+    "SELECT path, mtime FROM directories WHERE parent = ?",
+    // ListFiles
+    "SELECT path, size, mtime FROM files WHERE parent = ?",
+    // ListDirectoryTree
+    "SELECT path, mtime FROM directories WHERE path > ?1 AND path < ?2 ORDER BY path LIMIT ?3",
+    // ListFileTree
+    "SELECT path, size, mtime FROM files WHERE path > ?1 AND path < ?2 ORDER BY path LIMIT ?3",
+    // FindFilesBySize (unary + keeps the planner off the path index)
+    "SELECT path, size, mtime FROM files "
+    "WHERE size BETWEEN ?3 AND ?4 AND +path > ?1 AND +path < ?2",
+    // FindFilesByMtime
+    "SELECT path, size, mtime FROM files "
+    "WHERE mtime BETWEEN ?5 AND ?6 AND +size BETWEEN ?3 AND ?4 AND +path > ?1 AND +path < ?2",
+    // LookupFile
+    "SELECT id, size FROM files WHERE path = ?",
+    // UpsertFile
+    "INSERT INTO files (path, parent, size, mtime) VALUES (?, ?, ?, ?) "
+    "ON CONFLICT(path) DO UPDATE SET size = excluded.size, mtime = excluded.mtime RETURNING id",
+    // UpdateFileSize
+    "UPDATE files SET size = ?, mtime = ? WHERE id = ?",
+    // DeleteFile
+    "DELETE FROM files WHERE path = ?",
+    // DeleteFileRange
+    "DELETE FROM files WHERE path >= ?1 AND path < ?2",
+    // DeleteDirectoryTree
+    "DELETE FROM directories WHERE path = ?1 OR (path >= ?2 AND path < ?3)",
+    // RenameFile
+    "UPDATE files SET path = ?2, parent = ?3 WHERE path = ?1",
+    // RenameFileRange
+    "UPDATE files SET path = ?2 || substr(path, length(?1) + 1), "
+    "parent = ?2 || substr(parent, length(?1) + 1) WHERE path >= ?3 AND path < ?4",
+    // RenameDirectoryTree
+    "UPDATE directories SET path = ?2 || substr(path, length(?1) + 1), "
+    "parent = CASE WHEN path = ?1 THEN ?5 ELSE ?2 || substr(parent, length(?1) + 1) END "
+    "WHERE path = ?1 OR (path >= ?3 AND path < ?4)",
+    // SelectChunk
+    "SELECT COALESCE(c.data, b.data), COALESCE(b.compressed, c.compressed) "
+    "FROM chunks c LEFT JOIN blobs b ON b.id = c.blob_id WHERE c.file_id = ? AND c.idx = ?",
+    // SelectChunkRange
+    "SELECT c.idx, COALESCE(c.data, b.data), COALESCE(b.compressed, c.compressed) "
+    "FROM chunks c LEFT JOIN blobs b ON b.id = c.blob_id "
+    "WHERE c.file_id = ? AND c.idx BETWEEN ? AND ? ORDER BY c.idx",
+    // SelectChunkChecksums
+    "SELECT c.idx, COALESCE(c.data, b.data), COALESCE(b.compressed, c.compressed), c.checksum "
+    "FROM chunks c LEFT JOIN blobs b ON b.id = c.blob_id WHERE c.file_id = ? ORDER BY c.idx",
+    // InsertChunk (an upsert rather than INSERT OR REPLACE, whose implicit
+    // delete would bypass the reference counting triggers)
+    "INSERT INTO chunks (file_id, idx, data, blob_id, compressed, checksum) "
+    "VALUES (?, ?, ?, ?, ?, ?) "
+    "ON CONFLICT(file_id, idx) DO UPDATE SET data = excluded.data, blob_id = excluded.blob_id, "
+    "compressed = excluded.compressed, checksum = excluded.checksum",
+    // DeleteChunks
+    "DELETE FROM chunks WHERE file_id = ? AND idx >= ?",
+    // FindBlob
+    "SELECT blob_id FROM blob_refs WHERE hash = ?",
+    // InsertBlob
+    "INSERT INTO blobs (data, compressed) VALUES (?, ?)",
+    // InsertBlobRef
+    "INSERT INTO blob_refs (blob_id, hash, size) VALUES (?, ?, ?)",
+    // SelectUsage
+    "SELECT used_bytes, stored_bytes, file_count, dir_count FROM usage WHERE id = 1",
+    // ReplaceText
+    "REPLACE INTO file_text (rowid, body) VALUES (?1, ?2)",
+    // DeleteText
+    "DELETE FROM file_text WHERE rowid = ?1",
+    // InsertTextSkipped
+    "INSERT OR IGNORE INTO file_text_skipped (file_id) VALUES (?1)",
+    // DeleteTextSkipped
+    "DELETE FROM file_text_skipped WHERE file_id = ?1",
+    // InsertTextStale
+    "INSERT OR IGNORE INTO file_text_stale (file_id) VALUES (?1)",
+    // DeleteTextStale
+    "DELETE FROM file_text_stale WHERE file_id = ?1",
+    // SelectTextCandidates (a stale file may also match its old entry)
+    "SELECT path FROM files WHERE id IN (SELECT rowid FROM file_text WHERE file_text MATCH ?3) "
+    "AND path > ?1 AND path < ?2 UNION "
+    "SELECT f.path FROM file_text_skipped s JOIN files f ON f.id = s.file_id "
+    "WHERE f.path > ?1 AND f.path < ?2 UNION "
+    "SELECT f.path FROM file_text_stale s JOIN files f ON f.id = s.file_id "
+    "WHERE f.path > ?1 AND f.path < ?2",
+};
+
+/**
+ * @brief Build an FTS5 query matching rows that contain every trigram of some terms
+ *
+ * The text index is created with detail=none, which cannot answer phrase
+ * queries, so each term is split into its overlapping three-character
+ * (UTF-8 code point) substrings, each quoted as a single-token string.
+ *
+ * @return The query, or an empty string if no term has three characters
+ */
+std::string trigramQuery(const std::vector<std::string>& terms)
+{
+    std::set<std::string> trigrams;
+    for (const auto& term : terms)
+    {
+        std::vector<size_t> starts;
+        for (size_t i = 0; i < term.size(); ++i)
+        {
+            if ((static_cast<unsigned char>(term[i]) & 0xC0) != 0x80)
+            {
+                starts.push_back(i);
+            }
+        }
+        starts.push_back(term.size());
+        for (size_t i = 0; i + 3 < starts.size(); ++i)
+        {
+            trigrams.insert(term.substr(starts[i], starts[i + 3] - starts[i]));
+        }
+    }
+
+    std::string query;
+    for (const auto& trigram : trigrams)
+    {
+        query += query.empty() ? "\"" : " AND \"";
+        for (char c : trigram)
+        {
+            query += c == '"' ? "\"\"" : std::string(1, c);
+        }
+        query += '"';
+    }
+    return query;
+}
+
+/**
+ * @brief Check a pragma value against the values SQLite accepts
+ * @param value Configured value
+ * @param allowed Accepted values in upper case
+ * @return true if value matches one of them, ignoring case
+ */
+bool isPragmaValue(const std::string& value, std::initializer_list<const char*> allowed)
+{
+    std::string upper = value;
+    std::transform(upper.begin(), upper.end(), upper.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+    return std::any_of(allowed.begin(), allowed.end(),
+                       [&](const char* candidate) { return upper == candidate; });
+}
+
+/**
+ * @brief Apply the per-connection settings of a mount right after sqlite3_key()
+ * @param db Keyed connection that has not been accessed yet
+ * @param options Mount options
+ *
+ * @details The cipher settings must precede the first access, which is
+ *          when SQLCipher derives the key.
+ */
+void applyConnectionPragmas(sqlite3* db, const MountOptions& options)
+{
+    if (options.cipher_page_size > 0)
+    {
+        std::string sql = "PRAGMA cipher_page_size = " + std::to_string(options.cipher_page_size);
+        sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
+    }
+    if (options.kdf_iter > 0)
+    {
+        std::string sql = "PRAGMA kdf_iter = " + std::to_string(options.kdf_iter);
+        sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
+    }
+    if (options.page_cache_kb > 0)
+    {
+        // Negative sizes are in KiB rather than pages
+        std::string sql = "PRAGMA cache_size = -" + std::to_string(options.page_cache_kb);
+        sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
+    }
+    if (options.mmap_size_mb > 0)
+    {
+        int64_t bytes = options.mmap_size_mb * 1024 * 1024;
+        std::string sql = "PRAGMA mmap_size = " + std::to_string(bytes);
+        sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
+    }
+}
+
+} // namespace
+
+class EncryptedMount::WriteLock
+{
+public:
+    explicit WriteLock(EncryptedMount& mount)
+        : mount_(mount)
+    {
+        mount_.lockWriter();
+    }
+
+    ~WriteLock()
+    {
+        mount_.unlockWriter();
+    }
+
+    WriteLock(const WriteLock&) = delete;
+    WriteLock& operator=(const WriteLock&) = delete;
+
+private:
+    EncryptedMount& mount_;
+};
+
+class EncryptedMount::ReadLease
+{
+public:
+    /// Which connections a lease may take
+    enum class Mode
+    {
+        Any,    ///< The idle writer or a pooled reader
+        Pooled, ///< A pooled reader; the writer only when there is no pool
+    };
+
+    explicit ReadLease(EncryptedMount& mount, Mode mode = Mode::Any)
+        : mount_(mount)
+        , generation_(mount.chunk_cache_.generation())
+    {
+        // A writing thread must see its own uncommitted changes
+        if (mount_.ownsWriter() || mount_.options_.read_connections <= 0 ||
+            mount_.reader_key_.empty())
+        {
+            mount_.writer_mutex_.lock();
+            return;
+        }
+
+        std::unique_lock<std::mutex> lock(mount_.pool_mutex_);
+        while (true)
+        {
+            if (!mount_.idle_readers_.empty())
+            {
+                reader_ = mount_.idle_readers_.back();
+                mount_.idle_readers_.pop_back();
+                return;
+            }
+
+            // An idle writer serves reads as well, so single-threaded use
+            // never opens a reader connection
+            if (mode == Mode::Any && mount_.writer_mutex_.try_lock())
+            {
+                return;
+            }
+
+            if (static_cast<int>(mount_.readers_.size()) + mount_.pending_readers_ <
+                mount_.options_.read_connections)
+            {
+                // Reserve the slot and open the connection without blocking
+                // other leases meanwhile
+                ++mount_.pending_readers_;
+                lock.unlock();
+                auto reader = mount_.openReader();
+                lock.lock();
+                --mount_.pending_readers_;
+                if (!reader)
+                {
+                    lock.unlock();
+                    mount_.pool_cv_.notify_one();
+                    mount_.writer_mutex_.lock();
+                    return;
+                }
+                reader_ = reader.get();
+                mount_.readers_.push_back(std::move(reader));
+                return;
+            }
+
+            mount_.pool_cv_.wait(lock);
+        }
+    }
+
+    ~ReadLease()
+    {
+        if (reader_)
+        {
+            std::lock_guard<std::mutex> lock(mount_.pool_mutex_);
+            mount_.idle_readers_.push_back(reader_);
+        }
+        else
+        {
+            mount_.writer_mutex_.unlock();
+            std::lock_guard<std::mutex> lock(mount_.pool_mutex_);
+        }
+        mount_.pool_cv_.notify_one();
+    }
+
+    ReadLease(const ReadLease&) = delete;
+    ReadLease& operator=(const ReadLease&) = delete;
+
+    sqlite3_stmt* statement(Statement id)
+    {
+        return reader_ ? prepareCached(reader_->db, reader_->statements, id)
+                       : mount_.getStatement(id);
+    }
+
+    /// Connection the lease holds, for one-off queries
+    sqlite3* connection() const
+    {
+        return reader_ ? reader_->db : mount_.db_;
+    }
+
+    /**
+     * @brief Check whether this read may use the chunk cache
+     *
+     * The cache may hold chunks a write in progress has not committed yet,
+     * which a pooled reader's snapshot must not see (and must not add to).
+     */
+    bool usesCache() const
+    {
+        return !reader_ || !mount_.writing_;
+    }
+
+    /// Cache generation when the lease was taken; see ChunkCache::insert()
+    uint64_t generation() const
+    {
+        return generation_;
+    }
+
+private:
+    EncryptedMount& mount_;
+    Reader* reader_ = nullptr;
+    uint64_t generation_;
+};
+
 EncryptedMount::EncryptedMount(const std::string& name, const std::string& db_path,
-                               const std::string& mount_point, int64_t max_size_mb)
+                               const std::string& mount_point, int64_t max_size_mb,
+                               const MountOptions& options)
     : name_(name)
     , db_path_(db_path)
     , mount_point_(mount_point)
     , max_size_bytes_(max_size_mb * 1024 * 1024)
+    , options_(options)
     , db_(nullptr)
+    , chunk_cache_(options.chunk_cache_bytes)
 {
 }
 
@@ -34,6 +601,14 @@ bool EncryptedMount::mount(const std::string& password)
         return true; // Already mounted
     }
 
+    // Both end up in PRAGMA statements, so only SQLite's own keywords pass
+    if (!isPragmaValue(options_.journal_mode,
+                       {"DELETE", "TRUNCATE", "PERSIST", "MEMORY", "WAL", "OFF"}) ||
+        !isPragmaValue(options_.synchronous, {"OFF", "NORMAL", "FULL", "EXTRA"}))
+    {
+        return false;
+    }
+
     // Ensure parent directory exists
     std::filesystem::path db_file_path(db_path_);
     std::filesystem::path parent_dir = db_file_path.parent_path();
@@ -67,46 +642,134 @@ bool EncryptedMount::mount(const std::string& password)
     }
 
     // Configure SQLCipher for performance and quota
-    sqlite3_exec(db_, "PRAGMA journal_mode=WAL", nullptr, nullptr, nullptr);
-    sqlite3_exec(db_, "PRAGMA synchronous=NORMAL", nullptr, nullptr, nullptr);
-
-    // Set max page count for quota (4KB pages)
-    int64_t max_pages = max_size_bytes_ / 4096;
+    applyConnectionPragmas(db_, options_);
+    // Only takes effect on a new database, and only before the switch to
+    // WAL writes its header; compact() converts older databases
+    sqlite3_exec(db_, "PRAGMA auto_vacuum = INCREMENTAL", nullptr, nullptr, nullptr);
+    std::string journal_sql = "PRAGMA journal_mode = " + options_.journal_mode;
+    sqlite3_exec(db_, journal_sql.c_str(), nullptr, nullptr, nullptr);
+    std::string synchronous_sql = "PRAGMA synchronous = " + options_.synchronous;
+    sqlite3_exec(db_, synchronous_sql.c_str(), nullptr, nullptr, nullptr);
+
+    // Set max page count for quota in the database's actual page size
+    int64_t page_size = 4096;
+    sqlite3_stmt* page_stmt = nullptr;
+    if (sqlite3_prepare_v2(db_, "PRAGMA page_size", -1, &page_stmt, nullptr) == SQLITE_OK &&
+        sqlite3_step(page_stmt) == SQLITE_ROW && sqlite3_column_int64(page_stmt, 0) > 0)
+    {
+        page_size = sqlite3_column_int64(page_stmt, 0);
+    }
+    sqlite3_finalize(page_stmt);
+    page_size_ = page_size;
+    int64_t max_pages = max_size_bytes_ / page_size;
     std::string quota_sql = "PRAGMA max_page_count = " + std::to_string(max_pages);
     sqlite3_exec(db_, quota_sql.c_str(), nullptr, nullptr, nullptr);
 
-    // Initialize schema if needed
-    if (!initializeSchema())
+    // Initialize schema if needed, then prepare the statement cache
+    if (!initializeSchema() || !prepareStatements())
     {
+        finalizeStatements();
         sqlite3_close(db_);
         db_ = nullptr;
         return false;
     }
 
+    // Readers and snapshots are keyed with this rather than the password
+    reader_key_ = deriveRawKey(db_, password);
+
     // Create root directory if it doesn't exist
     if (!exists("/"))
     {
-        sqlite3_stmt* stmt;
-        const char* sql = "INSERT INTO directories (path, parent, mtime) VALUES ('/', '', ?)";
-        if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) == SQLITE_OK)
+        ScopedStatement stmt(getStatement(Statement::InsertDirectory));
+        if (stmt)
         {
             auto now = std::chrono::system_clock::now().time_since_epoch().count();
-            sqlite3_bind_int64(stmt, 1, now);
-            sqlite3_step(stmt);
-            sqlite3_finalize(stmt);
+            sqlite3_bind_text(stmt.get(), 1, "/", -1, SQLITE_STATIC);
+            sqlite3_bind_text(stmt.get(), 2, "", -1, SQLITE_STATIC);
+            sqlite3_bind_int64(stmt.get(), 3, now);
+            sqlite3_step(stmt.get());
         }
     }
 
+    if (!setupTextIndex())
+    {
+        finalizeStatements();
+        sqlite3_close(db_);
+        db_ = nullptr;
+        wipe(reader_key_);
+        return false;
+    }
+
+    unlock_pending_ = false;
+    return true;
+}
+
+bool EncryptedMount::mountLazily(const std::string& password)
+{
+    if (db_ != nullptr)
+    {
+        return true; // Already mounted
+    }
+
+    std::lock_guard<std::recursive_mutex> lock(unlock_mutex_);
+    password_ = password;
+    unlock_failed_ = false;
+    unlock_pending_ = true;
     return true;
 }
 
+bool EncryptedMount::ensureOpen()
+{
+    if (!unlock_pending_)
+    {
+        return db_ != nullptr;
+    }
+
+    // Recursive because mount() itself reads through the public methods;
+    // other threads wait here until the first one has finished mounting
+    std::lock_guard<std::recursive_mutex> lock(unlock_mutex_);
+    if (unlock_pending_ && db_ == nullptr)
+    {
+        std::string password = password_;
+        wipe(password_);
+        unlock_failed_ = !mount(password);
+        wipe(password);
+        unlock_pending_ = false;
+    }
+    return db_ != nullptr;
+}
+
 bool EncryptedMount::unmount()
 {
+    if (unlock_pending_)
+    {
+        // Never unlocked: just forget the password
+        std::lock_guard<std::recursive_mutex> lock(unlock_mutex_);
+        wipe(password_);
+        unlock_pending_ = false;
+    }
+
     if (db_ == nullptr)
     {
         return true;
     }
 
+    closeReaders();
+    finalizeStatements();
+    chunk_cache_.clear();
+    read_ahead_file_ = -1;
+    wipe(reader_key_);
+
+    // Commit a batch left open by the caller rather than losing its writes
+    if (batch_depth_ > 0)
+    {
+        sqlite3_exec(db_, "COMMIT", nullptr, nullptr, nullptr);
+        for (; batch_depth_ > 0; --batch_depth_)
+        {
+            unlockWriter();
+        }
+    }
+
     // Close database connection
     // Note: sqlite3_close() might fail if there are unfinalized statements,
     // but we'll use sqlite3_close_v2() which handles this gracefully
@@ -116,329 +779,2245 @@ bool EncryptedMount::unmount()
     return (rc == SQLITE_OK);
 }
 
-bool EncryptedMount::initializeSchema()
+sqlite3_stmt* EncryptedMount::getStatement(Statement id)
 {
-    const char* schema = R"(
-        CREATE TABLE IF NOT EXISTS files (
-            path TEXT PRIMARY KEY,
-            content BLOB,
-            size INTEGER,
-            mtime INTEGER
-        );
-
-        CREATE TABLE IF NOT EXISTS directories (
-            path TEXT PRIMARY KEY,
-            parent TEXT,
-            mtime INTEGER
-        );
-
-        CREATE INDEX IF NOT EXISTS idx_dir_parent ON directories(parent);
-    )";
+    return prepareCached(db_, statements_, id);
+}
 
-    char* err_msg = nullptr;
-    int rc = sqlite3_exec(db_, schema, nullptr, nullptr, &err_msg);
-    if (rc != SQLITE_OK)
+sqlite3_stmt* EncryptedMount::prepareCached(sqlite3* db, StatementCache& cache, Statement id)
+{
+    sqlite3_stmt*& stmt = cache[static_cast<size_t>(id)];
+    if (!stmt && db)
     {
-        if (err_msg)
+        if (sqlite3_prepare_v3(db, kStatementSql[static_cast<size_t>(id)], -1,
+                               SQLITE_PREPARE_PERSISTENT, &stmt, nullptr) != SQLITE_OK)
         {
-            sqlite3_free(err_msg);
+            sqlite3_finalize(stmt);
+            stmt = nullptr;
         }
-        return false;
     }
-
-    return true;
+    return stmt;
 }
 
-std::string EncryptedMount::normalizePath(const std::string& path)
+void EncryptedMount::lockWriter()
 {
-    if (path.empty() || path[0] != '/')
+    writer_mutex_.lock();
+    if (write_depth_++ == 0)
     {
-        return "/" + path;
+        writer_owner_ = std::this_thread::get_id();
+        writing_ = true;
+        chunk_cache_.advanceGeneration();
     }
+}
 
-    std::string normalized = path;
-    // Remove trailing slash unless it's root
-    if (normalized.length() > 1 && normalized.back() == '/')
+void EncryptedMount::unlockWriter()
+{
+    if (--write_depth_ == 0)
     {
-        normalized.pop_back();
+        // Advance before clearing writing_ so that a pooled read which
+        // started during the write cannot cache what it saw
+        chunk_cache_.advanceGeneration();
+        writing_ = false;
+        writer_owner_ = std::thread::id();
     }
+    writer_mutex_.unlock();
 
-    return normalized;
+    // Taking the pool mutex orders this with a reader about to wait
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex_);
+    }
+    pool_cv_.notify_all();
 }
 
-bool EncryptedMount::exists(const std::string& path)
+std::unique_ptr<EncryptedMount::Reader> EncryptedMount::openReader()
 {
-    if (!db_)
-        return false;
-
-    std::string norm_path = normalizePath(path);
-
-    // Check files
-    sqlite3_stmt* stmt;
-    const char* sql = "SELECT 1 FROM files WHERE path = ? LIMIT 1";
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) == SQLITE_OK)
+    auto reader = std::make_unique<Reader>();
+
+    // Each reader is used by one thread at a time, so SQLite's own mutexes
+    // are not needed; query_only guards against a stray write
+    int flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_NOMUTEX;
+    if (sqlite3_open_v2(db_path_.c_str(), &reader->db, flags, nullptr) != SQLITE_OK ||
+        sqlite3_key(reader->db, reader_key_.c_str(), static_cast<int>(reader_key_.length())) !=
+            SQLITE_OK)
     {
-        sqlite3_bind_text(stmt, 1, norm_path.c_str(), -1, SQLITE_STATIC);
-        bool found = (sqlite3_step(stmt) == SQLITE_ROW);
-        sqlite3_finalize(stmt);
-        if (found)
-            return true;
+        sqlite3_close_v2(reader->db);
+        return nullptr;
     }
 
-    // Check directories
-    sql = "SELECT 1 FROM directories WHERE path = ? LIMIT 1";
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) == SQLITE_OK)
+    applyConnectionPragmas(reader->db, options_);
+    if (sqlite3_exec(reader->db, "PRAGMA query_only = 1", nullptr, nullptr, nullptr) !=
+            SQLITE_OK ||
+        sqlite3_exec(reader->db, "SELECT count(*) FROM sqlite_master", nullptr, nullptr,
+                     nullptr) != SQLITE_OK)
     {
-        sqlite3_bind_text(stmt, 1, norm_path.c_str(), -1, SQLITE_STATIC);
-        bool found = (sqlite3_step(stmt) == SQLITE_ROW);
-        sqlite3_finalize(stmt);
-        return found;
+        sqlite3_close_v2(reader->db);
+        return nullptr;
     }
 
-    return false;
+    sqlite3_busy_timeout(reader->db, 1000);
+    return reader;
 }
 
-bool EncryptedMount::isDirectory(const std::string& path)
+void EncryptedMount::closeReaders()
 {
-    if (!db_)
-        return false;
-
-    std::string norm_path = normalizePath(path);
-
-    sqlite3_stmt* stmt;
-    const char* sql = "SELECT 1 FROM directories WHERE path = ? LIMIT 1";
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) == SQLITE_OK)
+    std::lock_guard<std::mutex> lock(pool_mutex_);
+    for (auto& reader : readers_)
     {
-        sqlite3_bind_text(stmt, 1, norm_path.c_str(), -1, SQLITE_STATIC);
-        bool is_dir = (sqlite3_step(stmt) == SQLITE_ROW);
-        sqlite3_finalize(stmt);
-        return is_dir;
+        for (auto& stmt : reader->statements)
+        {
+            sqlite3_finalize(stmt);
+        }
+        sqlite3_close_v2(reader->db);
+    }
+    readers_.clear();
+    idle_readers_.clear();
+}
+
+bool EncryptedMount::prepareStatements()
+{
+    static_assert(std::size(kStatementSql) == static_cast<size_t>(Statement::Count),
+                  "kStatementSql must have one entry per Statement");
+
+    // The text index statements are prepared on first use
+    for (size_t i = 0; i < static_cast<size_t>(Statement::ReplaceText); ++i)
+    {
+        if (!getStatement(static_cast<Statement>(i)))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void EncryptedMount::finalizeStatements()
+{
+    for (auto& stmt : statements_)
+    {
+        // sqlite3_finalize(nullptr) is a harmless no-op
+        sqlite3_finalize(stmt);
+        stmt = nullptr;
+    }
+}
+
+bool EncryptedMount::initializeSchema()
+{
+    // Databases created before chunked storage kept each file in a single
+    // files.content BLOB and never set user_version
+    bool legacy = false;
+    sqlite3_stmt* stmt;
+    const char* sql = "SELECT 1 FROM pragma_table_info('files') WHERE name = 'content'";
+    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) == SQLITE_OK)
+    {
+        legacy = (sqlite3_step(stmt) == SQLITE_ROW);
+        sqlite3_finalize(stmt);
+    }
+    else
+    {
+        // Fails here when the password is wrong
+        return false;
+    }
+
+    int version = 0;
+    if (sqlite3_prepare_v2(db_, "PRAGMA user_version", -1, &stmt, nullptr) == SQLITE_OK)
+    {
+        if (sqlite3_step(stmt) == SQLITE_ROW)
+        {
+            version = sqlite3_column_int(stmt, 0);
+        }
+        sqlite3_finalize(stmt);
+    }
+
+    // One transaction for the whole upgrade, version bump included: if any
+    // step fails the database stays at its old version and the next mount
+    // starts over (each migration's own savepoint nests inside this one)
+    Savepoint savepoint(db_);
+    if (!savepoint.isActive())
+    {
+        return false;
+    }
+
+    if (legacy && !migrateFromBlobSchema())
+    {
+        return false;
+    }
+
+    // Must precede the version 2 migration, which recreates the triggers
+    if (version >= 2 && version < 5 && !migrateAddChunkBlobs())
+    {
+        return false;
+    }
+
+    if (version >= 2 && version < 6 && !migrateAddCompressionFlags())
+    {
+        return false;
+    }
+
+    if (version >= 2 && version < 8 && !migrateAddChunkChecksums())
+    {
+        return false;
+    }
+
+    if (version == 2 && !migrateAddFileParent())
+    {
+        return false;
+    }
+
+    if (!createSchema())
+    {
+        return false;
+    }
+
+    // Usage counters were introduced in version 4 and stored bytes in
+    // version 5; seed them from the tables
+    if (version < 5 && !rebuildUsageCounters())
+    {
+        return false;
+    }
+
+    return savepoint.commit();
+}
+
+bool EncryptedMount::createSchema()
+{
+    const char* schema = R"(
+        CREATE TABLE IF NOT EXISTS files (
+            id INTEGER PRIMARY KEY,
+            path TEXT NOT NULL UNIQUE,
+            parent TEXT NOT NULL,
+            size INTEGER NOT NULL DEFAULT 0,
+            mtime INTEGER
+        );
+
+        CREATE INDEX IF NOT EXISTS idx_files_parent ON files(parent);
+        CREATE INDEX IF NOT EXISTS idx_files_size ON files(size);
+        CREATE INDEX IF NOT EXISTS idx_files_mtime ON files(mtime);
+
+        CREATE TABLE IF NOT EXISTS chunks (
+            file_id INTEGER NOT NULL,
+            idx INTEGER NOT NULL,
+            data BLOB,
+            blob_id INTEGER,
+            compressed INTEGER NOT NULL DEFAULT 0,
+            checksum INTEGER,
+            PRIMARY KEY (file_id, idx)
+        );
+
+        CREATE TABLE IF NOT EXISTS blobs (
+            id INTEGER PRIMARY KEY,
+            data BLOB NOT NULL,
+            compressed INTEGER NOT NULL DEFAULT 0
+        );
+
+        CREATE TABLE IF NOT EXISTS blob_refs (
+            blob_id INTEGER PRIMARY KEY,
+            hash BLOB NOT NULL UNIQUE,
+            size INTEGER NOT NULL,
+            refs INTEGER NOT NULL DEFAULT 0
+        );
+
+        CREATE TABLE IF NOT EXISTS directories (
+            path TEXT PRIMARY KEY,
+            parent TEXT,
+            mtime INTEGER
+        );
+
+        CREATE INDEX IF NOT EXISTS idx_dir_parent ON directories(parent);
+
+        CREATE TRIGGER IF NOT EXISTS files_delete_chunks AFTER DELETE ON files
+        BEGIN
+            DELETE FROM chunks WHERE file_id = OLD.id;
+        END;
+
+        CREATE TABLE IF NOT EXISTS usage (
+            id INTEGER PRIMARY KEY CHECK (id = 1),
+            used_bytes INTEGER NOT NULL,
+            file_count INTEGER NOT NULL,
+            dir_count INTEGER NOT NULL,
+            stored_bytes INTEGER NOT NULL DEFAULT 0
+        );
+
+        INSERT OR IGNORE INTO usage (id, used_bytes, file_count, dir_count) VALUES (1, 0, 0, 0);
+
+        CREATE TRIGGER IF NOT EXISTS usage_files_insert AFTER INSERT ON files
+        BEGIN
+            UPDATE usage SET used_bytes = used_bytes + NEW.size, file_count = file_count + 1;
+        END;
+
+        CREATE TRIGGER IF NOT EXISTS usage_files_update AFTER UPDATE OF size ON files
+        BEGIN
+            UPDATE usage SET used_bytes = used_bytes + NEW.size - OLD.size;
+        END;
+
+        CREATE TRIGGER IF NOT EXISTS usage_files_delete AFTER DELETE ON files
+        BEGIN
+            UPDATE usage SET used_bytes = used_bytes - OLD.size, file_count = file_count - 1;
+        END;
+
+        CREATE TRIGGER IF NOT EXISTS usage_dirs_insert AFTER INSERT ON directories
+        WHEN NEW.path <> '/'
+        BEGIN
+            UPDATE usage SET dir_count = dir_count + 1;
+        END;
+
+        CREATE TRIGGER IF NOT EXISTS usage_dirs_delete AFTER DELETE ON directories
+        WHEN OLD.path <> '/'
+        BEGIN
+            UPDATE usage SET dir_count = dir_count - 1;
+        END;
+
+        -- Reference counts live in the small blob_refs rows so that counting
+        -- never rewrites a blob; a NULL blob_id (inline chunk) matches nothing
+        CREATE TRIGGER IF NOT EXISTS chunks_insert AFTER INSERT ON chunks
+        BEGIN
+            UPDATE blob_refs SET refs = refs + 1 WHERE blob_id = NEW.blob_id;
+            UPDATE usage SET stored_bytes = stored_bytes + COALESCE(length(NEW.data), 0);
+        END;
+
+        CREATE TRIGGER IF NOT EXISTS chunks_update AFTER UPDATE OF data, blob_id ON chunks
+        BEGIN
+            UPDATE blob_refs SET refs = refs + 1 WHERE blob_id = NEW.blob_id;
+            UPDATE blob_refs SET refs = refs - 1 WHERE blob_id = OLD.blob_id;
+            DELETE FROM blob_refs WHERE blob_id = OLD.blob_id AND refs = 0;
+            UPDATE usage SET stored_bytes = stored_bytes + COALESCE(length(NEW.data), 0) -
+                                            COALESCE(length(OLD.data), 0);
+        END;
+
+        CREATE TRIGGER IF NOT EXISTS chunks_delete AFTER DELETE ON chunks
+        BEGIN
+            UPDATE blob_refs SET refs = refs - 1 WHERE blob_id = OLD.blob_id;
+            DELETE FROM blob_refs WHERE blob_id = OLD.blob_id AND refs = 0;
+            UPDATE usage SET stored_bytes = stored_bytes - COALESCE(length(OLD.data), 0);
+        END;
+
+        CREATE TRIGGER IF NOT EXISTS blob_refs_insert AFTER INSERT ON blob_refs
+        BEGIN
+            UPDATE usage SET stored_bytes = stored_bytes + NEW.size;
+        END;
+
+        CREATE TRIGGER IF NOT EXISTS blob_refs_delete AFTER DELETE ON blob_refs
+        BEGIN
+            DELETE FROM blobs WHERE id = OLD.blob_id;
+            UPDATE usage SET stored_bytes = stored_bytes - OLD.size;
+        END;
+    )";
+
+    char* err_msg = nullptr;
+    int rc = sqlite3_exec(db_, schema, nullptr, nullptr, &err_msg);
+    if (rc != SQLITE_OK)
+    {
+        if (err_msg)
+        {
+            sqlite3_free(err_msg);
+        }
+        return false;
+    }
+
+    std::string version_sql = "PRAGMA user_version = " + std::to_string(kSchemaVersion);
+    return sqlite3_exec(db_, version_sql.c_str(), nullptr, nullptr, nullptr) == SQLITE_OK;
+}
+
+bool EncryptedMount::migrateAddFileParent()
+{
+    Savepoint savepoint(db_);
+    if (!savepoint.isActive())
+    {
+        return false;
+    }
+
+    // SQLite cannot add a NOT NULL column without a default, so existing
+    // databases get a nullable column; the writers always set it
+    std::string sql = std::string("ALTER TABLE files ADD COLUMN parent TEXT;"
+                                  "UPDATE files SET parent = ") +
+                      kParentOfPathSql + ";";
+    if (sqlite3_exec(db_, sql.c_str(), nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+        return false;
+    }
+
+    return createSchema() && savepoint.commit();
+}
+
+bool EncryptedMount::migrateAddChunkBlobs()
+{
+    Savepoint savepoint(db_);
+    if (!savepoint.isActive())
+    {
+        return false;
+    }
+
+    // Version 4 added the usage table; earlier versions get it from createSchema()
+    std::string sql = "ALTER TABLE chunks ADD COLUMN blob_id INTEGER;";
+    if (hasTable(db_, "usage"))
+    {
+        sql += "ALTER TABLE usage ADD COLUMN stored_bytes INTEGER NOT NULL DEFAULT 0;";
+    }
+    if (sqlite3_exec(db_, sql.c_str(), nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+        return false;
+    }
+
+    return savepoint.commit();
+}
+
+bool EncryptedMount::migrateAddCompressionFlags()
+{
+    Savepoint savepoint(db_);
+    if (!savepoint.isActive())
+    {
+        return false;
+    }
+
+    // Version 5 added the blobs table; earlier versions get it from createSchema()
+    std::string sql = "ALTER TABLE chunks ADD COLUMN compressed INTEGER NOT NULL DEFAULT 0;";
+    if (hasTable(db_, "blobs"))
+    {
+        sql += "ALTER TABLE blobs ADD COLUMN compressed INTEGER NOT NULL DEFAULT 0;";
+    }
+    if (sqlite3_exec(db_, sql.c_str(), nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+        return false;
+    }
+
+    return savepoint.commit();
+}
+
+bool EncryptedMount::migrateAddChunkChecksums()
+{
+    Savepoint savepoint(db_);
+    if (!savepoint.isActive())
+    {
+        return false;
+    }
+
+    // Chunks written before this have no checksum; verifyFile() counts them
+    // as unverified
+    if (sqlite3_exec(db_, "ALTER TABLE chunks ADD COLUMN checksum INTEGER", nullptr, nullptr,
+                     nullptr) != SQLITE_OK)
+    {
+        return false;
+    }
+
+    return savepoint.commit();
+}
+
+bool EncryptedMount::migrateFromBlobSchema()
+{
+    Savepoint savepoint(db_);
+    if (!savepoint.isActive())
+    {
+        return false;
+    }
+
+    if (sqlite3_exec(db_, "ALTER TABLE files RENAME TO files_v1", nullptr, nullptr, nullptr) !=
+        SQLITE_OK)
+    {
+        return false;
+    }
+
+    // Recreate the tables in the current layout
+    if (!createSchema())
+    {
+        return false;
+    }
+
+    std::string copy_sql = std::string("INSERT INTO files (id, path, parent, size, mtime) "
+                                       "SELECT rowid, path, ") +
+                           kParentOfPathSql +
+                           ", COALESCE(length(content), 0), mtime FROM files_v1";
+    if (sqlite3_exec(db_, copy_sql.c_str(), nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+        return false;
+    }
+
+    // Split each BLOB into chunks through incremental BLOB I/O so that memory
+    // stays bounded by the chunk size even for very large files
+    std::vector<int64_t> rowids;
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db_, "SELECT rowid FROM files_v1 WHERE length(content) > 0", -1, &stmt,
+                           nullptr) != SQLITE_OK)
+    {
+        return false;
+    }
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        rowids.push_back(sqlite3_column_int64(stmt, 0));
+    }
+    sqlite3_finalize(stmt);
+
+    std::string buffer(static_cast<size_t>(kChunkSize), '\0');
+    for (int64_t rowid : rowids)
+    {
+        sqlite3_blob* blob = nullptr;
+        if (sqlite3_blob_open(db_, "main", "files_v1", "content", rowid, 0, &blob) != SQLITE_OK)
+        {
+            sqlite3_blob_close(blob);
+            return false;
+        }
+
+        int64_t total = sqlite3_blob_bytes(blob);
+        bool ok = true;
+        for (int64_t offset = 0, idx = 0; offset < total && ok; offset += kChunkSize, ++idx)
+        {
+            int64_t len = std::min(kChunkSize, total - offset);
+            ok = sqlite3_blob_read(blob, buffer.data(), static_cast<int>(len),
+                                   static_cast<int>(offset)) == SQLITE_OK &&
+                 writeChunk(rowid, idx, buffer.data(), len);
+        }
+        sqlite3_blob_close(blob);
+        if (!ok)
+        {
+            return false;
+        }
+    }
+
+    if (sqlite3_exec(db_, "DROP TABLE files_v1", nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+        return false;
+    }
+
+    return savepoint.commit();
+}
+
+std::string EncryptedMount::normalizePath(const std::string& path)
+{
+    if (path.empty() || path[0] != '/')
+    {
+        return "/" + path;
+    }
+
+    std::string normalized = path;
+    // Remove trailing slash unless it's root
+    if (normalized.length() > 1 && normalized.back() == '/')
+    {
+        normalized.pop_back();
+    }
+
+    return normalized;
+}
+
+bool EncryptedMount::exists(const std::string& path)
+{
+    if (!ensureOpen())
+        return false;
+
+    std::string norm_path = normalizePath(path);
+
+    ReadLease lease(*this);
+    // Checks files and directories in a single statement
+    ScopedStatement stmt(lease.statement(Statement::PathExists));
+    if (!stmt)
+    {
+        return false;
+    }
+
+    sqlite3_bind_text(stmt.get(), 1, norm_path.c_str(), -1, SQLITE_STATIC);
+    return (sqlite3_step(stmt.get()) == SQLITE_ROW);
+}
+
+bool EncryptedMount::isDirectory(const std::string& path)
+{
+    if (!ensureOpen())
+        return false;
+
+    std::string norm_path = normalizePath(path);
+
+    ReadLease lease(*this);
+    ScopedStatement stmt(lease.statement(Statement::DirectoryExists));
+    if (!stmt)
+    {
+        return false;
+    }
+
+    sqlite3_bind_text(stmt.get(), 1, norm_path.c_str(), -1, SQLITE_STATIC);
+    return (sqlite3_step(stmt.get()) == SQLITE_ROW);
+}
+
+std::vector<VirtualFileInfo> EncryptedMount::listDirectory(const std::string& path)
+{
+    std::vector<VirtualFileInfo> results;
+    if (!ensureOpen())
+        return results;
+
+    std::string norm_path = normalizePath(path);
+    ReadLease lease(*this);
+
+    // List subdirectories
+    {
+        ScopedStatement stmt(lease.statement(Statement::ListSubdirectories));
+        if (stmt)
+        {
+            sqlite3_bind_text(stmt.get(), 1, norm_path.c_str(), -1, SQLITE_STATIC);
+            while (sqlite3_step(stmt.get()) == SQLITE_ROW)
+            {
+                VirtualFileInfo info;
+                info.path = reinterpret_cast<const char*>(sqlite3_column_text(stmt.get(), 0));
+                info.name = info.path.substr(info.path.find_last_of('/') + 1);
+                info.is_directory = true;
+                info.size = 0;
+                info.mtime = sqlite3_column_int64(stmt.get(), 1);
+                results.push_back(info);
+            }
+        }
+    }
+
+    // List files through the parent index
+    {
+        ScopedStatement stmt(lease.statement(Statement::ListFiles));
+        if (stmt)
+        {
+            sqlite3_bind_text(stmt.get(), 1, norm_path.c_str(), -1, SQLITE_STATIC);
+            while (sqlite3_step(stmt.get()) == SQLITE_ROW)
+            {
+                VirtualFileInfo info;
+                info.path = reinterpret_cast<const char*>(sqlite3_column_text(stmt.get(), 0));
+                info.name = info.path.substr(info.path.find_last_of('/') + 1);
+                info.is_directory = false;
+                info.size = sqlite3_column_int64(stmt.get(), 1);
+                info.mtime = sqlite3_column_int64(stmt.get(), 2);
+                results.push_back(info);
+            }
+        }
+    }
+
+    return results;
+}
+
+bool EncryptedMount::walkTree(const std::string& path,
+                              const std::function<bool(const VirtualFileInfo&)>& visitor)
+{
+    if (!ensureOpen())
+        return false;
+
+    std::string norm_path = normalizePath(path);
+    if (!isDirectory(norm_path))
+    {
+        return false;
+    }
+
+    // Descendants sort in (dir + '/', dir + '0'); the root's are all of ("/", "0")
+    std::string lower = norm_path == "/" ? "/" : norm_path + "/";
+    std::string upper = norm_path == "/" ? "0" : norm_path + "0";
+    constexpr int kPageSize = 256;
+
+    for (Statement query : {Statement::ListDirectoryTree, Statement::ListFileTree})
+    {
+        bool directories = query == Statement::ListDirectoryTree;
+        std::string after = lower;
+        std::vector<VirtualFileInfo> page;
+        do
+        {
+            // Fetch a page, then release the connection before visiting it
+            page.clear();
+            {
+                ReadLease lease(*this);
+                ScopedStatement stmt(lease.statement(query));
+                if (!stmt)
+                {
+                    return false;
+                }
+                sqlite3_bind_text(stmt.get(), 1, after.c_str(), -1, SQLITE_STATIC);
+                sqlite3_bind_text(stmt.get(), 2, upper.c_str(), -1, SQLITE_STATIC);
+                sqlite3_bind_int(stmt.get(), 3, kPageSize);
+                while (sqlite3_step(stmt.get()) == SQLITE_ROW)
+                {
+                    VirtualFileInfo info;
+                    info.path = reinterpret_cast<const char*>(sqlite3_column_text(stmt.get(), 0));
+                    info.name = info.path.substr(info.path.find_last_of('/') + 1);
+                    info.is_directory = directories;
+                    info.size = directories ? 0 : sqlite3_column_int64(stmt.get(), 1);
+                    info.mtime = sqlite3_column_int64(stmt.get(), directories ? 1 : 2);
+                    page.push_back(std::move(info));
+                }
+            }
+
+            for (const auto& info : page)
+            {
+                if (!visitor(info))
+                {
+                    return false;
+                }
+            }
+            if (!page.empty())
+            {
+                after = page.back().path;
+            }
+        } while (page.size() == kPageSize);
+    }
+    return true;
+}
+
+bool EncryptedMount::findFiles(const FileQuery& query, std::vector<VirtualFileInfo>& results)
+{
+    results.clear();
+    if (!ensureOpen())
+        return false;
+
+    std::string norm_path = normalizePath(query.path);
+    if (!isDirectory(norm_path))
+    {
+        return false;
+    }
+
+    // Same descendant range as walkTree()
+    std::string lower = norm_path == "/" ? "/" : norm_path + "/";
+    std::string upper = norm_path == "/" ? "0" : norm_path + "0";
+
+    // Without bounds this is the unpaged path range scan of walkTree()
+    Statement query_id = query.hasMtimeBounds()  ? Statement::FindFilesByMtime
+                         : query.hasSizeBounds() ? Statement::FindFilesBySize
+                                                 : Statement::ListFileTree;
+
+    ReadLease lease(*this);
+    ScopedStatement stmt(lease.statement(query_id));
+    if (!stmt)
+    {
+        return false;
+    }
+    sqlite3_bind_text(stmt.get(), 1, lower.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt.get(), 2, upper.c_str(), -1, SQLITE_STATIC);
+    if (query_id == Statement::ListFileTree)
+    {
+        sqlite3_bind_int(stmt.get(), 3, -1); // No LIMIT
+    }
+    else
+    {
+        sqlite3_bind_int64(stmt.get(), 3, query.min_size);
+        sqlite3_bind_int64(stmt.get(), 4, query.max_size);
+    }
+    if (query_id == Statement::FindFilesByMtime)
+    {
+        sqlite3_bind_int64(stmt.get(), 5, query.min_mtime);
+        sqlite3_bind_int64(stmt.get(), 6, query.max_mtime);
+    }
+
+    int rc;
+    while ((rc = sqlite3_step(stmt.get())) == SQLITE_ROW)
+    {
+        VirtualFileInfo info;
+        info.path = reinterpret_cast<const char*>(sqlite3_column_text(stmt.get(), 0));
+        info.name = info.path.substr(info.path.find_last_of('/') + 1);
+        info.is_directory = false;
+        info.size = sqlite3_column_int64(stmt.get(), 1);
+        info.mtime = sqlite3_column_int64(stmt.get(), 2);
+        results.push_back(std::move(info));
+    }
+    if (rc != SQLITE_DONE)
+    {
+        results.clear();
+        return false;
+    }
+
+    // The index scans return rows in size or mtime order
+    if (query_id != Statement::ListFileTree)
+    {
+        std::sort(results.begin(), results.end(),
+                  [](const VirtualFileInfo& a, const VirtualFileInfo& b)
+                  {
+                      return a.path < b.path;
+                  });
+    }
+    return true;
+}
+
+bool EncryptedMount::findTextCandidates(const std::string& path,
+                                        const std::vector<std::string>& terms,
+                                        std::vector<std::string>& paths)
+{
+    paths.clear();
+    if (!options_.text_index || !ensureOpen())
+        return false;
+
+    std::string match = trigramQuery(terms);
+    std::string norm_path = normalizePath(path);
+    if (match.empty() || !isDirectory(norm_path))
+    {
+        return false;
+    }
+
+    // Same descendant range as walkTree()
+    std::string lower = norm_path == "/" ? "/" : norm_path + "/";
+    std::string upper = norm_path == "/" ? "0" : norm_path + "0";
+
+    ReadLease lease(*this);
+    ScopedStatement stmt(lease.statement(Statement::SelectTextCandidates));
+    if (!stmt)
+    {
+        return false;
+    }
+    sqlite3_bind_text(stmt.get(), 1, lower.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt.get(), 2, upper.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt.get(), 3, match.c_str(), -1, SQLITE_STATIC);
+
+    int rc;
+    while ((rc = sqlite3_step(stmt.get())) == SQLITE_ROW)
+    {
+        paths.emplace_back(reinterpret_cast<const char*>(sqlite3_column_text(stmt.get(), 0)));
+    }
+    if (rc != SQLITE_DONE)
+    {
+        paths.clear();
+        return false;
+    }
+    std::sort(paths.begin(), paths.end());
+    return true;
+}
+
+bool EncryptedMount::stat(const std::string& path, VirtualFileInfo& info)
+{
+    if (!ensureOpen())
+        return false;
+
+    std::string norm_path = normalizePath(path);
+
+    // Type, size and mtime of either kind of entry in one round trip
+    ReadLease lease(*this);
+    ScopedStatement stmt(lease.statement(Statement::StatPath));
+    if (!stmt)
+    {
+        return false;
+    }
+
+    sqlite3_bind_text(stmt.get(), 1, norm_path.c_str(), -1, SQLITE_STATIC);
+    if (sqlite3_step(stmt.get()) != SQLITE_ROW)
+    {
+        return false;
+    }
+
+    info.path = norm_path;
+    info.name = norm_path.substr(norm_path.find_last_of('/') + 1);
+    info.is_directory = sqlite3_column_int(stmt.get(), 0) != 0;
+    info.size = sqlite3_column_int64(stmt.get(), 1);
+    info.mtime = sqlite3_column_int64(stmt.get(), 2);
+    return true;
+}
+
+bool EncryptedMount::lookupFile(ReadLease& lease, const std::string& norm_path, int64_t& file_id,
+                                int64_t& size)
+{
+    ScopedStatement stmt(lease.statement(Statement::LookupFile));
+    if (!stmt)
+    {
+        return false;
+    }
+
+    sqlite3_bind_text(stmt.get(), 1, norm_path.c_str(), -1, SQLITE_STATIC);
+    if (sqlite3_step(stmt.get()) != SQLITE_ROW)
+    {
+        return false;
+    }
+
+    file_id = sqlite3_column_int64(stmt.get(), 0);
+    size = sqlite3_column_int64(stmt.get(), 1);
+    return true;
+}
+
+bool EncryptedMount::writeChunk(int64_t file_id, int64_t idx, const char* data, int64_t size)
+{
+    chunk_cache_.invalidate(file_id, idx);
+
+    ScopedStatement stmt(getStatement(Statement::InsertChunk));
+    if (!stmt)
+    {
+        return false;
+    }
+
+    sqlite3_bind_int64(stmt.get(), 1, file_id);
+    sqlite3_bind_int64(stmt.get(), 2, idx);
+    sqlite3_bind_int64(stmt.get(), 6,
+                       mz_crc32(MZ_CRC32_INIT, reinterpret_cast<const unsigned char*>(data),
+                                static_cast<size_t>(size)));
+
+    std::string compressed;
+    if (options_.dedup)
+    {
+        int64_t blob_id = 0;
+        if (!findOrInsertBlob(data, size, blob_id))
+        {
+            return false;
+        }
+        sqlite3_bind_null(stmt.get(), 3);
+        sqlite3_bind_int64(stmt.get(), 4, blob_id);
+        sqlite3_bind_int(stmt.get(), 5, 0);
+    }
+    else if (compressChunk(data, size, compressed))
+    {
+        sqlite3_bind_blob(stmt.get(), 3, compressed.data(), static_cast<int>(compressed.size()),
+                          SQLITE_STATIC);
+        sqlite3_bind_null(stmt.get(), 4);
+        sqlite3_bind_int(stmt.get(), 5, 1);
+    }
+    else
+    {
+        sqlite3_bind_blob(stmt.get(), 3, data, static_cast<int>(size), SQLITE_STATIC);
+        sqlite3_bind_null(stmt.get(), 4);
+        sqlite3_bind_int(stmt.get(), 5, 0);
+    }
+    return (sqlite3_step(stmt.get()) == SQLITE_DONE);
+}
+
+bool EncryptedMount::findOrInsertBlob(const char* data, int64_t size, int64_t& blob_id)
+{
+    unsigned char hash[SHA256_DIGEST_LENGTH];
+    SHA256(reinterpret_cast<const unsigned char*>(data), static_cast<size_t>(size), hash);
+
+    {
+        ScopedStatement stmt(getStatement(Statement::FindBlob));
+        if (!stmt)
+        {
+            return false;
+        }
+        sqlite3_bind_blob(stmt.get(), 1, hash, sizeof(hash), SQLITE_STATIC);
+        if (sqlite3_step(stmt.get()) == SQLITE_ROW)
+        {
+            blob_id = sqlite3_column_int64(stmt.get(), 0);
+            return true;
+        }
+    }
+
+    // The hash is of the uncompressed content; only what is stored is deflated
+    std::string compressed;
+    bool is_compressed = compressChunk(data, size, compressed);
+    if (is_compressed)
+    {
+        data = compressed.data();
+        size = static_cast<int64_t>(compressed.size());
+    }
+
+    {
+        ScopedStatement stmt(getStatement(Statement::InsertBlob));
+        if (!stmt)
+        {
+            return false;
+        }
+        sqlite3_bind_blob(stmt.get(), 1, data, static_cast<int>(size), SQLITE_STATIC);
+        sqlite3_bind_int(stmt.get(), 2, is_compressed ? 1 : 0);
+        if (sqlite3_step(stmt.get()) != SQLITE_DONE)
+        {
+            return false;
+        }
+        blob_id = sqlite3_last_insert_rowid(db_);
+    }
+
+    ScopedStatement stmt(getStatement(Statement::InsertBlobRef));
+    if (!stmt)
+    {
+        return false;
+    }
+    sqlite3_bind_int64(stmt.get(), 1, blob_id);
+    sqlite3_bind_blob(stmt.get(), 2, hash, sizeof(hash), SQLITE_STATIC);
+    sqlite3_bind_int64(stmt.get(), 3, size);
+    return (sqlite3_step(stmt.get()) == SQLITE_DONE);
+}
+
+bool EncryptedMount::compressChunk(const char* data, int64_t size, std::string& compressed)
+{
+    // Below this a deflate stream's own overhead eats most of the gain
+    constexpr int64_t kMinCompressSize = 128;
+    constexpr int64_t kSampleSize = 4096;
+
+    if (options_.compression_level <= 0 || size < kMinCompressSize)
+    {
+        return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto deflate = [&](int64_t length) -> bool
+    {
+        mz_ulong out_len = mz_compressBound(static_cast<mz_ulong>(length));
+        compressed.resize(static_cast<size_t>(out_len));
+        if (mz_compress2(reinterpret_cast<unsigned char*>(compressed.data()), &out_len,
+                         reinterpret_cast<const unsigned char*>(data),
+                         static_cast<mz_ulong>(length), options_.compression_level) != MZ_OK)
+        {
+            return false;
+        }
+        compressed.resize(static_cast<size_t>(out_len));
+
+        // Worth storing compressed only if it saves at least 1/8
+        return static_cast<int64_t>(out_len) <= length - length / 8;
+    };
+
+    // Judge large chunks by a sample first so that media and archives cost
+    // one small deflate instead of a full one
+    bool worthwhile = (size <= kSampleSize * 2 || deflate(kSampleSize)) && deflate(size);
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start);
+
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    compression_stats_.compress_ns += static_cast<uint64_t>(elapsed.count());
+    if (!worthwhile)
+    {
+        ++compression_stats_.chunks_skipped;
+        return false;
+    }
+
+    ++compression_stats_.chunks_compressed;
+    compression_stats_.bytes_in += static_cast<uint64_t>(size);
+    compression_stats_.bytes_out += compressed.size();
+    return true;
+}
+
+bool EncryptedMount::readChunkColumn(sqlite3_stmt* stmt, int column, std::string& content)
+{
+    const char* data = static_cast<const char*>(sqlite3_column_blob(stmt, column));
+    int bytes = sqlite3_column_bytes(stmt, column);
+    if (sqlite3_column_int(stmt, column + 1) == 0)
+    {
+        content.assign(data ? data : "", static_cast<size_t>(bytes));
+        return true;
+    }
+
+    // Chunks never exceed kChunkSize uncompressed
+    auto start = std::chrono::steady_clock::now();
+    mz_ulong out_len = static_cast<mz_ulong>(kChunkSize);
+    content.resize(static_cast<size_t>(kChunkSize));
+    if (mz_uncompress(reinterpret_cast<unsigned char*>(content.data()), &out_len,
+                      reinterpret_cast<const unsigned char*>(data),
+                      static_cast<mz_ulong>(bytes)) != MZ_OK)
+    {
+        content.clear();
+        return false;
+    }
+    content.resize(static_cast<size_t>(out_len));
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start);
+
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    compression_stats_.bytes_inflated += out_len;
+    compression_stats_.decompress_ns += static_cast<uint64_t>(elapsed.count());
+    return true;
+}
+
+int64_t EncryptedMount::getFileSize(const std::string& path)
+{
+    if (!ensureOpen())
+        return -1;
+
+    ReadLease lease(*this);
+    int64_t file_id = 0;
+    int64_t size = 0;
+    if (!lookupFile(lease, normalizePath(path), file_id, size))
+    {
+        return -1;
+    }
+    return size;
+}
+
+bool EncryptedMount::readFile(const std::string& path, std::string& content)
+{
+    return readFileRange(path, 0, std::numeric_limits<int64_t>::max(), content);
+}
+
+bool EncryptedMount::readFileRange(const std::string& path, int64_t offset, int64_t length,
+                                   std::string& content)
+{
+    if (!ensureOpen() || offset < 0 || length < 0)
+        return false;
+
+    ReadLease lease(*this);
+    int64_t file_id = 0;
+    int64_t size = 0;
+    if (!lookupFile(lease, normalizePath(path), file_id, size))
+    {
+        return false;
+    }
+
+    int64_t end = offset + std::min(length, std::max<int64_t>(size - offset, 0));
+    if (offset >= end)
+    {
+        content.clear();
+        return true;
+    }
+
+    int64_t first = offset / kChunkSize;
+    int64_t last = (end - 1) / kChunkSize;
+
+    // A read continuing where the previous one of this file ended is sequential:
+    // grow the read-ahead window, bounded by a quarter of the cache budget
+    // A read that may not use the cache fetches exactly what it needs
+    bool cached = lease.usesCache();
+    int64_t window = 0;
+    if (cached)
+    {
+        std::lock_guard<std::mutex> lock(read_ahead_mutex_);
+        if (file_id == read_ahead_file_ && offset == read_ahead_next_)
+        {
+            int64_t budget_chunks = chunk_cache_.getStats().budget / kChunkSize / 4;
+            window = std::min({std::max<int64_t>(read_ahead_window_ * 2, 1),
+                               kMaxReadAheadChunks, budget_chunks});
+        }
+        read_ahead_file_ = file_id;
+        read_ahead_next_ = end;
+        read_ahead_window_ = window;
+    }
+    int64_t fetch_last = std::min(last + window, (size - 1) / kChunkSize);
+
+    std::vector<ChunkCache::Block> blocks(static_cast<size_t>(last - first + 1));
+    int64_t fetch_first = cached ? -1 : first;
+    for (int64_t idx = first; cached && idx <= last; ++idx)
+    {
+        blocks[idx - first] = chunk_cache_.lookup(file_id, idx);
+        if (!blocks[idx - first] && fetch_first < 0)
+        {
+            fetch_first = idx;
+        }
+    }
+
+    // Everything cached: only go to the database once the window runs dry,
+    // so one range query serves several sequential reads
+    if (fetch_first < 0 && fetch_last > last && !chunk_cache_.contains(file_id, last + 1))
+    {
+        fetch_first = last + 1;
+    }
+
+    if (fetch_first >= 0 &&
+        !loadChunks(lease, file_id, fetch_first, std::max(fetch_last, last), first, blocks))
+    {
+        return false;
+    }
+
+    // Chunks that were never written (holes) read back as zeros
+    content.assign(static_cast<size_t>(end - offset), '\0');
+    for (int64_t idx = first; idx <= last; ++idx)
+    {
+        const std::string& data = *blocks[idx - first];
+        int64_t chunk_start = idx * kChunkSize;
+        int64_t chunk_end = chunk_start + static_cast<int64_t>(data.size());
+
+        int64_t copy_start = std::max(chunk_start, offset);
+        int64_t copy_end = std::min(chunk_end, end);
+        if (copy_start < copy_end)
+        {
+            std::memcpy(content.data() + (copy_start - offset),
+                        data.data() + (copy_start - chunk_start),
+                        static_cast<size_t>(copy_end - copy_start));
+        }
+    }
+
+    return true;
+}
+
+bool EncryptedMount::loadChunks(ReadLease& lease, int64_t file_id, int64_t from, int64_t to,
+                                int64_t first, std::vector<ChunkCache::Block>& blocks)
+{
+    ScopedStatement stmt(lease.statement(Statement::SelectChunkRange));
+    if (!stmt)
+    {
+        return false;
+    }
+
+    sqlite3_bind_int64(stmt.get(), 1, file_id);
+    sqlite3_bind_int64(stmt.get(), 2, from);
+    sqlite3_bind_int64(stmt.get(), 3, to);
+
+    int64_t last = first + static_cast<int64_t>(blocks.size()) - 1;
+    auto store = [&](int64_t idx, ChunkCache::Block block)
+    {
+        if (idx >= first && idx <= last && !blocks[idx - first])
+        {
+            blocks[idx - first] = block;
+        }
+        if (lease.usesCache())
+        {
+            chunk_cache_.insert(file_id, idx, std::move(block), idx > last, lease.generation());
+        }
+    };
+
+    // Rows arrive in index order; gaps between them are holes
+    auto hole = std::make_shared<const std::string>();
+    int64_t next = from;
+    int rc;
+    while ((rc = sqlite3_step(stmt.get())) == SQLITE_ROW)
+    {
+        int64_t idx = sqlite3_column_int64(stmt.get(), 0);
+        for (; next < idx; ++next)
+        {
+            store(next, hole);
+        }
+
+        std::string content;
+        if (!readChunkColumn(stmt.get(), 1, content))
+        {
+            return false;
+        }
+        store(idx, std::make_shared<const std::string>(std::move(content)));
+        next = idx + 1;
+    }
+
+    if (rc != SQLITE_DONE)
+    {
+        return false;
+    }
+
+    for (; next <= to; ++next)
+    {
+        store(next, hole);
+    }
+    return true;
+}
+
+bool EncryptedMount::writeFile(const std::string& path, const std::string& content)
+{
+    if (!ensureOpen())
+        return false;
+
+    WriteLock write_lock(*this);
+
+    std::string norm_path = normalizePath(path);
+
+    // Ensure parent directory exists
+    if (!ensureParentDirectory(norm_path))
+    {
+        return false;
+    }
+
+    auto now = std::chrono::system_clock::now().time_since_epoch().count();
+    int64_t size = static_cast<int64_t>(content.size());
+
+    Savepoint savepoint(db_);
+    if (!savepoint.isActive())
+    {
+        return false;
+    }
+
+    // Upsert the file row, keeping its id so existing chunk rows are overwritten
+    // in place (deduplicated content that did not change keeps its blob)
+    std::string parent = getParentPath(norm_path);
+    int64_t file_id = 0;
+    {
+        ScopedStatement stmt(getStatement(Statement::UpsertFile));
+        if (!stmt)
+        {
+            return false;
+        }
+
+        sqlite3_bind_text(stmt.get(), 1, norm_path.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt.get(), 2, parent.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int64(stmt.get(), 3, size);
+        sqlite3_bind_int64(stmt.get(), 4, now);
+
+        if (sqlite3_step(stmt.get()) != SQLITE_ROW)
+        {
+            return false;
+        }
+        file_id = sqlite3_column_int64(stmt.get(), 0);
+        if (sqlite3_step(stmt.get()) != SQLITE_DONE)
+        {
+            return false;
+        }
+    }
+
+    chunk_cache_.invalidateFile(file_id);
+
+    for (int64_t offset = 0; offset < size; offset += kChunkSize)
+    {
+        if (!writeChunk(file_id, offset / kChunkSize, content.data() + offset,
+                        std::min(kChunkSize, size - offset)))
+        {
+            return false;
+        }
+    }
+
+    // Drop chunks past the new end
+    {
+        ScopedStatement stmt(getStatement(Statement::DeleteChunks));
+        if (!stmt)
+        {
+            return false;
+        }
+        sqlite3_bind_int64(stmt.get(), 1, file_id);
+        sqlite3_bind_int64(stmt.get(), 2, (size + kChunkSize - 1) / kChunkSize);
+        if (sqlite3_step(stmt.get()) != SQLITE_DONE)
+        {
+            return false;
+        }
+    }
+
+    if (options_.text_index &&
+        !indexText(file_id, size <= kMaxIndexedTextBytes ? &content : nullptr))
+    {
+        return false;
+    }
+
+    if (!savepoint.commit())
+    {
+        return false;
+    }
+    notifyChange(norm_path, false);
+    return true;
+}
+
+bool EncryptedMount::writeFileRange(const std::string& path, int64_t offset,
+                                    const std::string& data)
+{
+    if (!ensureOpen() || offset < 0)
+        return false;
+
+    WriteLock write_lock(*this);
+    ReadLease lease(*this);
+    std::string norm_path = normalizePath(path);
+
+    Savepoint savepoint(db_);
+    if (!savepoint.isActive())
+    {
+        return false;
+    }
+
+    int64_t file_id = 0;
+    int64_t old_size = 0;
+    if (!lookupFile(lease, norm_path, file_id, old_size))
+    {
+        if (!writeFile(norm_path, ""))
+        {
+            return false;
+        }
+        if (!lookupFile(lease, norm_path, file_id, old_size))
+        {
+            return false;
+        }
+    }
+
+    int64_t length = static_cast<int64_t>(data.size());
+    int64_t end = offset + length;
+    std::string chunk;
+
+    for (int64_t idx = offset / kChunkSize; length > 0 && idx * kChunkSize < end; ++idx)
+    {
+        int64_t chunk_start = idx * kChunkSize;
+        int64_t write_start = std::max(offset, chunk_start);
+        int64_t write_end = std::min(end, chunk_start + kChunkSize);
+        const char* src = data.data() + (write_start - offset);
+
+        if (write_start == chunk_start && write_end == chunk_start + kChunkSize)
+        {
+            // Whole chunk replaced, no need to read the old one
+            if (!writeChunk(file_id, idx, src, kChunkSize))
+            {
+                return false;
+            }
+            continue;
+        }
+
+        // Partial chunk: merge with the existing data
+        chunk.clear();
+        {
+            ScopedStatement stmt(getStatement(Statement::SelectChunk));
+            if (!stmt)
+            {
+                return false;
+            }
+            sqlite3_bind_int64(stmt.get(), 1, file_id);
+            sqlite3_bind_int64(stmt.get(), 2, idx);
+            if (sqlite3_step(stmt.get()) == SQLITE_ROW && !readChunkColumn(stmt.get(), 0, chunk))
+            {
+                return false;
+            }
+        }
+
+        size_t needed = static_cast<size_t>(write_end - chunk_start);
+        if (chunk.size() < needed)
+        {
+            chunk.resize(needed, '\0');
+        }
+        std::memcpy(chunk.data() + (write_start - chunk_start), src,
+                    static_cast<size_t>(write_end - write_start));
+
+        if (!writeChunk(file_id, idx, chunk.data(), static_cast<int64_t>(chunk.size())))
+        {
+            return false;
+        }
+    }
+
+    auto now = std::chrono::system_clock::now().time_since_epoch().count();
+    int64_t new_size = length > 0 ? std::max(old_size, end) : old_size;
+
+    {
+        ScopedStatement stmt(getStatement(Statement::UpdateFileSize));
+        if (!stmt)
+        {
+            return false;
+        }
+        sqlite3_bind_int64(stmt.get(), 1, new_size);
+        sqlite3_bind_int64(stmt.get(), 2, now);
+        sqlite3_bind_int64(stmt.get(), 3, file_id);
+        if (sqlite3_step(stmt.get()) != SQLITE_DONE)
+        {
+            return false;
+        }
+    }
+
+    // Re-reading the whole file here would make a series of appends
+    // quadratic; the file stays a search candidate until it is re-indexed
+    if (options_.text_index && length > 0)
+    {
+        ScopedStatement stmt(getStatement(Statement::InsertTextStale));
+        if (!stmt)
+        {
+            return false;
+        }
+        sqlite3_bind_int64(stmt.get(), 1, file_id);
+        if (sqlite3_step(stmt.get()) != SQLITE_DONE)
+        {
+            return false;
+        }
+    }
+
+    if (!savepoint.commit())
+    {
+        return false;
+    }
+    notifyChange(norm_path, false);
+    return true;
+}
+
+bool EncryptedMount::appendFile(const std::string& path, const std::string& data)
+{
+    if (!ensureOpen())
+        return false;
+
+    // Hold the writer across the size lookup so a concurrent append cannot interleave
+    WriteLock write_lock(*this);
+    ReadLease lease(*this);
+    std::string norm_path = normalizePath(path);
+
+    // A missing file stays at size 0 and is created by writeFileRange
+    int64_t file_id = 0;
+    int64_t size = 0;
+    lookupFile(lease, norm_path, file_id, size);
+    return writeFileRange(norm_path, size, data);
+}
+
+bool EncryptedMount::createDirectory(const std::string& path)
+{
+    if (!ensureOpen())
+        return false;
+
+    WriteLock write_lock(*this);
+
+    std::string norm_path = normalizePath(path);
+
+    if (exists(norm_path))
+    {
+        return isDirectory(norm_path);
+    }
+
+    // Ensure parent exists
+    std::string parent = getParentPath(norm_path);
+    if (!parent.empty() && parent != "/" && !exists(parent))
+    {
+        if (!createDirectory(parent))
+        {
+            return false;
+        }
+    }
+
+    auto now = std::chrono::system_clock::now().time_since_epoch().count();
+
+    ScopedStatement stmt(getStatement(Statement::InsertDirectory));
+    if (!stmt)
+    {
+        return false;
+    }
+
+    sqlite3_bind_text(stmt.get(), 1, norm_path.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt.get(), 2, parent.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt.get(), 3, now);
+
+    if (sqlite3_step(stmt.get()) != SQLITE_DONE)
+    {
+        return false;
+    }
+    notifyChange(norm_path, false);
+    return true;
+}
+
+bool EncryptedMount::remove(const std::string& path)
+{
+    if (!ensureOpen())
+        return false;
+
+    WriteLock write_lock(*this);
+
+    std::string norm_path = normalizePath(path);
+
+    if (isDirectory(norm_path))
+    {
+        // The root directory itself cannot be removed
+        if (norm_path == "/")
+        {
+            return false;
+        }
+
+        // Every descendant sorts in [dir + '/', dir + '0'), '0' being the character
+        // after '/', so both deletes are index range scans over just the subtree
+        std::string lower = norm_path + "/";
+        std::string upper = norm_path + "0";
+
+        Savepoint savepoint(db_);
+        if (!savepoint.isActive())
+        {
+            return false;
+        }
+
+        {
+            ScopedStatement stmt(getStatement(Statement::DeleteFileRange));
+            if (!stmt)
+            {
+                return false;
+            }
+            sqlite3_bind_text(stmt.get(), 1, lower.c_str(), -1, SQLITE_STATIC);
+            sqlite3_bind_text(stmt.get(), 2, upper.c_str(), -1, SQLITE_STATIC);
+            if (sqlite3_step(stmt.get()) != SQLITE_DONE)
+            {
+                return false;
+            }
+        }
+
+        {
+            ScopedStatement stmt(getStatement(Statement::DeleteDirectoryTree));
+            if (!stmt)
+            {
+                return false;
+            }
+            sqlite3_bind_text(stmt.get(), 1, norm_path.c_str(), -1, SQLITE_STATIC);
+            sqlite3_bind_text(stmt.get(), 2, lower.c_str(), -1, SQLITE_STATIC);
+            sqlite3_bind_text(stmt.get(), 3, upper.c_str(), -1, SQLITE_STATIC);
+            if (sqlite3_step(stmt.get()) != SQLITE_DONE)
+            {
+                return false;
+            }
+        }
+
+        if (!savepoint.commit())
+        {
+            return false;
+        }
+        chunk_cache_.clear();
+        notifyChange(norm_path, true);
+        return true;
+    }
+    else
+    {
+        // Remove file; its id may be reused, so its cached chunks must go
+        ReadLease lease(*this);
+        int64_t file_id = 0;
+        int64_t size = 0;
+        if (lookupFile(lease, norm_path, file_id, size))
+        {
+            chunk_cache_.invalidateFile(file_id);
+        }
+
+        ScopedStatement stmt(getStatement(Statement::DeleteFile));
+        if (stmt)
+        {
+            sqlite3_bind_text(stmt.get(), 1, norm_path.c_str(), -1, SQLITE_STATIC);
+            if (sqlite3_step(stmt.get()) != SQLITE_DONE)
+            {
+                return false;
+            }
+            notifyChange(norm_path, false);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool EncryptedMount::rename(const std::string& from, const std::string& to)
+{
+    if (!ensureOpen())
+        return false;
+
+    WriteLock write_lock(*this);
+
+    std::string old_path = normalizePath(from);
+    std::string new_path = normalizePath(to);
+    if (old_path == "/" || new_path == "/" || !exists(old_path))
+    {
+        return false;
+    }
+    if (old_path == new_path)
+    {
+        return true;
+    }
+
+    bool is_dir = isDirectory(old_path);
+
+    // A directory cannot be moved into itself
+    if (is_dir && new_path.compare(0, old_path.size() + 1, old_path + "/") == 0)
+    {
+        return false;
+    }
+
+    // Only a file may replace an existing file; directories are never overwritten
+    if (exists(new_path) && (is_dir || isDirectory(new_path)))
+    {
+        return false;
+    }
+
+    std::string new_parent = getParentPath(new_path);
+
+    Savepoint savepoint(db_);
+    if (!savepoint.isActive() || !ensureParentDirectory(new_path))
+    {
+        return false;
+    }
+
+    if (!is_dir)
+    {
+        ReadLease lease(*this);
+        int64_t replaced_id = 0;
+        int64_t replaced_size = 0;
+        if (lookupFile(lease, new_path, replaced_id, replaced_size))
+        {
+            chunk_cache_.invalidateFile(replaced_id);
+        }
+
+        {
+            ScopedStatement stmt(getStatement(Statement::DeleteFile));
+            if (!stmt)
+            {
+                return false;
+            }
+            sqlite3_bind_text(stmt.get(), 1, new_path.c_str(), -1, SQLITE_STATIC);
+            if (sqlite3_step(stmt.get()) != SQLITE_DONE)
+            {
+                return false;
+            }
+        }
+
+        ScopedStatement stmt(getStatement(Statement::RenameFile));
+        if (!stmt)
+        {
+            return false;
+        }
+        sqlite3_bind_text(stmt.get(), 1, old_path.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt.get(), 2, new_path.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt.get(), 3, new_parent.c_str(), -1, SQLITE_STATIC);
+        if (sqlite3_step(stmt.get()) != SQLITE_DONE)
+        {
+            return false;
+        }
+        if (!savepoint.commit())
+        {
+            return false;
+        }
+        notifyChange(old_path, false);
+        notifyChange(new_path, false);
+        return true;
+    }
+
+    // Rewrite the prefix of every path in the subtree; chunks are keyed by
+    // file id and stay where they are
+    std::string lower = old_path + "/";
+    std::string upper = old_path + "0";
+
+    {
+        ScopedStatement stmt(getStatement(Statement::RenameFileRange));
+        if (!stmt)
+        {
+            return false;
+        }
+        sqlite3_bind_text(stmt.get(), 1, old_path.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt.get(), 2, new_path.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt.get(), 3, lower.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt.get(), 4, upper.c_str(), -1, SQLITE_STATIC);
+        if (sqlite3_step(stmt.get()) != SQLITE_DONE)
+        {
+            return false;
+        }
     }
 
-    return false;
+    {
+        ScopedStatement stmt(getStatement(Statement::RenameDirectoryTree));
+        if (!stmt)
+        {
+            return false;
+        }
+        sqlite3_bind_text(stmt.get(), 1, old_path.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt.get(), 2, new_path.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt.get(), 3, lower.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt.get(), 4, upper.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt.get(), 5, new_parent.c_str(), -1, SQLITE_STATIC);
+        if (sqlite3_step(stmt.get()) != SQLITE_DONE)
+        {
+            return false;
+        }
+    }
+
+    if (!savepoint.commit())
+    {
+        return false;
+    }
+    notifyChange(old_path, true);
+    notifyChange(new_path, true);
+    return true;
 }
 
-std::vector<VirtualFileInfo> EncryptedMount::listDirectory(const std::string& path)
+bool EncryptedMount::beginBatch()
 {
-    std::vector<VirtualFileInfo> results;
-    if (!db_)
-        return results;
+    if (!ensureOpen())
+        return false;
 
-    std::string norm_path = normalizePath(path);
+    // The batch holds the writer until endBatch(), keeping other threads'
+    // writes out of its transaction
+    lockWriter();
+    if (batch_depth_ == 0 && sqlite3_exec(db_, "BEGIN", nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+        unlockWriter();
+        return false;
+    }
 
-    // List subdirectories
-    sqlite3_stmt* stmt;
-    const char* sql = "SELECT path, mtime FROM directories WHERE parent = ?";
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) == SQLITE_OK)
+    ++batch_depth_;
+    return true;
+}
+
+bool EncryptedMount::endBatch()
+{
+    if (!ensureOpen() || batch_depth_ == 0)
+        return false;
+
+    bool committed = true;
+    if (--batch_depth_ == 0 && sqlite3_exec(db_, "COMMIT", nullptr, nullptr, nullptr) != SQLITE_OK)
     {
-        sqlite3_bind_text(stmt, 1, norm_path.c_str(), -1, SQLITE_STATIC);
-        while (sqlite3_step(stmt) == SQLITE_ROW)
-        {
-            VirtualFileInfo info;
-            info.path = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
-            info.name = info.path.substr(info.path.find_last_of('/') + 1);
-            info.is_directory = true;
-            info.size = 0;
-            info.mtime = sqlite3_column_int64(stmt, 1);
-            results.push_back(info);
-        }
-        sqlite3_finalize(stmt);
+        sqlite3_exec(db_, "ROLLBACK", nullptr, nullptr, nullptr);
+
+        // Anything reported or cached during the batch may have been undone
+        chunk_cache_.clear();
+        notifyChange("/", true);
+        committed = false;
     }
 
-    // List files
-    // Files are stored with full path, need to filter by directory
-    sql = "SELECT path, size, mtime FROM files";
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) == SQLITE_OK)
+    unlockWriter(); // the hold taken by beginBatch()
+    return committed;
+}
+
+void EncryptedMount::setChangeListener(ChangeListener listener)
+{
+    change_listener_ = std::move(listener);
+}
+
+bool EncryptedMount::snapshot(const std::string& dest_path, const std::string& new_password,
+                              const std::function<void(const SnapshotProgress&)>& progress,
+                              int pages_per_step)
+{
+    if (!ensureOpen() || pages_per_step <= 0 || reader_key_.empty())
+        return false;
+
+    std::error_code ec;
+    if (std::filesystem::exists(dest_path, ec) || dest_path == db_path_)
+    {
+        return false;
+    }
+
+    // Same key and cipher settings as the mount: the backup API copies
+    // encrypted pages as they are
+    sqlite3* dest = nullptr;
+    if (sqlite3_open_v2(dest_path.c_str(), &dest, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE,
+                        nullptr) != SQLITE_OK ||
+        sqlite3_key(dest, reader_key_.c_str(), static_cast<int>(reader_key_.length())) !=
+            SQLITE_OK)
+    {
+        sqlite3_close(dest);
+        std::filesystem::remove(dest_path, ec);
+        return false;
+    }
+    applyConnectionPragmas(dest, options_);
+
+    auto start = std::chrono::steady_clock::now();
+    bool ok = false;
+    sqlite3_backup* backup = sqlite3_backup_init(dest, "main", db_, "main");
+    if (backup)
     {
-        while (sqlite3_step(stmt) == SQLITE_ROW)
+        SnapshotProgress state;
+        int rc = SQLITE_OK;
+        while (rc == SQLITE_OK || rc == SQLITE_BUSY || rc == SQLITE_LOCKED)
         {
-            std::string file_path = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
-            std::string parent = getParentPath(file_path);
+            {
+                // Hold the writer for one step only; pages written through
+                // this connection meanwhile are updated in the copy
+                WriteLock write_lock(*this);
+                rc = sqlite3_backup_step(backup, pages_per_step);
+                state.page_count = sqlite3_backup_pagecount(backup);
+                state.pages_copied = state.page_count - sqlite3_backup_remaining(backup);
+            }
+            state.page_size = page_size_;
+            state.seconds =
+                std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (progress)
+            {
+                progress(state);
+            }
 
-            if (parent == norm_path)
+            if (rc == SQLITE_BUSY || rc == SQLITE_LOCKED)
             {
-                VirtualFileInfo info;
-                info.path = file_path;
-                info.name = file_path.substr(file_path.find_last_of('/') + 1);
-                info.is_directory = false;
-                info.size = sqlite3_column_int64(stmt, 1);
-                info.mtime = sqlite3_column_int64(stmt, 2);
-                results.push_back(info);
+                sqlite3_sleep(10);
+            }
+            else if (rc == SQLITE_OK)
+            {
+                std::this_thread::yield();
             }
         }
-        sqlite3_finalize(stmt);
+        ok = sqlite3_backup_finish(backup) == SQLITE_OK && rc == SQLITE_DONE;
     }
 
-    return results;
+    if (ok && !new_password.empty())
+    {
+        ok = sqlite3_rekey(dest, new_password.c_str(), static_cast<int>(new_password.length())) ==
+             SQLITE_OK;
+    }
+
+    ok = sqlite3_close(dest) == SQLITE_OK && ok;
+    if (!ok)
+    {
+        std::filesystem::remove(dest_path, ec);
+    }
+    return ok;
 }
 
-bool EncryptedMount::readFile(const std::string& path, std::string& content)
+bool EncryptedMount::compact(CompactProgress& result,
+                             const std::function<bool(const CompactProgress&)>& progress,
+                             int pages_per_step)
 {
-    if (!db_)
+    result = CompactProgress();
+    if (!ensureOpen() || pages_per_step <= 0)
         return false;
 
-    std::string norm_path = normalizePath(path);
+    auto start = std::chrono::steady_clock::now();
+    result.page_size = page_size_;
+    auto report = [&]()
+    {
+        result.seconds =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return !progress || progress(result);
+    };
 
-    sqlite3_stmt* stmt;
-    const char* sql = "SELECT content FROM files WHERE path = ?";
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) == SQLITE_OK)
     {
-        sqlite3_bind_text(stmt, 1, norm_path.c_str(), -1, SQLITE_STATIC);
-        if (sqlite3_step(stmt) == SQLITE_ROW)
+        WriteLock write_lock(*this);
+        // 2 = INCREMENTAL; anything else needs a VACUUM to rebuild the file
+        // with the pointer-map pages incremental vacuum relies on
+        if (pragmaInt(db_, "PRAGMA auto_vacuum") != 2)
         {
-            const void* blob = sqlite3_column_blob(stmt, 0);
-            int size = sqlite3_column_bytes(stmt, 0);
-            content.assign(static_cast<const char*>(blob), size);
-            sqlite3_finalize(stmt);
-            return true;
+            int64_t before = pragmaInt(db_, "PRAGMA page_count");
+            if (sqlite3_exec(db_, "PRAGMA auto_vacuum = INCREMENTAL; VACUUM", nullptr, nullptr,
+                             nullptr) != SQLITE_OK)
+            {
+                return false;
+            }
+            int64_t after = pragmaInt(db_, "PRAGMA page_count");
+            result.pages_freed = std::max<int64_t>(before - after, 0);
+            result.vacuumed = true;
         }
-        sqlite3_finalize(stmt);
     }
 
-    return false;
+    while (!result.vacuumed)
+    {
+        {
+            WriteLock write_lock(*this);
+            int64_t before = pragmaInt(db_, "PRAGMA freelist_count");
+            if (before <= 0)
+            {
+                break;
+            }
+            std::string sql = "PRAGMA incremental_vacuum(" + std::to_string(pages_per_step) + ")";
+            if (sqlite3_exec(db_, sql.c_str(), nullptr, nullptr, nullptr) != SQLITE_OK)
+            {
+                return false;
+            }
+            result.pages_remaining = pragmaInt(db_, "PRAGMA freelist_count");
+            result.pages_freed += before - result.pages_remaining;
+        }
+
+        if (!report())
+        {
+            result.cancelled = true;
+            break;
+        }
+        std::this_thread::yield();
+    }
+
+    {
+        // Freed pages leave the database file only when the WAL is copied
+        // back; readers still on older snapshots may keep part of it
+        WriteLock write_lock(*this);
+        sqlite3_wal_checkpoint_v2(db_, nullptr, SQLITE_CHECKPOINT_TRUNCATE, nullptr, nullptr);
+    }
+
+    if (result.vacuumed)
+    {
+        report();
+    }
+    return true;
 }
 
-bool EncryptedMount::writeFile(const std::string& path, const std::string& content)
+int64_t EncryptedMount::getReclaimableBytes()
 {
-    if (!db_)
-        return false;
+    if (!ensureOpen())
+        return 0;
 
-    std::string norm_path = normalizePath(path);
+    WriteLock write_lock(*this);
+    return std::max<int64_t>(pragmaInt(db_, "PRAGMA freelist_count"), 0) * page_size_;
+}
 
-    // Ensure parent directory exists
-    if (!ensureParentDirectory(norm_path))
+void EncryptedMount::notifyChange(const std::string& norm_path, bool subtree)
+{
+    if (change_listener_)
     {
-        return false;
+        change_listener_(norm_path, subtree);
     }
+}
 
-    auto now = std::chrono::system_clock::now().time_since_epoch().count();
+int64_t EncryptedMount::getUsedSpace()
+{
+    return getUsage().used_bytes;
+}
 
-    sqlite3_stmt* stmt;
-    const char* sql =
-        "INSERT OR REPLACE INTO files (path, content, size, mtime) VALUES (?, ?, ?, ?)";
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) == SQLITE_OK)
+MountUsage EncryptedMount::getUsage()
+{
+    MountUsage usage;
+    if (!ensureOpen())
+        return usage;
+
+    // Maintained by triggers, so this is a single-row read
+    ReadLease lease(*this);
+    ScopedStatement stmt(lease.statement(Statement::SelectUsage));
+    if (stmt && sqlite3_step(stmt.get()) == SQLITE_ROW)
     {
-        sqlite3_bind_text(stmt, 1, norm_path.c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_blob(stmt, 2, content.data(), static_cast<int>(content.size()), SQLITE_STATIC);
-        sqlite3_bind_int64(stmt, 3, static_cast<int64_t>(content.size()));
-        sqlite3_bind_int64(stmt, 4, now);
-
-        int rc = sqlite3_step(stmt);
-        sqlite3_finalize(stmt);
-        return (rc == SQLITE_DONE);
+        usage.used_bytes = sqlite3_column_int64(stmt.get(), 0);
+        usage.stored_bytes = sqlite3_column_int64(stmt.get(), 1);
+        usage.file_count = sqlite3_column_int64(stmt.get(), 2);
+        usage.directory_count = sqlite3_column_int64(stmt.get(), 3);
     }
 
-    return false;
+    return usage;
 }
 
-bool EncryptedMount::createDirectory(const std::string& path)
+bool EncryptedMount::verifyUsage()
 {
-    if (!db_)
+    if (!ensureOpen())
         return false;
 
-    std::string norm_path = normalizePath(path);
+    WriteLock write_lock(*this);
 
-    if (exists(norm_path))
+    const char* sql = "SELECT (SELECT COALESCE(SUM(size), 0) FROM files), "
+                      "(SELECT COALESCE(SUM(length(data)), 0) FROM chunks) + "
+                      "(SELECT COALESCE(SUM(size), 0) FROM blob_refs), "
+                      "(SELECT COUNT(*) FROM files), "
+                      "(SELECT COUNT(*) FROM directories WHERE path <> '/')";
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK)
     {
-        return isDirectory(norm_path);
+        return false;
     }
 
-    // Ensure parent exists
-    std::string parent = getParentPath(norm_path);
-    if (!parent.empty() && parent != "/" && !exists(parent))
+    MountUsage actual;
+    if (sqlite3_step(stmt) == SQLITE_ROW)
     {
-        if (!createDirectory(parent))
-        {
-            return false;
-        }
+        actual.used_bytes = sqlite3_column_int64(stmt, 0);
+        actual.stored_bytes = sqlite3_column_int64(stmt, 1);
+        actual.file_count = sqlite3_column_int64(stmt, 2);
+        actual.directory_count = sqlite3_column_int64(stmt, 3);
     }
+    sqlite3_finalize(stmt);
 
-    auto now = std::chrono::system_clock::now().time_since_epoch().count();
-
-    sqlite3_stmt* stmt;
-    const char* sql = "INSERT INTO directories (path, parent, mtime) VALUES (?, ?, ?)";
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) == SQLITE_OK)
+    MountUsage stored = getUsage();
+    if (stored.used_bytes == actual.used_bytes && stored.stored_bytes == actual.stored_bytes &&
+        stored.file_count == actual.file_count &&
+        stored.directory_count == actual.directory_count)
     {
-        sqlite3_bind_text(stmt, 1, norm_path.c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_text(stmt, 2, parent.c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_int64(stmt, 3, now);
-
-        int rc = sqlite3_step(stmt);
-        sqlite3_finalize(stmt);
-        return (rc == SQLITE_DONE);
+        return true;
     }
 
+    rebuildUsageCounters();
     return false;
 }
 
-bool EncryptedMount::remove(const std::string& path)
+bool EncryptedMount::checkIntegrity(std::vector<std::string>& errors)
+{
+    errors.clear();
+    if (!ensureOpen())
+        return false;
+
+    // Reads the whole file, so keep it off the writer
+    ReadLease lease(*this, ReadLease::Mode::Pooled);
+    // cipher_integrity_check reports only problems; integrity_check a
+    // single "ok" row when there are none
+    for (const char* sql : {"PRAGMA cipher_integrity_check", "PRAGMA integrity_check"})
+    {
+        sqlite3_stmt* stmt;
+        if (sqlite3_prepare_v2(lease.connection(), sql, -1, &stmt, nullptr) != SQLITE_OK)
+        {
+            return false;
+        }
+        int rc;
+        while ((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+        {
+            const char* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+            std::string message = text ? text : "";
+            if (message != "ok")
+            {
+                errors.push_back(std::move(message));
+            }
+        }
+        sqlite3_finalize(stmt);
+        if (rc != SQLITE_DONE)
+        {
+            errors.push_back(std::string(sql) + ": " + sqlite3_errstr(rc));
+        }
+    }
+    return true;
+}
+
+bool EncryptedMount::verifyFile(const std::string& path, FileCheck& check)
 {
-    if (!db_)
+    check = FileCheck();
+    if (!ensureOpen())
         return false;
 
     std::string norm_path = normalizePath(path);
+    ReadLease lease(*this, ReadLease::Mode::Pooled);
+    int64_t file_id = 0;
+    int64_t size = 0;
+    if (!lookupFile(lease, norm_path, file_id, size))
+    {
+        return false;
+    }
 
-    if (isDirectory(norm_path))
+    ScopedStatement stmt(lease.statement(Statement::SelectChunkChecksums));
+    if (!stmt)
     {
-        // Remove directory and all contents
-        sqlite3_stmt* stmt;
-        const char* sql = "DELETE FROM directories WHERE path = ? OR parent = ?";
-        if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) == SQLITE_OK)
+        return false;
+    }
+    sqlite3_bind_int64(stmt.get(), 1, file_id);
+
+    std::string content;
+    int rc;
+    while ((rc = sqlite3_step(stmt.get())) == SQLITE_ROW)
+    {
+        int64_t idx = sqlite3_column_int64(stmt.get(), 0);
+        ++check.chunks;
+        if (!readChunkColumn(stmt.get(), 1, content))
         {
-            sqlite3_bind_text(stmt, 1, norm_path.c_str(), -1, SQLITE_STATIC);
-            sqlite3_bind_text(stmt, 2, norm_path.c_str(), -1, SQLITE_STATIC);
-            sqlite3_step(stmt);
-            sqlite3_finalize(stmt);
+            check.corrupt.push_back(idx);
+            continue;
         }
+        check.bytes += static_cast<int64_t>(content.size());
 
-        // Remove files in directory
-        sql = "DELETE FROM files WHERE path LIKE ?";
-        if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) == SQLITE_OK)
+        if (sqlite3_column_type(stmt.get(), 3) == SQLITE_NULL)
         {
-            std::string pattern = norm_path + "/%";
-            sqlite3_bind_text(stmt, 1, pattern.c_str(), -1, SQLITE_STATIC);
-            sqlite3_step(stmt);
-            sqlite3_finalize(stmt);
+            ++check.unverified;
         }
+        else if (static_cast<int64_t>(mz_crc32(
+                     MZ_CRC32_INIT, reinterpret_cast<const unsigned char*>(content.data()),
+                     content.size())) != sqlite3_column_int64(stmt.get(), 3))
+        {
+            check.corrupt.push_back(idx);
+        }
+    }
+    return rc == SQLITE_DONE;
+}
 
+bool EncryptedMount::rebuildUsageCounters()
+{
+    const char* sql = "UPDATE usage SET "
+                      "used_bytes = (SELECT COALESCE(SUM(size), 0) FROM files), "
+                      "stored_bytes = (SELECT COALESCE(SUM(length(data)), 0) FROM chunks) + "
+                      "(SELECT COALESCE(SUM(size), 0) FROM blob_refs), "
+                      "file_count = (SELECT COUNT(*) FROM files), "
+                      "dir_count = (SELECT COUNT(*) FROM directories WHERE path <> '/') "
+                      "WHERE id = 1";
+    return sqlite3_exec(db_, sql, nullptr, nullptr, nullptr) == SQLITE_OK;
+}
+
+bool EncryptedMount::setupTextIndex()
+{
+    bool exists = hasTable(db_, "file_text");
+    if (!exists && !options_.text_index)
+    {
         return true;
     }
-    else
+
+    // Older indexes predate the stale list
+    if (exists && sqlite3_exec(db_, "CREATE TABLE IF NOT EXISTS file_text_stale (file_id INTEGER "
+                                    "PRIMARY KEY)",
+                               nullptr, nullptr, nullptr) != SQLITE_OK)
     {
-        // Remove file
-        sqlite3_stmt* stmt;
-        const char* sql = "DELETE FROM files WHERE path = ?";
-        if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) == SQLITE_OK)
+        return false;
+    }
+
+    if (!options_.text_index)
+    {
+        // Keep the index, but list every file written on this connection;
+        // deletions are still handled by files_delete_text. TEMP triggers
+        // live only as long as the connection.
+        const char* track = R"(
+            CREATE TEMP TRIGGER IF NOT EXISTS files_insert_text_stale AFTER INSERT ON main.files
+            BEGIN
+                INSERT OR IGNORE INTO file_text_stale (file_id) VALUES (NEW.id);
+            END;
+
+            CREATE TEMP TRIGGER IF NOT EXISTS files_update_text_stale
+            AFTER UPDATE OF mtime ON main.files
+            BEGIN
+                INSERT OR IGNORE INTO file_text_stale (file_id) VALUES (NEW.id);
+            END;
+        )";
+        return sqlite3_exec(db_, track, nullptr, nullptr, nullptr) == SQLITE_OK;
+    }
+    if (exists)
+    {
+        return refreshStaleText();
+    }
+
+    WriteLock write_lock(*this);
+    Savepoint savepoint(db_);
+    if (!savepoint.isActive())
+    {
+        return false;
+    }
+
+    const char* schema = R"(
+        CREATE VIRTUAL TABLE file_text USING fts5(
+            body, tokenize = 'trigram', detail = 'none', columnsize = 0
+        );
+
+        CREATE TABLE file_text_skipped (
+            file_id INTEGER PRIMARY KEY
+        );
+
+        CREATE TABLE file_text_stale (
+            file_id INTEGER PRIMARY KEY
+        );
+
+        CREATE TRIGGER files_delete_text AFTER DELETE ON files
+        BEGIN
+            DELETE FROM file_text WHERE rowid = OLD.id;
+            DELETE FROM file_text_skipped WHERE file_id = OLD.id;
+            DELETE FROM file_text_stale WHERE file_id = OLD.id;
+        END;
+    )";
+    if (sqlite3_exec(db_, schema, nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+        return false;
+    }
+
+    // Index the existing files in the same transaction
+    struct IndexedFile
+    {
+        int64_t id;
+        std::string path;
+        int64_t size;
+    };
+    std::vector<IndexedFile> files;
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db_, "SELECT id, path, size FROM files", -1, &stmt, nullptr) !=
+        SQLITE_OK)
+    {
+        return false;
+    }
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        files.push_back({sqlite3_column_int64(stmt, 0),
+                         reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1)),
+                         sqlite3_column_int64(stmt, 2)});
+    }
+    sqlite3_finalize(stmt);
+
+    for (const auto& file : files)
+    {
+        if (!reindexText(file.id, file.path, file.size))
         {
-            sqlite3_bind_text(stmt, 1, norm_path.c_str(), -1, SQLITE_STATIC);
-            int rc = sqlite3_step(stmt);
-            sqlite3_finalize(stmt);
-            return (rc == SQLITE_DONE);
+            return false;
         }
     }
-
-    return false;
+    return savepoint.commit();
 }
 
-int64_t EncryptedMount::getUsedSpace()
+bool EncryptedMount::refreshStaleText()
 {
-    if (!db_)
-        return 0;
+    WriteLock write_lock(*this);
+    Savepoint savepoint(db_);
+    if (!savepoint.isActive())
+    {
+        return false;
+    }
 
+    // Deleted files have left the index already; a reused id is just indexed
+    struct StaleFile
+    {
+        int64_t id;
+        std::string path;
+        int64_t size;
+    };
+    std::vector<StaleFile> files;
     sqlite3_stmt* stmt;
-    const char* sql = "SELECT SUM(size) FROM files";
-    if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) == SQLITE_OK)
+    if (sqlite3_prepare_v2(db_,
+                           "SELECT f.id, f.path, f.size FROM file_text_stale s "
+                           "JOIN files f ON f.id = s.file_id",
+                           -1, &stmt, nullptr) != SQLITE_OK)
     {
-        if (sqlite3_step(stmt) == SQLITE_ROW)
+        return false;
+    }
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        files.push_back({sqlite3_column_int64(stmt, 0),
+                         reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1)),
+                         sqlite3_column_int64(stmt, 2)});
+    }
+    sqlite3_finalize(stmt);
+
+    for (const auto& file : files)
+    {
+        if (!reindexText(file.id, file.path, file.size))
         {
-            int64_t used = sqlite3_column_int64(stmt, 0);
-            sqlite3_finalize(stmt);
-            return used;
+            return false;
         }
-        sqlite3_finalize(stmt);
+    }
+    return sqlite3_exec(db_, "DELETE FROM file_text_stale", nullptr, nullptr, nullptr) ==
+               SQLITE_OK &&
+           savepoint.commit();
+}
+
+bool EncryptedMount::indexText(int64_t file_id, const std::string* content)
+{
+    // Like grep, a NUL byte marks a file as binary
+    bool indexed = content && content->find('\0') == std::string::npos;
+
+    ScopedStatement text_stmt(
+        getStatement(indexed ? Statement::ReplaceText : Statement::DeleteText));
+    ScopedStatement skipped_stmt(
+        getStatement(indexed ? Statement::DeleteTextSkipped : Statement::InsertTextSkipped));
+    ScopedStatement stale_stmt(getStatement(Statement::DeleteTextStale));
+    if (!text_stmt || !skipped_stmt || !stale_stmt)
+    {
+        return false;
+    }
+
+    sqlite3_bind_int64(text_stmt.get(), 1, file_id);
+    if (indexed)
+    {
+        sqlite3_bind_text(text_stmt.get(), 2, content->data(),
+                          static_cast<int>(content->size()), SQLITE_STATIC);
+    }
+    sqlite3_bind_int64(skipped_stmt.get(), 1, file_id);
+    sqlite3_bind_int64(stale_stmt.get(), 1, file_id);
+    return sqlite3_step(text_stmt.get()) == SQLITE_DONE &&
+           sqlite3_step(skipped_stmt.get()) == SQLITE_DONE &&
+           sqlite3_step(stale_stmt.get()) == SQLITE_DONE;
+}
+
+bool EncryptedMount::reindexText(int64_t file_id, const std::string& norm_path, int64_t size)
+{
+    if (size > kMaxIndexedTextBytes)
+    {
+        return indexText(file_id, nullptr);
     }
 
-    return 0;
+    // Reads through the writer, so the uncommitted content is seen
+    std::string content;
+    return readFileRange(norm_path, 0, size, content) && indexText(file_id, &content);
 }
 
 bool EncryptedMount::ensureParentDirectory(const std::string& path)
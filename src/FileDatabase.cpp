@@ -7,12 +7,44 @@
 #include <chrono>
 #include <cstring>
 #include <filesystem>
+#include <unordered_map>
 
 namespace fs = std::filesystem;
 
 namespace homeshell
 {
 
+namespace
+{
+
+/// Layout of the locate database (stored in PRAGMA user_version)
+constexpr int kSchemaVersion = 1;
+
+/**
+ * @brief Get the directory an indexed path is in
+ */
+std::string parentPath(const std::string& path)
+{
+    auto slash = path.find_last_of('/');
+    if (slash == std::string::npos)
+    {
+        return "";
+    }
+    return slash == 0 ? "/" : path.substr(0, slash);
+}
+
+std::string joinPath(const std::string& dir, const std::string& name)
+{
+    return dir.back() == '/' ? dir + name : dir + "/" + name;
+}
+
+int64_t toSeconds(fs::file_time_type time)
+{
+    return std::chrono::duration_cast<std::chrono::seconds>(time.time_since_epoch()).count();
+}
+
+} // namespace
+
 FileDatabase::FileDatabase(const std::string& db_path)
     : db_path_(db_path)
     , db_(nullptr)
@@ -84,14 +116,48 @@ bool FileDatabase::initSchema()
         return false;
     }
 
+    // The index is a cache that the next update rebuilds, so a database in
+    // an older layout is simply dropped
+    int version = 0;
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db_, "PRAGMA user_version", -1, &stmt, nullptr) == SQLITE_OK &&
+        sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        version = sqlite3_column_int(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+
+    if (version < kSchemaVersion)
+    {
+        sqlite3_exec(db_,
+                     "DROP TABLE IF EXISTS files; DROP TABLE IF EXISTS directories; "
+                     "DROP TABLE IF EXISTS settings;",
+                     nullptr, nullptr, nullptr);
+    }
+
     const char* schema = R"(
         CREATE TABLE IF NOT EXISTS files (
             path TEXT PRIMARY KEY,
+            parent TEXT NOT NULL,
             is_directory INTEGER NOT NULL,
             size INTEGER NOT NULL,
             mtime INTEGER NOT NULL
         );
         CREATE INDEX IF NOT EXISTS idx_path ON files(path);
+        CREATE INDEX IF NOT EXISTS idx_parent ON files(parent);
+
+        -- Directories as of their last listing; mtime in file clock ticks
+        CREATE TABLE IF NOT EXISTS directories (
+            path TEXT PRIMARY KEY,
+            parent TEXT NOT NULL,
+            mtime INTEGER NOT NULL
+        );
+        CREATE INDEX IF NOT EXISTS idx_directories_parent ON directories(parent);
+
+        CREATE TABLE IF NOT EXISTS settings (
+            key TEXT PRIMARY KEY,
+            value TEXT NOT NULL
+        );
     )";
 
     char* err_msg = nullptr;
@@ -104,11 +170,140 @@ bool FileDatabase::initSchema()
         return false;
     }
 
-    return true;
+    std::string version_sql = "PRAGMA user_version = " + std::to_string(kSchemaVersion);
+    return sqlite3_exec(db_, version_sql.c_str(), nullptr, nullptr, nullptr) == SQLITE_OK;
 }
 
+struct FileDatabase::Update
+{
+    enum Statement
+    {
+        UpsertEntry,
+        SelectEntry,
+        SelectChildren,
+        DeleteEntryTree,
+        SelectDirectoryMtime,
+        SelectChildDirectories,
+        UpsertDirectory,
+        DeleteDirectoryTree,
+        StatementCount
+    };
+
+    explicit Update(sqlite3* db)
+    {
+        const char* sql[StatementCount] = {
+            "INSERT OR REPLACE INTO files (path, parent, is_directory, size, mtime) "
+            "VALUES (?, ?, ?, ?, ?)",
+            "SELECT is_directory, size, mtime FROM files WHERE path = ?",
+            "SELECT path, is_directory, size, mtime FROM files WHERE parent = ?",
+            "DELETE FROM files WHERE path = ?1 OR (path > ?2 AND path < ?3)",
+            "SELECT mtime FROM directories WHERE path = ?",
+            "SELECT path FROM directories WHERE parent = ?",
+            "INSERT OR REPLACE INTO directories (path, parent, mtime) VALUES (?, ?, ?)",
+            "DELETE FROM directories WHERE path = ?1 OR (path > ?2 AND path < ?3)",
+        };
+        for (int i = 0; i < StatementCount; ++i)
+        {
+            if (sqlite3_prepare_v2(db, sql[i], -1, &statements[i], nullptr) != SQLITE_OK)
+            {
+                ok = false;
+            }
+        }
+    }
+
+    ~Update()
+    {
+        for (auto* stmt : statements)
+        {
+            sqlite3_finalize(stmt);
+        }
+    }
+
+    Update(const Update&) = delete;
+    Update& operator=(const Update&) = delete;
+
+    /**
+     * @brief Get a statement, reset and with its bindings cleared
+     */
+    sqlite3_stmt* get(Statement id)
+    {
+        sqlite3_reset(statements[id]);
+        sqlite3_clear_bindings(statements[id]);
+        return statements[id];
+    }
+
+    void upsert(const FileEntry& entry)
+    {
+        sqlite3_stmt* stmt = get(UpsertEntry);
+        std::string parent = parentPath(entry.path);
+        sqlite3_bind_text(stmt, 1, entry.path.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 2, parent.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int(stmt, 3, entry.is_directory ? 1 : 0);
+        sqlite3_bind_int64(stmt, 4, entry.size);
+        sqlite3_bind_int64(stmt, 5, entry.mtime);
+        sqlite3_step(stmt);
+        ++stats.entries_updated;
+    }
+
+    /**
+     * @brief Upsert an entry unless the index already holds it unchanged
+     */
+    void refresh(const FileEntry& entry)
+    {
+        sqlite3_stmt* stmt = get(SelectEntry);
+        sqlite3_bind_text(stmt, 1, entry.path.c_str(), -1, SQLITE_TRANSIENT);
+        if (sqlite3_step(stmt) != SQLITE_ROW ||
+            (sqlite3_column_int(stmt, 0) != 0) != entry.is_directory ||
+            sqlite3_column_int64(stmt, 1) != entry.size ||
+            sqlite3_column_int64(stmt, 2) != entry.mtime)
+        {
+            upsert(entry);
+        }
+    }
+
+    /**
+     * @brief Remember the mtime a directory had when it was listed
+     */
+    void recordDirectory(const std::string& path, int64_t mtime)
+    {
+        sqlite3_stmt* stmt = get(UpsertDirectory);
+        std::string parent = parentPath(path);
+        sqlite3_bind_text(stmt, 1, path.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 2, parent.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int64(stmt, 3, mtime);
+        sqlite3_step(stmt);
+    }
+
+    /**
+     * @brief Delete an entry and, if it was a directory, everything below it
+     */
+    void removeTree(const std::string& path)
+    {
+        // Descendants sort between "path/" and "path0" ('0' follows '/')
+        std::string lower = path == "/" ? "/" : path + "/";
+        std::string upper = path == "/" ? "0" : path + "0";
+        for (Statement id : {DeleteEntryTree, DeleteDirectoryTree})
+        {
+            sqlite3_stmt* stmt = get(id);
+            sqlite3_bind_text(stmt, 1, path.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_text(stmt, 2, lower.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_text(stmt, 3, upper.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_step(stmt);
+            if (id == DeleteEntryTree)
+            {
+                stats.entries_removed += sqlite3_changes(sqlite3_db_handle(stmt));
+            }
+        }
+    }
+
+    sqlite3_stmt* statements[StatementCount] = {};
+    bool ok = true;
+    DatabaseStats stats;
+};
+
 DatabaseStats FileDatabase::updateDatabase(const std::vector<std::string>& search_paths,
-                                           const std::vector<std::string>& exclude_paths)
+                                           const std::vector<std::string>& exclude_paths,
+                                           bool full)
 {
     DatabaseStats stats;
     auto start_time = std::chrono::high_resolution_clock::now();
@@ -136,6 +331,13 @@ DatabaseStats FileDatabase::updateDatabase(const std::vector<std::string>& searc
             }
         }
     }
+    for (auto& path : paths_to_scan)
+    {
+        while (path.size() > 1 && path.back() == '/')
+        {
+            path.pop_back();
+        }
+    }
 
     // Default exclude paths
     std::vector<std::string> excludes = exclude_paths;
@@ -144,50 +346,64 @@ DatabaseStats FileDatabase::updateDatabase(const std::vector<std::string>& searc
         excludes = {"/proc", "/sys", "/dev", "/run", "/tmp"};
     }
 
-    // Clear existing data
-    sqlite3_exec(db_, "DELETE FROM files", nullptr, nullptr, nullptr);
-
-    // Collect all file entries
-    std::vector<FileEntry> entries;
+    // Entries outside the new roots, or inside new excludes, would
+    // otherwise linger, so a different configuration starts over
+    std::string config;
     for (const auto& path : paths_to_scan)
     {
-        scanDirectory(path, excludes, entries);
+        config += path + '\n';
+    }
+    config += '\n';
+    for (const auto& exclude : excludes)
+    {
+        config += exclude + '\n';
     }
 
-    // Begin transaction for faster inserts
-    sqlite3_exec(db_, "BEGIN TRANSACTION", nullptr, nullptr, nullptr);
-
-    // Prepare insert statement
-    const char* insert_sql =
-        "INSERT OR REPLACE INTO files (path, is_directory, size, mtime) VALUES (?, ?, ?, ?)";
     sqlite3_stmt* stmt = nullptr;
-    sqlite3_prepare_v2(db_, insert_sql, -1, &stmt, nullptr);
+    if (sqlite3_prepare_v2(db_, "SELECT value FROM settings WHERE key = 'scan_config'", -1,
+                           &stmt, nullptr) == SQLITE_OK)
+    {
+        const unsigned char* previous =
+            sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_text(stmt, 0) : nullptr;
+        full = full || !previous || config != reinterpret_cast<const char*>(previous);
+    }
+    sqlite3_finalize(stmt);
 
-    // Insert all entries
-    for (const auto& entry : entries)
+    // One transaction for the whole update; readers keep the previous index
+    sqlite3_exec(db_, "BEGIN TRANSACTION", nullptr, nullptr, nullptr);
+    if (full)
     {
-        sqlite3_bind_text(stmt, 1, entry.path.c_str(), -1, SQLITE_TRANSIENT);
-        sqlite3_bind_int(stmt, 2, entry.is_directory ? 1 : 0);
-        sqlite3_bind_int64(stmt, 3, entry.size);
-        sqlite3_bind_int64(stmt, 4, entry.mtime);
+        sqlite3_exec(db_, "DELETE FROM files; DELETE FROM directories;", nullptr, nullptr,
+                     nullptr);
+    }
 
-        sqlite3_step(stmt);
-        sqlite3_reset(stmt);
+    Update update(db_);
+    if (!update.ok)
+    {
+        sqlite3_exec(db_, "ROLLBACK", nullptr, nullptr, nullptr);
+        return stats;
+    }
 
-        if (entry.is_directory)
-        {
-            stats.total_directories++;
-        }
-        else
-        {
-            stats.total_files++;
-            stats.total_size += entry.size;
-        }
+    for (const auto& path : paths_to_scan)
+    {
+        updateTree(path, excludes, update);
     }
 
+    if (sqlite3_prepare_v2(db_, "INSERT OR REPLACE INTO settings VALUES ('scan_config', ?)", -1,
+                           &stmt, nullptr) == SQLITE_OK)
+    {
+        sqlite3_bind_text(stmt, 1, config.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_step(stmt);
+    }
     sqlite3_finalize(stmt);
     sqlite3_exec(db_, "COMMIT", nullptr, nullptr, nullptr);
 
+    stats = getStats();
+    stats.scanned_directories = update.stats.scanned_directories;
+    stats.skipped_directories = update.stats.skipped_directories;
+    stats.entries_updated = update.stats.entries_updated;
+    stats.entries_removed = update.stats.entries_removed;
+
     auto end_time = std::chrono::high_resolution_clock::now();
     stats.scan_time_ms =
         std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
@@ -195,119 +411,164 @@ DatabaseStats FileDatabase::updateDatabase(const std::vector<std::string>& searc
     return stats;
 }
 
-void FileDatabase::scanDirectory(const std::string& path,
-                                 const std::vector<std::string>& exclude_paths,
-                                 std::vector<FileEntry>& entries)
+void FileDatabase::updateTree(const std::string& root,
+                              const std::vector<std::string>& exclude_paths, Update& update)
 {
-    if (shouldExclude(path, exclude_paths))
+    if (shouldExclude(root, exclude_paths))
     {
         return;
     }
 
     auto& vfs = VirtualFilesystem::getInstance();
-
-    // Check if this is a virtual filesystem path
-    if (vfs.isVirtualPath(path))
+    bool is_virtual = vfs.isVirtualPath(root);
+    if (is_virtual)
     {
-        // Scan virtual filesystem
-        if (!vfs.exists(path) || !vfs.isDirectory(path))
+        if (!vfs.exists(root) || !vfs.isDirectory(root))
         {
             return;
         }
-
-        auto vfs_entries = vfs.listDirectory(path);
-        for (const auto& vfs_entry : vfs_entries)
-        {
-            std::string entry_path = path;
-            if (path.back() != '/')
-            {
-                entry_path += "/";
-            }
-            entry_path += vfs_entry.name;
-
-            FileEntry file_entry;
-            file_entry.path = entry_path;
-            file_entry.is_directory = vfs_entry.is_directory;
-            file_entry.size = vfs_entry.size;
-            file_entry.mtime = vfs_entry.mtime;
-
-            entries.push_back(file_entry);
-
-            if (vfs_entry.is_directory)
-            {
-                scanDirectory(entry_path, exclude_paths, entries);
-            }
-        }
     }
     else
     {
-        // Scan regular filesystem
+        // The root itself is indexed as well, and may be a plain file
         std::error_code ec;
-        if (!fs::exists(path, ec))
+        auto status = fs::status(root, ec);
+        if (ec || !fs::exists(status))
         {
+            update.removeTree(root);
             return;
         }
 
-        if (!fs::is_directory(path, ec))
+        FileEntry entry;
+        entry.path = root;
+        entry.is_directory = fs::is_directory(status);
+        entry.size = entry.is_directory ? 0 : static_cast<int64_t>(fs::file_size(root, ec));
+        entry.mtime = 0;
+        auto ftime = fs::last_write_time(root, ec);
+        if (!ec)
+        {
+            entry.mtime = toSeconds(ftime);
+        }
+        update.refresh(entry);
+        if (!entry.is_directory)
         {
-            // If it's a file, just add it
-            FileEntry file_entry;
-            file_entry.path = path;
-            file_entry.is_directory = false;
-            file_entry.size = fs::file_size(path, ec);
-            file_entry.mtime = 0;
-
-            auto ftime = fs::last_write_time(path, ec);
-            if (!ec)
-            {
-                file_entry.mtime =
-                    std::chrono::duration_cast<std::chrono::seconds>(ftime.time_since_epoch())
-                        .count();
-            }
-
-            entries.push_back(file_entry);
             return;
         }
+    }
 
-        // Add the directory itself
-        FileEntry dir_entry;
-        dir_entry.path = path;
-        dir_entry.is_directory = true;
-        dir_entry.size = 0;
-        dir_entry.mtime = 0;
+    std::vector<std::string> pending = {root};
+    std::vector<FileEntry> entries;
+    std::vector<std::string> subdirectories;
+    while (!pending.empty())
+    {
+        std::string dir = std::move(pending.back());
+        pending.pop_back();
 
-        auto ftime = fs::last_write_time(path, ec);
-        if (!ec)
+        // An unchanged mtime means no entry was added, removed or renamed
+        // here; subdirectories can still have changed
+        std::error_code ec;
+        int64_t mtime = 0;
+        if (!is_virtual)
         {
-            dir_entry.mtime =
-                std::chrono::duration_cast<std::chrono::seconds>(ftime.time_since_epoch()).count();
+            auto ftime = fs::last_write_time(dir, ec);
+            mtime = ec ? 0 : static_cast<int64_t>(ftime.time_since_epoch().count());
+        }
+        if (!is_virtual && !ec)
+        {
+            sqlite3_stmt* stmt = update.get(Update::SelectDirectoryMtime);
+            sqlite3_bind_text(stmt, 1, dir.c_str(), -1, SQLITE_TRANSIENT);
+            if (sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_int64(stmt, 0) == mtime)
+            {
+                ++update.stats.skipped_directories;
+                stmt = update.get(Update::SelectChildDirectories);
+                sqlite3_bind_text(stmt, 1, dir.c_str(), -1, SQLITE_TRANSIENT);
+                while (sqlite3_step(stmt) == SQLITE_ROW)
+                {
+                    pending.emplace_back(
+                        reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)));
+                }
+                continue;
+            }
         }
 
-        entries.push_back(dir_entry);
+        entries.clear();
+        subdirectories.clear();
+        if (!listDirectory(dir, is_virtual, exclude_paths, entries, subdirectories))
+        {
+            // Unreadable: nothing below it is indexed, as with a full scan
+            sqlite3_stmt* stmt = update.get(Update::SelectChildren);
+            sqlite3_bind_text(stmt, 1, dir.c_str(), -1, SQLITE_TRANSIENT);
+            std::vector<std::string> children;
+            while (sqlite3_step(stmt) == SQLITE_ROW)
+            {
+                children.emplace_back(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)));
+            }
+            for (const auto& child : children)
+            {
+                update.removeTree(child);
+            }
 
-        // Recursively scan subdirectories
-        std::error_code iter_ec;
-        auto iter_end = fs::recursive_directory_iterator();
-        auto iter = fs::recursive_directory_iterator(
-            path, fs::directory_options::skip_permission_denied, iter_ec);
+            // Recorded with an mtime that never matches, so it is retried
+            update.recordDirectory(dir, 0);
+            continue;
+        }
+        ++update.stats.scanned_directories;
 
-        if (iter_ec)
+        // Diff against what the index holds for this directory
+        std::unordered_map<std::string, FileEntry> stored;
+        sqlite3_stmt* stmt = update.get(Update::SelectChildren);
+        sqlite3_bind_text(stmt, 1, dir.c_str(), -1, SQLITE_TRANSIENT);
+        while (sqlite3_step(stmt) == SQLITE_ROW)
         {
-            // Failed to create iterator
-            return;
+            FileEntry entry;
+            entry.path = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+            entry.is_directory = sqlite3_column_int(stmt, 1) != 0;
+            entry.size = sqlite3_column_int64(stmt, 2);
+            entry.mtime = sqlite3_column_int64(stmt, 3);
+            stored.emplace(entry.path, entry);
         }
 
-        for (; iter != iter_end; ++iter)
+        for (const auto& entry : entries)
         {
-            std::error_code entry_ec;
-            const auto& dir_entry = *iter;
-
-            if (entry_ec)
+            auto it = stored.find(entry.path);
+            if (it != stored.end() && it->second.is_directory && !entry.is_directory)
             {
-                continue;
+                // A directory replaced by a file takes its subtree with it
+                update.removeTree(entry.path);
+                stored.erase(it);
+                it = stored.end();
+            }
+            if (it == stored.end() || it->second.is_directory != entry.is_directory ||
+                it->second.size != entry.size || it->second.mtime != entry.mtime)
+            {
+                update.upsert(entry);
             }
+            if (it != stored.end())
+            {
+                stored.erase(it);
+            }
+        }
+        for (const auto& [path, entry] : stored)
+        {
+            update.removeTree(path);
+        }
+
+        update.recordDirectory(dir, mtime);
+        pending.insert(pending.end(), subdirectories.begin(), subdirectories.end());
+    }
+}
 
-            std::string entry_path = dir_entry.path().string();
+bool FileDatabase::listDirectory(const std::string& path, bool is_virtual,
+                                 const std::vector<std::string>& exclude_paths,
+                                 std::vector<FileEntry>& entries,
+                                 std::vector<std::string>& subdirectories)
+{
+    if (is_virtual)
+    {
+        auto& vfs = VirtualFilesystem::getInstance();
+        for (const auto& vfs_entry : vfs.listDirectory(path))
+        {
+            std::string entry_path = joinPath(path, vfs_entry.name);
             if (shouldExclude(entry_path, exclude_paths))
             {
                 continue;
@@ -315,29 +576,65 @@ void FileDatabase::scanDirectory(const std::string& path,
 
             FileEntry file_entry;
             file_entry.path = entry_path;
-            file_entry.is_directory = dir_entry.is_directory(entry_ec);
-            file_entry.size = 0;
-            file_entry.mtime = 0;
+            file_entry.is_directory = vfs_entry.is_directory;
+            file_entry.size = vfs_entry.size;
+            file_entry.mtime = vfs_entry.mtime;
+            entries.push_back(file_entry);
 
-            if (!entry_ec && dir_entry.is_regular_file(entry_ec))
+            if (vfs_entry.is_directory)
             {
-                file_entry.size = dir_entry.file_size(entry_ec);
+                subdirectories.push_back(entry_path);
             }
+        }
+        return true;
+    }
+
+    std::error_code ec;
+    auto iter = fs::directory_iterator(path, ec);
+    if (ec)
+    {
+        return false;
+    }
+
+    for (; iter != fs::directory_iterator(); iter.increment(ec))
+    {
+        const auto& dir_entry = *iter;
+        std::string entry_path = joinPath(path, dir_entry.path().filename().string());
+        if (shouldExclude(entry_path, exclude_paths))
+        {
+            continue;
+        }
+
+        std::error_code entry_ec;
+        FileEntry file_entry;
+        file_entry.path = entry_path;
+        file_entry.is_directory = dir_entry.is_directory(entry_ec);
+        file_entry.size = 0;
+        file_entry.mtime = 0;
+
+        if (!entry_ec && dir_entry.is_regular_file(entry_ec))
+        {
+            file_entry.size = static_cast<int64_t>(dir_entry.file_size(entry_ec));
+        }
 
+        if (!entry_ec)
+        {
+            auto ftime = dir_entry.last_write_time(entry_ec);
             if (!entry_ec)
             {
-                auto ftime = dir_entry.last_write_time(entry_ec);
-                if (!entry_ec)
-                {
-                    file_entry.mtime =
-                        std::chrono::duration_cast<std::chrono::seconds>(ftime.time_since_epoch())
-                            .count();
-                }
+                file_entry.mtime = toSeconds(ftime);
             }
+        }
 
-            entries.push_back(file_entry);
+        entries.push_back(file_entry);
+
+        // Symlinked directories are indexed but not followed
+        if (file_entry.is_directory && !dir_entry.is_symlink(entry_ec))
+        {
+            subdirectories.push_back(entry_path);
         }
     }
+    return !ec;
 }
 
 bool FileDatabase::shouldExclude(const std::string& path,
@@ -472,7 +769,8 @@ bool FileDatabase::clear()
     }
 
     char* err_msg = nullptr;
-    int rc = sqlite3_exec(db_, "DELETE FROM files", nullptr, nullptr, &err_msg);
+    int rc = sqlite3_exec(db_, "DELETE FROM files; DELETE FROM directories; DELETE FROM settings;",
+                          nullptr, nullptr, &err_msg);
 
     if (rc != SQLITE_OK)
     {
@@ -0,0 +1,136 @@
+#include <homeshell/MetadataCache.hpp>
+
+namespace homeshell
+{
+
+bool MetadataCache::lookup(const std::string& key, CachedMetadata& metadata)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = index_.find(key);
+    if (it == index_.end())
+    {
+        ++misses_;
+        return false;
+    }
+
+    lru_.splice(lru_.begin(), lru_, it->second);
+    metadata = it->second->second;
+    ++hits_;
+    return true;
+}
+
+void MetadataCache::insert(const std::string& key, const CachedMetadata& metadata,
+                           uint64_t generation)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (capacity_ == 0 || (generation != kAnyGeneration && generation != generation_))
+    {
+        return;
+    }
+
+    auto it = index_.find(key);
+    if (it != index_.end())
+    {
+        it->second->second = metadata;
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return;
+    }
+
+    if (lru_.size() >= capacity_)
+    {
+        index_.erase(lru_.back().first);
+        lru_.pop_back();
+    }
+
+    lru_.emplace_front(key, metadata);
+    index_[key] = lru_.begin();
+}
+
+void MetadataCache::invalidate(const std::string& key)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++generation_;
+    eraseLocked(key);
+    eraseAncestorsLocked(key);
+}
+
+void MetadataCache::invalidateTree(const std::string& key)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    ++generation_;
+    std::string prefix = key == "/" ? key : key + "/";
+    for (auto it = lru_.begin(); it != lru_.end();)
+    {
+        if (it->first.compare(0, prefix.size(), prefix) == 0)
+        {
+            index_.erase(it->first);
+            it = lru_.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    eraseLocked(key);
+    eraseAncestorsLocked(key);
+}
+
+void MetadataCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++generation_;
+    lru_.clear();
+    index_.clear();
+}
+
+uint64_t MetadataCache::generation() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return generation_;
+}
+
+MetadataCacheStats MetadataCache::getStats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    MetadataCacheStats stats;
+    stats.hits = hits_;
+    stats.misses = misses_;
+    stats.entries = lru_.size();
+    stats.capacity = capacity_;
+    return stats;
+}
+
+void MetadataCache::resetStats()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    hits_ = 0;
+    misses_ = 0;
+}
+
+void MetadataCache::eraseLocked(const std::string& key)
+{
+    auto it = index_.find(key);
+    if (it != index_.end())
+    {
+        lru_.erase(it->second);
+        index_.erase(it);
+    }
+}
+
+void MetadataCache::eraseAncestorsLocked(const std::string& key)
+{
+    std::string ancestor = key;
+    size_t slash;
+    while ((slash = ancestor.find_last_of('/')) != std::string::npos && ancestor.size() > 1)
+    {
+        ancestor.resize(slash == 0 ? 1 : slash);
+        eraseLocked(ancestor);
+    }
+}
+
+} // namespace homeshell
@@ -0,0 +1,254 @@
+#include <homeshell/EncryptedMount.hpp>
+#include <homeshell/MountExport.hpp>
+#include <homeshell/VirtualFilesystem.hpp>
+
+#include <miniz.h>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <system_error>
+
+namespace homeshell
+{
+
+namespace
+{
+
+/// Bytes read from the mount per call when writing to a file descriptor
+constexpr int64_t kExportBlock = 1024 * 1024;
+
+/**
+ * @brief Walk state shared by both export targets
+ */
+struct ExportWalk
+{
+    std::string base;   ///< Normalized exported directory
+    ExportStats& stats; ///< Counters to update
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    /**
+     * @brief Get the path of an entry relative to the exported directory
+     */
+    std::string relative(const std::string& path) const
+    {
+        return path.substr(base == "/" ? 1 : base.size() + 1);
+    }
+
+    void finish()
+    {
+        stats.seconds =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+};
+
+/**
+ * @brief Convert a stored modification time to a timespec
+ */
+timespec toTimespec(int64_t mtime)
+{
+    auto since_epoch = std::chrono::system_clock::duration(mtime);
+    auto seconds = std::chrono::duration_cast<std::chrono::seconds>(since_epoch);
+    timespec ts;
+    ts.tv_sec = static_cast<time_t>(seconds.count());
+    ts.tv_nsec = static_cast<long>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(since_epoch - seconds).count());
+    return ts;
+}
+
+/**
+ * @brief Write a whole buffer to a file descriptor
+ */
+bool writeAll(int fd, const std::string& data)
+{
+    size_t done = 0;
+    while (done < data.size())
+    {
+        ssize_t n = ::write(fd, data.data() + done, data.size() - done);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        done += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+/**
+ * @brief Source of a file added through mz_zip_writer_add_read_buf_callback()
+ */
+struct ZipSource
+{
+    EncryptedMount* mount;
+    const std::string* path;
+    std::string buffer;
+    bool failed = false;
+};
+
+size_t zipReadCallback(void* opaque, mz_uint64 file_ofs, void* out, size_t n)
+{
+    auto* source = static_cast<ZipSource*>(opaque);
+    if (!source->mount->readFileRange(*source->path, static_cast<int64_t>(file_ofs),
+                                      static_cast<int64_t>(n), source->buffer))
+    {
+        source->failed = true;
+        return 0;
+    }
+    std::memcpy(out, source->buffer.data(), source->buffer.size());
+    return source->buffer.size();
+}
+
+} // namespace
+
+bool exportToDirectory(EncryptedMount& mount, const std::string& source,
+                       const std::filesystem::path& dest, ExportStats& stats, std::string& error)
+{
+    stats = ExportStats();
+    ExportWalk walk{VirtualFilesystem::normalizePath("/", source), stats};
+    if (!mount.isDirectory(walk.base))
+    {
+        error = "Not a directory: " + source;
+        return false;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(dest, ec);
+    if (ec)
+    {
+        error = "Cannot create " + dest.string() + ": " + ec.message();
+        return false;
+    }
+
+    std::string content;
+    bool completed = mount.walkTree(
+        walk.base,
+        [&](const VirtualFileInfo& info)
+        {
+            auto target = dest / walk.relative(info.path);
+            if (info.is_directory)
+            {
+                std::filesystem::create_directory(target, ec);
+                if (ec)
+                {
+                    error = "Cannot create " + target.string() + ": " + ec.message();
+                    return false;
+                }
+                ++stats.directories;
+                return true;
+            }
+
+            int fd = ::open(target.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (fd < 0)
+            {
+                error = "Cannot create " + target.string() + ": " + std::strerror(errno);
+                return false;
+            }
+
+            bool ok = true;
+            for (int64_t offset = 0; ok && offset < info.size; offset += kExportBlock)
+            {
+                ok = mount.readFileRange(info.path, offset, kExportBlock, content) &&
+                     writeAll(fd, content);
+                stats.bytes += ok ? static_cast<int64_t>(content.size()) : 0;
+            }
+            timespec times[2] = {toTimespec(info.mtime), toTimespec(info.mtime)};
+            ::futimens(fd, times);
+            ok = ::close(fd) == 0 && ok;
+
+            if (!ok)
+            {
+                error = "Cannot export " + info.path + " to " + target.string();
+                return false;
+            }
+            ++stats.files;
+            return true;
+        });
+
+    walk.finish();
+    if (!completed && error.empty())
+    {
+        error = "Cannot read " + source;
+    }
+    return completed;
+}
+
+bool exportToZip(EncryptedMount& mount, const std::string& source,
+                 const std::filesystem::path& zip_path, ExportStats& stats, std::string& error)
+{
+    stats = ExportStats();
+    ExportWalk walk{VirtualFilesystem::normalizePath("/", source), stats};
+    if (!mount.isDirectory(walk.base))
+    {
+        error = "Not a directory: " + source;
+        return false;
+    }
+
+    mz_zip_archive zip;
+    std::memset(&zip, 0, sizeof(zip));
+    if (!mz_zip_writer_init_file(&zip, zip_path.c_str(), 0))
+    {
+        error = "Cannot create " + zip_path.string();
+        return false;
+    }
+
+    bool completed = mount.walkTree(
+        walk.base,
+        [&](const VirtualFileInfo& info)
+        {
+            std::string name = walk.relative(info.path);
+            time_t mtime = toTimespec(info.mtime).tv_sec;
+            if (info.is_directory)
+            {
+                name += "/";
+                if (!mz_zip_writer_add_mem_ex_v2(&zip, name.c_str(), nullptr, 0, nullptr, 0,
+                                                 MZ_NO_COMPRESSION, 0, 0, &mtime, nullptr, 0,
+                                                 nullptr, 0))
+                {
+                    error = "Cannot add " + name + " to " + zip_path.string();
+                    return false;
+                }
+                ++stats.directories;
+                return true;
+            }
+
+            ZipSource reader{&mount, &info.path, {}};
+            if (!mz_zip_writer_add_read_buf_callback(
+                    &zip, name.c_str(), &zipReadCallback, &reader,
+                    static_cast<mz_uint64>(info.size), &mtime, nullptr, 0,
+                    MZ_DEFAULT_COMPRESSION, nullptr, 0, nullptr, 0) ||
+                reader.failed)
+            {
+                error = "Cannot add " + info.path + " to " + zip_path.string();
+                return false;
+            }
+            stats.bytes += info.size;
+            ++stats.files;
+            return true;
+        });
+
+    bool finalized = completed && mz_zip_writer_finalize_archive(&zip);
+    mz_zip_writer_end(&zip);
+    walk.finish();
+
+    if (!finalized && error.empty())
+    {
+        error = completed ? "Cannot finalize " + zip_path.string() : "Cannot read " + source;
+    }
+    if (!finalized)
+    {
+        std::error_code ec;
+        std::filesystem::remove(zip_path, ec);
+    }
+    return finalized;
+}
+
+} // namespace homeshell
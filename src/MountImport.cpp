@@ -0,0 +1,352 @@
+#include <homeshell/EncryptedMount.hpp>
+#include <homeshell/MountImport.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <system_error>
+#include <thread>
+
+namespace homeshell
+{
+
+namespace
+{
+
+/**
+ * @brief Part of one source file on its way from a reader to the writer
+ */
+struct Block
+{
+    size_t file = 0;     ///< Index into the file list
+    int64_t offset = 0;  ///< Offset of data within the file
+    std::string data;    ///< File content at offset
+    bool last = false;   ///< Final block of the file
+    bool failed = false; ///< Reading failed; blocks already sent must be discarded
+};
+
+/**
+ * @brief FIFO of blocks bounded by the bytes it holds
+ *
+ * Blocks of one file are pushed by a single reader in order, so the writer
+ * sees every file's blocks in offset order.
+ */
+class BlockQueue
+{
+public:
+    BlockQueue(int64_t capacity, int producers)
+        : capacity_(capacity)
+        , producers_(producers)
+    {
+    }
+
+    /**
+     * @brief Wait for room and append a block
+     * @return false if the queue was closed (the block is dropped)
+     */
+    bool push(Block block)
+    {
+        int64_t size = static_cast<int64_t>(block.data.size());
+        std::unique_lock<std::mutex> lock(mutex_);
+        // An empty queue always takes a block, so one larger than the capacity cannot stall
+        not_full_.wait(lock,
+                       [&] { return closed_ || bytes_ == 0 || bytes_ + size <= capacity_; });
+        if (closed_)
+        {
+            return false;
+        }
+        bytes_ += size;
+        blocks_.push_back(std::move(block));
+        not_empty_.notify_one();
+        return true;
+    }
+
+    /**
+     * @brief Wait for the next block
+     * @return false once every producer is done and the queue is drained, or it was closed
+     */
+    bool pop(Block& block)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_empty_.wait(lock, [&] { return closed_ || !blocks_.empty() || producers_ == 0; });
+        if (closed_ || blocks_.empty())
+        {
+            return false;
+        }
+        block = std::move(blocks_.front());
+        blocks_.pop_front();
+        bytes_ -= static_cast<int64_t>(block.data.size());
+        not_full_.notify_all();
+        return true;
+    }
+
+    /**
+     * @brief Signal that one producer will push no more blocks
+     */
+    void producerDone()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        --producers_;
+        not_empty_.notify_all();
+    }
+
+    /**
+     * @brief Stop the transfer: pending and future blocks are dropped
+     */
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        blocks_.clear();
+        not_full_.notify_all();
+        not_empty_.notify_all();
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable not_full_;
+    std::condition_variable not_empty_;
+    std::deque<Block> blocks_;
+    int64_t bytes_ = 0;
+    int64_t capacity_;
+    int producers_;
+    bool closed_ = false;
+};
+
+/**
+ * @brief Read one source file into the queue block by block
+ * @return false if the queue was closed
+ */
+bool readSourceFile(const std::filesystem::path& path, size_t index, int64_t block_bytes,
+                    BlockQueue& queue)
+{
+    std::ifstream in(path, std::ios::binary);
+    int64_t offset = 0;
+    while (in)
+    {
+        Block block;
+        block.file = index;
+        block.offset = offset;
+        block.data.resize(static_cast<size_t>(block_bytes));
+        in.read(block.data.data(), block_bytes);
+        if (in.bad())
+        {
+            break;
+        }
+        block.data.resize(static_cast<size_t>(in.gcount()));
+        block.last = in.peek() == std::ifstream::traits_type::eof();
+        offset += static_cast<int64_t>(block.data.size());
+
+        bool last = block.last;
+        if (!queue.push(std::move(block)))
+        {
+            return false;
+        }
+        if (last)
+        {
+            return true;
+        }
+    }
+
+    Block failed;
+    failed.file = index;
+    failed.offset = offset;
+    failed.failed = true;
+    return queue.push(std::move(failed));
+}
+
+} // namespace
+
+bool importDirectory(EncryptedMount& mount, const std::filesystem::path& source,
+                     const std::string& dest, const ImportOptions& options, ImportStats& stats,
+                     std::string& error)
+{
+    namespace fs = std::filesystem;
+
+    stats = ImportStats();
+    auto start = std::chrono::steady_clock::now();
+
+    std::error_code ec;
+    if (!fs::is_directory(source, ec))
+    {
+        error = "Not a directory: " + source.string();
+        return false;
+    }
+
+    std::string base = dest;
+    while (!base.empty() && base.back() == '/')
+    {
+        base.pop_back();
+    }
+
+    // Walk the source first: directories are created up front, files are
+    // handed out to the readers by index
+    std::vector<std::string> directories = {base.empty() ? "/" : base};
+    std::vector<fs::path> files;
+    std::vector<std::string> targets;
+    fs::recursive_directory_iterator it(source, fs::directory_options::skip_permission_denied, ec);
+    for (; !ec && it != fs::recursive_directory_iterator(); it.increment(ec))
+    {
+        std::error_code entry_ec;
+        if (it->is_symlink(entry_ec))
+        {
+            it.disable_recursion_pending();
+            continue;
+        }
+        std::string target = base + "/" + it->path().lexically_relative(source).generic_string();
+        if (it->is_directory(entry_ec))
+        {
+            directories.push_back(target);
+        }
+        else if (it->is_regular_file(entry_ec))
+        {
+            files.push_back(it->path());
+            targets.push_back(target);
+        }
+    }
+    if (ec)
+    {
+        error = "Cannot read " + source.string() + ": " + ec.message();
+        return false;
+    }
+
+    if (!mount.beginBatch())
+    {
+        error = "Mount is not available";
+        return false;
+    }
+
+    for (const auto& dir : directories)
+    {
+        if (!mount.createDirectory(dir))
+        {
+            mount.endBatch();
+            error = "Cannot create directory " + dir;
+            return false;
+        }
+    }
+    stats.directories = static_cast<int64_t>(directories.size());
+
+    int workers = options.workers > 0
+                      ? options.workers
+                      : std::clamp(static_cast<int>(std::thread::hardware_concurrency()), 1, 8);
+    workers = std::max(1, std::min(workers, static_cast<int>(files.size())));
+    // Whole chunks per block, so the writer never has to merge a partial chunk
+    const int64_t chunk = EncryptedMount::kChunkSize;
+    int64_t block_bytes = std::max<int64_t>((options.block_bytes + chunk - 1) / chunk, 1) * chunk;
+
+    BlockQueue queue(options.queue_bytes, workers);
+    std::atomic<size_t> next_file{0};
+    std::vector<std::thread> readers;
+    for (int i = 0; i < workers; ++i)
+    {
+        readers.emplace_back(
+            [&]
+            {
+                for (size_t index = next_file++; index < files.size(); index = next_file++)
+                {
+                    if (!readSourceFile(files[index], index, block_bytes, queue))
+                    {
+                        break;
+                    }
+                }
+                queue.producerDone();
+            });
+    }
+
+    // This thread is the only writer; it commits every batch_bytes
+    bool ok = true;
+    bool batch_open = true;
+    int64_t uncommitted = 0;
+    std::map<size_t, int64_t> partial; // Files with some but not all blocks written
+    Block block;
+    while (queue.pop(block))
+    {
+        const std::string& target = targets[block.file];
+        if (block.failed)
+        {
+            // The writer has seen every earlier block of the file
+            if (block.offset > 0)
+            {
+                mount.remove(target);
+                stats.bytes -= block.offset;
+                partial.erase(block.file);
+            }
+            stats.failed.push_back(files[block.file].string());
+            continue;
+        }
+
+        bool written = block.offset == 0 ? mount.writeFile(target, block.data)
+                                         : mount.writeFileRange(target, block.offset, block.data);
+        if (!written)
+        {
+            error = "Cannot write " + target + " (quota exceeded?)";
+            ok = false;
+            queue.close();
+            break;
+        }
+
+        stats.bytes += static_cast<int64_t>(block.data.size());
+        uncommitted += static_cast<int64_t>(block.data.size());
+        if (block.last)
+        {
+            ++stats.files;
+            partial.erase(block.file);
+        }
+        else
+        {
+            partial[block.file] = block.offset + static_cast<int64_t>(block.data.size());
+        }
+
+        if (uncommitted >= options.batch_bytes)
+        {
+            batch_open = mount.endBatch() && mount.beginBatch();
+            if (!batch_open)
+            {
+                error = "Commit failed";
+                ok = false;
+                queue.close();
+                break;
+            }
+            ++stats.commits;
+            uncommitted = 0;
+        }
+    }
+
+    for (auto& reader : readers)
+    {
+        reader.join();
+    }
+
+    // The rest of these files was dropped with the queue; do not commit them truncated
+    for (const auto& [index, bytes] : partial)
+    {
+        mount.remove(targets[index]);
+        stats.bytes -= bytes;
+        stats.failed.push_back(files[index].string());
+    }
+
+    if (batch_open)
+    {
+        if (mount.endBatch())
+        {
+            ++stats.commits;
+        }
+        else if (ok)
+        {
+            error = "Commit failed";
+            ok = false;
+        }
+    }
+
+    stats.seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return ok;
+}
+
+} // namespace homeshell
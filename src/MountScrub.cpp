@@ -0,0 +1,90 @@
+#include <homeshell/EncryptedMount.hpp>
+#include <homeshell/MountScrub.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+namespace homeshell
+{
+
+bool scrubMount(EncryptedMount& mount, const ScrubOptions& options, ScrubStats& stats,
+                std::string& error)
+{
+    stats = ScrubStats();
+    auto start = std::chrono::steady_clock::now();
+    auto finish = [&]()
+    {
+        stats.seconds =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    if (!mount.checkIntegrity(stats.integrity_errors))
+    {
+        error = "Cannot run the integrity check";
+        finish();
+        return false;
+    }
+
+    std::vector<VirtualFileInfo> files;
+    if (!mount.findFiles(FileQuery(), files))
+    {
+        error = "Cannot list the files";
+        finish();
+        return false;
+    }
+
+    int workers = options.workers > 0
+                      ? options.workers
+                      : std::clamp(static_cast<int>(std::thread::hardware_concurrency()), 1, 8);
+    workers = std::max(1, std::min(workers, static_cast<int>(files.size())));
+
+    std::mutex stats_mutex;
+    std::atomic<size_t> next_file{0};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < workers; ++i)
+    {
+        threads.emplace_back(
+            [&]
+            {
+                FileCheck check;
+                for (size_t index = next_file++; index < files.size(); index = next_file++)
+                {
+                    if (options.stop && options.stop->load())
+                    {
+                        break;
+                    }
+
+                    // A file removed since the listing is not an error
+                    bool read = mount.verifyFile(files[index].path, check);
+                    if (!read && !mount.exists(files[index].path))
+                    {
+                        continue;
+                    }
+
+                    std::lock_guard<std::mutex> lock(stats_mutex);
+                    ++stats.files;
+                    stats.chunks += check.chunks;
+                    stats.unverified_chunks += check.unverified;
+                    stats.bytes += check.bytes;
+                    if (!read || !check.corrupt.empty())
+                    {
+                        stats.corrupt.push_back(files[index].path);
+                    }
+                }
+            });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    stats.stopped = options.stop && options.stop->load();
+    std::sort(stats.corrupt.begin(), stats.corrupt.end());
+    finish();
+    return true;
+}
+
+} // namespace homeshell
@@ -0,0 +1,89 @@
+#include <homeshell/MountTrie.hpp>
+
+namespace homeshell
+{
+
+namespace
+{
+
+/**
+ * @brief Get the next non-empty component of a path
+ * @param path Path being split
+ * @param[in,out] pos Position to continue from; set past the component
+ * @return The component, or an empty view when none is left
+ */
+std::string_view nextComponent(std::string_view path, size_t& pos)
+{
+    while (pos < path.size() && path[pos] == '/')
+    {
+        ++pos;
+    }
+    size_t start = pos;
+    while (pos < path.size() && path[pos] != '/')
+    {
+        ++pos;
+    }
+    return path.substr(start, pos - start);
+}
+
+} // namespace
+
+bool MountTrie::insert(std::string_view mount_point, EncryptedMount* mount)
+{
+    Node* node = &root_;
+    size_t pos = 0;
+    for (auto part = nextComponent(mount_point, pos); !part.empty();
+         part = nextComponent(mount_point, pos))
+    {
+        auto it = node->children.find(part);
+        if (it == node->children.end())
+        {
+            it = node->children.emplace(std::string(part), std::make_unique<Node>()).first;
+        }
+        node = it->second.get();
+    }
+
+    if (node->mount)
+    {
+        return false;
+    }
+    node->mount = mount;
+    ++size_;
+    return true;
+}
+
+void MountTrie::clear()
+{
+    root_.children.clear();
+    root_.mount = nullptr;
+    size_ = 0;
+}
+
+MountMatch MountTrie::findLongestPrefix(std::string_view path) const
+{
+    MountMatch match;
+    const Node* node = &root_;
+    if (node->mount)
+    {
+        match.mount = node->mount;
+    }
+
+    size_t pos = 0;
+    for (auto part = nextComponent(path, pos); !part.empty(); part = nextComponent(path, pos))
+    {
+        auto it = node->children.find(part);
+        if (it == node->children.end())
+        {
+            break;
+        }
+        node = it->second.get();
+        if (node->mount)
+        {
+            match.mount = node->mount;
+            match.length = pos;
+        }
+    }
+    return match;
+}
+
+} // namespace homeshell
@@ -1,4 +1,5 @@
 #include <homeshell/OutputRedirection.hpp>
+#include <homeshell/VirtualFilesystem.hpp>
 
 #include <fcntl.h>
 #include <unistd.h>
@@ -133,9 +134,24 @@ bool OutputRedirection::redirect(const RedirectInfo& info)
         return false;
     }
 
-    // Open the output file
-    const char* mode = (info.mode == RedirectMode::Append) ? "a" : "w";
-    redirect_file_ = fopen(info.filename.c_str(), mode);
+    ResolvedPath resolved = VirtualFilesystem::getInstance().resolvePath(info.filename);
+    if (resolved.type == PathType::Virtual)
+    {
+        // Mount files have no descriptor to dup2 onto: spool the output and
+        // hand it to the mount in restore(), appending rather than rewriting
+        if (resolved.mount && resolved.mount->is_mounted())
+        {
+            redirect_file_ = std::tmpfile();
+        }
+        virtual_path_ = info.filename;
+        virtual_mode_ = info.mode;
+    }
+    else
+    {
+        // Open the output file
+        const char* mode = (info.mode == RedirectMode::Append) ? "a" : "w";
+        redirect_file_ = fopen(info.filename.c_str(), mode);
+    }
 
     if (!redirect_file_)
     {
@@ -152,6 +168,7 @@ bool OutputRedirection::redirect(const RedirectInfo& info)
         std::cerr << "Error: Failed to save file descriptors\n";
         fclose(redirect_file_);
         redirect_file_ = nullptr;
+        virtual_path_.clear();
         return false;
     }
 
@@ -216,11 +233,39 @@ void OutputRedirection::restore()
     // Close redirect file
     if (redirect_file_)
     {
+        if (!virtual_path_.empty() && !flushToVirtualFile())
+        {
+            std::cerr << "Error: Cannot write to file '" << virtual_path_ << "'\n";
+        }
         fclose(redirect_file_);
         redirect_file_ = nullptr;
     }
+    virtual_path_.clear();
 
     redirected_ = false;
 }
 
+bool OutputRedirection::flushToVirtualFile()
+{
+    auto& vfs = VirtualFilesystem::getInstance();
+    VfsBatch batch(virtual_path_);
+
+    if (virtual_mode_ == RedirectMode::Truncate && !vfs.writeFile(virtual_path_, ""))
+    {
+        return false;
+    }
+
+    // Copy the spooled output in chunk-sized pieces so large output is never
+    // held in memory at once
+    std::rewind(redirect_file_);
+    std::string buffer(64 * 1024, '\0');
+    bool ok = true;
+    size_t n;
+    while (ok && (n = std::fread(buffer.data(), 1, buffer.size(), redirect_file_)) > 0)
+    {
+        ok = vfs.appendFile(virtual_path_, buffer.substr(0, n));
+    }
+    return batch.commit() && ok;
+}
+
 } // namespace homeshell
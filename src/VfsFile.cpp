@@ -0,0 +1,241 @@
+#include <homeshell/EncryptedMount.hpp>
+#include <homeshell/VfsFile.hpp>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+namespace homeshell
+{
+
+int64_t VfsFile::read(char* buffer, int64_t size)
+{
+    int64_t n = pread(buffer, size, position_);
+    if (n > 0)
+    {
+        position_ += n;
+    }
+    return n;
+}
+
+int64_t VfsFile::write(const char* data, int64_t size)
+{
+    int64_t n = pwrite(data, size, position_);
+    if (n > 0)
+    {
+        position_ += n;
+    }
+    return n;
+}
+
+int64_t VfsFile::append(const char* data, int64_t size)
+{
+    int64_t end = this->size();
+    if (end < 0)
+    {
+        return -1;
+    }
+
+    position_ = end;
+    return write(data, size);
+}
+
+int64_t VfsFile::seek(int64_t offset, VfsSeekOrigin origin)
+{
+    int64_t base = 0;
+    switch (origin)
+    {
+    case VfsSeekOrigin::Begin:
+        base = 0;
+        break;
+    case VfsSeekOrigin::Current:
+        base = position_;
+        break;
+    case VfsSeekOrigin::End:
+        base = size();
+        if (base < 0)
+        {
+            return -1;
+        }
+        break;
+    }
+
+    if (base + offset < 0)
+    {
+        return -1;
+    }
+
+    position_ = base + offset;
+    return position_;
+}
+
+int64_t RealVfsFile::pread(char* buffer, int64_t size, int64_t offset)
+{
+    if (fd_ < 0)
+    {
+        return -1;
+    }
+
+    ssize_t n;
+    do
+    {
+        n = ::pread(fd_, buffer, static_cast<size_t>(size), static_cast<off_t>(offset));
+    } while (n < 0 && errno == EINTR);
+
+    return n;
+}
+
+int64_t RealVfsFile::pwrite(const char* data, int64_t size, int64_t offset)
+{
+    if (fd_ < 0)
+    {
+        return -1;
+    }
+
+    int64_t written = 0;
+    while (written < size)
+    {
+        ssize_t n = ::pwrite(fd_, data + written, static_cast<size_t>(size - written),
+                             static_cast<off_t>(offset + written));
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        written += n;
+    }
+
+    return written;
+}
+
+int64_t RealVfsFile::append(const char* data, int64_t size)
+{
+    // Without O_APPEND the end has to be looked up before writing
+    int flags = fd_ >= 0 ? ::fcntl(fd_, F_GETFL) : -1;
+    if (flags < 0 || !(flags & O_APPEND))
+    {
+        return VfsFile::append(data, size);
+    }
+
+    // The kernel moves every write() to the end of the file
+    int64_t written = 0;
+    while (written < size)
+    {
+        ssize_t n = ::write(fd_, data + written, static_cast<size_t>(size - written));
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        written += n;
+    }
+
+    off_t end = ::lseek(fd_, 0, SEEK_CUR);
+    if (end >= 0)
+    {
+        position_ = end;
+    }
+    return written;
+}
+
+int64_t RealVfsFile::size()
+{
+    struct stat st;
+    if (fd_ < 0 || ::fstat(fd_, &st) != 0)
+    {
+        return -1;
+    }
+    return st.st_size;
+}
+
+void RealVfsFile::close()
+{
+    if (fd_ >= 0)
+    {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+int64_t MountVfsFile::pread(char* buffer, int64_t size, int64_t offset)
+{
+    if (!mount_ || mode_ == VfsOpenMode::Write || mode_ == VfsOpenMode::Append ||
+        !mount_->readFileRange(path_, offset, size, scratch_))
+    {
+        return -1;
+    }
+
+    std::memcpy(buffer, scratch_.data(), scratch_.size());
+    return static_cast<int64_t>(scratch_.size());
+}
+
+int64_t MountVfsFile::pwrite(const char* data, int64_t size, int64_t offset)
+{
+    if (!mount_ || mode_ == VfsOpenMode::Read)
+    {
+        return -1;
+    }
+
+    // Like pwrite() on an O_APPEND descriptor, ignore the offset
+    std::string content(data, static_cast<size_t>(size));
+    bool written = mode_ == VfsOpenMode::Append ? mount_->appendFile(path_, content)
+                                                : mount_->writeFileRange(path_, offset, content);
+    return written ? size : -1;
+}
+
+int64_t MountVfsFile::append(const char* data, int64_t size)
+{
+    // The mount looks up the end and writes under one lock
+    if (!mount_ || mode_ == VfsOpenMode::Read ||
+        !mount_->appendFile(path_, std::string(data, static_cast<size_t>(size))))
+    {
+        return -1;
+    }
+
+    int64_t end = mount_->getFileSize(path_);
+    if (end >= 0)
+    {
+        position_ = end;
+    }
+    return size;
+}
+
+int64_t MountVfsFile::size()
+{
+    return mount_ ? mount_->getFileSize(path_) : -1;
+}
+
+void MountVfsFile::close()
+{
+    mount_ = nullptr;
+    scratch_.clear();
+    scratch_.shrink_to_fit();
+}
+
+VfsStreamBuf::int_type VfsStreamBuf::underflow()
+{
+    if (gptr() < egptr())
+    {
+        return traits_type::to_int_type(*gptr());
+    }
+
+    int64_t n = file_.read(buffer_.data(), static_cast<int64_t>(buffer_.size()));
+    if (n <= 0)
+    {
+        return traits_type::eof();
+    }
+
+    setg(buffer_.data(), buffer_.data(), buffer_.data() + n);
+    return traits_type::to_int_type(*gptr());
+}
+
+} // namespace homeshell
@@ -1,13 +1,40 @@
 #include <homeshell/VirtualFilesystem.hpp>
 
+#include <fcntl.h>
+#include <sys/stat.h>
+
 #include <algorithm>
 #include <filesystem>
 #include <fstream>
-#include <sstream>
 
 namespace homeshell
 {
 
+namespace
+{
+
+/**
+ * @brief Metadata cache key of a path inside a mount
+ *
+ * Mount point plus the path within the mount, with the trailing slash
+ * stripped the same way EncryptedMount normalizes paths.
+ */
+std::string metadataKey(const std::string& mount_point, const std::string& relative_path)
+{
+    if (relative_path.empty() || relative_path == "/")
+    {
+        return mount_point;
+    }
+
+    if (relative_path.back() == '/')
+    {
+        return mount_point + relative_path.substr(0, relative_path.size() - 1);
+    }
+    return mount_point + relative_path;
+}
+
+} // namespace
+
 bool VirtualFilesystem::addMount(std::shared_ptr<EncryptedMount> mount)
 {
     if (!mount)
@@ -15,7 +42,24 @@ bool VirtualFilesystem::addMount(std::shared_ptr<EncryptedMount> mount)
         return false;
     }
 
+    std::string mount_point = mount->getMountPoint();
+    metadata_cache_.invalidateTree(mount_point);
+    mount->setChangeListener(
+        [this, mount_point](const std::string& path, bool subtree)
+        {
+            std::string key = metadataKey(mount_point, path);
+            if (subtree)
+            {
+                metadata_cache_.invalidateTree(key);
+            }
+            else
+            {
+                metadata_cache_.invalidate(key);
+            }
+        });
+
     mounts_[mount->getName()] = mount;
+    rebuildMountTrie();
     return true;
 }
 
@@ -24,8 +68,11 @@ bool VirtualFilesystem::removeMount(const std::string& name)
     auto it = mounts_.find(name);
     if (it != mounts_.end())
     {
+        it->second->setChangeListener(nullptr);
         it->second->unmount();
+        metadata_cache_.invalidateTree(it->second->getMountPoint());
         mounts_.erase(it);
+        rebuildMountTrie();
         return true;
     }
     return false;
@@ -54,38 +101,20 @@ std::vector<std::string> VirtualFilesystem::getMountNames() const
 ResolvedPath VirtualFilesystem::resolvePath(const std::string& path) const
 {
     ResolvedPath result;
-    std::string resolved = resolveRelativePath(path);
+    result.full_path = normalizePath(current_directory_, path);
 
-    // Check if path matches any mount point
-    for (const auto& pair : mounts_)
+    MountMatch match = mount_trie_.findLongestPrefix(result.full_path);
+    if (!match.mount)
     {
-        const std::string& mount_point = pair.second->getMountPoint();
-
-        if (resolved == mount_point || (resolved.length() > mount_point.length() &&
-                                        resolved.substr(0, mount_point.length()) == mount_point &&
-                                        resolved[mount_point.length()] == '/'))
-        {
-            result.type = PathType::Virtual;
-            result.full_path = resolved;
-            result.mount_point = mount_point;
-
-            if (resolved == mount_point)
-            {
-                result.relative_path = "/";
-            }
-            else
-            {
-                result.relative_path = resolved.substr(mount_point.length());
-            }
-
-            result.mount = pair.second.get();
-            return result;
-        }
+        result.type = PathType::Real;
+        return result;
     }
 
-    // Regular filesystem path
-    result.type = PathType::Real;
-    result.full_path = resolved;
+    result.type = PathType::Virtual;
+    result.mount_point = match.mount->getMountPoint();
+    result.relative_path =
+        match.length < result.full_path.size() ? result.full_path.substr(match.length) : "/";
+    result.mount = match.mount;
     return result;
 }
 
@@ -94,71 +123,64 @@ bool VirtualFilesystem::isVirtualPath(const std::string& path) const
     return resolvePath(path).type == PathType::Virtual;
 }
 
-std::string VirtualFilesystem::resolveRelativePath(const std::string& path) const
+std::string VirtualFilesystem::normalizePath(std::string_view base, std::string_view path)
 {
-    if (path.empty())
-    {
-        return current_directory_;
-    }
-
-    if (path[0] == '/')
-    {
-        return path;
-    }
-
-    // Handle . (current directory)
-    if (path == ".")
-    {
-        return current_directory_;
-    }
-
-    // Relative path - resolve against current directory
-    std::string result = current_directory_;
-    if (result.back() != '/')
-    {
-        result += "/";
-    }
-    result += path;
-
-    // Normalize path (remove ., .., etc.)
-    std::vector<std::string> parts;
-    std::stringstream ss(result);
-    std::string part;
+    std::string result;
+    result.reserve(base.size() + path.size() + 1);
 
-    while (std::getline(ss, part, '/'))
+    auto append = [&result](std::string_view input)
     {
-        if (part.empty() || part == ".")
+        size_t pos = 0;
+        while (pos < input.size())
         {
-            continue; // Skip empty parts and "."
-        }
-        else if (part == "..")
-        {
-            if (!parts.empty())
+            size_t end = input.find('/', pos);
+            if (end == std::string_view::npos)
             {
-                parts.pop_back(); // Go up one directory
+                end = input.size();
             }
+            std::string_view part = input.substr(pos, end - pos);
+            pos = end + 1;
+
+            if (part.empty() || part == ".")
+            {
+                continue;
+            }
+            if (part == "..")
+            {
+                // Above the root stays at the root
+                size_t slash = result.rfind('/');
+                result.resize(slash == std::string::npos ? 0 : slash);
+                continue;
+            }
+            result += '/';
+            result += part;
         }
-        else
-        {
-            parts.push_back(part);
-        }
-    }
+    };
 
-    // Reconstruct path
-    if (parts.empty())
+    if (path.empty() || path.front() != '/')
     {
-        return "/";
+        append(base);
     }
+    append(path);
 
-    result = "";
-    for (const auto& p : parts)
+    if (result.empty())
     {
-        result += "/" + p;
+        result = "/";
     }
-
     return result;
 }
 
+void VirtualFilesystem::rebuildMountTrie()
+{
+    // Name order, so that of two mounts on one mount point the same one
+    // always wins
+    mount_trie_.clear();
+    for (const auto& pair : mounts_)
+    {
+        mount_trie_.insert(pair.second->getMountPoint(), pair.second.get());
+    }
+}
+
 std::vector<VirtualFileInfo> VirtualFilesystem::listDirectory(const std::string& path)
 {
     ResolvedPath resolved = resolvePath(path);
@@ -167,7 +189,21 @@ std::vector<VirtualFileInfo> VirtualFilesystem::listDirectory(const std::string&
     {
         if (resolved.mount && resolved.mount->is_mounted())
         {
-            return resolved.mount->listDirectory(resolved.relative_path);
+            uint64_t generation = metadata_cache_.generation();
+            auto entries = resolved.mount->listDirectory(resolved.relative_path);
+
+            // Commands typically stat what they just listed
+            std::string parent_key = metadataKey(resolved.mount_point, resolved.relative_path);
+            for (const auto& entry : entries)
+            {
+                CachedMetadata metadata;
+                metadata.exists = true;
+                metadata.is_directory = entry.is_directory;
+                metadata.size = entry.size;
+                metadata.mtime = entry.mtime;
+                metadata_cache_.insert(parent_key + "/" + entry.name, metadata, generation);
+            }
+            return entries;
         }
         return {};
     }
@@ -230,8 +266,8 @@ bool VirtualFilesystem::exists(const std::string& path)
 
     if (resolved.type == PathType::Virtual)
     {
-        return resolved.mount && resolved.mount->is_mounted() &&
-               resolved.mount->exists(resolved.relative_path);
+        CachedMetadata metadata;
+        return statVirtual(resolved, metadata);
     }
     else
     {
@@ -245,8 +281,8 @@ bool VirtualFilesystem::isDirectory(const std::string& path)
 
     if (resolved.type == PathType::Virtual)
     {
-        return resolved.mount && resolved.mount->is_mounted() &&
-               resolved.mount->isDirectory(resolved.relative_path);
+        CachedMetadata metadata;
+        return statVirtual(resolved, metadata) && metadata.is_directory;
     }
     else
     {
@@ -254,6 +290,71 @@ bool VirtualFilesystem::isDirectory(const std::string& path)
     }
 }
 
+bool VirtualFilesystem::stat(const std::string& path, VirtualFileInfo& info)
+{
+    ResolvedPath resolved = resolvePath(path);
+    info.path = resolved.full_path;
+    info.name = std::filesystem::path(resolved.full_path).filename().string();
+
+    if (resolved.type == PathType::Virtual)
+    {
+        CachedMetadata metadata;
+        if (!statVirtual(resolved, metadata))
+        {
+            return false;
+        }
+
+        info.is_directory = metadata.is_directory;
+        info.size = metadata.size;
+        info.mtime = metadata.mtime;
+        return true;
+    }
+    else
+    {
+        // Real filesystem
+        struct stat st;
+        if (::stat(resolved.full_path.c_str(), &st) != 0)
+        {
+            return false;
+        }
+
+        info.is_directory = S_ISDIR(st.st_mode);
+        info.size = info.is_directory ? 0 : static_cast<int64_t>(st.st_size);
+        info.mtime = static_cast<int64_t>(st.st_mtime);
+        return true;
+    }
+}
+
+bool VirtualFilesystem::statVirtual(const ResolvedPath& resolved, CachedMetadata& metadata)
+{
+    if (!resolved.mount || !resolved.mount->is_mounted())
+    {
+        return false;
+    }
+
+    std::string key = metadataKey(resolved.mount_point, resolved.relative_path);
+    if (metadata_cache_.lookup(key, metadata))
+    {
+        return metadata.exists;
+    }
+
+    // Missing paths are cached too; creating them invalidates the entry.
+    // A change made while the mount is queried discards the result.
+    uint64_t generation = metadata_cache_.generation();
+    VirtualFileInfo info;
+    metadata = CachedMetadata();
+    if (resolved.mount->stat(resolved.relative_path, info))
+    {
+        metadata.exists = true;
+        metadata.is_directory = info.is_directory;
+        metadata.size = info.size;
+        metadata.mtime = info.mtime;
+    }
+
+    metadata_cache_.insert(key, metadata, generation);
+    return metadata.exists;
+}
+
 bool VirtualFilesystem::readFile(const std::string& path, std::string& content)
 {
     ResolvedPath resolved = resolvePath(path);
@@ -300,6 +401,108 @@ bool VirtualFilesystem::writeFile(const std::string& path, const std::string& co
     }
 }
 
+bool VirtualFilesystem::appendFile(const std::string& path, const std::string& content)
+{
+    ResolvedPath resolved = resolvePath(path);
+
+    if (resolved.type == PathType::Virtual)
+    {
+        CachedMetadata metadata;
+        if (!resolved.mount || !resolved.mount->is_mounted() ||
+            (statVirtual(resolved, metadata) && metadata.is_directory))
+        {
+            return false;
+        }
+        return resolved.mount->appendFile(resolved.relative_path, content);
+    }
+    else
+    {
+        // Real filesystem
+        std::ofstream file(resolved.full_path, std::ios::binary | std::ios::app);
+        if (!file.is_open())
+        {
+            return false;
+        }
+
+        file.write(content.data(), content.size());
+        return file.good();
+    }
+}
+
+std::unique_ptr<VfsFile> VirtualFilesystem::openFile(const std::string& path, VfsOpenMode mode)
+{
+    ResolvedPath resolved = resolvePath(path);
+
+    if (resolved.type == PathType::Virtual)
+    {
+        EncryptedMount* mount = resolved.mount;
+        CachedMetadata metadata;
+        bool exists = statVirtual(resolved, metadata);
+        if (!mount || !mount->is_mounted() || metadata.is_directory)
+        {
+            return nullptr;
+        }
+
+        if (mode == VfsOpenMode::Read && !exists)
+        {
+            return nullptr;
+        }
+
+        if ((mode == VfsOpenMode::Write || !exists) &&
+            !mount->writeFile(resolved.relative_path, ""))
+        {
+            return nullptr;
+        }
+
+        auto file = std::make_unique<MountVfsFile>(mount, resolved.relative_path, mode);
+        if (mode == VfsOpenMode::Append)
+        {
+            file->seek(0, VfsSeekOrigin::End);
+        }
+        return file;
+    }
+    else
+    {
+        // Real filesystem
+        if (FilesystemHelper::isDirectory(resolved.full_path))
+        {
+            return nullptr;
+        }
+
+        int flags = O_RDONLY;
+        switch (mode)
+        {
+        case VfsOpenMode::Read:
+            flags = O_RDONLY;
+            break;
+        case VfsOpenMode::Write:
+            flags = O_WRONLY | O_CREAT | O_TRUNC;
+            break;
+        case VfsOpenMode::Append:
+            flags = O_WRONLY | O_CREAT | O_APPEND;
+            break;
+        case VfsOpenMode::ReadWrite:
+            flags = O_RDWR | O_CREAT;
+            break;
+        }
+
+        int fd = ::open(resolved.full_path.c_str(), flags | O_CLOEXEC, 0644);
+        if (fd < 0)
+        {
+            return nullptr;
+        }
+
+        // O_APPEND places the writes; the position only starts at the end
+        // so that tell() matches the mount handles
+        auto file = std::make_unique<RealVfsFile>(fd);
+        if (mode == VfsOpenMode::Append)
+        {
+            file->seek(0, VfsSeekOrigin::End);
+        }
+        return file;
+    }
+}
+
 bool VirtualFilesystem::createDirectory(const std::string& path)
 {
     ResolvedPath resolved = resolvePath(path);
@@ -336,4 +539,28 @@ bool VirtualFilesystem::remove(const std::string& path)
     }
 }
 
+bool VirtualFilesystem::rename(const std::string& from, const std::string& to)
+{
+    ResolvedPath source = resolvePath(from);
+    ResolvedPath target = resolvePath(to);
+
+    if (source.type != target.type)
+    {
+        return false;
+    }
+
+    if (source.type == PathType::Virtual)
+    {
+        return source.mount && source.mount == target.mount && source.mount->is_mounted() &&
+               source.mount->rename(source.relative_path, target.relative_path);
+    }
+    else
+    {
+        // Real filesystem
+        std::error_code ec;
+        std::filesystem::rename(source.full_path, target.full_path, ec);
+        return !ec;
+    }
+}
+
 } // namespace homeshell
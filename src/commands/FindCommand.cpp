@@ -1,16 +1,35 @@
+#include <homeshell/EncryptedMount.hpp>
 #include <homeshell/VirtualFilesystem.hpp>
 #include <homeshell/commands/FindCommand.hpp>
 
 #include <fmt/color.h>
 #include <fmt/core.h>
 
+#include <sys/stat.h>
+
 #include <algorithm>
 #include <cctype>
+#include <chrono>
 #include <filesystem>
 
 namespace homeshell
 {
 
+namespace
+{
+
+/**
+ * @brief Convert a stat() modification time to std::chrono::system_clock ticks
+ */
+int64_t toSystemTicks(const struct stat& st)
+{
+    auto since_epoch =
+        std::chrono::seconds(st.st_mtim.tv_sec) + std::chrono::nanoseconds(st.st_mtim.tv_nsec);
+    return std::chrono::duration_cast<std::chrono::system_clock::duration>(since_epoch).count();
+}
+
+} // namespace
+
 Status FindCommand::execute(const CommandContext& context)
 {
     FindOptions options;
@@ -71,6 +90,37 @@ Status FindCommand::execute(const CommandContext& context)
             }
             i += 2;
         }
+        else if (arg == "-size" && i + 1 < context.args.size())
+        {
+            if (!parseSize(context.args[i + 1], options))
+            {
+                fmt::print(fg(fmt::color::red), "Error: Invalid -size value '{}'\n",
+                           context.args[i + 1]);
+                return Status::error("Invalid size value");
+            }
+            i += 2;
+        }
+        else if (arg == "-mtime" && i + 1 < context.args.size())
+        {
+            if (!parseMtime(context.args[i + 1], options))
+            {
+                fmt::print(fg(fmt::color::red), "Error: Invalid -mtime value '{}'\n",
+                           context.args[i + 1]);
+                return Status::error("Invalid mtime value");
+            }
+            i += 2;
+        }
+        else if (arg == "-newer" && i + 1 < context.args.size())
+        {
+            int64_t reference = 0;
+            if (!modificationTime(context.args[i + 1], reference))
+            {
+                fmt::print(fg(fmt::color::red), "Error: Cannot stat '{}'\n", context.args[i + 1]);
+                return Status::error("Reference file not found");
+            }
+            options.min_mtime = std::max(options.min_mtime, reference + 1);
+            i += 2;
+        }
         else if (arg == "--help")
         {
             fmt::print("Usage: find [path] [options]\n");
@@ -80,6 +130,10 @@ Status FindCommand::execute(const CommandContext& context)
             fmt::print("  -iname <pattern>     Case-insensitive name search\n");
             fmt::print("  -type <f|d>          Filter by type: f=file, d=directory\n");
             fmt::print("  -maxdepth <n>        Descend at most n levels\n");
+            fmt::print("  -size [+-]<n>[ckMG]  Size of n units (default 512-byte blocks),\n"
+                       "                       more (+n) or less (-n)\n");
+            fmt::print("  -mtime [+-]<n>       Modified n days ago, more (+n) or less (-n)\n");
+            fmt::print("  -newer <file>        Modified more recently than file\n");
             fmt::print("  --help               Show this help message\n");
             fmt::print("\nExamples:\n");
             fmt::print(
@@ -88,6 +142,8 @@ Status FindCommand::execute(const CommandContext& context)
             fmt::print("  find . -name '*.txt' Find all .txt files\n");
             fmt::print("  find . -type d       Find all directories\n");
             fmt::print("  find . -maxdepth 2   Search up to 2 levels deep\n");
+            fmt::print("  find . -size +10M    Find files larger than 10 MiB\n");
+            fmt::print("  find . -mtime -1     Find entries modified in the last 24 hours\n");
             return Status::ok();
         }
         else if (arg[0] != '-')
@@ -107,6 +163,18 @@ Status FindCommand::execute(const CommandContext& context)
     auto& vfs = VirtualFilesystem::getInstance();
     auto resolved = vfs.resolvePath(options.start_path);
 
+    if (resolved.type == PathType::Virtual)
+    {
+        if (!vfs.exists(resolved.full_path))
+        {
+            fmt::print(fg(fmt::color::red), "Error: Path '{}' does not exist\n",
+                       options.start_path);
+            return Status::error("Path not found");
+        }
+        findVirtual(resolved, options, context);
+        return Status::ok();
+    }
+
     // Check if path exists
     std::error_code ec;
     if (!std::filesystem::exists(resolved.full_path, ec))
@@ -137,7 +205,7 @@ void FindCommand::findRecursive(const std::string& path, const FindOptions& opti
             options.name_pattern.empty() ||
             matchesPattern(filename, options.name_pattern, options.case_insensitive);
 
-        if (type_matches && name_matches)
+        if (type_matches && name_matches && (!options.hasBounds() || withinBounds(path, options)))
         {
             if (context.use_colors)
             {
@@ -167,7 +235,7 @@ void FindCommand::findRecursive(const std::string& path, const FindOptions& opti
         bool name_matches = options.name_pattern.empty() ||
                             matchesPattern(dirname, options.name_pattern, options.case_insensitive);
 
-        if (type_matches && name_matches)
+        if (type_matches && name_matches && (!options.hasBounds() || withinBounds(path, options)))
         {
             if (context.use_colors)
             {
@@ -217,7 +285,8 @@ void FindCommand::findRecursive(const std::string& path, const FindOptions& opti
                     options.name_pattern.empty() ||
                     matchesPattern(filename, options.name_pattern, options.case_insensitive);
 
-                if (type_matches && name_matches)
+                if (type_matches && name_matches &&
+                    (!options.hasBounds() || withinBounds(entry_path, options)))
                 {
                     if (context.use_colors)
                     {
@@ -237,6 +306,277 @@ void FindCommand::findRecursive(const std::string& path, const FindOptions& opti
     }
 }
 
+void FindCommand::findVirtual(const ResolvedPath& start, const FindOptions& options,
+                              const CommandContext& context)
+{
+    EncryptedMount* mount = start.mount;
+    auto within = [&options](const VirtualFileInfo& info)
+    {
+        return info.size >= options.min_size && info.size <= options.max_size &&
+               info.mtime >= options.min_mtime && info.mtime <= options.max_mtime;
+    };
+    auto matches = [&](const VirtualFileInfo& info)
+    {
+        return (options.name_pattern.empty() ||
+                matchesPattern(info.name, options.name_pattern, options.case_insensitive)) &&
+               within(info);
+    };
+    auto display = [&start](const std::string& path)
+    {
+        if (start.mount_point == "/")
+        {
+            return path;
+        }
+        return path == "/" ? start.mount_point : start.mount_point + path;
+    };
+    auto print = [&](const VirtualFileInfo& info)
+    {
+        if (info.is_directory && context.use_colors)
+        {
+            fmt::print(fg(fmt::color::blue) | fmt::emphasis::bold, "{}\n", display(info.path));
+        }
+        else
+        {
+            fmt::print("{}\n", display(info.path));
+        }
+    };
+
+    VirtualFileInfo root;
+    if (!mount->stat(start.relative_path, root))
+    {
+        return;
+    }
+    if (!root.is_directory)
+    {
+        if (options.type != FileType::Directory && matches(root))
+        {
+            print(root);
+        }
+        return;
+    }
+
+    // The start directory is at depth 0; a mount root is named after its mount point
+    if (options.type != FileType::File)
+    {
+        std::string shown = display(root.path);
+        root.name = shown.substr(shown.find_last_of('/') + 1);
+        if (matches(root))
+        {
+            print(root);
+        }
+    }
+
+    std::vector<VirtualFileInfo> entries;
+    if (options.type != FileType::File)
+    {
+        // walkTree() lists all directories before any file; stop at the first file
+        mount->walkTree(start.relative_path,
+                        [&entries](const VirtualFileInfo& info)
+                        {
+                            if (!info.is_directory)
+                            {
+                                return false;
+                            }
+                            entries.push_back(info);
+                            return true;
+                        });
+    }
+    if (options.type != FileType::Directory)
+    {
+        // The size and time predicates are evaluated by the mount's indexes
+        FileQuery query;
+        query.path = start.relative_path;
+        query.min_size = options.min_size;
+        query.max_size = options.max_size;
+        query.min_mtime = options.min_mtime;
+        query.max_mtime = options.max_mtime;
+        std::vector<VirtualFileInfo> files;
+        mount->findFiles(query, files);
+        entries.insert(entries.end(), std::make_move_iterator(files.begin()),
+                       std::make_move_iterator(files.end()));
+    }
+    std::sort(entries.begin(), entries.end(),
+              [](const VirtualFileInfo& a, const VirtualFileInfo& b)
+              {
+                  return a.path < b.path;
+              });
+
+    size_t base_length = start.relative_path == "/" ? 0 : start.relative_path.size();
+    for (const auto& info : entries)
+    {
+        // Entries directly in the start directory are at depth 1
+        int depth = static_cast<int>(
+            std::count(info.path.begin() + static_cast<std::ptrdiff_t>(base_length),
+                       info.path.end(), '/'));
+        if ((options.max_depth >= 0 && depth > options.max_depth) || !matches(info))
+        {
+            continue;
+        }
+        print(info);
+    }
+}
+
+bool FindCommand::parseSize(const std::string& arg, FindOptions& options)
+{
+    std::string value = arg;
+    char sign = 0;
+    if (!value.empty() && (value[0] == '+' || value[0] == '-'))
+    {
+        sign = value[0];
+        value.erase(0, 1);
+    }
+
+    int64_t unit = 512;
+    if (!value.empty() && !std::isdigit(static_cast<unsigned char>(value.back())))
+    {
+        switch (value.back())
+        {
+        case 'c':
+            unit = 1;
+            break;
+        case 'w':
+            unit = 2;
+            break;
+        case 'b':
+            unit = 512;
+            break;
+        case 'k':
+            unit = 1024;
+            break;
+        case 'M':
+            unit = 1024 * 1024;
+            break;
+        case 'G':
+            unit = 1024 * 1024 * 1024;
+            break;
+        default:
+            return false;
+        }
+        value.pop_back();
+    }
+    if (value.empty() || value.size() > 18 ||
+        !std::all_of(value.begin(), value.end(),
+                     [](unsigned char c)
+                     {
+                         return std::isdigit(c);
+                     }))
+    {
+        return false;
+    }
+    int64_t n = std::stoll(value);
+    if (n > std::numeric_limits<int64_t>::max() / unit - 1)
+    {
+        return false;
+    }
+
+    // Like find, sizes are rounded up to whole units before comparing
+    int64_t low = 0;
+    int64_t high = std::numeric_limits<int64_t>::max();
+    if (sign == '+')
+    {
+        low = n * unit + 1;
+    }
+    else if (sign == '-')
+    {
+        high = n == 0 ? -1 : (n - 1) * unit;
+    }
+    else
+    {
+        low = n == 0 ? 0 : (n - 1) * unit + 1;
+        high = n * unit;
+    }
+    options.min_size = std::max(options.min_size, low);
+    options.max_size = std::min(options.max_size, high);
+    return true;
+}
+
+bool FindCommand::parseMtime(const std::string& arg, FindOptions& options)
+{
+    std::string value = arg;
+    char sign = 0;
+    if (!value.empty() && (value[0] == '+' || value[0] == '-'))
+    {
+        sign = value[0];
+        value.erase(0, 1);
+    }
+    if (value.empty() || value.size() > 6 ||
+        !std::all_of(value.begin(), value.end(),
+                     [](unsigned char c)
+                     {
+                         return std::isdigit(c);
+                     }))
+    {
+        return false;
+    }
+    int64_t n = std::stoll(value);
+
+    // Like find, the age is counted in whole days, rounding down
+    const int64_t day =
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::hours(24))
+            .count();
+    const int64_t now = std::chrono::system_clock::now().time_since_epoch().count();
+    if (n + 1 > now / day)
+    {
+        return false;
+    }
+
+    int64_t low = std::numeric_limits<int64_t>::min();
+    int64_t high = std::numeric_limits<int64_t>::max();
+    if (sign == '+')
+    {
+        high = now - (n + 1) * day;
+    }
+    else if (sign == '-')
+    {
+        low = now - n * day + 1;
+    }
+    else
+    {
+        low = now - (n + 1) * day + 1;
+        high = now - n * day;
+    }
+    options.min_mtime = std::max(options.min_mtime, low);
+    options.max_mtime = std::min(options.max_mtime, high);
+    return true;
+}
+
+bool FindCommand::modificationTime(const std::string& path, int64_t& mtime)
+{
+    auto& vfs = VirtualFilesystem::getInstance();
+    auto resolved = vfs.resolvePath(path);
+    if (resolved.type == PathType::Virtual)
+    {
+        VirtualFileInfo info;
+        if (!vfs.stat(resolved.full_path, info))
+        {
+            return false;
+        }
+        mtime = info.mtime;
+        return true;
+    }
+
+    struct stat st;
+    if (::stat(resolved.full_path.c_str(), &st) != 0)
+    {
+        return false;
+    }
+    mtime = toSystemTicks(st);
+    return true;
+}
+
+bool FindCommand::withinBounds(const std::string& path, const FindOptions& options)
+{
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0)
+    {
+        return false;
+    }
+    int64_t size = static_cast<int64_t>(st.st_size);
+    int64_t mtime = toSystemTicks(st);
+    return size >= options.min_size && size <= options.max_size && mtime >= options.min_mtime &&
+           mtime <= options.max_mtime;
+}
+
 bool FindCommand::matchesPattern(const std::string& filename, const std::string& pattern,
                                  bool case_insensitive)
 {
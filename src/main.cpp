@@ -68,7 +68,10 @@
 #include <fmt/core.h>
 
 #include <CLI/CLI.hpp>
+#include <algorithm>
+#include <future>
 #include <iostream>
+#include <vector>
 
 int main(int argc, char** argv)
 {
@@ -144,8 +147,19 @@ int main(int argc, char** argv)
         }
     }
 
-    // Auto-mount encrypted mounts from config
+    // Auto-mount encrypted mounts from config. Passwords are collected first
+    // (prompting is sequential); the key derivations then run in parallel,
+    // or on first access for lazy mounts.
     auto& vfs = VirtualFilesystem::getInstance();
+    struct PendingMount
+    {
+        std::shared_ptr<EncryptedMount> mount;
+        std::string password;
+        bool lazy;
+        std::future<bool> mounted;
+    };
+    std::vector<PendingMount> pending;
+
     for (const auto& mount_config : config.encrypted_mounts)
     {
         if (!mount_config.auto_mount)
@@ -154,8 +168,22 @@ int main(int argc, char** argv)
         }
 
         std::string expanded_path = config.expandPath(mount_config.db_path);
-        auto mount = std::make_shared<EncryptedMount>(
-            mount_config.name, expanded_path, mount_config.mount_point, mount_config.max_size_mb);
+        MountOptions options;
+        options.chunk_cache_bytes = mount_config.cache_size_mb * 1024 * 1024;
+        options.dedup = mount_config.dedup;
+        options.compression_level = mount_config.compression_level;
+        options.text_index = mount_config.text_index;
+        options.read_connections = mount_config.read_connections;
+        options.journal_mode = mount_config.journal_mode;
+        options.synchronous = mount_config.synchronous;
+        options.page_cache_kb = mount_config.page_cache_kb;
+        options.mmap_size_mb = mount_config.mmap_size_mb;
+        options.cipher_page_size = mount_config.cipher_page_size;
+        options.kdf_iter = mount_config.kdf_iter;
+        auto mount =
+            std::make_shared<EncryptedMount>(mount_config.name, expanded_path,
+                                             mount_config.mount_point, mount_config.max_size_mb,
+                                             options);
 
         // Get password - prompt if not in config or empty
         std::string password = mount_config.password;
@@ -185,20 +213,39 @@ int main(int argc, char** argv)
             }
         }
 
-        if (mount->mount(password))
+        pending.push_back({mount, std::move(password), mount_config.lazy_unlock, {}});
+    }
+
+    for (auto& entry : pending)
+    {
+        if (!entry.lazy)
+        {
+            entry.mounted = std::async(std::launch::async, [&entry]
+                                       { return entry.mount->mount(entry.password); });
+        }
+    }
+
+    // Register in config order regardless of which derivation finished first
+    for (auto& entry : pending)
+    {
+        bool mounted = entry.lazy ? entry.mount->mountLazily(entry.password)
+                                  : entry.mounted.get();
+        if (mounted)
         {
-            vfs.addMount(mount);
+            vfs.addMount(entry.mount);
             if (verbose)
             {
-                fmt::print("Auto-mounted '{}' at '{}'\n", mount_config.name,
-                           mount_config.mount_point);
+                fmt::print("{} '{}' at '{}'\n",
+                           entry.lazy ? "Registered (unlocks on first access)" : "Auto-mounted",
+                           entry.mount->getName(), entry.mount->getMountPoint());
             }
         }
         else
         {
             fmt::print(stderr, "Warning: Failed to auto-mount '{}' (incorrect password?)\n",
-                       mount_config.name);
+                       entry.mount->getName());
         }
+        std::fill(entry.password.begin(), entry.password.end(), '\0');
     }
 
     // Display mounted volumes if any
@@ -216,7 +263,8 @@ int main(int argc, char** argv)
             auto* mount = vfs.getMount(name);
             if (mount)
             {
-                fmt::print("  • {} → {}\n", mount->getMountPoint(), name);
+                fmt::print("  • {} → {}{}\n", mount->getMountPoint(), name,
+                           mount->isUnlockPending() ? " (unlocks on first access)" : "");
             }
         }
         fmt::print("\n");
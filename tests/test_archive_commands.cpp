@@ -3,6 +3,8 @@
 #include <homeshell/commands/UnzipCommand.hpp>
 #include <homeshell/commands/ZipInfoCommand.hpp>
 #include <homeshell/VirtualFilesystem.hpp>
+#include <chrono>
+#include <ctime>
 #include <filesystem>
 #include <fstream>
 
@@ -127,6 +129,41 @@ TEST_F(ArchiveCommandsTest, ZipCreateArchiveWithDirectory)
     EXPECT_TRUE(std::filesystem::exists("test.zip"));
 }
 
+TEST_F(ArchiveCommandsTest, ZipStoresModificationTimes)
+{
+    // Even, since ZIP stores times with two-second resolution
+    const std::time_t stamp = 1577836800; // 2020-01-01T00:00:00Z
+    std::filesystem::last_write_time(
+        "file1.txt", std::filesystem::file_time_type::clock::from_sys(
+                         std::chrono::system_clock::from_time_t(stamp)));
+
+    auto& vfs = VirtualFilesystem::getInstance();
+    auto mount = std::make_shared<EncryptedMount>("zip_test", (test_dir_ / "zip.db").string(),
+                                                  "/zipvirt", 10);
+    ASSERT_TRUE(mount->mount("password"));
+    ASSERT_TRUE(vfs.addMount(mount));
+    std::time_t before = std::time(nullptr);
+    ASSERT_TRUE(vfs.writeFile("/zipvirt/note.txt", "virtual"));
+
+    ZipCommand cmd;
+    CommandContext ctx;
+    ctx.args = {"times.zip", "file1.txt", "/zipvirt/note.txt"};
+    EXPECT_TRUE(cmd.execute(ctx).isSuccess());
+    vfs.removeMount("zip_test");
+
+    mz_zip_archive zip;
+    memset(&zip, 0, sizeof(zip));
+    ASSERT_TRUE(mz_zip_reader_init_file(&zip, "times.zip", 0));
+    ASSERT_EQ(mz_zip_reader_get_num_files(&zip), 2u);
+    mz_zip_archive_file_stat stat;
+    ASSERT_TRUE(mz_zip_reader_file_stat(&zip, 0, &stat));
+    EXPECT_EQ(stat.m_time, stamp);
+    ASSERT_TRUE(mz_zip_reader_file_stat(&zip, 1, &stat));
+    EXPECT_GE(stat.m_time, before - 2);
+    EXPECT_LE(stat.m_time, std::time(nullptr) + 2);
+    mz_zip_reader_end(&zip);
+}
+
 TEST_F(ArchiveCommandsTest, ZipInsufficientArguments)
 {
     ZipCommand cmd;
@@ -0,0 +1,147 @@
+#include <homeshell/ChunkCache.hpp>
+#include <gtest/gtest.h>
+
+using homeshell::ChunkCache;
+
+namespace
+{
+
+ChunkCache::Block block(size_t size, char fill = 'x')
+{
+    return std::make_shared<const std::string>(size, fill);
+}
+
+} // namespace
+
+TEST(ChunkCacheTest, LookupCountsHitsAndMisses)
+{
+    ChunkCache cache(1024);
+
+    EXPECT_EQ(cache.lookup(1, 0), nullptr);
+    cache.insert(1, 0, block(10, 'a'));
+    auto found = cache.lookup(1, 0);
+    ASSERT_NE(found, nullptr);
+    EXPECT_EQ(*found, std::string(10, 'a'));
+
+    auto stats = cache.getStats();
+    EXPECT_EQ(stats.hits, 1u);
+    EXPECT_EQ(stats.misses, 1u);
+    EXPECT_EQ(stats.bytes, 10);
+    EXPECT_EQ(stats.budget, 1024);
+}
+
+TEST(ChunkCacheTest, EvictsLeastRecentlyUsedByBytes)
+{
+    ChunkCache cache(300);
+
+    cache.insert(1, 0, block(100));
+    cache.insert(1, 1, block(100));
+    cache.insert(1, 2, block(100));
+    EXPECT_NE(cache.lookup(1, 0), nullptr); // chunk 1 is now least recent
+    cache.insert(2, 0, block(100));
+
+    EXPECT_TRUE(cache.contains(1, 0));
+    EXPECT_FALSE(cache.contains(1, 1));
+    EXPECT_TRUE(cache.contains(1, 2));
+    EXPECT_TRUE(cache.contains(2, 0));
+
+    auto stats = cache.getStats();
+    EXPECT_EQ(stats.bytes, 300);
+    EXPECT_EQ(stats.evictions, 1u);
+}
+
+TEST(ChunkCacheTest, ReplacingAChunkKeepsByteCountExact)
+{
+    ChunkCache cache(1024);
+
+    cache.insert(1, 0, block(100));
+    cache.insert(1, 0, block(40, 'b'));
+
+    EXPECT_EQ(cache.getStats().bytes, 40);
+    EXPECT_EQ(*cache.lookup(1, 0), std::string(40, 'b'));
+}
+
+TEST(ChunkCacheTest, InvalidateFileDropsOnlyThatFile)
+{
+    ChunkCache cache(1024);
+
+    cache.insert(1, 0, block(10));
+    cache.insert(1, 1, block(10));
+    cache.insert(2, 0, block(10));
+    cache.invalidate(2, 0);
+    cache.insert(2, 1, block(10));
+
+    cache.invalidateFile(1);
+
+    EXPECT_FALSE(cache.contains(1, 0));
+    EXPECT_FALSE(cache.contains(1, 1));
+    EXPECT_FALSE(cache.contains(2, 0));
+    EXPECT_TRUE(cache.contains(2, 1));
+    EXPECT_EQ(cache.getStats().bytes, 10);
+}
+
+TEST(ChunkCacheTest, ReadAheadInsertsAreCounted)
+{
+    ChunkCache cache(1024);
+
+    cache.insert(1, 0, block(10));
+    cache.insert(1, 1, block(10), true);
+    cache.insert(1, 2, block(10), true);
+
+    EXPECT_EQ(cache.getStats().read_ahead, 2u);
+}
+
+TEST(ChunkCacheTest, ZeroBudgetDisablesCaching)
+{
+    ChunkCache cache(0);
+
+    cache.insert(1, 0, block(10));
+    EXPECT_FALSE(cache.contains(1, 0));
+    EXPECT_EQ(cache.getStats().bytes, 0);
+
+    cache.setBudget(100);
+    cache.insert(1, 0, block(10));
+    cache.insert(1, 1, block(200)); // larger than the whole budget
+    EXPECT_TRUE(cache.contains(1, 0));
+    EXPECT_FALSE(cache.contains(1, 1));
+
+    cache.setBudget(0);
+    EXPECT_FALSE(cache.contains(1, 0));
+    EXPECT_EQ(cache.getStats().bytes, 0);
+}
+
+TEST(ChunkCacheTest, InsertFromOlderGenerationIsDropped)
+{
+    ChunkCache cache(1024);
+
+    uint64_t before = cache.generation();
+    cache.invalidate(1, 5); // a writer changed something meanwhile
+    cache.insert(1, 0, block(10), false, before);
+    EXPECT_FALSE(cache.contains(1, 0));
+
+    uint64_t current = cache.generation();
+    cache.insert(1, 0, block(10), false, current);
+    EXPECT_TRUE(cache.contains(1, 0));
+
+    cache.advanceGeneration();
+    cache.insert(1, 1, block(10), false, current);
+    EXPECT_FALSE(cache.contains(1, 1));
+}
+
+TEST(ChunkCacheTest, HolesAreNotCached)
+{
+    ChunkCache cache(1024);
+
+    for (int64_t idx = 0; idx < 10000; ++idx)
+    {
+        cache.insert(1, idx, block(0));
+    }
+    EXPECT_FALSE(cache.contains(1, 0));
+    EXPECT_EQ(cache.getStats().bytes, 0);
+
+    // A chunk that became a hole does not keep its old content
+    cache.insert(2, 0, block(10));
+    cache.insert(2, 0, block(0));
+    EXPECT_FALSE(cache.contains(2, 0));
+    EXPECT_EQ(cache.getStats().bytes, 0);
+}
@@ -48,3 +48,42 @@ TEST(ConfigTest, LoadFromFileWithMissingField)
     std::remove(temp_file.c_str());
 }
 
+TEST(ConfigTest, LoadMountTuning)
+{
+    std::string temp_file = "/tmp/test_config_tuning.json";
+    {
+        std::ofstream file(temp_file);
+        file << R"({"encrypted_mounts": [{"name": "usb", "journal_mode": "DELETE",
+                    "synchronous": "FULL", "page_cache_kb": 4096, "mmap_size_mb": 64,
+                    "cipher_page_size": 16384, "kdf_iter": 64000}]})";
+    }
+
+    Config config = Config::loadFromFile(temp_file);
+    ASSERT_EQ(config.encrypted_mounts.size(), 1u);
+    const auto& mount = config.encrypted_mounts[0];
+    EXPECT_EQ(mount.journal_mode, "DELETE");
+    EXPECT_EQ(mount.synchronous, "FULL");
+    EXPECT_EQ(mount.page_cache_kb, 4096);
+    EXPECT_EQ(mount.mmap_size_mb, 64);
+    EXPECT_EQ(mount.cipher_page_size, 16384);
+    EXPECT_EQ(mount.kdf_iter, 64000);
+
+    std::remove(temp_file.c_str());
+}
+
+TEST(ConfigTest, LoadMountTextIndex)
+{
+    std::string temp_file = "/tmp/test_config_text_index.json";
+    {
+        std::ofstream file(temp_file);
+        file << R"({"encrypted_mounts": [{"name": "docs", "text_index": true},
+                                         {"name": "media"}]})";
+    }
+
+    Config config = Config::loadFromFile(temp_file);
+    ASSERT_EQ(config.encrypted_mounts.size(), 2u);
+    EXPECT_TRUE(config.encrypted_mounts[0].text_index);
+    EXPECT_FALSE(config.encrypted_mounts[1].text_index); // off unless asked for
+
+    std::remove(temp_file.c_str());
+}
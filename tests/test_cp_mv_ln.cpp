@@ -168,6 +168,82 @@ TEST_F(CpCommandTest, MultipleFiles)
     EXPECT_TRUE(fs::exists(dst_dir + "/file2.txt"));
 }
 
+TEST_F(CpCommandTest, RecursiveCopyIntoVirtualMount)
+{
+    std::string src_dir = test_dir + "/src_dir";
+    fs::create_directories(src_dir + "/nested");
+    createFile(src_dir + "/file1.txt", "content1");
+    createFile(src_dir + "/nested/file2.txt", "content2");
+
+    auto& vfs = VirtualFilesystem::getInstance();
+    auto mount = std::make_shared<EncryptedMount>("cp_test", test_dir + "/cp.db", "/cpvirt", 10);
+    ASSERT_TRUE(mount->mount("password"));
+    ASSERT_TRUE(vfs.addMount(mount));
+
+    CommandContext ctx;
+    ctx.args = {"-r", src_dir, "/cpvirt"};
+    auto status = cmd.execute(ctx);
+    EXPECT_TRUE(status.isOk());
+
+    std::string content;
+    EXPECT_TRUE(vfs.readFile("/cpvirt/src_dir/file1.txt", content));
+    EXPECT_EQ(content, "content1");
+    EXPECT_TRUE(vfs.readFile("/cpvirt/src_dir/nested/file2.txt", content));
+    EXPECT_EQ(content, "content2");
+
+    // And back out to the real filesystem
+    ctx.args = {"/cpvirt/src_dir/nested/file2.txt", test_dir + "/copied.txt"};
+    EXPECT_TRUE(cmd.execute(ctx).isOk());
+    EXPECT_TRUE(fs::exists(test_dir + "/copied.txt"));
+
+    vfs.removeMount("cp_test");
+}
+
+TEST_F(CpCommandTest, DirectoryIntoItselfRefused)
+{
+    std::string src_dir = test_dir + "/src_dir";
+    fs::create_directory(src_dir);
+    createFile(src_dir + "/file1.txt", "content1");
+
+    CommandContext ctx;
+    ctx.args = {"-r", src_dir, src_dir + "/sub"};
+    EXPECT_TRUE(cmd.execute(ctx).isOk());
+    EXPECT_FALSE(fs::exists(src_dir + "/sub"));
+
+    // A sibling whose name starts with the source is not inside it
+    ctx.args = {"-r", src_dir, test_dir + "/src_dir2"};
+    EXPECT_TRUE(cmd.execute(ctx).isOk());
+    EXPECT_TRUE(fs::exists(test_dir + "/src_dir2/file1.txt"));
+}
+
+TEST_F(CpCommandTest, VirtualDirectoryIntoItselfRefused)
+{
+    auto& vfs = VirtualFilesystem::getInstance();
+    auto mount = std::make_shared<EncryptedMount>("cp_self", test_dir + "/self.db", "/cpself", 10);
+    ASSERT_TRUE(mount->mount("password"));
+    ASSERT_TRUE(vfs.addMount(mount));
+    ASSERT_TRUE(vfs.createDirectory("/cpself/dir"));
+    ASSERT_TRUE(vfs.writeFile("/cpself/dir/file.txt", "content"));
+
+    // Into itself, below itself and through a non-normalized path
+    CommandContext ctx;
+    for (const char* dest : {"/cpself/dir", "/cpself/dir/sub", "/cpself/./dir/"})
+    {
+        ctx.args = {"-r", "/cpself/dir", dest};
+        EXPECT_TRUE(cmd.execute(ctx).isOk());
+    }
+    EXPECT_FALSE(vfs.exists("/cpself/dir/dir"));
+    EXPECT_FALSE(vfs.exists("/cpself/dir/sub"));
+
+    ctx.args = {"-r", "/cpself/dir", "/cpself/copy"};
+    EXPECT_TRUE(cmd.execute(ctx).isOk());
+    std::string content;
+    EXPECT_TRUE(vfs.readFile("/cpself/copy/file.txt", content));
+    EXPECT_EQ(content, "content");
+
+    vfs.removeMount("cp_self");
+}
+
 TEST_F(CpCommandTest, HelpOption)
 {
     CommandContext ctx;
@@ -343,6 +419,33 @@ TEST_F(MvCommandTest, HelpOption)
     EXPECT_NE(getOutput().find("Move or rename"), std::string::npos);
 }
 
+TEST_F(MvCommandTest, MoveWithinVirtualMount)
+{
+    auto& vfs = VirtualFilesystem::getInstance();
+    auto mount = std::make_shared<EncryptedMount>("mv_test", test_dir + "/mv.db", "/mvvirt", 10);
+    ASSERT_TRUE(mount->mount("password"));
+    ASSERT_TRUE(vfs.addMount(mount));
+    vfs.writeFile("/mvvirt/project/src/main.cpp", "int main() {}");
+    vfs.createDirectory("/mvvirt/archive");
+
+    CommandContext ctx;
+    ctx.args = {"/mvvirt/project", "/mvvirt/archive"};
+    EXPECT_TRUE(cmd.execute(ctx).isOk());
+
+    std::string content;
+    EXPECT_FALSE(vfs.exists("/mvvirt/project"));
+    EXPECT_TRUE(vfs.readFile("/mvvirt/archive/project/src/main.cpp", content));
+    EXPECT_EQ(content, "int main() {}");
+
+    // Leaving the mount is refused rather than half done
+    ctx.args = {"/mvvirt/archive/project/src/main.cpp", test_dir + "/main.cpp"};
+    EXPECT_TRUE(cmd.execute(ctx).isOk());
+    EXPECT_FALSE(fs::exists(test_dir + "/main.cpp"));
+    EXPECT_TRUE(vfs.exists("/mvvirt/archive/project/src/main.cpp"));
+
+    vfs.removeMount("mv_test");
+}
+
 // ============================================================================
 // LnCommand Tests
 // ============================================================================
@@ -1,6 +1,13 @@
 #include <homeshell/EncryptedMount.hpp>
 #include <gtest/gtest.h>
 #include <filesystem>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <random>
+#include <thread>
+#include <vector>
 
 namespace fs = std::filesystem;
 
@@ -24,6 +31,87 @@ protected:
         }
     }
 
+    /**
+     * @brief Create a database in the layout of an earlier schema version
+     * @param version 4 to 7
+     * @param extra_sql Run after the schema, e.g. to plant a conflict
+     *
+     * @details Holds /docs/note.txt ("note") and /root.txt ("root"), with
+     *          usage counters as that version maintained them.
+     */
+    void createDatabaseAtVersion(int version, const std::string& extra_sql = "")
+    {
+        std::string chunk_columns = version >= 6   ? ", blob_id INTEGER, compressed INTEGER NOT "
+                                                     "NULL DEFAULT 0"
+                                    : version >= 5 ? ", blob_id INTEGER"
+                                                   : "";
+        std::string sql =
+            "CREATE TABLE files (id INTEGER PRIMARY KEY, path TEXT NOT NULL UNIQUE, "
+            "parent TEXT NOT NULL, size INTEGER NOT NULL DEFAULT 0, mtime INTEGER);"
+            "CREATE INDEX idx_files_parent ON files(parent);"
+            "CREATE TABLE chunks (file_id INTEGER NOT NULL, idx INTEGER NOT NULL, data BLOB" +
+            chunk_columns +
+            ", PRIMARY KEY (file_id, idx));"
+            "CREATE TABLE directories (path TEXT PRIMARY KEY, parent TEXT, mtime INTEGER);"
+            "CREATE TABLE usage (id INTEGER PRIMARY KEY CHECK (id = 1), used_bytes INTEGER "
+            "NOT NULL, file_count INTEGER NOT NULL, dir_count INTEGER NOT NULL" +
+            std::string(version >= 5 ? ", stored_bytes INTEGER NOT NULL DEFAULT 0" : "") +
+            ");"
+            "INSERT INTO directories VALUES ('/', '', 0);"
+            "INSERT INTO directories VALUES ('/docs', '/', 0);"
+            "INSERT INTO files (id, path, parent, size, mtime) VALUES (1, '/root.txt', '/', 4, 0);"
+            "INSERT INTO chunks (file_id, idx, data) VALUES (1, 0, 'root');"
+            "INSERT INTO files (id, path, parent, size, mtime) "
+            "VALUES (2, '/docs/note.txt', '/docs', 4, 0);"
+            "INSERT INTO chunks (file_id, idx, data) VALUES (2, 0, 'note');";
+        if (version >= 5)
+        {
+            std::string blobs_columns = version >= 6 ? ", compressed INTEGER NOT NULL DEFAULT 0"
+                                                     : "";
+            sql += "CREATE TABLE blobs (id INTEGER PRIMARY KEY, data BLOB NOT NULL" +
+                   blobs_columns +
+                   ");"
+                   "CREATE TABLE blob_refs (blob_id INTEGER PRIMARY KEY, hash BLOB NOT NULL "
+                   "UNIQUE, size INTEGER NOT NULL, refs INTEGER NOT NULL DEFAULT 0);"
+                   "INSERT INTO usage VALUES (1, 8, 2, 1, 8);";
+        }
+        else
+        {
+            // Counters that a version 4 database may have let drift
+            sql += "INSERT INTO usage VALUES (1, 0, 0, 0);";
+        }
+        sql += "PRAGMA user_version = " + std::to_string(version) + ";" + extra_sql;
+
+        sqlite3* db = nullptr;
+        ASSERT_EQ(sqlite3_open(db_path_.string().c_str(), &db), SQLITE_OK);
+        sqlite3_key(db, password_.c_str(), static_cast<int>(password_.size()));
+        EXPECT_EQ(sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr), SQLITE_OK)
+            << sqlite3_errmsg(db);
+        sqlite3_close(db);
+    }
+
+    /**
+     * @brief Read PRAGMA user_version of the test database
+     */
+    int schemaVersion()
+    {
+        sqlite3* db = nullptr;
+        int version = -1;
+        if (sqlite3_open(db_path_.string().c_str(), &db) == SQLITE_OK)
+        {
+            sqlite3_key(db, password_.c_str(), static_cast<int>(password_.size()));
+            sqlite3_stmt* stmt = nullptr;
+            if (sqlite3_prepare_v2(db, "PRAGMA user_version", -1, &stmt, nullptr) == SQLITE_OK &&
+                sqlite3_step(stmt) == SQLITE_ROW)
+            {
+                version = sqlite3_column_int(stmt, 0);
+            }
+            sqlite3_finalize(stmt);
+        }
+        sqlite3_close(db);
+        return version;
+    }
+
     fs::path test_dir_;
     fs::path db_path_;
     std::string password_;
@@ -217,3 +305,1499 @@ TEST_F(EncryptedMountTest, AutoCreateParentDirectory)
     EXPECT_TRUE(fs::exists(nested_path));
 }
 
+TEST_F(EncryptedMountTest, LargeFileSpansMultipleChunks)
+{
+    homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10);
+    ASSERT_TRUE(mount.mount(password_));
+
+    std::string content;
+    for (int64_t i = 0; i < homeshell::EncryptedMount::kChunkSize * 3 + 123; ++i)
+    {
+        content.push_back(static_cast<char>('a' + i % 26));
+    }
+
+    EXPECT_TRUE(mount.writeFile("/big.bin", content));
+    EXPECT_EQ(mount.getFileSize("/big.bin"), static_cast<int64_t>(content.size()));
+
+    std::string read_content;
+    EXPECT_TRUE(mount.readFile("/big.bin", read_content));
+    EXPECT_EQ(read_content, content);
+
+    // Overwriting with a shorter file must drop the stale chunks
+    EXPECT_TRUE(mount.writeFile("/big.bin", "short"));
+    EXPECT_TRUE(mount.readFile("/big.bin", read_content));
+    EXPECT_EQ(read_content, "short");
+}
+
+TEST_F(EncryptedMountTest, ReadFileRange)
+{
+    homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10);
+    ASSERT_TRUE(mount.mount(password_));
+
+    const int64_t chunk = homeshell::EncryptedMount::kChunkSize;
+    std::string content(static_cast<size_t>(chunk * 2), 'x');
+    content[chunk - 1] = 'A';
+    content[chunk] = 'B';
+    ASSERT_TRUE(mount.writeFile("/range.bin", content));
+
+    std::string part;
+    EXPECT_TRUE(mount.readFileRange("/range.bin", chunk - 1, 2, part));
+    EXPECT_EQ(part, "AB");
+
+    EXPECT_TRUE(mount.readFileRange("/range.bin", chunk * 2 - 1, 100, part));
+    EXPECT_EQ(part, "x");
+
+    EXPECT_TRUE(mount.readFileRange("/range.bin", chunk * 5, 10, part));
+    EXPECT_TRUE(part.empty());
+
+    EXPECT_FALSE(mount.readFileRange("/missing.bin", 0, 10, part));
+}
+
+TEST_F(EncryptedMountTest, WriteFileRange)
+{
+    homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10);
+    ASSERT_TRUE(mount.mount(password_));
+
+    const int64_t chunk = homeshell::EncryptedMount::kChunkSize;
+    ASSERT_TRUE(mount.writeFile("/data.bin", std::string(static_cast<size_t>(chunk + 10), 'x')));
+
+    // Patch across a chunk boundary
+    EXPECT_TRUE(mount.writeFileRange("/data.bin", chunk - 2, "1234"));
+    std::string content;
+    EXPECT_TRUE(mount.readFile("/data.bin", content));
+    EXPECT_EQ(content.size(), static_cast<size_t>(chunk + 10));
+    EXPECT_EQ(content.substr(chunk - 3, 6), "x1234x");
+
+    // Writing past the end leaves a zero-filled gap
+    EXPECT_TRUE(mount.writeFileRange("/data.bin", chunk * 3, "end"));
+    EXPECT_EQ(mount.getFileSize("/data.bin"), chunk * 3 + 3);
+    EXPECT_TRUE(mount.readFileRange("/data.bin", chunk * 2, chunk + 3, content));
+    EXPECT_EQ(content, std::string(static_cast<size_t>(chunk), '\0') + "end");
+
+    // Missing files are created
+    EXPECT_TRUE(mount.writeFileRange("/new/file.txt", 0, "hello"));
+    EXPECT_TRUE(mount.isDirectory("/new"));
+    EXPECT_TRUE(mount.readFile("/new/file.txt", content));
+    EXPECT_EQ(content, "hello");
+}
+
+TEST_F(EncryptedMountTest, AppendFile)
+{
+    homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10);
+    ASSERT_TRUE(mount.mount(password_));
+
+    // Missing files are created
+    EXPECT_TRUE(mount.appendFile("/logs/app.log", "first\n"));
+    EXPECT_TRUE(mount.isDirectory("/logs"));
+    EXPECT_TRUE(mount.appendFile("/logs/app.log", "second\n"));
+    std::string content;
+    EXPECT_TRUE(mount.readFile("/logs/app.log", content));
+    EXPECT_EQ(content, "first\nsecond\n");
+
+    // Appends that cross a chunk boundary
+    const int64_t chunk = homeshell::EncryptedMount::kChunkSize;
+    std::string expected(static_cast<size_t>(chunk - 3), 'a');
+    ASSERT_TRUE(mount.writeFile("/data.bin", expected));
+    for (char c : {'b', 'c', 'd'})
+    {
+        std::string piece(static_cast<size_t>(chunk / 2), c);
+        EXPECT_TRUE(mount.appendFile("/data.bin", piece));
+        expected += piece;
+    }
+    EXPECT_EQ(mount.getFileSize("/data.bin"), static_cast<int64_t>(expected.size()));
+    EXPECT_TRUE(mount.readFile("/data.bin", content));
+    EXPECT_EQ(content, expected);
+}
+
+TEST_F(EncryptedMountTest, WalkTreeVisitsSubtreeInPathOrder)
+{
+    homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10);
+    ASSERT_TRUE(mount.mount(password_));
+
+    // More entries than one page of the walk
+    mount.beginBatch();
+    for (int i = 0; i < 300; ++i)
+    {
+        ASSERT_TRUE(mount.writeFile("/a/files/f" + std::to_string(1000 + i), "x"));
+    }
+    mount.endBatch();
+    ASSERT_TRUE(mount.createDirectory("/a/empty"));
+    ASSERT_TRUE(mount.writeFile("/a.txt", "outside"));
+    ASSERT_TRUE(mount.writeFile("/ab/other.txt", "outside"));
+
+    std::vector<std::string> seen;
+    EXPECT_TRUE(mount.walkTree("/a",
+                               [&](const homeshell::VirtualFileInfo& info)
+                               {
+                                   seen.push_back(info.path);
+                                   return true;
+                               }));
+    ASSERT_EQ(seen.size(), 302u);
+    EXPECT_EQ(seen[0], "/a/empty");
+    EXPECT_EQ(seen[1], "/a/files");
+    EXPECT_EQ(seen[2], "/a/files/f1000");
+    EXPECT_EQ(seen.back(), "/a/files/f1299");
+    EXPECT_TRUE(std::is_sorted(seen.begin() + 2, seen.end()));
+
+    // The root walk sees everything; a visitor can stop it early
+    int count = 0;
+    EXPECT_TRUE(mount.walkTree("/", [&](const homeshell::VirtualFileInfo&) { return ++count; }));
+    EXPECT_EQ(count, 306);
+    EXPECT_FALSE(mount.walkTree("/", [](const homeshell::VirtualFileInfo&) { return false; }));
+    EXPECT_FALSE(mount.walkTree("/a.txt", [](const homeshell::VirtualFileInfo&) { return true; }));
+}
+
+TEST_F(EncryptedMountTest, FindFilesBySizeAndMtime)
+{
+    homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10);
+    ASSERT_TRUE(mount.mount(password_));
+
+    ASSERT_TRUE(mount.writeFile("/docs/small.txt", "tiny"));
+    ASSERT_TRUE(mount.writeFile("/docs/large.bin", std::string(5000, 'l')));
+    ASSERT_TRUE(mount.writeFile("/media/huge.bin", std::string(20000, 'h')));
+    ASSERT_TRUE(mount.writeFile("/docsx/large.bin", std::string(6000, 'o')));
+    auto before_update = std::chrono::system_clock::now().time_since_epoch().count();
+    ASSERT_TRUE(mount.writeFile("/docs/recent.txt", "new"));
+
+    auto paths = [](const std::vector<homeshell::VirtualFileInfo>& files)
+    {
+        std::vector<std::string> result;
+        for (const auto& info : files)
+        {
+            result.push_back(info.path);
+        }
+        return result;
+    };
+
+    std::vector<homeshell::VirtualFileInfo> files;
+    homeshell::FileQuery query;
+    ASSERT_TRUE(mount.findFiles(query, files));
+    EXPECT_EQ(files.size(), 5u);
+
+    query.min_size = 4096;
+    ASSERT_TRUE(mount.findFiles(query, files));
+    EXPECT_EQ(paths(files),
+              (std::vector<std::string>{"/docs/large.bin", "/docsx/large.bin", "/media/huge.bin"}));
+
+    query.path = "/docs";
+    query.max_size = 5000;
+    ASSERT_TRUE(mount.findFiles(query, files));
+    EXPECT_EQ(paths(files), std::vector<std::string>{"/docs/large.bin"});
+    EXPECT_EQ(files[0].size, 5000);
+
+    query = homeshell::FileQuery();
+    query.min_mtime = before_update;
+    ASSERT_TRUE(mount.findFiles(query, files));
+    EXPECT_EQ(paths(files), std::vector<std::string>{"/docs/recent.txt"});
+
+    query.min_mtime = std::numeric_limits<int64_t>::min();
+    query.max_mtime = before_update;
+    query.min_size = 1;
+    query.max_size = 10;
+    ASSERT_TRUE(mount.findFiles(query, files));
+    EXPECT_EQ(paths(files), std::vector<std::string>{"/docs/small.txt"});
+
+    query.path = "/docs/small.txt";
+    EXPECT_FALSE(mount.findFiles(query, files));
+}
+
+TEST_F(EncryptedMountTest, TextIndexFindsCandidates)
+{
+    // Written before the index exists, so indexed when it is created
+    {
+        homeshell::EncryptedMount plain("test", db_path_.string(), "/test", 10);
+        ASSERT_TRUE(plain.mount(password_));
+        ASSERT_TRUE(plain.writeFile("/notes/old.txt", "remember the Milk"));
+    }
+
+    homeshell::MountOptions options;
+    options.text_index = true;
+    auto mount = std::make_unique<homeshell::EncryptedMount>("test", db_path_.string(), "/test",
+                                                             10, options);
+    ASSERT_TRUE(mount->mount(password_));
+    ASSERT_TRUE(mount->writeFile("/notes/a.txt", "the quick brown fox"));
+    ASSERT_TRUE(mount->writeFile("/notes/b.txt", "lazy dog"));
+    ASSERT_TRUE(mount->writeFile("/other/c.txt", "Quick fox"));
+    ASSERT_TRUE(mount->writeFile("/notes/binary", std::string("\0quick", 6)));
+    auto big_size = static_cast<size_t>(homeshell::EncryptedMount::kMaxIndexedTextBytes + 1);
+    ASSERT_TRUE(mount->writeFile("/notes/big.txt", std::string(big_size, 'x')));
+
+    std::vector<std::string> paths;
+    auto candidates = [&](const std::string& path, const std::vector<std::string>& terms)
+    {
+        EXPECT_TRUE(mount->findTextCandidates(path, terms, paths));
+        return paths;
+    };
+    using Paths = std::vector<std::string>;
+
+    // Binary and oversized files are always candidates
+    EXPECT_EQ(candidates("/", {"QUICK"}),
+              (Paths{"/notes/a.txt", "/notes/big.txt", "/notes/binary", "/other/c.txt"}));
+    EXPECT_EQ(candidates("/notes", {"quick", "brown fox"}),
+              (Paths{"/notes/a.txt", "/notes/big.txt", "/notes/binary"}));
+    EXPECT_EQ(candidates("/", {"milk"}),
+              (Paths{"/notes/big.txt", "/notes/binary", "/notes/old.txt"}));
+    EXPECT_FALSE(mount->findTextCandidates("/", {"ab"}, paths));
+    EXPECT_FALSE(mount->findTextCandidates("/notes/a.txt", {"quick"}, paths));
+
+    // An append only marks the file stale: it matches any term until re-indexed
+    ASSERT_TRUE(mount->appendFile("/notes/b.txt", " jumps"));
+    EXPECT_EQ(candidates("/notes", {"dog jumps"}),
+              (Paths{"/notes/b.txt", "/notes/big.txt", "/notes/binary"}));
+    EXPECT_EQ(candidates("/notes", {"milk"}),
+              (Paths{"/notes/b.txt", "/notes/big.txt", "/notes/binary", "/notes/old.txt"}));
+
+    // Whole writes and removals keep the index current
+    ASSERT_TRUE(mount->remove("/notes/a.txt"));
+    ASSERT_TRUE(mount->writeFile("/notes/b.txt", "cat"));
+    ASSERT_TRUE(mount->remove("/notes/big.txt"));
+    ASSERT_TRUE(mount->remove("/notes/binary"));
+    EXPECT_EQ(candidates("/", {"fox"}), Paths{"/other/c.txt"});
+    EXPECT_EQ(candidates("/", {"jumps"}), Paths{});
+
+    // Mounting without the option keeps the index; enabling it again catches up
+    ASSERT_TRUE(mount->unmount());
+    {
+        homeshell::EncryptedMount plain("test", db_path_.string(), "/test", 10);
+        ASSERT_TRUE(plain.mount(password_));
+        EXPECT_FALSE(plain.findTextCandidates("/", {"fox"}, paths));
+        ASSERT_TRUE(plain.writeFile("/late.txt", "a late fox"));
+    }
+    mount = std::make_unique<homeshell::EncryptedMount>("test", db_path_.string(), "/test", 10,
+                                                        options);
+    ASSERT_TRUE(mount->mount(password_));
+    EXPECT_EQ(candidates("/", {"fox"}), (Paths{"/late.txt", "/other/c.txt"}));
+}
+
+TEST_F(EncryptedMountTest, TextIndexSurvivesMountWithoutIt)
+{
+    homeshell::MountOptions options;
+    options.text_index = true;
+    auto mount = std::make_unique<homeshell::EncryptedMount>("test", db_path_.string(), "/test",
+                                                             10, options);
+    ASSERT_TRUE(mount->mount(password_));
+    ASSERT_TRUE(mount->writeFile("/keep.txt", "an old fox"));
+    ASSERT_TRUE(mount->writeFile("/change.txt", "a red fox"));
+    ASSERT_TRUE(mount->writeFile("/gone.txt", "the last fox"));
+    ASSERT_TRUE(mount->unmount());
+
+    {
+        homeshell::EncryptedMount plain("test", db_path_.string(), "/test", 10);
+        ASSERT_TRUE(plain.mount(password_));
+        ASSERT_TRUE(plain.writeFileRange("/change.txt", 6, "hen"));
+        ASSERT_TRUE(plain.remove("/gone.txt"));
+        ASSERT_TRUE(plain.writeFile("/new.txt", "a new fox"));
+        ASSERT_TRUE(plain.unmount());
+    }
+
+    // Only the written files are listed for re-indexing
+    auto stale = [&]
+    {
+        sqlite3* db = nullptr;
+        std::vector<std::string> paths;
+        EXPECT_EQ(sqlite3_open(db_path_.string().c_str(), &db), SQLITE_OK);
+        sqlite3_key(db, password_.c_str(), static_cast<int>(password_.size()));
+        sqlite3_stmt* stmt = nullptr;
+        EXPECT_EQ(sqlite3_prepare_v2(db,
+                                     "SELECT f.path FROM file_text_stale s JOIN files f "
+                                     "ON f.id = s.file_id ORDER BY f.path",
+                                     -1, &stmt, nullptr),
+                  SQLITE_OK);
+        while (sqlite3_step(stmt) == SQLITE_ROW)
+        {
+            paths.emplace_back(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)));
+        }
+        sqlite3_finalize(stmt);
+        sqlite3_close(db);
+        return paths;
+    };
+    EXPECT_EQ(stale(), (std::vector<std::string>{"/change.txt", "/new.txt"}));
+
+    mount = std::make_unique<homeshell::EncryptedMount>("test", db_path_.string(), "/test", 10,
+                                                        options);
+    ASSERT_TRUE(mount->mount(password_));
+    std::vector<std::string> paths;
+    ASSERT_TRUE(mount->findTextCandidates("/", {"fox"}, paths));
+    EXPECT_EQ(paths, (std::vector<std::string>{"/keep.txt", "/new.txt"}));
+    ASSERT_TRUE(mount->findTextCandidates("/", {"red hen"}, paths));
+    EXPECT_EQ(paths, std::vector<std::string>{"/change.txt"});
+    ASSERT_TRUE(mount->unmount());
+    EXPECT_TRUE(stale().empty());
+}
+
+TEST_F(EncryptedMountTest, TextIndexDefersAppends)
+{
+    homeshell::MountOptions options;
+    options.text_index = true;
+    auto mount = std::make_unique<homeshell::EncryptedMount>("test", db_path_.string(), "/test",
+                                                             10, options);
+    ASSERT_TRUE(mount->mount(password_));
+    ASSERT_TRUE(mount->writeFile("/log.txt", "start\n"));
+    for (int i = 0; i < 50; ++i)
+    {
+        ASSERT_TRUE(mount->appendFile("/log.txt", "entry " + std::to_string(i) + "\n"));
+    }
+
+    // Still a candidate for terms it did not contain when last indexed
+    std::vector<std::string> paths;
+    ASSERT_TRUE(mount->findTextCandidates("/", {"entry 49"}, paths));
+    EXPECT_EQ(paths, std::vector<std::string>{"/log.txt"});
+    ASSERT_TRUE(mount->findTextCandidates("/", {"missing"}, paths));
+    EXPECT_EQ(paths, std::vector<std::string>{"/log.txt"});
+
+    // The next indexed mount reads it once
+    ASSERT_TRUE(mount->unmount());
+    mount = std::make_unique<homeshell::EncryptedMount>("test", db_path_.string(), "/test", 10,
+                                                        options);
+    ASSERT_TRUE(mount->mount(password_));
+    ASSERT_TRUE(mount->findTextCandidates("/", {"entry 49"}, paths));
+    EXPECT_EQ(paths, std::vector<std::string>{"/log.txt"});
+    ASSERT_TRUE(mount->findTextCandidates("/", {"missing"}, paths));
+    EXPECT_TRUE(paths.empty());
+}
+
+TEST_F(EncryptedMountTest, MigratesLegacyBlobSchema)
+{
+    std::string large(static_cast<size_t>(homeshell::EncryptedMount::kChunkSize + 5), 'z');
+
+    // Build a database in the original one-BLOB-per-file layout
+    {
+        sqlite3* db = nullptr;
+        ASSERT_EQ(sqlite3_open(db_path_.string().c_str(), &db), SQLITE_OK);
+        sqlite3_key(db, password_.c_str(), static_cast<int>(password_.size()));
+        ASSERT_EQ(sqlite3_exec(db,
+                               "CREATE TABLE files (path TEXT PRIMARY KEY, content BLOB, "
+                               "size INTEGER, mtime INTEGER);"
+                               "CREATE TABLE directories (path TEXT PRIMARY KEY, parent TEXT, "
+                               "mtime INTEGER);"
+                               "INSERT INTO directories VALUES ('/', '', 0);"
+                               "INSERT INTO files VALUES ('/small.txt', 'legacy', 6, 0);"
+                               "INSERT INTO files VALUES ('/empty.txt', '', 0, 0);",
+                               nullptr, nullptr, nullptr),
+                  SQLITE_OK);
+
+        sqlite3_stmt* stmt = nullptr;
+        ASSERT_EQ(sqlite3_prepare_v2(db, "INSERT INTO files VALUES ('/large.bin', ?, ?, 0)", -1,
+                                     &stmt, nullptr),
+                  SQLITE_OK);
+        sqlite3_bind_blob(stmt, 1, large.data(), static_cast<int>(large.size()), SQLITE_STATIC);
+        sqlite3_bind_int64(stmt, 2, static_cast<int64_t>(large.size()));
+        EXPECT_EQ(sqlite3_step(stmt), SQLITE_DONE);
+        sqlite3_finalize(stmt);
+        sqlite3_close(db);
+    }
+
+    homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10);
+    ASSERT_TRUE(mount.mount(password_));
+
+    std::string content;
+    EXPECT_TRUE(mount.readFile("/small.txt", content));
+    EXPECT_EQ(content, "legacy");
+    EXPECT_TRUE(mount.readFile("/empty.txt", content));
+    EXPECT_TRUE(content.empty());
+    EXPECT_TRUE(mount.readFile("/large.bin", content));
+    EXPECT_EQ(content, large);
+    EXPECT_EQ(mount.listDirectory("/").size(), 3);
+}
+
+TEST_F(EncryptedMountTest, OperationsAcrossRemount)
+{
+    homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10);
+    ASSERT_TRUE(mount.mount(password_));
+    EXPECT_TRUE(mount.writeFile("/a.txt", "first"));
+    EXPECT_TRUE(mount.unmount());
+
+    // Cached statements are released on unmount and must not be used afterwards
+    std::string content;
+    EXPECT_FALSE(mount.exists("/a.txt"));
+    EXPECT_FALSE(mount.readFile("/a.txt", content));
+
+    ASSERT_TRUE(mount.mount(password_));
+    for (int i = 0; i < 3; ++i)
+    {
+        EXPECT_TRUE(mount.exists("/a.txt"));
+        EXPECT_FALSE(mount.isDirectory("/a.txt"));
+        EXPECT_TRUE(mount.readFile("/a.txt", content));
+        EXPECT_EQ(content, "first");
+    }
+}
+
+TEST_F(EncryptedMountTest, ListDirectoryOnlyReturnsDirectChildren)
+{
+    homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10);
+    ASSERT_TRUE(mount.mount(password_));
+
+    mount.writeFile("/top.txt", "t");
+    mount.writeFile("/a/one.txt", "1");
+    mount.writeFile("/a/two.txt", "2");
+    mount.writeFile("/a/b/deep.txt", "d");
+    mount.writeFile("/ab/other.txt", "o");
+
+    auto entries = mount.listDirectory("/a");
+    std::vector<std::string> names;
+    for (const auto& entry : entries)
+    {
+        names.push_back(entry.name);
+    }
+    std::sort(names.begin(), names.end());
+    EXPECT_EQ(names, (std::vector<std::string>{"b", "one.txt", "two.txt"}));
+
+    EXPECT_EQ(mount.listDirectory("/a/b").size(), 1);
+    EXPECT_EQ(mount.listDirectory("/").size(), 3); // top.txt, a, ab
+}
+
+TEST_F(EncryptedMountTest, MigratesSchemaWithoutFileParent)
+{
+    // Build a version 2 database (chunked files without a parent column)
+    {
+        sqlite3* db = nullptr;
+        ASSERT_EQ(sqlite3_open(db_path_.string().c_str(), &db), SQLITE_OK);
+        sqlite3_key(db, password_.c_str(), static_cast<int>(password_.size()));
+        ASSERT_EQ(sqlite3_exec(db,
+                               "CREATE TABLE files (id INTEGER PRIMARY KEY, path TEXT NOT NULL "
+                               "UNIQUE, size INTEGER NOT NULL DEFAULT 0, mtime INTEGER);"
+                               "CREATE TABLE chunks (file_id INTEGER NOT NULL, idx INTEGER NOT "
+                               "NULL, data BLOB, PRIMARY KEY (file_id, idx));"
+                               "CREATE TABLE directories (path TEXT PRIMARY KEY, parent TEXT, "
+                               "mtime INTEGER);"
+                               "INSERT INTO directories VALUES ('/', '', 0);"
+                               "INSERT INTO directories VALUES ('/docs', '/', 0);"
+                               "INSERT INTO files VALUES (1, '/root.txt', 4, 0);"
+                               "INSERT INTO chunks VALUES (1, 0, 'root');"
+                               "INSERT INTO files VALUES (2, '/docs/note.txt', 4, 0);"
+                               "INSERT INTO chunks VALUES (2, 0, 'note');"
+                               "PRAGMA user_version = 2;",
+                               nullptr, nullptr, nullptr),
+                  SQLITE_OK);
+        sqlite3_close(db);
+    }
+
+    homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10);
+    ASSERT_TRUE(mount.mount(password_));
+
+    auto root = mount.listDirectory("/");
+    EXPECT_EQ(root.size(), 2); // docs, root.txt
+
+    auto docs = mount.listDirectory("/docs");
+    ASSERT_EQ(docs.size(), 1);
+    EXPECT_EQ(docs[0].name, "note.txt");
+    EXPECT_EQ(docs[0].size, 4);
+
+    std::string content;
+    EXPECT_TRUE(mount.readFile("/docs/note.txt", content));
+    EXPECT_EQ(content, "note");
+
+    // Usage counters are seeded from the existing rows
+    auto usage = mount.getUsage();
+    EXPECT_EQ(usage.used_bytes, 8);
+    EXPECT_EQ(usage.stored_bytes, 8);
+    EXPECT_EQ(usage.file_count, 2);
+    EXPECT_EQ(usage.directory_count, 1);
+}
+
+TEST_F(EncryptedMountTest, MigratesEachSchemaVersion)
+{
+    for (int version : {4, 5, 6, 7})
+    {
+        SCOPED_TRACE("version " + std::to_string(version));
+        fs::remove(db_path_);
+        createDatabaseAtVersion(version);
+
+        homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10);
+        ASSERT_TRUE(mount.mount(password_));
+
+        std::string content;
+        EXPECT_TRUE(mount.readFile("/docs/note.txt", content));
+        EXPECT_EQ(content, "note");
+        EXPECT_TRUE(mount.verifyUsage());
+        auto usage = mount.getUsage();
+        EXPECT_EQ(usage.used_bytes, 8);
+        EXPECT_EQ(usage.stored_bytes, 8);
+        EXPECT_EQ(usage.file_count, 2);
+        EXPECT_EQ(usage.directory_count, 1);
+
+        // Old chunks carry no checksum; new ones do
+        homeshell::FileCheck check;
+        ASSERT_TRUE(mount.verifyFile("/root.txt", check));
+        EXPECT_EQ(check.unverified, 1);
+        ASSERT_TRUE(mount.writeFile("/new.txt", "fresh"));
+        ASSERT_TRUE(mount.verifyFile("/new.txt", check));
+        EXPECT_EQ(check.unverified, 0);
+        EXPECT_TRUE(check.corrupt.empty());
+
+        mount.unmount();
+        EXPECT_EQ(schemaVersion(), homeshell::EncryptedMount::kSchemaVersion);
+        ASSERT_TRUE(mount.mount(password_));
+        mount.unmount();
+    }
+}
+
+TEST_F(EncryptedMountTest, FailedMigrationLeavesOldVersion)
+{
+    // A table taking the name of a new index makes the upgrade fail after
+    // the columns have been added
+    createDatabaseAtVersion(4, "CREATE TABLE idx_files_mtime (x);");
+    {
+        homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10);
+        EXPECT_FALSE(mount.mount(password_));
+    }
+    EXPECT_EQ(schemaVersion(), 4);
+
+    // Once the obstacle is gone the whole upgrade runs again
+    sqlite3* db = nullptr;
+    ASSERT_EQ(sqlite3_open(db_path_.string().c_str(), &db), SQLITE_OK);
+    sqlite3_key(db, password_.c_str(), static_cast<int>(password_.size()));
+    ASSERT_EQ(sqlite3_exec(db, "DROP TABLE idx_files_mtime", nullptr, nullptr, nullptr),
+              SQLITE_OK);
+    sqlite3_close(db);
+
+    homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10);
+    ASSERT_TRUE(mount.mount(password_));
+    std::string content;
+    EXPECT_TRUE(mount.readFile("/root.txt", content));
+    EXPECT_EQ(content, "root");
+    EXPECT_EQ(mount.getUsage().used_bytes, 8);
+    mount.unmount();
+    EXPECT_EQ(schemaVersion(), homeshell::EncryptedMount::kSchemaVersion);
+}
+
+TEST_F(EncryptedMountTest, UsageCountersTrackChanges)
+{
+    homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10);
+    ASSERT_TRUE(mount.mount(password_));
+
+    mount.writeFile("/a/one.txt", "12345");
+    mount.writeFile("/a/b/two.txt", "123");
+    auto usage = mount.getUsage();
+    EXPECT_EQ(usage.used_bytes, 8);
+    EXPECT_EQ(usage.file_count, 2);
+    EXPECT_EQ(usage.directory_count, 2);
+
+    mount.writeFile("/a/one.txt", "1");
+    mount.writeFileRange("/a/b/two.txt", 10, "xy");
+    EXPECT_EQ(mount.getUsedSpace(), 13);
+
+    mount.remove("/a/one.txt");
+    usage = mount.getUsage();
+    EXPECT_EQ(usage.used_bytes, 12);
+    EXPECT_EQ(usage.file_count, 1);
+
+    mount.remove("/a");
+    usage = mount.getUsage();
+    EXPECT_EQ(usage.used_bytes, 0);
+    EXPECT_EQ(usage.file_count, 0);
+    EXPECT_EQ(usage.directory_count, 0);
+    EXPECT_TRUE(mount.verifyUsage());
+}
+
+TEST_F(EncryptedMountTest, VerifyUsageRebuildsDriftedCounters)
+{
+    {
+        homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10);
+        ASSERT_TRUE(mount.mount(password_));
+        mount.writeFile("/docs/a.txt", "abc");
+        mount.writeFile("/docs/b.txt", "defg");
+    }
+
+    {
+        sqlite3* db = nullptr;
+        ASSERT_EQ(sqlite3_open(db_path_.string().c_str(), &db), SQLITE_OK);
+        sqlite3_key(db, password_.c_str(), static_cast<int>(password_.size()));
+        ASSERT_EQ(sqlite3_exec(db, "UPDATE usage SET used_bytes = 999, file_count = 42", nullptr,
+                               nullptr, nullptr),
+                  SQLITE_OK);
+        sqlite3_close(db);
+    }
+
+    homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10);
+    ASSERT_TRUE(mount.mount(password_));
+    EXPECT_EQ(mount.getUsedSpace(), 999);
+
+    EXPECT_FALSE(mount.verifyUsage());
+    auto usage = mount.getUsage();
+    EXPECT_EQ(usage.used_bytes, 7);
+    EXPECT_EQ(usage.file_count, 2);
+    EXPECT_EQ(usage.directory_count, 1);
+    EXPECT_TRUE(mount.verifyUsage());
+}
+
+TEST_F(EncryptedMountTest, BatchCommitsOnOutermostEnd)
+{
+    homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10);
+    ASSERT_TRUE(mount.mount(password_));
+
+    auto countFiles = [&]() {
+        sqlite3* db = nullptr;
+        sqlite3_open(db_path_.string().c_str(), &db);
+        sqlite3_key(db, password_.c_str(), static_cast<int>(password_.size()));
+        sqlite3_stmt* stmt = nullptr;
+        int count = -1;
+        if (sqlite3_prepare_v2(db, "SELECT COUNT(*) FROM files", -1, &stmt, nullptr) ==
+                SQLITE_OK &&
+            sqlite3_step(stmt) == SQLITE_ROW)
+        {
+            count = sqlite3_column_int(stmt, 0);
+        }
+        sqlite3_finalize(stmt);
+        sqlite3_close(db);
+        return count;
+    };
+
+    EXPECT_FALSE(mount.endBatch());
+
+    ASSERT_TRUE(mount.beginBatch());
+    EXPECT_TRUE(mount.writeFile("/a.txt", "a"));
+    ASSERT_TRUE(mount.beginBatch());
+    EXPECT_TRUE(mount.writeFile("/dir/b.txt", "b"));
+    EXPECT_TRUE(mount.endBatch());
+
+    // Visible to the mount itself, not yet to other connections
+    EXPECT_TRUE(mount.exists("/dir/b.txt"));
+    EXPECT_EQ(countFiles(), 0);
+
+    EXPECT_TRUE(mount.endBatch());
+    EXPECT_EQ(countFiles(), 2);
+    EXPECT_EQ(mount.getUsage().file_count, 2);
+}
+
+TEST_F(EncryptedMountTest, UnmountCommitsOpenBatch)
+{
+    {
+        homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10);
+        ASSERT_TRUE(mount.mount(password_));
+        ASSERT_TRUE(mount.beginBatch());
+        EXPECT_TRUE(mount.writeFile("/kept.txt", "kept"));
+        EXPECT_TRUE(mount.unmount());
+        EXPECT_FALSE(mount.endBatch());
+    }
+
+    homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10);
+    ASSERT_TRUE(mount.mount(password_));
+    std::string content;
+    EXPECT_TRUE(mount.readFile("/kept.txt", content));
+    EXPECT_EQ(content, "kept");
+}
+
+TEST_F(EncryptedMountTest, RemoveDirectoryRemovesWholeSubtree)
+{
+    homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10);
+    ASSERT_TRUE(mount.mount(password_));
+
+    mount.writeFile("/a/one.txt", "1");
+    mount.writeFile("/a/b/two.txt", "22");
+    mount.writeFile("/a/b/c/three.txt", "333");
+    mount.createDirectory("/a/b/c/empty");
+
+    // Siblings sharing the prefix must survive
+    mount.writeFile("/a.txt", "x");
+    mount.writeFile("/a-b/keep.txt", "k");
+    mount.writeFile("/ab/keep.txt", "k");
+
+    EXPECT_TRUE(mount.remove("/a"));
+    EXPECT_FALSE(mount.exists("/a"));
+    EXPECT_FALSE(mount.exists("/a/b/c"));
+    EXPECT_FALSE(mount.exists("/a/b/c/empty"));
+    EXPECT_FALSE(mount.exists("/a/b/c/three.txt"));
+
+    EXPECT_TRUE(mount.exists("/a.txt"));
+    EXPECT_TRUE(mount.exists("/a-b/keep.txt"));
+    EXPECT_TRUE(mount.exists("/ab/keep.txt"));
+
+    auto usage = mount.getUsage();
+    EXPECT_EQ(usage.file_count, 3);
+    EXPECT_EQ(usage.directory_count, 2);
+    EXPECT_EQ(usage.used_bytes, 3);
+
+    EXPECT_FALSE(mount.remove("/"));
+    EXPECT_TRUE(mount.exists("/"));
+}
+
+TEST_F(EncryptedMountTest, RenameMovesSubtreeWithoutCopying)
+{
+    homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10);
+    ASSERT_TRUE(mount.mount(password_));
+
+    std::string large(static_cast<size_t>(homeshell::EncryptedMount::kChunkSize * 2 + 7), 'q');
+    mount.writeFile("/src/one.txt", "1");
+    mount.writeFile("/src/sub/large.bin", large);
+    mount.createDirectory("/src/sub/empty");
+    mount.writeFile("/src-other/keep.txt", "k");
+    auto before = mount.getUsage();
+
+    EXPECT_TRUE(mount.rename("/src", "/dst/moved"));
+    EXPECT_FALSE(mount.exists("/src"));
+    EXPECT_FALSE(mount.exists("/src/sub/large.bin"));
+    EXPECT_TRUE(mount.exists("/src-other/keep.txt"));
+    EXPECT_TRUE(mount.isDirectory("/dst/moved/sub/empty"));
+
+    std::string content;
+    EXPECT_TRUE(mount.readFile("/dst/moved/sub/large.bin", content));
+    EXPECT_EQ(content, large);
+
+    // Parents were rewritten too, so listings follow the move
+    EXPECT_EQ(mount.listDirectory("/dst/moved").size(), 2);
+    EXPECT_EQ(mount.listDirectory("/dst/moved/sub").size(), 2);
+    EXPECT_EQ(mount.listDirectory("/dst").size(), 1);
+
+    auto after = mount.getUsage();
+    EXPECT_EQ(after.used_bytes, before.used_bytes);
+    EXPECT_EQ(after.file_count, before.file_count);
+    EXPECT_EQ(after.directory_count, before.directory_count + 1); // new /dst
+    EXPECT_TRUE(mount.verifyUsage());
+}
+
+TEST_F(EncryptedMountTest, RenameFile)
+{
+    homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10);
+    ASSERT_TRUE(mount.mount(password_));
+
+    mount.writeFile("/a.txt", "new");
+    mount.writeFile("/b.txt", "old");
+    mount.createDirectory("/dir");
+
+    EXPECT_TRUE(mount.rename("/a.txt", "/b.txt")); // replaces the target file
+    std::string content;
+    EXPECT_TRUE(mount.readFile("/b.txt", content));
+    EXPECT_EQ(content, "new");
+    EXPECT_FALSE(mount.exists("/a.txt"));
+    EXPECT_EQ(mount.getUsage().file_count, 1);
+
+    EXPECT_FALSE(mount.rename("/b.txt", "/dir"));
+    EXPECT_FALSE(mount.rename("/dir", "/dir/inside"));
+    EXPECT_FALSE(mount.rename("/missing", "/other"));
+    EXPECT_FALSE(mount.rename("/", "/root"));
+}
+
+TEST_F(EncryptedMountTest, ChunkCacheServesRepeatedReads)
+{
+    homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10);
+    ASSERT_TRUE(mount.mount(password_));
+
+    const int64_t chunk = homeshell::EncryptedMount::kChunkSize;
+    ASSERT_TRUE(mount.writeFile("/data.bin", std::string(static_cast<size_t>(chunk * 2), 'd')));
+
+    std::string part;
+    ASSERT_TRUE(mount.readFileRange("/data.bin", 10, 20, part));
+    auto first = mount.getChunkCacheStats();
+    ASSERT_TRUE(mount.readFileRange("/data.bin", 100, 20, part));
+    auto second = mount.getChunkCacheStats();
+
+    EXPECT_EQ(part, std::string(20, 'd'));
+    EXPECT_EQ(second.misses, first.misses);
+    EXPECT_GT(second.hits, first.hits);
+}
+
+TEST_F(EncryptedMountTest, SequentialReadsPrefetchAhead)
+{
+    homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10);
+    ASSERT_TRUE(mount.mount(password_));
+
+    const int64_t chunk = homeshell::EncryptedMount::kChunkSize;
+    std::string content;
+    for (int i = 0; i < 8; ++i)
+    {
+        content += std::string(static_cast<size_t>(chunk), static_cast<char>('a' + i));
+    }
+    ASSERT_TRUE(mount.writeFile("/seq.bin", content));
+
+    std::string read_back;
+    std::string part;
+    for (int64_t offset = 0; offset < chunk * 8; offset += chunk / 2)
+    {
+        ASSERT_TRUE(mount.readFileRange("/seq.bin", offset, chunk / 2, part));
+        read_back += part;
+    }
+
+    EXPECT_EQ(read_back, content);
+    auto stats = mount.getChunkCacheStats();
+    EXPECT_GT(stats.read_ahead, 0u);
+    EXPECT_LT(stats.misses, 8u);
+}
+
+TEST_F(EncryptedMountTest, SparseReadsReadHolesAsZeros)
+{
+    homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10);
+    ASSERT_TRUE(mount.mount(password_));
+
+    // One real chunk after 64 holes
+    const int64_t chunk = homeshell::EncryptedMount::kChunkSize;
+    ASSERT_TRUE(mount.writeFileRange("/sparse.bin", chunk * 64, "tail"));
+
+    std::string part;
+    for (int64_t offset = 0; offset < chunk * 64; offset += chunk)
+    {
+        ASSERT_TRUE(mount.readFileRange("/sparse.bin", offset, chunk, part));
+        ASSERT_EQ(part, std::string(static_cast<size_t>(chunk), '\0'));
+    }
+    ASSERT_TRUE(mount.readFileRange("/sparse.bin", chunk * 64, 4, part));
+    EXPECT_EQ(part, "tail");
+
+    // Only the written chunk takes cache space
+    EXPECT_EQ(mount.getChunkCacheStats().bytes, 4);
+}
+
+TEST_F(EncryptedMountTest, ChunkCacheIsNotServedStale)
+{
+    homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10);
+    ASSERT_TRUE(mount.mount(password_));
+
+    std::string content;
+    ASSERT_TRUE(mount.writeFile("/f.txt", "first version"));
+    ASSERT_TRUE(mount.readFile("/f.txt", content));
+
+    ASSERT_TRUE(mount.writeFile("/f.txt", "second"));
+    ASSERT_TRUE(mount.readFile("/f.txt", content));
+    EXPECT_EQ(content, "second");
+
+    ASSERT_TRUE(mount.writeFileRange("/f.txt", 0, "SE"));
+    ASSERT_TRUE(mount.readFile("/f.txt", content));
+    EXPECT_EQ(content, "SEcond");
+
+    // A new file may reuse the id of a removed one
+    ASSERT_TRUE(mount.remove("/f.txt"));
+    ASSERT_TRUE(mount.writeFile("/g.txt", "other"));
+    ASSERT_TRUE(mount.readFile("/g.txt", content));
+    EXPECT_EQ(content, "other");
+}
+
+TEST_F(EncryptedMountTest, ReadsWorkWithChunkCacheDisabled)
+{
+    homeshell::MountOptions options;
+    options.chunk_cache_bytes = 0;
+    homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10, options);
+    ASSERT_TRUE(mount.mount(password_));
+
+    const int64_t chunk = homeshell::EncryptedMount::kChunkSize;
+    std::string content(static_cast<size_t>(chunk * 3), 'q');
+    ASSERT_TRUE(mount.writeFile("/q.bin", content));
+
+    std::string part;
+    for (int i = 0; i < 2; ++i)
+    {
+        ASSERT_TRUE(mount.readFileRange("/q.bin", chunk - 1, chunk + 2, part));
+        EXPECT_EQ(part, content.substr(static_cast<size_t>(chunk - 1), chunk + 2));
+    }
+
+    auto stats = mount.getChunkCacheStats();
+    EXPECT_EQ(stats.hits, 0u);
+    EXPECT_EQ(stats.bytes, 0);
+}
+
+TEST_F(EncryptedMountTest, DedupStoresIdenticalChunksOnce)
+{
+    homeshell::MountOptions options;
+    options.dedup = true;
+    homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10, options);
+    ASSERT_TRUE(mount.mount(password_));
+
+    const int64_t chunk = homeshell::EncryptedMount::kChunkSize;
+    std::string content = std::string(static_cast<size_t>(chunk), 'a') +
+                          std::string(static_cast<size_t>(chunk), 'b') + "tail";
+    int64_t size = static_cast<int64_t>(content.size());
+    ASSERT_TRUE(mount.writeFile("/one.bin", content));
+    ASSERT_TRUE(mount.writeFile("/copies/two.bin", content));
+    ASSERT_TRUE(mount.writeFile("/copies/three.bin", content));
+
+    auto usage = mount.getUsage();
+    EXPECT_EQ(usage.used_bytes, size * 3);
+    EXPECT_EQ(usage.stored_bytes, size);
+
+    std::string read_back;
+    ASSERT_TRUE(mount.readFile("/copies/three.bin", read_back));
+    EXPECT_EQ(read_back, content);
+
+    // Blobs stay while any file still references them
+    ASSERT_TRUE(mount.remove("/copies"));
+    EXPECT_EQ(mount.getUsage().stored_bytes, size);
+    ASSERT_TRUE(mount.readFile("/one.bin", read_back));
+    EXPECT_EQ(read_back, content);
+
+    ASSERT_TRUE(mount.remove("/one.bin"));
+    EXPECT_EQ(mount.getUsage().stored_bytes, 0);
+    EXPECT_TRUE(mount.verifyUsage());
+    mount.unmount();
+
+    sqlite3* db = nullptr;
+    ASSERT_EQ(sqlite3_open(db_path_.string().c_str(), &db), SQLITE_OK);
+    sqlite3_key(db, password_.c_str(), static_cast<int>(password_.size()));
+    sqlite3_stmt* stmt = nullptr;
+    ASSERT_EQ(sqlite3_prepare_v2(db,
+                                 "SELECT (SELECT COUNT(*) FROM blobs) + "
+                                 "(SELECT COUNT(*) FROM blob_refs)",
+                                 -1, &stmt, nullptr),
+              SQLITE_OK);
+    ASSERT_EQ(sqlite3_step(stmt), SQLITE_ROW);
+    EXPECT_EQ(sqlite3_column_int64(stmt, 0), 0);
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+}
+
+TEST_F(EncryptedMountTest, DedupOverwritesReleaseUnusedBlobs)
+{
+    homeshell::MountOptions options;
+    options.dedup = true;
+    homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10, options);
+    ASSERT_TRUE(mount.mount(password_));
+
+    ASSERT_TRUE(mount.writeFile("/a.txt", "shared"));
+    ASSERT_TRUE(mount.writeFile("/b.txt", "shared"));
+    EXPECT_EQ(mount.getUsage().stored_bytes, 6);
+
+    // Rewriting identical content keeps the blob
+    ASSERT_TRUE(mount.writeFile("/a.txt", "shared"));
+    EXPECT_EQ(mount.getUsage().stored_bytes, 6);
+
+    ASSERT_TRUE(mount.writeFile("/a.txt", "changed!"));
+    EXPECT_EQ(mount.getUsage().stored_bytes, 14);
+
+    ASSERT_TRUE(mount.writeFileRange("/b.txt", 0, "SH"));
+    EXPECT_EQ(mount.getUsage().stored_bytes, 14); // old "shared" blob released
+
+    ASSERT_TRUE(mount.rename("/a.txt", "/b.txt"));
+    EXPECT_EQ(mount.getUsage().stored_bytes, 8);
+
+    std::string content;
+    ASSERT_TRUE(mount.readFile("/b.txt", content));
+    EXPECT_EQ(content, "changed!");
+    EXPECT_TRUE(mount.verifyUsage());
+}
+
+TEST_F(EncryptedMountTest, InlineAndDedupChunksMix)
+{
+    const std::string content = "same bytes in both modes";
+    {
+        homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10);
+        ASSERT_TRUE(mount.mount(password_));
+        ASSERT_TRUE(mount.writeFile("/inline.txt", content));
+        EXPECT_EQ(mount.getUsage().stored_bytes, mount.getUsage().used_bytes);
+        mount.unmount();
+    }
+
+    homeshell::MountOptions options;
+    options.dedup = true;
+    homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10, options);
+    ASSERT_TRUE(mount.mount(password_));
+    ASSERT_TRUE(mount.writeFile("/dedup1.txt", content));
+    ASSERT_TRUE(mount.writeFile("/dedup2.txt", content));
+
+    // One inline copy plus one shared blob
+    auto usage = mount.getUsage();
+    int64_t size = static_cast<int64_t>(content.size());
+    EXPECT_EQ(usage.used_bytes, size * 3);
+    EXPECT_EQ(usage.stored_bytes, size * 2);
+
+    // Overwriting the inline file converts it to a blob reference
+    ASSERT_TRUE(mount.writeFile("/inline.txt", content));
+    EXPECT_EQ(mount.getUsage().stored_bytes, size);
+
+    std::string read_back;
+    for (const char* path : {"/inline.txt", "/dedup1.txt", "/dedup2.txt"})
+    {
+        ASSERT_TRUE(mount.readFile(path, read_back));
+        EXPECT_EQ(read_back, content);
+    }
+    EXPECT_TRUE(mount.verifyUsage());
+}
+
+namespace
+{
+
+std::string makeLogText(size_t size)
+{
+    std::string text;
+    for (int line = 0; text.size() < size; ++line)
+    {
+        text += "2024-01-01 12:00:" + std::to_string(line % 60) + " INFO request served in " +
+                std::to_string(line % 97) + " ms\n";
+    }
+    text.resize(size);
+    return text;
+}
+
+} // namespace
+
+TEST_F(EncryptedMountTest, CompressionShrinksCompressibleChunks)
+{
+    homeshell::MountOptions options;
+    options.compression_level = 6;
+    homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10, options);
+    ASSERT_TRUE(mount.mount(password_));
+
+    const int64_t chunk = homeshell::EncryptedMount::kChunkSize;
+    std::string text = makeLogText(static_cast<size_t>(chunk * 3 + 1000));
+    ASSERT_TRUE(mount.writeFile("/app.log", text));
+
+    auto usage = mount.getUsage();
+    EXPECT_EQ(usage.used_bytes, static_cast<int64_t>(text.size()));
+    EXPECT_LT(usage.stored_bytes * 2, usage.used_bytes);
+
+    auto stats = mount.getCompressionStats();
+    EXPECT_EQ(stats.chunks_compressed, 4u);
+    EXPECT_EQ(stats.chunks_skipped, 0u);
+    EXPECT_EQ(stats.bytes_in, text.size());
+    EXPECT_EQ(static_cast<int64_t>(stats.bytes_out), usage.stored_bytes);
+
+    std::string content;
+    ASSERT_TRUE(mount.readFile("/app.log", content));
+    EXPECT_EQ(content, text);
+    EXPECT_EQ(mount.getCompressionStats().bytes_inflated, text.size());
+
+    // Patch a compressed chunk across a boundary
+    ASSERT_TRUE(mount.writeFileRange("/app.log", chunk - 2, "PATCH"));
+    text.replace(static_cast<size_t>(chunk - 2), 5, "PATCH");
+    ASSERT_TRUE(mount.readFile("/app.log", content));
+    EXPECT_EQ(content, text);
+    EXPECT_TRUE(mount.verifyUsage());
+}
+
+TEST_F(EncryptedMountTest, CompressionSkipsIncompressibleChunks)
+{
+    homeshell::MountOptions options;
+    options.compression_level = 6;
+    homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10, options);
+    ASSERT_TRUE(mount.mount(password_));
+
+    const int64_t chunk = homeshell::EncryptedMount::kChunkSize;
+    std::mt19937 rng(42);
+    std::string noise(static_cast<size_t>(chunk * 2), '\0');
+    for (auto& c : noise)
+    {
+        c = static_cast<char>(rng() & 0xff);
+    }
+    ASSERT_TRUE(mount.writeFile("/noise.bin", noise));
+
+    auto usage = mount.getUsage();
+    EXPECT_EQ(usage.stored_bytes, usage.used_bytes);
+    auto stats = mount.getCompressionStats();
+    EXPECT_EQ(stats.chunks_compressed, 0u);
+    EXPECT_EQ(stats.chunks_skipped, 2u);
+
+    std::string content;
+    ASSERT_TRUE(mount.readFile("/noise.bin", content));
+    EXPECT_EQ(content, noise);
+}
+
+TEST_F(EncryptedMountTest, CompressedChunksReadableWithCompressionOff)
+{
+    std::string text = makeLogText(20000);
+    {
+        homeshell::MountOptions options;
+        options.compression_level = 1;
+        options.dedup = true;
+        homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10, options);
+        ASSERT_TRUE(mount.mount(password_));
+        ASSERT_TRUE(mount.writeFile("/a.log", text));
+        ASSERT_TRUE(mount.writeFile("/b.log", text));
+        EXPECT_LT(mount.getUsage().stored_bytes, static_cast<int64_t>(text.size()) / 2);
+        mount.unmount();
+    }
+
+    homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10);
+    ASSERT_TRUE(mount.mount(password_));
+    std::string content;
+    ASSERT_TRUE(mount.readFile("/b.log", content));
+    EXPECT_EQ(content, text);
+    EXPECT_TRUE(mount.verifyUsage());
+}
+
+TEST_F(EncryptedMountTest, ConcurrentReadersWhileWriting)
+{
+    homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10);
+    ASSERT_TRUE(mount.mount(password_));
+
+    const int64_t chunk = homeshell::EncryptedMount::kChunkSize;
+    std::vector<std::string> files;
+    for (int i = 0; i < 4; ++i)
+    {
+        files.push_back(std::string(static_cast<size_t>(chunk * 2 + 100 * i), 'a' + i));
+        ASSERT_TRUE(mount.writeFile("/f" + std::to_string(i), files.back()));
+    }
+
+    // The writer only ever replaces /w with a uniform fill, so any mix of
+    // characters seen by a reader would mean it read a half-written file
+    std::atomic<bool> done{false};
+    std::atomic<int> failures{0};
+    std::thread writer(
+        [&]
+        {
+            for (int round = 0; round < 20; ++round)
+            {
+                std::string fill(static_cast<size_t>(chunk + round), 'k' + round % 8);
+                if (!mount.writeFile("/w", fill))
+                {
+                    ++failures;
+                }
+            }
+            done = true;
+        });
+
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; ++t)
+    {
+        readers.emplace_back(
+            [&, t]
+            {
+                std::string content;
+                while (!done)
+                {
+                    if (!mount.readFile("/f" + std::to_string(t), content) ||
+                        content != files[t])
+                    {
+                        ++failures;
+                    }
+                    if (mount.readFile("/w", content) &&
+                        content.find_first_not_of(content[0]) != std::string::npos)
+                    {
+                        ++failures;
+                    }
+                }
+            });
+    }
+
+    writer.join();
+    for (auto& reader : readers)
+    {
+        reader.join();
+    }
+    EXPECT_EQ(failures, 0);
+
+    std::string content;
+    ASSERT_TRUE(mount.readFile("/w", content));
+    EXPECT_EQ(content, std::string(static_cast<size_t>(chunk + 19), 'k' + 19 % 8));
+    EXPECT_TRUE(mount.verifyUsage());
+    mount.unmount();
+}
+
+TEST_F(EncryptedMountTest, BatchOwnerSeesUncommittedWrites)
+{
+    homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10);
+    ASSERT_TRUE(mount.mount(password_));
+    ASSERT_TRUE(mount.writeFile("/file.txt", "old"));
+
+    ASSERT_TRUE(mount.beginBatch());
+    ASSERT_TRUE(mount.writeFile("/file.txt", "new"));
+
+    std::string content;
+    ASSERT_TRUE(mount.readFile("/file.txt", content));
+    EXPECT_EQ(content, "new");
+
+    // Another thread reads the last commit on a pooled connection
+    std::string other;
+    std::thread reader([&] { mount.readFile("/file.txt", other); });
+    reader.join();
+    EXPECT_EQ(other, "old");
+
+    ASSERT_TRUE(mount.endBatch());
+    reader = std::thread([&] { mount.readFile("/file.txt", other); });
+    reader.join();
+    EXPECT_EQ(other, "new");
+    mount.unmount();
+}
+
+TEST_F(EncryptedMountTest, WriterOnlyModeServesConcurrentReads)
+{
+    homeshell::MountOptions options;
+    options.read_connections = 0;
+    homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10, options);
+    ASSERT_TRUE(mount.mount(password_));
+    ASSERT_TRUE(mount.writeFile("/file.txt", "shared"));
+
+    std::atomic<int> failures{0};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; ++t)
+    {
+        readers.emplace_back(
+            [&]
+            {
+                std::string content;
+                for (int i = 0; i < 50; ++i)
+                {
+                    if (!mount.readFile("/file.txt", content) || content != "shared")
+                    {
+                        ++failures;
+                    }
+                }
+            });
+    }
+    for (auto& reader : readers)
+    {
+        reader.join();
+    }
+    EXPECT_EQ(failures, 0);
+    mount.unmount();
+}
+
+TEST_F(EncryptedMountTest, LazyMountUnlocksOnFirstAccess)
+{
+    {
+        homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10);
+        ASSERT_TRUE(mount.mount(password_));
+        ASSERT_TRUE(mount.writeFile("/file.txt", "content"));
+        mount.unmount();
+    }
+
+    homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10);
+    ASSERT_TRUE(mount.mountLazily(password_));
+    EXPECT_TRUE(mount.is_mounted());
+    EXPECT_TRUE(mount.isUnlockPending());
+
+    std::string content;
+    ASSERT_TRUE(mount.readFile("/file.txt", content));
+    EXPECT_EQ(content, "content");
+    EXPECT_FALSE(mount.isUnlockPending());
+    EXPECT_FALSE(mount.unlockFailed());
+    EXPECT_TRUE(mount.is_mounted());
+    mount.unmount();
+}
+
+TEST_F(EncryptedMountTest, LazyMountUnlocksOnceAcrossThreads)
+{
+    {
+        homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10);
+        ASSERT_TRUE(mount.mount(password_));
+        ASSERT_TRUE(mount.writeFile("/file.txt", "content"));
+        mount.unmount();
+    }
+
+    homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10);
+    ASSERT_TRUE(mount.mountLazily(password_));
+
+    std::atomic<int> failures{0};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; ++t)
+    {
+        readers.emplace_back(
+            [&]
+            {
+                std::string content;
+                if (!mount.readFile("/file.txt", content) || content != "content")
+                {
+                    ++failures;
+                }
+            });
+    }
+    for (auto& reader : readers)
+    {
+        reader.join();
+    }
+    EXPECT_EQ(failures, 0);
+    mount.unmount();
+}
+
+TEST_F(EncryptedMountTest, LazyMountWithWrongPasswordFailsOnFirstAccess)
+{
+    {
+        homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10);
+        ASSERT_TRUE(mount.mount(password_));
+        mount.unmount();
+    }
+
+    homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10);
+    ASSERT_TRUE(mount.mountLazily("wrong_password"));
+    EXPECT_TRUE(mount.is_mounted());
+
+    EXPECT_FALSE(mount.exists("/"));
+    EXPECT_TRUE(mount.unlockFailed());
+    EXPECT_FALSE(mount.is_mounted());
+}
+
+TEST_F(EncryptedMountTest, UnmountBeforeLazyUnlock)
+{
+    homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10);
+    ASSERT_TRUE(mount.mountLazily(password_));
+    EXPECT_TRUE(mount.unmount());
+    EXPECT_FALSE(mount.is_mounted());
+    EXPECT_FALSE(mount.exists("/"));
+    EXPECT_FALSE(fs::exists(db_path_));
+}
+
+TEST_F(EncryptedMountTest, SnapshotWhileInUse)
+{
+    homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10);
+    ASSERT_TRUE(mount.mount(password_));
+    std::string data(static_cast<size_t>(homeshell::EncryptedMount::kChunkSize * 4), 'd');
+    for (int i = 0; i < 8; ++i)
+    {
+        ASSERT_TRUE(mount.writeFile("/file" + std::to_string(i), data));
+    }
+
+    // Writes made between steps are carried into the copy
+    auto snapshot_path = (test_dir_ / "snapshot.db").string();
+    int steps = 0;
+    homeshell::SnapshotProgress last;
+    ASSERT_TRUE(mount.snapshot(
+        snapshot_path, "",
+        [&](const homeshell::SnapshotProgress& progress)
+        {
+            if (steps++ == 1)
+            {
+                EXPECT_TRUE(mount.writeFile("/during.txt", "written mid-snapshot"));
+            }
+            last = progress;
+        },
+        4));
+    EXPECT_GT(steps, 2);
+    EXPECT_EQ(last.pages_copied, last.page_count);
+    EXPECT_GT(last.page_size, 0);
+
+    homeshell::EncryptedMount copy("copy", snapshot_path, "/copy", 10);
+    ASSERT_TRUE(copy.mount(password_));
+    std::string content;
+    EXPECT_TRUE(copy.readFile("/file7", content));
+    EXPECT_EQ(content, data);
+    EXPECT_TRUE(copy.readFile("/during.txt", content));
+    EXPECT_EQ(content, "written mid-snapshot");
+
+    // The destination must not exist yet
+    EXPECT_FALSE(mount.snapshot(snapshot_path, ""));
+}
+
+TEST_F(EncryptedMountTest, SnapshotWithNewPassword)
+{
+    homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10);
+    ASSERT_TRUE(mount.mount(password_));
+    ASSERT_TRUE(mount.writeFile("/secret.txt", "rekeyed"));
+
+    auto snapshot_path = (test_dir_ / "rekeyed.db").string();
+    ASSERT_TRUE(mount.snapshot(snapshot_path, "new_password"));
+
+    homeshell::EncryptedMount with_old("old", snapshot_path, "/old", 10);
+    EXPECT_FALSE(with_old.mount(password_));
+
+    homeshell::EncryptedMount with_new("new", snapshot_path, "/new", 10);
+    ASSERT_TRUE(with_new.mount("new_password"));
+    std::string content;
+    EXPECT_TRUE(with_new.readFile("/secret.txt", content));
+    EXPECT_EQ(content, "rekeyed");
+}
+
+TEST_F(EncryptedMountTest, CompactFreesDeletedPages)
+{
+    homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10);
+    ASSERT_TRUE(mount.mount(password_));
+    std::string data(static_cast<size_t>(homeshell::EncryptedMount::kChunkSize * 4), 'c');
+    for (int i = 0; i < 8; ++i)
+    {
+        ASSERT_TRUE(mount.writeFile("/file" + std::to_string(i) + ".bin", data + char('0' + i)));
+    }
+    for (int i = 1; i < 8; ++i)
+    {
+        ASSERT_TRUE(mount.remove("/file" + std::to_string(i) + ".bin"));
+    }
+    int64_t reclaimable = mount.getReclaimableBytes();
+    ASSERT_GT(reclaimable, 0);
+    auto size_before = fs::file_size(db_path_);
+
+    int steps = 0;
+    homeshell::CompactProgress result;
+    ASSERT_TRUE(mount.compact(
+        result,
+        [&](const homeshell::CompactProgress&)
+        {
+            ++steps;
+            return true;
+        },
+        16));
+    EXPECT_GT(steps, 2);
+    EXPECT_FALSE(result.vacuumed);
+    EXPECT_FALSE(result.cancelled);
+    EXPECT_EQ(result.pages_remaining, 0);
+    EXPECT_EQ(result.bytesFreed(), reclaimable);
+    EXPECT_EQ(mount.getReclaimableBytes(), 0);
+    EXPECT_LT(fs::file_size(db_path_), size_before);
+
+    std::string content;
+    EXPECT_TRUE(mount.readFile("/file0.bin", content));
+    EXPECT_EQ(content, data + '0');
+}
+
+TEST_F(EncryptedMountTest, CompactCanBeCancelled)
+{
+    homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10);
+    ASSERT_TRUE(mount.mount(password_));
+    std::string data(static_cast<size_t>(homeshell::EncryptedMount::kChunkSize * 4), 'c');
+    ASSERT_TRUE(mount.writeFile("/big.bin", data));
+    ASSERT_TRUE(mount.remove("/big.bin"));
+
+    homeshell::CompactProgress result;
+    ASSERT_TRUE(mount.compact(
+        result, [](const homeshell::CompactProgress&) { return false; }, 4));
+    EXPECT_TRUE(result.cancelled);
+    EXPECT_EQ(result.pages_freed, 4);
+    EXPECT_GT(result.pages_remaining, 0);
+    EXPECT_EQ(mount.getReclaimableBytes(), result.pages_remaining * result.page_size);
+}
+
+TEST_F(EncryptedMountTest, CompactConvertsDatabaseWithoutAutoVacuum)
+{
+    // A database created before auto_vacuum was enabled for new mounts
+    {
+        sqlite3* db = nullptr;
+        ASSERT_EQ(sqlite3_open(db_path_.string().c_str(), &db), SQLITE_OK);
+        sqlite3_key(db, password_.c_str(), static_cast<int>(password_.size()));
+        ASSERT_EQ(sqlite3_exec(db, "PRAGMA auto_vacuum = NONE; CREATE TABLE placeholder (x)",
+                               nullptr, nullptr, nullptr),
+                  SQLITE_OK);
+        sqlite3_close(db);
+    }
+
+    homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10);
+    ASSERT_TRUE(mount.mount(password_));
+    std::string data(static_cast<size_t>(homeshell::EncryptedMount::kChunkSize * 4), 'c');
+    ASSERT_TRUE(mount.writeFile("/keep.txt", "kept"));
+    ASSERT_TRUE(mount.writeFile("/big.bin", data));
+    ASSERT_TRUE(mount.remove("/big.bin"));
+
+    homeshell::CompactProgress result;
+    ASSERT_TRUE(mount.compact(result));
+    EXPECT_TRUE(result.vacuumed);
+    EXPECT_GT(result.bytesFreed(), 0);
+
+    // Converted: the next compaction frees pages incrementally
+    ASSERT_TRUE(mount.writeFile("/big.bin", data));
+    ASSERT_TRUE(mount.remove("/big.bin"));
+    ASSERT_TRUE(mount.compact(result));
+    EXPECT_FALSE(result.vacuumed);
+    EXPECT_GT(result.bytesFreed(), 0);
+
+    std::string content;
+    EXPECT_TRUE(mount.readFile("/keep.txt", content));
+    EXPECT_EQ(content, "kept");
+}
+
+TEST_F(EncryptedMountTest, TuningOptionsRoundTrip)
+{
+    homeshell::MountOptions options;
+    options.journal_mode = "delete";
+    options.synchronous = "FULL";
+    options.page_cache_kb = 1024;
+    options.cipher_page_size = 8192;
+    options.kdf_iter = 4000;
+    {
+        homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10, options);
+        ASSERT_TRUE(mount.mount(password_));
+        ASSERT_TRUE(mount.writeFile("/file.txt", "tuned"));
+        mount.unmount();
+    }
+
+    homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10, options);
+    ASSERT_TRUE(mount.mount(password_));
+    std::string content;
+    ASSERT_TRUE(mount.readFile("/file.txt", content));
+    EXPECT_EQ(content, "tuned");
+    mount.unmount();
+}
+
+TEST_F(EncryptedMountTest, UnknownJournalModeFailsMount)
+{
+    homeshell::MountOptions options;
+    options.journal_mode = "WAL; DROP TABLE files";
+    homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10, options);
+    EXPECT_FALSE(mount.mount(password_));
+    EXPECT_FALSE(mount.is_mounted());
+
+    options.journal_mode = "WAL";
+    options.synchronous = "SOMETIMES";
+    homeshell::EncryptedMount other("test", db_path_.string(), "/test", 10, options);
+    EXPECT_FALSE(other.mount(password_));
+}
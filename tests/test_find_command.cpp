@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 #include <homeshell/commands/FindCommand.hpp>
+#include <homeshell/EncryptedMount.hpp>
 #include <homeshell/VirtualFilesystem.hpp>
 
 #include <filesystem>
@@ -223,5 +224,69 @@ TEST_F(FindCommandTest, HelpOption)
     EXPECT_NE(output.find("-type"), std::string::npos);
 }
 
+TEST_F(FindCommandTest, FindBySize)
+{
+    createFile(test_dir_ + "/dir2/big.bin");
+    std::filesystem::resize_file(test_dir_ + "/dir2/big.bin", 3 * 1024 * 1024);
+
+    CommandContext context;
+    context.args = {test_dir_, "-size", "+1M"};
+    context.use_colors = false;
+
+    testing::internal::CaptureStdout();
+    Status status = command_->execute(context);
+    std::string output = testing::internal::GetCapturedStdout();
+
+    EXPECT_TRUE(status.isSuccess());
+    EXPECT_EQ(output, test_dir_ + "/dir2/big.bin\n");
+
+    context.args = {test_dir_, "-size", "2x"};
+    EXPECT_FALSE(command_->execute(context).isSuccess());
+}
+
+TEST_F(FindCommandTest, FindInEncryptedMount)
+{
+    auto& vfs = VirtualFilesystem::getInstance();
+    auto mount = std::make_shared<EncryptedMount>("findtest", test_dir_ + "/find.db",
+                                                  "/findtest", 10);
+    ASSERT_TRUE(mount->mount("find_password"));
+    ASSERT_TRUE(vfs.addMount(mount));
+    ASSERT_TRUE(mount->writeFile("/logs/old.log", std::string(2048, 'o')));
+    ASSERT_TRUE(mount->writeFile("/logs/tiny.log", "t"));
+    ASSERT_TRUE(mount->writeFile("/notes.txt", "n"));
+    ASSERT_TRUE(mount->writeFile("/logs/new.log", "fresh"));
+
+    auto run = [&](std::vector<std::string> args)
+    {
+        CommandContext context;
+        context.args = std::move(args);
+        context.use_colors = false;
+        testing::internal::CaptureStdout();
+        Status status = command_->execute(context);
+        std::string output = testing::internal::GetCapturedStdout();
+        EXPECT_TRUE(status.isSuccess()) << status.message;
+        return output;
+    };
+
+    EXPECT_EQ(run({"/findtest"}), "/findtest\n/findtest/logs\n/findtest/logs/new.log\n"
+                                  "/findtest/logs/old.log\n/findtest/logs/tiny.log\n"
+                                  "/findtest/notes.txt\n");
+    EXPECT_EQ(run({"/findtest", "-size", "+1k"}), "/findtest/logs/old.log\n");
+    EXPECT_EQ(run({"/findtest/logs", "-type", "f", "-size", "-2k", "-name", "*.log"}),
+              "/findtest/logs/new.log\n/findtest/logs/tiny.log\n");
+    EXPECT_EQ(run({"/findtest", "-newer", "/findtest/notes.txt"}), "/findtest/logs/new.log\n");
+    EXPECT_EQ(run({"/findtest", "-type", "f", "-mtime", "-1", "-maxdepth", "1"}),
+              "/findtest/notes.txt\n");
+    EXPECT_EQ(run({"/findtest", "-mtime", "+0"}), "");
+
+    // The start directory is listed first when it matches
+    EXPECT_EQ(run({"/findtest", "-type", "d"}), "/findtest\n/findtest/logs\n");
+    EXPECT_EQ(run({"/findtest/logs", "-type", "d", "-maxdepth", "0"}), "/findtest/logs\n");
+    EXPECT_EQ(run({"/findtest", "-name", "findtest"}), "/findtest\n");
+    EXPECT_EQ(run({"/findtest", "-type", "d", "-name", "logs"}), "/findtest/logs\n");
+
+    vfs.removeMount("findtest");
+}
+
 } // namespace homeshell
 
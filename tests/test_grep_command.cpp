@@ -1,3 +1,5 @@
+#include <homeshell/EncryptedMount.hpp>
+#include <homeshell/VirtualFilesystem.hpp>
 #include <homeshell/commands/GrepCommand.hpp>
 #include <gtest/gtest.h>
 #include <filesystem>
@@ -391,3 +393,48 @@ TEST_F(GrepCommandTest, CombinedOptions)
     EXPECT_TRUE(output.find("ERROR") != std::string::npos);
 }
 
+
+TEST_F(GrepCommandTest, RecursiveInEncryptedMount)
+{
+    auto& vfs = VirtualFilesystem::getInstance();
+    for (bool text_index : {false, true})
+    {
+        MountOptions options;
+        options.text_index = text_index;
+        auto mount = std::make_shared<EncryptedMount>(
+            "greptest", (test_dir_ / "grep.db").string(), "/greptest", 10, options);
+        ASSERT_TRUE(mount->mount("grep_password"));
+        ASSERT_TRUE(vfs.addMount(mount));
+        ASSERT_TRUE(mount->writeFile("/logs/app.log", "started\nERROR: disk full\n"));
+        ASSERT_TRUE(mount->writeFile("/logs/old.log", "ERROR happened\n"));
+        ASSERT_TRUE(mount->writeFile("/notes.txt", "error in lower case\n"));
+
+        GrepCommand cmd;
+        CommandContext context;
+        context.args = {"-r", "--no-color", "ERROR: d.sk", "/greptest"};
+        testing::internal::CaptureStdout();
+        auto status = cmd.execute(context);
+        std::string output = testing::internal::GetCapturedStdout();
+        EXPECT_TRUE(status.isSuccess());
+        EXPECT_EQ(output, "/greptest/logs/app.log:ERROR: disk full\n");
+
+        // The index ignores case; the matcher decides
+        context.args = {"-r", "--no-color", "error", "/greptest"};
+        testing::internal::CaptureStdout();
+        status = cmd.execute(context);
+        output = testing::internal::GetCapturedStdout();
+        EXPECT_TRUE(status.isSuccess());
+        EXPECT_EQ(output, "/greptest/notes.txt:error in lower case\n");
+
+        context.args = {"-r", "--no-color", "full|happened", "/greptest/logs"};
+        testing::internal::CaptureStdout();
+        status = cmd.execute(context);
+        output = testing::internal::GetCapturedStdout();
+        EXPECT_EQ(output, "/greptest/logs/app.log:ERROR: disk full\n"
+                          "/greptest/logs/old.log:ERROR happened\n");
+
+        vfs.removeMount("greptest");
+        mount->unmount();
+        std::filesystem::remove(test_dir_ / "grep.db");
+    }
+}
@@ -128,6 +128,70 @@ TEST_F(LocateCommandsTest, FileDatabaseClear)
     db.close();
 }
 
+TEST_F(LocateCommandsTest, FileDatabaseIncrementalUpdate)
+{
+    homeshell::FileDatabase db(db_path_);
+    ASSERT_TRUE(db.open());
+    // Not test_dir_ itself, which changes whenever the database is written
+    std::vector<std::string> paths = {(test_dir_ / "dir1").string(),
+                                      (test_dir_ / "dir2").string()};
+
+    auto stats = db.updateDatabase(paths, {"/proc"});
+    EXPECT_EQ(stats.scanned_directories, 3);
+    EXPECT_EQ(stats.skipped_directories, 0);
+    EXPECT_EQ(stats.total_files, 3);
+    EXPECT_EQ(stats.total_directories, 3);
+
+    // Nothing changed: no directory is listed again
+    stats = db.updateDatabase(paths, {"/proc"});
+    EXPECT_EQ(stats.scanned_directories, 0);
+    EXPECT_EQ(stats.skipped_directories, 3);
+    EXPECT_EQ(stats.entries_updated, 0);
+    EXPECT_EQ(stats.total_files, 3);
+
+    // Only the directories whose entries changed are listed
+    std::ofstream(test_dir_ / "dir2" / "subdir" / "added.txt") << "new";
+    fs::remove(test_dir_ / "dir1" / "file3.hpp");
+    stats = db.updateDatabase(paths, {"/proc"});
+    EXPECT_EQ(stats.scanned_directories, 2);
+    EXPECT_EQ(stats.skipped_directories, 1);
+    EXPECT_EQ(stats.entries_updated, 1);
+    EXPECT_EQ(stats.entries_removed, 1);
+    EXPECT_EQ(stats.total_files, 3);
+    EXPECT_EQ(db.search("added.txt", false, 10).size(), 1u);
+    EXPECT_TRUE(db.search("file3.hpp", false, 10).empty());
+
+    // A removed directory takes its entries with it
+    fs::remove_all(test_dir_ / "dir2" / "subdir");
+    stats = db.updateDatabase(paths, {"/proc"});
+    EXPECT_EQ(stats.scanned_directories, 1);
+    EXPECT_EQ(stats.entries_removed, 3);
+    EXPECT_EQ(stats.total_files, 1);
+    EXPECT_EQ(stats.total_directories, 2);
+
+    stats = db.updateDatabase(paths, {"/proc"}, true);
+    EXPECT_EQ(stats.scanned_directories, 2);
+    EXPECT_EQ(stats.skipped_directories, 0);
+    EXPECT_EQ(stats.total_files, 1);
+
+    db.close();
+}
+
+TEST_F(LocateCommandsTest, FileDatabaseRescansWhenPathsChange)
+{
+    homeshell::FileDatabase db(db_path_);
+    ASSERT_TRUE(db.open());
+
+    db.updateDatabase({(test_dir_ / "dir1").string(), (test_dir_ / "dir2").string()}, {"/proc"});
+    auto stats = db.updateDatabase({(test_dir_ / "dir2").string()}, {"/proc"});
+    EXPECT_EQ(stats.scanned_directories, 2);
+    EXPECT_EQ(stats.skipped_directories, 0);
+    EXPECT_EQ(stats.total_files, 2);
+    EXPECT_TRUE(db.search("file3.hpp", false, 10).empty());
+
+    db.close();
+}
+
 // UpdatedbCommand Tests
 TEST_F(LocateCommandsTest, UpdatedbGetName)
 {
@@ -0,0 +1,111 @@
+#include <homeshell/MetadataCache.hpp>
+#include <gtest/gtest.h>
+
+using homeshell::CachedMetadata;
+using homeshell::MetadataCache;
+
+namespace
+{
+
+CachedMetadata file(int64_t size)
+{
+    CachedMetadata metadata;
+    metadata.exists = true;
+    metadata.size = size;
+    return metadata;
+}
+
+} // namespace
+
+TEST(MetadataCacheTest, LookupCountsHitsAndMisses)
+{
+    MetadataCache cache;
+    CachedMetadata metadata;
+
+    EXPECT_FALSE(cache.lookup("/m/a.txt", metadata));
+    cache.insert("/m/a.txt", file(5));
+    ASSERT_TRUE(cache.lookup("/m/a.txt", metadata));
+    EXPECT_EQ(metadata.size, 5);
+
+    auto stats = cache.getStats();
+    EXPECT_EQ(stats.hits, 1u);
+    EXPECT_EQ(stats.misses, 1u);
+    EXPECT_EQ(stats.entries, 1u);
+
+    cache.resetStats();
+    EXPECT_EQ(cache.getStats().hits, 0u);
+    EXPECT_EQ(cache.getStats().entries, 1u);
+}
+
+TEST(MetadataCacheTest, EvictsLeastRecentlyUsed)
+{
+    MetadataCache cache(2);
+    CachedMetadata metadata;
+
+    cache.insert("/m/a", file(1));
+    cache.insert("/m/b", file(2));
+    EXPECT_TRUE(cache.lookup("/m/a", metadata)); // b is now least recent
+    cache.insert("/m/c", file(3));
+
+    EXPECT_TRUE(cache.lookup("/m/a", metadata));
+    EXPECT_FALSE(cache.lookup("/m/b", metadata));
+    EXPECT_TRUE(cache.lookup("/m/c", metadata));
+    EXPECT_EQ(cache.getStats().entries, 2u);
+}
+
+TEST(MetadataCacheTest, InvalidateDropsPathAndAncestors)
+{
+    MetadataCache cache;
+    CachedMetadata metadata;
+
+    cache.insert("/m", file(0));
+    cache.insert("/m/dir", CachedMetadata()); // cached as missing
+    cache.insert("/m/dir/new.txt", CachedMetadata());
+    cache.insert("/m/other.txt", file(1));
+
+    cache.invalidate("/m/dir/new.txt");
+    EXPECT_FALSE(cache.lookup("/m/dir/new.txt", metadata));
+    EXPECT_FALSE(cache.lookup("/m/dir", metadata));
+    EXPECT_FALSE(cache.lookup("/m", metadata));
+    EXPECT_TRUE(cache.lookup("/m/other.txt", metadata));
+}
+
+TEST(MetadataCacheTest, InvalidateTreeDropsDescendants)
+{
+    MetadataCache cache;
+    CachedMetadata metadata;
+
+    cache.insert("/m/dir", file(0));
+    cache.insert("/m/dir/a.txt", file(1));
+    cache.insert("/m/dir/sub/b.txt", file(2));
+    cache.insert("/m/dir2/c.txt", file(3));
+
+    cache.invalidateTree("/m/dir");
+    EXPECT_FALSE(cache.lookup("/m/dir", metadata));
+    EXPECT_FALSE(cache.lookup("/m/dir/a.txt", metadata));
+    EXPECT_FALSE(cache.lookup("/m/dir/sub/b.txt", metadata));
+    EXPECT_TRUE(cache.lookup("/m/dir2/c.txt", metadata));
+}
+
+TEST(MetadataCacheTest, StaleInsertAfterInvalidateIsDropped)
+{
+    MetadataCache cache;
+    CachedMetadata metadata;
+
+    // A reader queried the mount, then a writer changed the path
+    uint64_t generation = cache.generation();
+    cache.invalidate("/m/a.txt");
+    cache.insert("/m/a.txt", CachedMetadata(), generation);
+    EXPECT_FALSE(cache.lookup("/m/a.txt", metadata));
+
+    generation = cache.generation();
+    cache.invalidateTree("/m");
+    cache.insert("/m/dir/b.txt", file(1), generation);
+    EXPECT_FALSE(cache.lookup("/m/dir/b.txt", metadata));
+
+    // Nothing changed in between
+    generation = cache.generation();
+    cache.insert("/m/a.txt", file(2), generation);
+    ASSERT_TRUE(cache.lookup("/m/a.txt", metadata));
+    EXPECT_EQ(metadata.size, 2);
+}
@@ -0,0 +1,61 @@
+#include <homeshell/commands/MountCommand.hpp>
+#include <gtest/gtest.h>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+class MountCommandTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        test_dir_ = fs::temp_directory_path() / "homeshell_mount_cmd_test";
+        fs::remove_all(test_dir_);
+        fs::create_directories(test_dir_);
+        db_path_ = (test_dir_ / "test.db").string();
+    }
+
+    void TearDown() override
+    {
+        homeshell::VirtualFilesystem::getInstance().removeMount("cmdtest");
+        fs::remove_all(test_dir_);
+    }
+
+    homeshell::Status run(std::vector<std::string> args)
+    {
+        homeshell::CommandContext context;
+        context.args = std::move(args);
+        context.use_colors = false;
+        testing::internal::CaptureStdout();
+        homeshell::Status status = command_.execute(context);
+        testing::internal::GetCapturedStdout();
+        return status;
+    }
+
+    homeshell::MountCommand command_;
+    fs::path test_dir_;
+    std::string db_path_;
+};
+
+TEST_F(MountCommandTest, PassesCipherOptions)
+{
+    EXPECT_TRUE(run({"--kdf-iter", "4000", "cmdtest", db_path_, "/cmdtest", "secret",
+                     "--cipher-page-size", "8192"})
+                    .isSuccess());
+
+    auto* mount = homeshell::VirtualFilesystem::getInstance().getMount("cmdtest");
+    ASSERT_NE(mount, nullptr);
+    EXPECT_EQ(mount->getOptions().cipher_page_size, 8192);
+    EXPECT_EQ(mount->getOptions().kdf_iter, 4000);
+}
+
+TEST_F(MountCommandTest, RejectsInvalidOptions)
+{
+    EXPECT_FALSE(run({"cmdtest", db_path_, "/cmdtest", "secret", "--kdf-iter", "many"})
+                     .isSuccess());
+    EXPECT_FALSE(run({"cmdtest", db_path_, "/cmdtest", "secret", "--cipher-page-size", "0"})
+                     .isSuccess());
+    EXPECT_FALSE(run({"cmdtest", db_path_, "/cmdtest", "secret", "--kdf-iter"}).isSuccess());
+    EXPECT_FALSE(run({"--kdf-iter", "4000", "cmdtest", db_path_}).isSuccess());
+    EXPECT_EQ(homeshell::VirtualFilesystem::getInstance().getMount("cmdtest"), nullptr);
+}
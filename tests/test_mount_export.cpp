@@ -0,0 +1,119 @@
+#include <homeshell/EncryptedMount.hpp>
+#include <homeshell/MountExport.hpp>
+#include <gtest/gtest.h>
+#include <miniz.h>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace fs = std::filesystem;
+
+class MountExportTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        test_dir_ = fs::temp_directory_path() / "homeshell_export_test";
+        fs::remove_all(test_dir_);
+        fs::create_directories(test_dir_);
+
+        mount_ = std::make_unique<homeshell::EncryptedMount>(
+            "test", (test_dir_ / "test.db").string(), "/test", 10);
+        ASSERT_TRUE(mount_->mount("export_password"));
+
+        // A file spanning several export blocks and chunks
+        large_.resize(static_cast<size_t>(homeshell::EncryptedMount::kChunkSize * 20 + 3));
+        for (size_t i = 0; i < large_.size(); ++i)
+        {
+            large_[i] = static_cast<char>(i * 7 % 253);
+        }
+        ASSERT_TRUE(mount_->writeFile("/docs/readme.txt", "hello"));
+        ASSERT_TRUE(mount_->writeFile("/docs/blank.txt", ""));
+        ASSERT_TRUE(mount_->writeFile("/media/video.bin", large_));
+        ASSERT_TRUE(mount_->createDirectory("/empty"));
+    }
+
+    void TearDown() override
+    {
+        mount_.reset();
+        fs::remove_all(test_dir_);
+    }
+
+    static std::string readReal(const fs::path& path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    }
+
+    fs::path test_dir_;
+    std::unique_ptr<homeshell::EncryptedMount> mount_;
+    std::string large_;
+};
+
+TEST_F(MountExportTest, ExportsToDirectory)
+{
+    auto dest = test_dir_ / "out";
+    homeshell::ExportStats stats;
+    std::string error;
+    ASSERT_TRUE(homeshell::exportToDirectory(*mount_, "/", dest, stats, error)) << error;
+
+    EXPECT_EQ(stats.files, 3);
+    EXPECT_EQ(stats.directories, 3);
+    EXPECT_EQ(stats.bytes, static_cast<int64_t>(5 + large_.size()));
+    EXPECT_EQ(readReal(dest / "docs" / "readme.txt"), "hello");
+    EXPECT_TRUE(fs::exists(dest / "docs" / "blank.txt"));
+    EXPECT_EQ(fs::file_size(dest / "docs" / "blank.txt"), 0u);
+    EXPECT_EQ(readReal(dest / "media" / "video.bin"), large_);
+    EXPECT_TRUE(fs::is_directory(dest / "empty"));
+}
+
+TEST_F(MountExportTest, ExportsSubdirectory)
+{
+    auto dest = test_dir_ / "docs_out";
+    homeshell::ExportStats stats;
+    std::string error;
+    ASSERT_TRUE(homeshell::exportToDirectory(*mount_, "/docs/", dest, stats, error)) << error;
+
+    EXPECT_EQ(stats.files, 2);
+    EXPECT_EQ(readReal(dest / "readme.txt"), "hello");
+    EXPECT_FALSE(fs::exists(dest / "media"));
+}
+
+TEST_F(MountExportTest, ExportsToZip)
+{
+    auto zip_path = test_dir_ / "out.zip";
+    homeshell::ExportStats stats;
+    std::string error;
+    ASSERT_TRUE(homeshell::exportToZip(*mount_, "/", zip_path, stats, error)) << error;
+    EXPECT_EQ(stats.files, 3);
+
+    mz_zip_archive zip;
+    std::memset(&zip, 0, sizeof(zip));
+    ASSERT_TRUE(mz_zip_reader_init_file(&zip, zip_path.c_str(), 0));
+    EXPECT_EQ(mz_zip_reader_get_num_files(&zip), 6u);
+
+    size_t size = 0;
+    void* data = mz_zip_reader_extract_file_to_heap(&zip, "media/video.bin", &size, 0);
+    ASSERT_NE(data, nullptr);
+    EXPECT_EQ(std::string(static_cast<char*>(data), size), large_);
+    mz_free(data);
+
+    data = mz_zip_reader_extract_file_to_heap(&zip, "docs/readme.txt", &size, 0);
+    ASSERT_NE(data, nullptr);
+    EXPECT_EQ(std::string(static_cast<char*>(data), size), "hello");
+    mz_free(data);
+    mz_zip_reader_end(&zip);
+}
+
+TEST_F(MountExportTest, RejectsFileAsSource)
+{
+    homeshell::ExportStats stats;
+    std::string error;
+    EXPECT_FALSE(homeshell::exportToDirectory(*mount_, "/docs/readme.txt", test_dir_ / "out",
+                                              stats, error));
+    EXPECT_FALSE(error.empty());
+    EXPECT_FALSE(
+        homeshell::exportToZip(*mount_, "/missing", test_dir_ / "out.zip", stats, error));
+    EXPECT_FALSE(fs::exists(test_dir_ / "out.zip"));
+}
@@ -0,0 +1,133 @@
+#include <homeshell/EncryptedMount.hpp>
+#include <homeshell/MountImport.hpp>
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace fs = std::filesystem;
+
+class MountImportTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        test_dir_ = fs::temp_directory_path() / "homeshell_import_test";
+        fs::remove_all(test_dir_);
+        source_ = test_dir_ / "source";
+        fs::create_directories(source_ / "photos" / "2024");
+        fs::create_directories(source_ / "empty");
+        db_path_ = test_dir_ / "test.db";
+    }
+
+    void TearDown() override
+    {
+        fs::remove_all(test_dir_);
+    }
+
+    void writeSource(const std::string& relative, const std::string& content)
+    {
+        std::ofstream(source_ / relative, std::ios::binary) << content;
+    }
+
+    fs::path test_dir_;
+    fs::path source_;
+    fs::path db_path_;
+    std::string password_ = "import_password";
+};
+
+TEST_F(MountImportTest, ImportsTree)
+{
+    // Sizes around the chunk and block boundaries
+    const int64_t chunk = homeshell::EncryptedMount::kChunkSize;
+    std::string large(static_cast<size_t>(chunk * 5 + 17), '\0');
+    for (size_t i = 0; i < large.size(); ++i)
+    {
+        large[i] = static_cast<char>(i * 31 % 251);
+    }
+    writeSource("readme.txt", "hello");
+    writeSource("blank.txt", "");
+    writeSource("photos/2024/large.bin", large);
+    writeSource("photos/2024/exact.bin", std::string(static_cast<size_t>(chunk * 2), 'e'));
+
+    homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10);
+    ASSERT_TRUE(mount.mount(password_));
+
+    homeshell::ImportOptions options;
+    options.workers = 3;
+    options.block_bytes = chunk * 2;
+    options.queue_bytes = chunk * 4;
+    options.batch_bytes = chunk * 3;
+    homeshell::ImportStats stats;
+    std::string error;
+    ASSERT_TRUE(homeshell::importDirectory(mount, source_, "/imported/", options, stats, error))
+        << error;
+
+    EXPECT_EQ(stats.files, 4);
+    EXPECT_EQ(stats.directories, 4); // target, photos, photos/2024, empty
+    EXPECT_EQ(stats.bytes, static_cast<int64_t>(5 + large.size() + chunk * 2));
+    EXPECT_GT(stats.commits, 1);
+    EXPECT_TRUE(stats.failed.empty());
+
+    std::string content;
+    EXPECT_TRUE(mount.readFile("/imported/readme.txt", content));
+    EXPECT_EQ(content, "hello");
+    EXPECT_TRUE(mount.readFile("/imported/blank.txt", content));
+    EXPECT_EQ(content, "");
+    EXPECT_TRUE(mount.readFile("/imported/photos/2024/large.bin", content));
+    EXPECT_EQ(content, large);
+    EXPECT_EQ(mount.getFileSize("/imported/photos/2024/exact.bin"), chunk * 2);
+    EXPECT_TRUE(mount.isDirectory("/imported/empty"));
+
+    // Re-importing overwrites, including files that shrank
+    writeSource("photos/2024/large.bin", "small");
+    ASSERT_TRUE(homeshell::importDirectory(mount, source_, "/imported", options, stats, error));
+    EXPECT_TRUE(mount.readFile("/imported/photos/2024/large.bin", content));
+    EXPECT_EQ(content, "small");
+}
+
+TEST_F(MountImportTest, RejectsMissingSource)
+{
+    homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 10);
+    ASSERT_TRUE(mount.mount(password_));
+
+    homeshell::ImportStats stats;
+    std::string error;
+    EXPECT_FALSE(homeshell::importDirectory(mount, test_dir_ / "missing", "/", {}, stats, error));
+    EXPECT_FALSE(error.empty());
+}
+
+TEST_F(MountImportTest, StopsWhenQuotaExceeded)
+{
+    for (int i = 0; i < 4; ++i)
+    {
+        writeSource("file" + std::to_string(i) + ".bin", std::string(400 * 1024, 'q'));
+    }
+
+    homeshell::EncryptedMount mount("test", db_path_.string(), "/test", 1);
+    ASSERT_TRUE(mount.mount(password_));
+
+    // Blocks of one chunk, so the quota is hit in the middle of a file
+    homeshell::ImportOptions options;
+    options.block_bytes = homeshell::EncryptedMount::kChunkSize;
+    homeshell::ImportStats stats;
+    std::string error;
+    EXPECT_FALSE(homeshell::importDirectory(mount, source_, "/", options, stats, error));
+    EXPECT_FALSE(error.empty());
+    EXPECT_LE(mount.getUsage().used_bytes, 1024 * 1024);
+
+    // Only complete files are kept; the partly written ones are reported
+    int64_t kept = 0;
+    for (const auto& entry : mount.listDirectory("/"))
+    {
+        if (!entry.is_directory)
+        {
+            EXPECT_EQ(entry.size, 400 * 1024) << entry.path;
+            ++kept;
+        }
+    }
+    EXPECT_EQ(kept, stats.files);
+    EXPECT_FALSE(stats.failed.empty());
+    EXPECT_EQ(stats.bytes, stats.files * 400 * 1024);
+    EXPECT_EQ(mount.getUsage().used_bytes, stats.bytes);
+}
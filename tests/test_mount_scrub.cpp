@@ -0,0 +1,120 @@
+#include <homeshell/EncryptedMount.hpp>
+#include <homeshell/MountScrub.hpp>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <filesystem>
+#include <string>
+
+namespace fs = std::filesystem;
+
+class MountScrubTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        test_dir_ = fs::temp_directory_path() / "homeshell_scrub_test";
+        fs::remove_all(test_dir_);
+        fs::create_directories(test_dir_);
+        db_path_ = test_dir_ / "test.db";
+
+        mount_ = std::make_unique<homeshell::EncryptedMount>("test", db_path_.string(), "/test",
+                                                             10);
+        ASSERT_TRUE(mount_->mount(password_));
+
+        std::string large(static_cast<size_t>(homeshell::EncryptedMount::kChunkSize * 3), 'x');
+        ASSERT_TRUE(mount_->writeFile("/docs/readme.txt", "hello"));
+        ASSERT_TRUE(mount_->writeFile("/docs/blank.txt", ""));
+        ASSERT_TRUE(mount_->writeFile("/media/video.bin", large));
+        ASSERT_TRUE(mount_->writeFileRange("/media/video.bin", 10, "patched"));
+    }
+
+    void TearDown() override
+    {
+        mount_.reset();
+        fs::remove_all(test_dir_);
+    }
+
+    /**
+     * @brief Overwrite a stored chunk behind the mount's back
+     */
+    void corruptChunk(const std::string& path, int64_t idx)
+    {
+        sqlite3* db = nullptr;
+        ASSERT_EQ(sqlite3_open(db_path_.string().c_str(), &db), SQLITE_OK);
+        sqlite3_key(db, password_.c_str(), static_cast<int>(password_.size()));
+        std::string sql = "UPDATE chunks SET data = zeroblob(length(data)) WHERE idx = " +
+                          std::to_string(idx) +
+                          " AND file_id = (SELECT id FROM files WHERE path = '" + path + "')";
+        EXPECT_EQ(sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr), SQLITE_OK);
+        EXPECT_EQ(sqlite3_changes(db), 1);
+        sqlite3_close(db);
+    }
+
+    fs::path test_dir_;
+    fs::path db_path_;
+    std::string password_ = "scrub_password";
+    std::unique_ptr<homeshell::EncryptedMount> mount_;
+};
+
+TEST_F(MountScrubTest, CleanMount)
+{
+    homeshell::ScrubOptions options;
+    options.workers = 2;
+    homeshell::ScrubStats stats;
+    std::string error;
+    ASSERT_TRUE(homeshell::scrubMount(*mount_, options, stats, error)) << error;
+
+    EXPECT_TRUE(stats.clean());
+    EXPECT_EQ(stats.files, 3);
+    EXPECT_EQ(stats.chunks, 4);
+    EXPECT_EQ(stats.unverified_chunks, 0);
+    EXPECT_EQ(stats.bytes, 5 + homeshell::EncryptedMount::kChunkSize * 3);
+    EXPECT_FALSE(stats.stopped);
+}
+
+TEST_F(MountScrubTest, ReportsCorruptFile)
+{
+    corruptChunk("/media/video.bin", 1);
+
+    homeshell::FileCheck check;
+    ASSERT_TRUE(mount_->verifyFile("/media/video.bin", check));
+    EXPECT_EQ(check.chunks, 3);
+    ASSERT_EQ(check.corrupt.size(), 1u);
+    EXPECT_EQ(check.corrupt[0], 1);
+
+    homeshell::ScrubStats stats;
+    std::string error;
+    ASSERT_TRUE(homeshell::scrubMount(*mount_, {}, stats, error)) << error;
+    EXPECT_FALSE(stats.clean());
+    EXPECT_TRUE(stats.integrity_errors.empty());
+    ASSERT_EQ(stats.corrupt.size(), 1u);
+    EXPECT_EQ(stats.corrupt[0], "/media/video.bin");
+}
+
+TEST_F(MountScrubTest, StopsWhenAsked)
+{
+    std::atomic<bool> stop{true};
+    homeshell::ScrubOptions options;
+    options.stop = &stop;
+    homeshell::ScrubStats stats;
+    std::string error;
+    ASSERT_TRUE(homeshell::scrubMount(*mount_, options, stats, error)) << error;
+    EXPECT_TRUE(stats.stopped);
+    EXPECT_EQ(stats.files, 0);
+}
+
+TEST_F(MountScrubTest, WriterOnlyMount)
+{
+    mount_->unmount();
+    homeshell::MountOptions options;
+    options.read_connections = 0;
+    mount_ = std::make_unique<homeshell::EncryptedMount>("test", db_path_.string(), "/test", 10,
+                                                         options);
+    ASSERT_TRUE(mount_->mount(password_));
+
+    homeshell::ScrubStats stats;
+    std::string error;
+    ASSERT_TRUE(homeshell::scrubMount(*mount_, {}, stats, error)) << error;
+    EXPECT_TRUE(stats.clean());
+    EXPECT_EQ(stats.files, 3);
+}
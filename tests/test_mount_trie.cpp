@@ -0,0 +1,62 @@
+#include <homeshell/MountTrie.hpp>
+#include <gtest/gtest.h>
+
+using homeshell::EncryptedMount;
+using homeshell::MountTrie;
+
+namespace
+{
+
+// The trie only stores the pointers, so any distinct addresses will do
+EncryptedMount* fakeMount(int id)
+{
+    return reinterpret_cast<EncryptedMount*>(static_cast<uintptr_t>(0x1000 + id * 16));
+}
+
+} // namespace
+
+TEST(MountTrieTest, MatchesWholeComponentsOnly)
+{
+    MountTrie trie;
+    ASSERT_TRUE(trie.insert("/data", fakeMount(1)));
+
+    auto match = trie.findLongestPrefix("/data/file.txt");
+    EXPECT_EQ(match.mount, fakeMount(1));
+    EXPECT_EQ(match.length, 5u);
+
+    match = trie.findLongestPrefix("/data");
+    EXPECT_EQ(match.mount, fakeMount(1));
+    EXPECT_EQ(match.length, 5u);
+
+    EXPECT_EQ(trie.findLongestPrefix("/database").mount, nullptr);
+    EXPECT_EQ(trie.findLongestPrefix("/").mount, nullptr);
+    EXPECT_EQ(trie.findLongestPrefix("/other/data").mount, nullptr);
+}
+
+TEST(MountTrieTest, DeepestMountPointWins)
+{
+    MountTrie trie;
+    ASSERT_TRUE(trie.insert("/mnt", fakeMount(1)));
+    ASSERT_TRUE(trie.insert("/mnt/usb/secure", fakeMount(2)));
+
+    auto match = trie.findLongestPrefix("/mnt/usb/secure/a/b");
+    EXPECT_EQ(match.mount, fakeMount(2));
+    EXPECT_EQ(match.length, 15u);
+
+    match = trie.findLongestPrefix("/mnt/usb/other");
+    EXPECT_EQ(match.mount, fakeMount(1));
+    EXPECT_EQ(match.length, 4u);
+}
+
+TEST(MountTrieTest, DuplicateMountPointKeepsFirst)
+{
+    MountTrie trie;
+    EXPECT_TRUE(trie.insert("/secure", fakeMount(1)));
+    EXPECT_FALSE(trie.insert("/secure/", fakeMount(2)));
+    EXPECT_EQ(trie.size(), 1u);
+    EXPECT_EQ(trie.findLongestPrefix("/secure/x").mount, fakeMount(1));
+
+    trie.clear();
+    EXPECT_EQ(trie.size(), 0u);
+    EXPECT_EQ(trie.findLongestPrefix("/secure/x").mount, nullptr);
+}
@@ -1,4 +1,6 @@
+#include <homeshell/EncryptedMount.hpp>
 #include <homeshell/OutputRedirection.hpp>
+#include <homeshell/VirtualFilesystem.hpp>
 #include <gtest/gtest.h>
 #include <filesystem>
 #include <fstream>
@@ -216,4 +218,33 @@ TEST_F(OutputRedirectionTest, InvalidFilePath)
     EXPECT_FALSE(redirector.redirect(info));
 }
 
+// Test redirection into an encrypted mount (> then >>)
+TEST_F(OutputRedirectionTest, RedirectIntoVirtualFile)
+{
+    auto& vfs = VirtualFilesystem::getInstance();
+    auto mount = std::make_shared<EncryptedMount>("redir", (test_dir_ / "redir.db").string(),
+                                                  "/redir", 10);
+    ASSERT_TRUE(mount->mount("password"));
+    vfs.addMount(mount);
+
+    RedirectInfo info;
+    info.type = RedirectType::Stdout;
+    info.mode = RedirectMode::Truncate;
+    info.filename = "/redir/out.txt";
+    info.command = "test";
 
+    for (const char* line : {"first", "second"})
+    {
+        OutputRedirection redirector;
+        ASSERT_TRUE(redirector.redirect(info));
+        std::cout << line << std::endl;
+        redirector.restore();
+        info.mode = RedirectMode::Append;
+    }
+
+    std::string content;
+    EXPECT_TRUE(vfs.readFile("/redir/out.txt", content));
+    EXPECT_EQ(content, "first\nsecond\n");
+
+    vfs.removeMount("redir");
+}
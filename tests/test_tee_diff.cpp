@@ -3,6 +3,8 @@
  * @brief Unit tests for text processing commands batch 3 (tee, diff)
  */
 
+#include <homeshell/EncryptedMount.hpp>
+#include <homeshell/VirtualFilesystem.hpp>
 #include <homeshell/commands/DiffCommand.hpp>
 #include <homeshell/commands/TeeCommand.hpp>
 
@@ -141,6 +143,31 @@ TEST_F(TeeCommandTest, AppendMode)
     EXPECT_NE(content.find("appended"), std::string::npos);
 }
 
+TEST_F(TeeCommandTest, AppendToVirtualFile)
+{
+    auto& vfs = VirtualFilesystem::getInstance();
+    auto mount = std::make_shared<EncryptedMount>("tee", test_dir + "/tee.db", "/teevault", 10);
+    ASSERT_TRUE(mount->mount("password"));
+    vfs.addMount(mount);
+
+    CommandContext ctx;
+    setInput("one\n");
+    ctx.args = {"/teevault/log.txt"};
+    EXPECT_TRUE(cmd.execute(ctx).isOk());
+
+    std::cin.clear();
+    setInput("two\nthree\n");
+    ctx.args = {"-a", "/teevault/log.txt"};
+    EXPECT_TRUE(cmd.execute(ctx).isOk());
+
+    std::string content;
+    EXPECT_TRUE(vfs.readFile("/teevault/log.txt", content));
+    EXPECT_EQ(content, "one\ntwo\nthree\n");
+    EXPECT_EQ(getOutput(), "one\ntwo\nthree\n");
+
+    vfs.removeMount("tee");
+}
+
 TEST_F(TeeCommandTest, OverwriteMode)
 {
     std::string file = test_dir + "/overwrite.txt";
@@ -152,6 +152,34 @@ TEST_F(VirtualFilesystemTest, WriteAndReadFileVirtual)
     EXPECT_EQ(content, "Virtual content");
 }
 
+TEST_F(VirtualFilesystemTest, AppendFile)
+{
+    auto& vfs = homeshell::VirtualFilesystem::getInstance();
+
+    auto mount = std::make_shared<homeshell::EncryptedMount>(
+        "test", db_path_.string(), "/virtual", 10);
+    ASSERT_TRUE(mount->mount(password_));
+    vfs.addMount(mount);
+
+    auto real_path = (test_dir_ / "log.txt").string();
+    for (const auto& path : {real_path, std::string("/virtual/log.txt")})
+    {
+        homeshell::VirtualFileInfo info;
+        EXPECT_TRUE(vfs.appendFile(path, "one\n"));
+        EXPECT_TRUE(vfs.stat(path, info));
+        EXPECT_EQ(info.size, 4);
+        EXPECT_TRUE(vfs.appendFile(path, "two\n"));
+        EXPECT_TRUE(vfs.stat(path, info));
+        EXPECT_EQ(info.size, 8);
+
+        std::string content;
+        EXPECT_TRUE(vfs.readFile(path, content));
+        EXPECT_EQ(content, "one\ntwo\n");
+    }
+
+    EXPECT_FALSE(vfs.appendFile("/virtual", "data"));
+}
+
 TEST_F(VirtualFilesystemTest, CreateDirectoryReal)
 {
     auto& vfs = homeshell::VirtualFilesystem::getInstance();
@@ -260,3 +288,248 @@ TEST_F(VirtualFilesystemTest, MultipleMounts)
     EXPECT_EQ(content2, "mount2 content");
 }
 
+
+TEST_F(VirtualFilesystemTest, OpenFileReal)
+{
+    auto& vfs = homeshell::VirtualFilesystem::getInstance();
+
+    auto path = (test_dir_ / "stream.txt").string();
+    auto writer = vfs.openFile(path, homeshell::VfsOpenMode::Write);
+    ASSERT_NE(writer, nullptr);
+    EXPECT_EQ(writer->write("hello ", 6), 6);
+    EXPECT_EQ(writer->append("world", 5), 5);
+    EXPECT_EQ(writer->size(), 11);
+    writer->close();
+
+    auto reader = vfs.openFile(path);
+    ASSERT_NE(reader, nullptr);
+    char buffer[16] = {};
+    EXPECT_EQ(reader->seek(6), 6);
+    EXPECT_EQ(reader->read(buffer, sizeof(buffer)), 5);
+    EXPECT_EQ(std::string(buffer, 5), "world");
+    EXPECT_EQ(reader->read(buffer, sizeof(buffer)), 0);
+    EXPECT_EQ(reader->pread(buffer, 5, 0), 5);
+    EXPECT_EQ(std::string(buffer, 5), "hello");
+
+    EXPECT_EQ(vfs.openFile((test_dir_ / "missing.txt").string()), nullptr);
+    EXPECT_EQ(vfs.openFile(test_dir_.string()), nullptr);
+}
+
+TEST_F(VirtualFilesystemTest, OpenFileVirtual)
+{
+    auto& vfs = homeshell::VirtualFilesystem::getInstance();
+
+    auto mount = std::make_shared<homeshell::EncryptedMount>(
+        "test", db_path_.string(), "/virtual", 10);
+    ASSERT_TRUE(mount->mount(password_));
+    vfs.addMount(mount);
+
+    auto writer = vfs.openFile("/virtual/dir/stream.txt", homeshell::VfsOpenMode::Write);
+    ASSERT_NE(writer, nullptr);
+    EXPECT_EQ(writer->write("line1\n", 6), 6);
+    EXPECT_EQ(writer->write("line2\n", 6), 6);
+    EXPECT_EQ(writer->seek(0, homeshell::VfsSeekOrigin::End), 12);
+    EXPECT_EQ(writer->append("line3\n", 6), 6);
+
+    auto reader = vfs.openFile("/virtual/dir/stream.txt");
+    ASSERT_NE(reader, nullptr);
+    EXPECT_EQ(reader->size(), 18);
+
+    // Small buffer forces several refills
+    homeshell::VfsStreamBuf buf(*reader, 4);
+    std::istream in(&buf);
+    std::vector<std::string> lines;
+    std::string line;
+    while (std::getline(in, line))
+    {
+        lines.push_back(line);
+    }
+    EXPECT_EQ(lines, (std::vector<std::string>{"line1", "line2", "line3"}));
+
+    EXPECT_EQ(vfs.openFile("/virtual/missing.txt"), nullptr);
+    EXPECT_EQ(vfs.openFile("/virtual/dir"), nullptr);
+}
+
+TEST_F(VirtualFilesystemTest, OpenFileModes)
+{
+    auto& vfs = homeshell::VirtualFilesystem::getInstance();
+
+    auto mount = std::make_shared<homeshell::EncryptedMount>(
+        "test", db_path_.string(), "/virtual", 10);
+    ASSERT_TRUE(mount->mount(password_));
+    vfs.addMount(mount);
+
+    for (const std::string& path : {(test_dir_ / "modes.txt").string(),
+                                    std::string("/virtual/modes.txt")})
+    {
+        ASSERT_TRUE(vfs.writeFile(path, "start"));
+
+        // Two appenders never overwrite each other's data
+        auto first = vfs.openFile(path, homeshell::VfsOpenMode::Append);
+        auto second = vfs.openFile(path, homeshell::VfsOpenMode::Append);
+        ASSERT_NE(first, nullptr);
+        ASSERT_NE(second, nullptr);
+        EXPECT_EQ(first->tell(), 5);
+        EXPECT_EQ(second->append("-two", 4), 4);
+        EXPECT_EQ(first->write("-one", 4), 4);
+        EXPECT_EQ(second->append("-three", 6), 6);
+        EXPECT_EQ(second->tell(), 19);
+        char buffer[4];
+        EXPECT_EQ(first->pread(buffer, sizeof(buffer), 0), -1);
+        first->close();
+        second->close();
+
+        auto reader = vfs.openFile(path);
+        ASSERT_NE(reader, nullptr);
+        EXPECT_EQ(reader->write("x", 1), -1);
+        EXPECT_EQ(reader->append("x", 1), -1);
+        reader->close();
+
+        std::string content;
+        ASSERT_TRUE(vfs.readFile(path, content));
+        EXPECT_EQ(content, "start-two-one-three") << path;
+    }
+}
+
+TEST_F(VirtualFilesystemTest, BatchGuard)
+{
+    auto& vfs = homeshell::VirtualFilesystem::getInstance();
+
+    auto mount = std::make_shared<homeshell::EncryptedMount>(
+        "test", db_path_.string(), "/virtual", 10);
+    ASSERT_TRUE(mount->mount(password_));
+    vfs.addMount(mount);
+
+    {
+        homeshell::VfsBatch outer("/virtual/import");
+        {
+            homeshell::VfsBatch inner(mount.get());
+            EXPECT_TRUE(vfs.writeFile("/virtual/import/one.txt", "1"));
+        }
+        EXPECT_TRUE(vfs.writeFile("/virtual/import/two.txt", "2"));
+        EXPECT_TRUE(outer.commit());
+        EXPECT_TRUE(outer.commit()); // already committed, no-op
+    }
+    EXPECT_FALSE(mount->endBatch()); // guards left no batch open
+    EXPECT_EQ(vfs.listDirectory("/virtual/import").size(), 2);
+
+    // Real paths have nothing to batch
+    homeshell::VfsBatch real(test_dir_.string());
+    EXPECT_TRUE(real.commit());
+}
+
+TEST_F(VirtualFilesystemTest, MetadataCacheServesRepeatedLookups)
+{
+    auto& vfs = homeshell::VirtualFilesystem::getInstance();
+
+    auto mount = std::make_shared<homeshell::EncryptedMount>(
+        "test", db_path_.string(), "/virtual", 10);
+    ASSERT_TRUE(mount->mount(password_));
+    vfs.addMount(mount);
+    vfs.writeFile("/virtual/dir/a.txt", "abc");
+    vfs.writeFile("/virtual/dir/b.txt", "defg");
+
+    vfs.resetMetadataCacheStats();
+    EXPECT_TRUE(vfs.exists("/virtual/dir/a.txt"));
+    EXPECT_FALSE(vfs.isDirectory("/virtual/dir/a.txt"));
+    homeshell::VirtualFileInfo info;
+    ASSERT_TRUE(vfs.stat("/virtual/dir/a.txt", info));
+    EXPECT_EQ(info.size, 3);
+    EXPECT_EQ(info.path, "/virtual/dir/a.txt");
+
+    auto stats = vfs.getMetadataCacheStats();
+    EXPECT_EQ(stats.misses, 1u);
+    EXPECT_EQ(stats.hits, 2u);
+
+    // Listing pre-populates the children
+    vfs.resetMetadataCacheStats();
+    vfs.listDirectory("/virtual/dir");
+    EXPECT_TRUE(vfs.exists("/virtual/dir/b.txt"));
+    EXPECT_EQ(vfs.getMetadataCacheStats().hits, 1u);
+    EXPECT_EQ(vfs.getMetadataCacheStats().misses, 0u);
+}
+
+TEST_F(VirtualFilesystemTest, MetadataCacheFollowsMountChanges)
+{
+    auto& vfs = homeshell::VirtualFilesystem::getInstance();
+
+    auto mount = std::make_shared<homeshell::EncryptedMount>(
+        "test", db_path_.string(), "/virtual", 10);
+    ASSERT_TRUE(mount->mount(password_));
+    vfs.addMount(mount);
+
+    // Negative entries are dropped when the path (or a child) is created
+    EXPECT_FALSE(vfs.exists("/virtual/new"));
+    EXPECT_FALSE(vfs.exists("/virtual/new/file.txt"));
+    vfs.writeFile("/virtual/new/file.txt", "12345");
+    EXPECT_TRUE(vfs.isDirectory("/virtual/new"));
+    homeshell::VirtualFileInfo info;
+    ASSERT_TRUE(vfs.stat("/virtual/new/file.txt", info));
+    EXPECT_EQ(info.size, 5);
+
+    // Writes through a streaming handle or directly on the mount are seen too
+    auto file = vfs.openFile("/virtual/new/file.txt", homeshell::VfsOpenMode::Append);
+    ASSERT_NE(file, nullptr);
+    file->write("67", 2);
+    ASSERT_TRUE(vfs.stat("/virtual/new/file.txt", info));
+    EXPECT_EQ(info.size, 7);
+    mount->writeFile("/new/file.txt", "1");
+    ASSERT_TRUE(vfs.stat("/virtual/new/file.txt", info));
+    EXPECT_EQ(info.size, 1);
+
+    EXPECT_TRUE(vfs.rename("/virtual/new", "/virtual/moved"));
+    EXPECT_FALSE(vfs.exists("/virtual/new/file.txt"));
+    EXPECT_TRUE(vfs.exists("/virtual/moved/file.txt"));
+
+    EXPECT_TRUE(vfs.remove("/virtual/moved"));
+    EXPECT_FALSE(vfs.exists("/virtual/moved/file.txt"));
+    EXPECT_FALSE(vfs.isDirectory("/virtual/moved"));
+
+    // Nothing is served for a removed mount
+    EXPECT_TRUE(vfs.exists("/virtual"));
+    vfs.removeMount("test");
+    EXPECT_FALSE(vfs.isVirtualPath("/virtual"));
+}
+
+TEST_F(VirtualFilesystemTest, NormalizePath)
+{
+    using homeshell::VirtualFilesystem;
+
+    EXPECT_EQ(VirtualFilesystem::normalizePath("/home/user", "docs/a.txt"),
+              "/home/user/docs/a.txt");
+    EXPECT_EQ(VirtualFilesystem::normalizePath("/home/user", "../other/./b"), "/home/other/b");
+    EXPECT_EQ(VirtualFilesystem::normalizePath("/home/user", "/abs//path/"), "/abs/path");
+    EXPECT_EQ(VirtualFilesystem::normalizePath("/home/user", "/a/../../.."), "/");
+    EXPECT_EQ(VirtualFilesystem::normalizePath("/home/user/", ""), "/home/user");
+    EXPECT_EQ(VirtualFilesystem::normalizePath("/", "."), "/");
+}
+
+TEST_F(VirtualFilesystemTest, PathResolutionPicksDeepestMount)
+{
+    auto& vfs = homeshell::VirtualFilesystem::getInstance();
+
+    auto outer = std::make_shared<homeshell::EncryptedMount>("outer", db_path_.string(),
+                                                             "/virtual", 10);
+    auto inner = std::make_shared<homeshell::EncryptedMount>(
+        "inner", (test_dir_ / "inner.db").string(), "/virtual/inner", 10);
+    vfs.addMount(outer);
+    vfs.addMount(inner);
+
+    auto resolved = vfs.resolvePath("/virtual/inner/dir/../file.txt");
+    EXPECT_EQ(resolved.type, homeshell::PathType::Virtual);
+    EXPECT_EQ(resolved.mount, inner.get());
+    EXPECT_EQ(resolved.mount_point, "/virtual/inner");
+    EXPECT_EQ(resolved.relative_path, "/file.txt");
+
+    resolved = vfs.resolvePath("/virtual/innerfile");
+    EXPECT_EQ(resolved.mount, outer.get());
+    EXPECT_EQ(resolved.relative_path, "/innerfile");
+
+    resolved = vfs.resolvePath("/virtual");
+    EXPECT_EQ(resolved.mount, outer.get());
+    EXPECT_EQ(resolved.relative_path, "/");
+
+    vfs.removeMount("inner");
+    EXPECT_EQ(vfs.resolvePath("/virtual/inner/file.txt").mount, outer.get());
+    EXPECT_EQ(vfs.resolvePath("/virtualx").type, homeshell::PathType::Real);
+}